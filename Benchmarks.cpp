@@ -0,0 +1,2285 @@
+//
+//  Benchmarks.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+#include "FrameBarrier.h"
+#include "FramePacing.h"
+#include "GLStateCache.h"
+#include "OpenGLProgramCache.h"
+#include "OpenGLUtilities.h"
+#include "PointGrid.h"
+#include "ProgramRegistry.h"
+#include "RenderLoop.h"
+#include "Scenarios.h"
+#include "SnapshotRing.h"
+#include "SpscRingBuffer.h"
+#include "StartupOrchestrator.h"
+#include "ThreadAffinity.h"
+#include "ThreadScheduling.h"
+#include "UniformRing.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Every allocation of the process is counted, for checking code does not
+// allocate.
+namespace {
+
+    std::atomic<uint64_t> num_allocations(0);
+
+} // unnamed namespace
+
+void*
+operator new(size_t size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* const pointer = malloc((size > 0) ? size : 1)) {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void
+operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Utilities
+    //------------------------------------------------------------------------------
+
+    typedef std::map<std::string, std::string> arguments_t;
+
+    //------------------------------------------------------------------------------
+    // Parse --name=value arguments, anything else is an error.
+    bool parse_arguments(int argc, char* argv[], int first, arguments_t& arguments)
+    {
+        for (int i = first; i < argc; ++i) {
+            const char* const equals = strchr(argv[i], '=');
+
+            if ((strncmp(argv[i], "--", 2) != 0) || (equals == nullptr)) {
+                std::cerr << "Error: Invalid argument: " << argv[i] << std::endl;
+                return false;
+            }
+
+            arguments[std::string((argv[i] + 2), size_t(equals - (argv[i] + 2)))] = (equals + 1);
+        }
+
+        return true;
+    }
+
+    int64_t get_argument(const arguments_t& arguments, const std::string& name, int64_t default_value)
+    {
+        const auto it = arguments.find(name);
+        return ((it != arguments.end()) ? atoll(it->second.c_str()) : default_value);
+    }
+
+    std::string get_argument(const arguments_t& arguments, const std::string& name, const std::string& default_value)
+    {
+        const auto it = arguments.find(name);
+        return ((it != arguments.end()) ? it->second : default_value);
+    }
+
+    //------------------------------------------------------------------------------
+    // Nearest-rank percentiles of the given values, which are reordered.
+    void print_distribution(std::ostream& stream, const std::string& label, std::vector<double>& values, const char* unit)
+    {
+        static const std::array<double, 5> PERCENTILES = { { 0.5, 0.9, 0.99, 0.999, 1.0 } };
+
+        stream << "  " << std::left << std::setw(24) << label << std::right << std::fixed << std::setprecision(1);
+
+        if (values.empty()) {
+            stream << " (no samples)" << std::endl;
+            return;
+        }
+
+        std::sort(begin(values), end(values));
+
+        for (const double p : PERCENTILES) {
+            const size_t rank = std::max<size_t>(1, size_t(std::ceil(p * double(values.size()))));
+            stream << std::setw(12) << values[std::min(rank, values.size()) - 1];
+        }
+
+        stream << "  " << unit << std::endl;
+    }
+
+    void print_distribution_header(std::ostream& stream)
+    {
+        stream << "  " << std::left << std::setw(24) << "" << std::right;
+        stream << std::setw(12) << "p50" << std::setw(12) << "p90" << std::setw(12) << "p99" << std::setw(12) << "p99.9" << std::setw(12) << "max" << std::endl;
+    }
+
+    //------------------------------------------------------------------------------
+    // Keep the given number of threads busy until destroyed, to measure under load.
+    class BackgroundLoad
+    {
+    public:
+
+        explicit BackgroundLoad(size_t num_threads)
+        {
+            for (size_t i = 0; i < num_threads; ++i) {
+                m_threads.emplace_back([this]() {
+                    volatile uint64_t x = 0;
+
+                    while (!m_stop.load(std::memory_order_relaxed)) {
+                        x = x + 1;
+                    }
+                });
+            }
+        }
+
+        ~BackgroundLoad()
+        {
+            m_stop = true;
+
+            for (auto& thread : m_threads) {
+                thread.join();
+            }
+        }
+
+    private:
+
+        std::atomic<bool>           m_stop { false };
+        std::vector<std::thread>    m_threads;
+    };
+
+    //------------------------------------------------------------------------------
+    // Wake accuracy
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Wake error of a plain sleep_until() versus the PrecisionWaiter at a fixed
+    // frame interval, optionally with background load.
+    int benchmark_wake(const arguments_t& arguments)
+    {
+        const int64_t iterations = get_argument(arguments, "iterations", 2000);
+        const int64_t interval_us = get_argument(arguments, "interval-us", 8333);
+        const int64_t load_threads = get_argument(arguments, "load-threads", 0);
+
+        std::cout << "Wake error, " << iterations << " waits at " << interval_us << " us intervals, "
+            << load_threads << " background load thread(s)" << std::endl << std::endl;
+
+        BackgroundLoad load(size_t(std::max<int64_t>(0, load_threads)));
+        toolbox::SteadyClock clock;
+
+        const auto run = [&](const std::function<toolbox::Clock::time_point(toolbox::Clock::time_point)>& wait_until) {
+            std::vector<double> errors_us;
+            errors_us.reserve(size_t(iterations));
+
+            toolbox::Clock::time_point deadline = (clock.now() + std::chrono::microseconds(interval_us));
+
+            for (int64_t i = 0; i < iterations; ++i) {
+                const toolbox::Clock::time_point woken = wait_until(deadline);
+                errors_us.push_back(std::chrono::duration<double, std::micro>(woken - deadline).count());
+                deadline += std::chrono::microseconds(interval_us);
+            }
+
+            return errors_us;
+        };
+
+        std::vector<double> sleep_errors_us = run([&clock](toolbox::Clock::time_point deadline) {
+            clock.sleep_until(deadline);
+            return clock.now();
+        });
+
+        toolbox::PrecisionWaiter waiter(clock);
+
+        std::vector<double> precision_errors_us = run([&waiter](toolbox::Clock::time_point deadline) {
+            return waiter.wait_until(deadline);
+        });
+
+        print_distribution_header(std::cout);
+        print_distribution(std::cout, "sleep_until", sleep_errors_us, "us");
+        print_distribution(std::cout, "PrecisionWaiter", precision_errors_us, "us");
+
+        const toolbox::WakeStatistics& sleep_statistics = waiter.sleep_statistics();
+
+        std::cout << std::endl << "PrecisionWaiter: final margin "
+            << std::chrono::duration<double, std::micro>(waiter.margin()).count() << " us, coarse sleep latency mean "
+            << (sleep_statistics.mean_ns() / 1000.0) << " us, stddev " << (sleep_statistics.standard_deviation_ns() / 1000.0) << " us, "
+            << waiter.wake_statistics().early_count() << " early wake(s)" << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // The free-run, fixed and hybrid pacers against a simulated clock, whose
+    // sleeps wake the given latency plus up to the jitter late, encoding frames of
+    // the given length. Checks every frame starts at its target (free-run right
+    // after the previous one), fixed wakes as late as the sleep and hybrid, once
+    // its margin adapted, within a relax step and never early.
+    int benchmark_pacing(const arguments_t& arguments)
+    {
+        typedef std::chrono::microseconds us;
+
+        const int64_t frames = std::max<int64_t>(1, get_argument(arguments, "frames", 600));
+        const int64_t latency_us = std::max<int64_t>(0, get_argument(arguments, "latency-us", 1000));
+        const int64_t jitter_us = std::max<int64_t>(0, get_argument(arguments, "jitter-us", 500));
+        const int64_t work_us = std::max<int64_t>(0, get_argument(arguments, "work-us", 4000));
+        const size_t num_frames = size_t(frames);
+
+        //------------------------------------------------------------------------------
+        // Frames the hybrid pacer's margin may take to adapt to the latency.
+        const size_t NUM_ADAPTING_FRAMES = 60;
+
+        std::cout << "Frame pacing, " << frames << " frames against a simulated clock, sleeps " << latency_us << " us + up to " << jitter_us
+            << " us late, " << work_us << " us per frame" << std::endl << std::endl;
+
+        toolbox::FramePacerConfig config;
+        const us relax_step(1);
+        const us latency(latency_us);
+        const us jitter(jitter_us);
+        bool is_valid = true;
+        double fixed_mean_ns = 0.0;
+        double hybrid_mean_ns = 0.0;
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  " << std::left << std::setw(12) << "" << std::right << std::setw(12) << "mean [us]" << std::setw(12) << "stddev"
+            << std::setw(12) << "min" << std::setw(12) << "max" << std::setw(8) << "early" << std::setw(10) << "sleeps" << std::setw(10) << "relaxes"
+            << std::setw(10) << "missed" << std::endl;
+
+        for (const std::string name : { "free-run", "fixed", "hybrid" }) {
+            toolbox::SimulatedClock clock(latency, jitter, relax_step);
+            const std::unique_ptr<toolbox::FramePacer> pacer = toolbox::create_frame_pacer(name, clock, config);
+
+            const toolbox::Clock::time_point start_time = clock.now();
+            const toolbox::Clock::time_point first_frame_time = (start_time + config.m_interval);
+            size_t num_missed = 0;
+
+            pacer->start(first_frame_time);
+
+            for (size_t i = 0; i < num_frames; ++i) {
+                pacer->wait();
+
+                //------------------------------------------------------------------------------
+                // When the frame should have started and how late it may be.
+                const toolbox::Clock::time_point woken = clock.now();
+                toolbox::Clock::time_point target = (first_frame_time + (config.m_interval * i));
+                toolbox::Clock::duration tolerance = relax_step;
+
+                if (name == "free-run") {
+                    target = (start_time + (us(work_us) * i));
+                    tolerance = toolbox::Clock::duration(0);
+                }
+                else if (name == "fixed") {
+                    target += latency;
+                    tolerance = jitter;
+                }
+                else if (i < NUM_ADAPTING_FRAMES) {
+                    tolerance = (latency + jitter + relax_step);
+                }
+
+                num_missed += (((woken < target) || (woken > (target + tolerance))) ? 1 : 0);
+                clock.advance(us(work_us));
+            }
+
+            const toolbox::WakeStatistics& statistics = pacer->wake_statistics();
+
+            std::cout << "  " << std::left << std::setw(12) << name << std::right << std::setw(12) << (statistics.mean_ns() / 1000.0)
+                << std::setw(12) << (statistics.standard_deviation_ns() / 1000.0) << std::setw(12) << (double(statistics.min_ns()) / 1000.0)
+                << std::setw(12) << (double(statistics.max_ns()) / 1000.0) << std::setw(8) << statistics.early_count() << std::setw(10) << clock.sleeps()
+                << std::setw(10) << clock.relaxes() << std::setw(10) << num_missed << std::endl;
+
+            is_valid &= ((num_missed == 0) && (statistics.early_count() == 0));
+
+            if (name == "free-run") {
+                is_valid &= ((statistics.count() == 0) && (clock.sleeps() == 0) && (clock.relaxes() == 0));
+            }
+            else if (name == "fixed") {
+                is_valid &= ((statistics.count() == num_frames) && (clock.sleeps() == num_frames) &&
+                    (statistics.min_ns() >= std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()) &&
+                    (statistics.max_ns() <= std::chrono::duration_cast<std::chrono::nanoseconds>(latency + jitter).count()));
+                fixed_mean_ns = statistics.mean_ns();
+            }
+            else {
+                is_valid &= ((statistics.count() == num_frames) && (clock.sleeps() <= num_frames));
+                hybrid_mean_ns = statistics.mean_ns();
+            }
+        }
+
+        if ((latency + jitter) > relax_step) {
+            is_valid &= (hybrid_mean_ns < fixed_mean_ns);
+        }
+
+        if (!is_valid) {
+            std::cerr << "Error: A pacer missed its frame targets or reported unexpected wake errors!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Frame barrier
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Round trip cost of the frame barrier for 2 to the maximum number of threads,
+    // spinning within the given budget and purely blocking. Checks no rendezvous
+    // timed out.
+    int benchmark_barrier(const arguments_t& arguments)
+    {
+        const int64_t iterations = std::max<int64_t>(1, get_argument(arguments, "iterations", 10000));
+        const int64_t max_threads = get_argument(arguments, "max-threads", 16);
+        const int64_t spin_budget_us = get_argument(arguments, "spin-budget-us", 100);
+
+        std::cout << "Frame barrier round trip, " << iterations << " rendezvous, "
+            << std::thread::hardware_concurrency() << " hardware thread(s)" << std::endl << std::endl;
+
+        std::cout << "  " << std::left << std::setw(10) << "threads" << std::setw(24) << "wait" << std::right
+            << std::setw(16) << "round trip" << std::setw(16) << "blocked" << std::endl;
+
+        const auto run = [iterations](size_t num_threads, std::chrono::nanoseconds spin_budget, const std::string& label) {
+            toolbox::FrameBarrier barrier(num_threads, spin_budget, std::chrono::seconds(10));
+            toolbox::FrameBarrier start_barrier(num_threads, std::chrono::nanoseconds(0), std::chrono::seconds(10));
+            std::vector<std::thread> threads;
+            std::atomic<bool> is_broken(false);
+            std::chrono::steady_clock::time_point start_time;
+
+            for (size_t i = 0; i < num_threads; ++i) {
+                threads.emplace_back([&, i]() {
+                    start_barrier.arrive_and_wait();
+
+                    if (i == 0) {
+                        start_time = std::chrono::steady_clock::now();
+                    }
+
+                    for (int64_t j = 0; j < iterations; ++j) {
+                        if (!barrier.arrive_and_wait()) {
+                            is_broken = true;
+                            break;
+                        }
+                    }
+                });
+            }
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            const double round_trip_us = (std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count() / double(iterations));
+            const double blocked = (100.0 * double(barrier.blocked_waits()) / double(iterations * int64_t(num_threads - 1)));
+
+            std::cout << "  " << std::left << std::setw(10) << num_threads << std::setw(24) << label << std::right << std::fixed << std::setprecision(2)
+                << std::setw(13) << round_trip_us << " us" << std::setw(15) << blocked << "%" << (is_broken ? "  (timed out)" : "") << std::endl;
+
+            return !is_broken;
+        };
+
+        bool is_valid = true;
+
+        for (size_t num_threads = 2; num_threads <= size_t(max_threads); num_threads *= 2) {
+            is_valid &= run(num_threads, std::chrono::microseconds(spin_budget_us), ("spin " + std::to_string(spin_budget_us) + " us"));
+            is_valid &= run(num_threads, std::chrono::nanoseconds(0), "block");
+        }
+
+        if (!is_valid) {
+            std::cerr << "Error: The barrier timed out, a thread never arrived!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Thread affinity
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Plan and apply the render thread placement for GPUs on the given NUMA nodes
+    // (-1 if unknown), then report which CPUs each pinned thread actually ran on.
+    int benchmark_affinity(const arguments_t& arguments)
+    {
+        toolbox::AffinityMode mode = toolbox::AffinityMode::core;
+        std::vector<int32_t> gpu_numa_nodes;
+
+        try {
+            mode = toolbox::affinity_mode_from_name(get_argument(arguments, "mode", std::string("core")));
+
+            std::istringstream nodes(get_argument(arguments, "gpu-nodes", std::string("-1,-1,-1,-1")));
+            std::string node;
+
+            while (std::getline(nodes, node, ',')) {
+                gpu_numa_nodes.push_back(int32_t(std::stoi(node)));
+            }
+        }
+        catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const std::vector<toolbox::LogicalCpu> cpus = toolbox::detect_cpu_topology();
+
+        std::cout << "Logical CPUs:";
+
+        for (const toolbox::LogicalCpu& cpu : cpus) {
+            std::cout << " " << cpu.m_index << "(core " << cpu.m_core << ", node " << cpu.m_numa_node << ")";
+        }
+
+        std::cout << std::endl << std::endl;
+
+        const toolbox::AffinityPlan plan = toolbox::plan_affinity(cpus, gpu_numa_nodes, mode);
+        toolbox::print_affinity_plan(std::cout, plan);
+
+        //------------------------------------------------------------------------------
+        // Apply to stand-in render threads and this (main) thread, spin a while and
+        // collect the CPUs seen.
+        std::mutex mutex;
+        std::vector<std::vector<uint32_t>> seen_cpus(gpu_numa_nodes.size() + 1);
+        std::vector<bool> is_applied(gpu_numa_nodes.size() + 1, false);
+
+        const auto sample = [&](size_t slot) {
+            std::vector<uint32_t> seen;
+            const auto end_time = (std::chrono::steady_clock::now() + std::chrono::milliseconds(200));
+
+            while (std::chrono::steady_clock::now() < end_time) {
+                const int32_t cpu = toolbox::current_cpu();
+
+                if ((cpu >= 0) && (std::find(begin(seen), end(seen), uint32_t(cpu)) == end(seen))) {
+                    seen.push_back(uint32_t(cpu));
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            seen_cpus[slot] = seen;
+        };
+
+        std::vector<std::thread> threads;
+
+        for (size_t i = 0; i < gpu_numa_nodes.size(); ++i) {
+            threads.emplace_back([&, i]() {
+                const bool applied = toolbox::set_current_thread_affinity(plan.m_render_threads[i]);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    is_applied[i] = applied;
+                }
+
+                sample(i);
+            });
+        }
+
+        is_applied.back() = toolbox::set_current_thread_affinity(plan.m_other_threads);
+        sample(gpu_numa_nodes.size());
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::cout << std::endl << "Observed:" << std::endl;
+
+        for (size_t i = 0; i < seen_cpus.size(); ++i) {
+            std::cout << "  " << ((i < gpu_numa_nodes.size()) ? ("Render thread " + std::to_string(i)) : std::string("Main thread"))
+                << ": CPU(s) " << toolbox::to_string(seen_cpus[i]) << (is_applied[i] ? "" : " (failed to set affinity)") << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Thread scheduling
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Wake error of the PrecisionWaiter and the context switches of the waiting
+    // thread at normal scheduling versus the given one, under background load.
+    int benchmark_scheduling(const arguments_t& arguments)
+    {
+        const int64_t iterations = get_argument(arguments, "iterations", 2000);
+        const int64_t interval_us = get_argument(arguments, "interval-us", 8333);
+        const int64_t load_threads = get_argument(arguments, "load-threads", int64_t(std::thread::hardware_concurrency()));
+        toolbox::SchedulingConfig config;
+
+        try {
+            config = toolbox::scheduling_config_from_string(get_argument(arguments, "policy", std::string("fifo:50")));
+        }
+        catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "Scheduling, " << iterations << " waits at " << interval_us << " us intervals, "
+            << load_threads << " background load thread(s)" << std::endl << std::endl;
+
+        BackgroundLoad load(size_t(std::max<int64_t>(0, load_threads)));
+        print_distribution_header(std::cout);
+
+        std::vector<std::string> reports;
+
+        for (const toolbox::SchedulingConfig& run_config : { toolbox::SchedulingConfig(), config }) {
+            std::vector<double> errors_us;
+            std::string report;
+
+            std::thread([&]() {
+                const toolbox::ScopedThreadScheduling scheduling(run_config);
+                toolbox::SteadyClock clock;
+                toolbox::PrecisionWaiter waiter(clock);
+
+                errors_us.reserve(size_t(iterations));
+                toolbox::Clock::time_point deadline = (clock.now() + std::chrono::microseconds(interval_us));
+
+                for (int64_t i = 0; i < iterations; ++i) {
+                    errors_us.push_back(std::chrono::duration<double, std::micro>(waiter.wait_until(deadline) - deadline).count());
+                    deadline += std::chrono::microseconds(interval_us);
+                }
+
+                report = (toolbox::to_string(run_config) + ": " + scheduling.report());
+            }).join();
+
+            print_distribution(std::cout, toolbox::to_string(run_config), errors_us, "us");
+            reports.push_back(report);
+        }
+
+        std::cout << std::endl;
+
+        for (const std::string& report : reports) {
+            std::cout << report << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Frame timing ring
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // A producer pushing as fast as it can into the ring of FrameTimingLog::Channel
+    // and a consumer draining it like the flusher, stalling every few batches as on
+    // a slow disk. Records are numbered by successful push, so the consumer must
+    // see every number once and in order, and every failed push must be counted as
+    // dropped.
+    int benchmark_spsc(const arguments_t& arguments)
+    {
+        const int64_t records = std::max<int64_t>(1, get_argument(arguments, "records", 10000000));
+        const int64_t stall_us = std::max<int64_t>(0, get_argument(arguments, "stall-us", 1000));
+        const int64_t stall_every = std::max<int64_t>(1, get_argument(arguments, "stall-every", 64));
+        const uint64_t num_records = uint64_t(records);
+
+        std::cout << "SPSC ring, " << records << " push(es) at full rate, the consumer stalling " << stall_us << " us every " << stall_every
+            << " batch(es)" << std::endl << std::endl;
+
+        typedef toolbox::SpscRingBuffer<toolbox::FrameTimingRecord, 4096> ring_t;
+
+        const std::unique_ptr<ring_t> ring(new ring_t());
+        std::atomic<bool> is_producing(true);
+        uint64_t num_pushed = 0;
+        uint64_t num_popped = 0;
+        uint64_t num_out_of_order = 0;
+        uint64_t num_corrupt = 0;
+        const auto start_time = std::chrono::steady_clock::now();
+
+        std::thread producer([&]() {
+            for (uint64_t i = 0; i < num_records; ++i) {
+                toolbox::FrameTimingRecord record = {};
+                record.m_frame_index = num_pushed;
+                record.m_frame_us = int64_t(num_pushed * 3);
+                record.m_swap_end_us = -int64_t(num_pushed);
+
+                if (ring->try_push(record)) {
+                    ++num_pushed;
+                }
+            }
+
+            is_producing.store(false, std::memory_order_release);
+        });
+
+        std::thread consumer([&]() {
+            toolbox::FrameTimingRecord batch[256];
+            uint64_t num_batches = 0;
+
+            for (;;) {
+                const bool was_producing = is_producing.load(std::memory_order_acquire);
+                const size_t count = ring->pop(batch, (sizeof(batch) / sizeof(batch[0])));
+
+                for (size_t i = 0; i < count; ++i) {
+                    const toolbox::FrameTimingRecord& record = batch[i];
+
+                    num_out_of_order += ((record.m_frame_index != num_popped) ? 1 : 0);
+                    num_corrupt += (((record.m_frame_us != int64_t(record.m_frame_index * 3)) || (record.m_swap_end_us != -int64_t(record.m_frame_index))) ? 1 : 0);
+                    num_popped = (record.m_frame_index + 1);
+                }
+
+                if ((count == 0) && !was_producing) {
+                    break;
+                }
+
+                if ((count > 0) && ((++num_batches % uint64_t(stall_every)) == 0)) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(stall_us));
+                }
+            }
+        });
+
+        producer.join();
+        consumer.join();
+
+        const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+        const uint64_t num_dropped = ring->dropped();
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  " << num_pushed << " pushed, " << num_popped << " popped, " << num_dropped << " dropped ("
+            << (100.0 * double(num_dropped) / double(num_records)) << "%), " << num_out_of_order << " out of order, " << num_corrupt << " corrupt" << std::endl;
+        std::cout << "  " << elapsed_ms << " ms, " << (1000000.0 * elapsed_ms / double(num_records)) << " ns per push" << std::endl;
+
+        if ((num_out_of_order > 0) || (num_corrupt > 0) || (num_popped != num_pushed) || (num_records != (num_popped + num_dropped))) {
+            std::cerr << "Error: The consumer did not get every pushed record once and in order!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Render loop
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Stand-ins for the render loop policies that do no work of their own, the
+    // fences keep the compiler from folding the calls away.
+    struct IdleEncoder
+    {
+        void encode(size_t) { std::atomic_signal_fence(std::memory_order_seq_cst); }
+    };
+
+    struct IdleSwap
+    {
+        void swap() { std::atomic_signal_fence(std::memory_order_seq_cst); }
+    };
+
+    //------------------------------------------------------------------------------
+    // Same ring as FrameTimingLog::Channel, drained in place of the flusher thread.
+    class RingChannel
+    {
+    public:
+
+        bool push(const toolbox::FrameTimingRecord& record)
+        {
+            const bool is_pushed = m_ring.try_push(record);
+
+            if ((++m_count % 1024) == 0) {
+                m_ring.pop(m_drained.data(), m_drained.size());
+            }
+
+            return is_pushed;
+        }
+
+    private:
+
+        toolbox::SpscRingBuffer<toolbox::FrameTimingRecord, 4096>   m_ring;
+        std::array<toolbox::FrameTimingRecord, 4096>                m_drained;
+        uint64_t                                                    m_count = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // The render loop as it was before it became a template, deciding per frame
+    // whether to take and log timings.
+    void run_runtime_flags_loop(size_t num_frames, bool log_to_console, bool log_to_file, toolbox::FramePacer& pacer, RingChannel& channel)
+    {
+        typedef std::chrono::microseconds us;
+
+        const auto start_time = std::chrono::steady_clock::now();
+        auto prev_frame_start_time = start_time;
+        toolbox::FrameTimingRecord timing_record = {};
+        IdleEncoder encoder;
+        IdleSwap swap;
+
+        pacer.start(start_time);
+
+        for (size_t frame_index = 0; frame_index < num_frames; ++frame_index) {
+            const auto frame_start_time = std::chrono::steady_clock::now();
+
+            if (log_to_console || log_to_file) {
+                timing_record.m_frame_index = frame_index;
+                timing_record.m_frame_us = std::chrono::duration_cast<us>(frame_start_time - prev_frame_start_time).count();
+                prev_frame_start_time = frame_start_time;
+            }
+
+            pacer.wait();
+
+            const auto encode_start_time = std::chrono::steady_clock::now();
+
+            if (log_to_console || log_to_file) {
+                timing_record.m_sync_us = std::chrono::duration_cast<us>(encode_start_time - frame_start_time).count();
+            }
+
+            encoder.encode(frame_index);
+
+            const auto swap_start_time = std::chrono::steady_clock::now();
+
+            if (log_to_console || log_to_file) {
+                timing_record.m_encode_us = std::chrono::duration_cast<us>(swap_start_time - encode_start_time).count();
+            }
+
+            swap.swap();
+
+            if (log_to_console || log_to_file) {
+                const auto now = std::chrono::steady_clock::now();
+
+                timing_record.m_swap_us = std::chrono::duration_cast<us>(now - swap_start_time).count();
+                timing_record.m_swap_end_us = std::chrono::duration_cast<us>(now - start_time).count();
+
+                if (log_to_console) {
+                    std::cout << "Frame: " << timing_record.m_frame_us << std::endl;
+                }
+
+                if (log_to_file && (frame_index > 60)) {
+                    channel.push(timing_record);
+                }
+            }
+        }
+    }
+
+    template <typename PacerT, typename TimingSinkT>
+    void run_specialized_loop(size_t num_frames, PacerT& pacer, TimingSinkT& timing_sink)
+    {
+        IdleEncoder encoder;
+        IdleSwap swap;
+        const auto start_time = std::chrono::steady_clock::now();
+
+        toolbox::run_render_loop<toolbox::SteadyClockPolicy>(num_frames, start_time, start_time, pacer, encoder, timing_sink, swap);
+    }
+
+    //------------------------------------------------------------------------------
+    // CPU overhead per frame of the render loop itself, with encoding and swapping
+    // doing nothing and a free running pacer, for the instantiations main.cpp
+    // selects from versus the loop branching on runtime flags.
+    int benchmark_loop(const arguments_t& arguments)
+    {
+        const int64_t frames = std::max<int64_t>(1, get_argument(arguments, "frames", 1000000));
+        const int64_t repetitions = std::max<int64_t>(1, get_argument(arguments, "repetitions", 15));
+
+        RingChannel channel;
+        toolbox::FreeRunPacer free_run_pacer;
+
+        // Read from the arguments so the compiler can not specialize the baseline.
+        const bool log_to_file = (get_argument(arguments, "timings", std::string("file")) == "file");
+
+        const std::vector<std::pair<std::string, std::function<void()>>> loops = {
+            { "runtime flags", [&]() {
+                run_runtime_flags_loop(size_t(frames), false, log_to_file, free_run_pacer, channel);
+            } },
+            { "free-run, no timings", [&]() {
+                toolbox::FreeRunPacing pacing;
+                toolbox::NullTimingSink timing_sink;
+                run_specialized_loop(size_t(frames), pacing, timing_sink);
+            } },
+            { "free-run, channel", [&]() {
+                toolbox::FreeRunPacing pacing;
+                toolbox::ChannelTimingSink<RingChannel> timing_sink(channel, 61);
+                run_specialized_loop(size_t(frames), pacing, timing_sink);
+            } },
+            { "dynamic, no timings", [&]() {
+                toolbox::DynamicPacing pacing(free_run_pacer);
+                toolbox::NullTimingSink timing_sink;
+                run_specialized_loop(size_t(frames), pacing, timing_sink);
+            } },
+            { "dynamic, channel", [&]() {
+                toolbox::DynamicPacing pacing(free_run_pacer);
+                toolbox::ChannelTimingSink<RingChannel> timing_sink(channel, 61);
+                run_specialized_loop(size_t(frames), pacing, timing_sink);
+            } },
+        };
+
+        std::cout << "Render loop, " << frames << " frames x " << repetitions << " repetitions, overhead per frame" << std::endl << std::endl;
+        print_distribution_header(std::cout);
+
+        for (const auto& loop : loops) {
+            std::vector<double> frame_ns;
+
+            for (int64_t i = 0; i < repetitions; ++i) {
+                const auto start_time = std::chrono::steady_clock::now();
+                loop.second();
+                frame_ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count() / double(frames));
+            }
+
+            print_distribution(std::cout, loop.first, frame_ns, "ns");
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Startup
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Startup of the application with its probes replaced by stubs sleeping for
+    // typical durations, once one after another and once as concurrent tasks with
+    // their dependencies. The given task throws instead to show what is skipped.
+    int benchmark_startup(const arguments_t& arguments)
+    {
+        struct probe_t {
+            const char*                 m_name;
+            int64_t                     m_duration_ms;
+            std::vector<std::string>    m_dependencies;
+        };
+
+        const double scale = std::max(0.0, atof(get_argument(arguments, "scale", std::string("1")).c_str()));
+        const std::string failing_probe = get_argument(arguments, "fail", std::string());
+
+        const std::vector<probe_t> probes = {
+            { "snapshot", 2, {} },
+            { "windows", 10, { "snapshot" } },
+            { "nvapi", 120, { "snapshot" } },
+            { "dxgi", 40, { "snapshot" } },
+            { "topology", 2, { "windows", "nvapi", "dxgi" } },
+            { "cuda", 150, {} },
+            { "opengl", 60, { "topology", "cuda" } },
+        };
+
+        for (const bool is_concurrent : { false, true }) {
+            toolbox::StartupOrchestrator startup;
+
+            for (size_t i = 0; i < probes.size(); ++i) {
+                std::vector<std::string> dependencies = probes[i].m_dependencies;
+
+                if (!is_concurrent && (i > 0)) {
+                    dependencies = { probes[i - 1].m_name };
+                }
+
+                const std::string name = probes[i].m_name;
+                const auto duration = std::chrono::microseconds(int64_t(double(probes[i].m_duration_ms) * scale * 1000.0));
+
+                startup.add_task(name, dependencies, [name, duration, &failing_probe]() {
+                    std::this_thread::sleep_for(duration);
+
+                    if (name == failing_probe) {
+                        throw std::runtime_error("stub failure");
+                    }
+                });
+            }
+
+            try {
+                startup.run();
+            }
+            catch (std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            startup.mark("first frame");
+
+            std::cout << (is_concurrent ? "Concurrent" : "Sequential") << ", time to first frame "
+                << std::fixed << std::setprecision(1) << startup.time_to("first frame").count() << " ms" << std::endl;
+            startup.print_timeline(std::cout);
+            std::cout << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Culling
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Splits the virtual screen into the given number of monitors side by side and
+    // culls the RenderPoints grid for each, once spanning the virtual screen and
+    // once rotated and tilted in perspective. Reports the share of the grid each
+    // monitor still draws, the cost of culling, and checks the ranges against
+    // transforming every point: none visible may be missed.
+    int benchmark_cull(const arguments_t& arguments)
+    {
+        const int64_t monitors = std::max<int64_t>(1, get_argument(arguments, "monitors", 4));
+        const int64_t iterations = std::max<int64_t>(1, get_argument(arguments, "iterations", 1000));
+        const float margin = (2.0f / 1920.0f);  // About a pixel.
+
+        const toolbox::PointGrid grid;
+        const float rect[4] = { -1.0f, -1.0f, 2.0f, 2.0f };
+
+        //------------------------------------------------------------------------------
+        // Rotated by 30 degrees about z, then tilted about x with w = 1 + 0.25 * y.
+        const float c = std::cos(0.5236f);
+        const float s = std::sin(0.5236f);
+        const float tilted_mvp[16] = {
+            (0.8f * c), (0.8f * s), 0.0f, (0.25f * 0.8f * s),
+            (-0.8f * s), (0.8f * c), 0.0f, (0.25f * 0.8f * c),
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f,
+        };
+
+        const float identity_mvp[16] = {
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f,
+        };
+
+        const std::vector<std::pair<std::string, const float*>> transforms = {
+            { "spanning", identity_mvp },
+            { "rotated, perspective", tilted_mvp },
+        };
+
+        size_t num_missed = 0;
+
+        for (const auto& transform : transforms) {
+            std::cout << "Grid of " << grid.num_points() << " points, " << transform.first << ", " << monitors << " monitor(s)" << std::endl << std::endl;
+            std::cout << "  " << std::left << std::setw(10) << "monitor" << std::right << std::setw(10) << "ranges" << std::setw(12) << "points"
+                << std::setw(10) << "share" << std::setw(14) << "cull [us]" << std::setw(10) << "extra" << std::setw(10) << "missed" << std::endl;
+
+            uint32_t total_points = 0;
+
+            for (int64_t monitor = 0; monitor < monitors; ++monitor) {
+                const float viewport[4] = {
+                    (-1.0f + ((2.0f * monitor) / monitors)), -1.0f,
+                    (-1.0f + ((2.0f * (monitor + 1)) / monitors)), 1.0f,
+                };
+
+                toolbox::PointGridRanges ranges;
+                const auto start_time = std::chrono::steady_clock::now();
+
+                for (int64_t i = 0; i < iterations; ++i) {
+                    toolbox::cull_point_grid(grid, rect, transform.second, viewport, margin, ranges);
+                }
+
+                const double cull_us = (std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count() / double(iterations));
+
+                //------------------------------------------------------------------------------
+                // Compare with the points found visible one by one.
+                std::vector<bool> is_drawn(grid.num_points(), false);
+
+                for (size_t i = 0; i < ranges.size(); ++i) {
+                    std::fill_n((is_drawn.begin() + ranges.m_firsts[i]), ranges.m_counts[i], true);
+                }
+
+                size_t num_extra = 0;
+                size_t num_monitor_missed = 0;
+
+                for (uint32_t index = 0; index < grid.num_points(); ++index) {
+                    const bool is_visible = toolbox::is_point_visible(grid, rect, transform.second, viewport, margin, index);
+                    num_extra += ((is_drawn[index] && !is_visible) ? 1 : 0);
+                    num_monitor_missed += ((!is_drawn[index] && is_visible) ? 1 : 0);
+                }
+
+                num_missed += num_monitor_missed;
+                total_points += ranges.num_points();
+
+                std::cout << "  " << std::left << std::setw(10) << monitor << std::right << std::setw(10) << ranges.size() << std::setw(12) << ranges.num_points()
+                    << std::fixed << std::setprecision(3) << std::setw(10) << (double(ranges.num_points()) / grid.num_points())
+                    << std::setprecision(1) << std::setw(14) << cull_us << std::setw(10) << num_extra << std::setw(10) << num_monitor_missed << std::endl;
+            }
+
+            std::cout << std::endl << "  Points drawn over all monitors: " << total_points << " instead of " << (uint64_t(grid.num_points()) * uint64_t(monitors)) << std::endl << std::endl;
+        }
+
+        if (num_missed > 0) {
+            std::cerr << "Error: Culling missed " << num_missed << " visible point(s)!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // GL state
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Makes the calls of the cache's interface straight to the API, as main.cpp did
+    // before the cache.
+    struct UncachedGLState
+    {
+        toolbox::CountingGLApi  m_api;
+
+        void use_program(uint32_t program) { m_api.use_program(program); }
+        void bind_vertex_array(uint32_t vertex_array) { m_api.bind_vertex_array(vertex_array); }
+        void enable_scissor_test(bool is_enabled) { m_api.enable_scissor_test(is_enabled); }
+        void enable_program_point_size(bool is_enabled) { m_api.enable_program_point_size(is_enabled); }
+        void scissor(int32_t x, int32_t y, int32_t width, int32_t height) { m_api.scissor(x, y, width, height); }
+        void clear_color(float r, float g, float b, float a) { m_api.clear_color(r, g, b, a); }
+        int32_t uniform_location(uint32_t program, toolbox::ShaderName name) { return m_api.get_uniform_location(program, name.name()); }
+        void uniform_4fv(int32_t location, const float* value) { m_api.uniform_4fv(location, value); }
+        void uniform_matrix_4fv(int32_t location, const float* value) { m_api.uniform_matrix_4fv(location, value); }
+        void bind_uniform_buffer_range(uint32_t index, uint32_t buffer, intptr_t offset, intptr_t size) { m_api.bind_uniform_buffer_range(index, buffer, offset, size); }
+    };
+
+    //------------------------------------------------------------------------------
+    // The state changes of main.cpp's encode_frame(), with the uniforms in a ring
+    // 3 frames deep of 256 byte aligned slots.
+    template <typename StateT>
+    void encode_state_changes(StateT& state, size_t frame_index, uint32_t workload)
+    {
+        static const int32_t BANDS[6][2] = { { 256, 256 }, { 512, 256 }, { 768, 256 }, { 64, 64 }, { 128, 64 }, { 192, 64 } };
+        static const float COLORS[7][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0, 0, 1 }, { 0, 1, 1 }, { 1, 0, 1 }, { 0.2f, 0.2f, 0.2f } };
+
+        if (workload & toolbox::WORKLOAD_CLEAR) {
+            state.enable_scissor_test(false);
+            state.clear_color(0.2f, 0.2f, 0.2f, 1.0f);
+        }
+
+        if (workload & toolbox::WORKLOAD_SCISSOR_CLEAR) {
+            const size_t band = std::min<size_t>((frame_index % 8), 6);
+
+            if (band < 6) {
+                state.enable_scissor_test(true);
+                state.scissor(0, BANDS[band][0], 2048, BANDS[band][1]);
+            }
+            else {
+                state.enable_scissor_test(false);
+            }
+
+            state.clear_color(COLORS[band][0], COLORS[band][1], COLORS[band][2], 1.0f);
+        }
+
+        if (workload & toolbox::WORKLOAD_POINTS) {
+            state.enable_scissor_test(false);
+            state.use_program(1);
+            state.bind_uniform_buffer_range(0, 1, intptr_t((frame_index % 3) * 256), intptr_t(sizeof(toolbox::PointGridUniforms)));
+            state.bind_vertex_array(1);
+            state.enable_program_point_size(true);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // State changes reaching the (counting) API per frame without and with the
+    // per-context cache, for the workloads of the render threads.
+    int benchmark_glstate(const arguments_t& arguments)
+    {
+        const int64_t frames = std::max<int64_t>(1, get_argument(arguments, "frames", 1000000));
+
+        const std::vector<std::pair<std::string, uint32_t>> workloads = {
+            { "scissor-clear", toolbox::WORKLOAD_SCISSOR_CLEAR },
+            { "points", toolbox::WORKLOAD_POINTS },
+            { "clear+points", (toolbox::WORKLOAD_CLEAR | toolbox::WORKLOAD_POINTS) },
+            { "scissor-clear+points", (toolbox::WORKLOAD_SCISSOR_CLEAR | toolbox::WORKLOAD_POINTS) },
+        };
+
+        std::cout << "GL state changes per frame, " << frames << " frames" << std::endl << std::endl;
+        std::cout << "  " << std::left << std::setw(24) << "workload" << std::right << std::setw(12) << "uncached" << std::setw(12) << "cached"
+            << std::setw(12) << "elided" << std::setw(16) << "cache [ns]" << std::endl;
+
+        for (const auto& entry : workloads) {
+            const std::string& name = entry.first;
+            const uint32_t workload = entry.second;
+
+            UncachedGLState uncached;
+
+            for (int64_t frame_index = 0; frame_index < frames; ++frame_index) {
+                encode_state_changes(uncached, size_t(frame_index), workload);
+            }
+
+            //------------------------------------------------------------------------------
+            // The cost of the cache itself, the calls it saves cost far more with a driver.
+            toolbox::GLStateCache<toolbox::CountingGLApi> cached;
+            const auto start_time = std::chrono::steady_clock::now();
+
+            for (int64_t frame_index = 0; frame_index < frames; ++frame_index) {
+                encode_state_changes(cached, size_t(frame_index), workload);
+            }
+
+            const double cached_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count() / double(frames));
+            const toolbox::GLStateCache<toolbox::CountingGLApi>::Statistics& statistics = cached.statistics();
+
+            std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(12) << (double(uncached.m_api.m_num_calls) / double(frames))
+                << std::setw(12) << (double(cached.api().m_num_calls) / double(frames))
+                << std::setw(11) << (100.0 * double(statistics.m_elided) / double(std::max<uint64_t>(statistics.m_calls, 1))) << "%"
+                << std::setprecision(1) << std::setw(16) << cached_ns << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Program registry
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Every context of a share group asking for the same programs at once, against
+    // a fake backend taking the given time to compile. Checks every program is
+    // compiled once, on the loader thread, every context gets the same name and a
+    // failing program fails for all of them.
+    int benchmark_programs(const arguments_t& arguments)
+    {
+        const int64_t contexts = std::max<int64_t>(1, get_argument(arguments, "contexts", 16));
+        const int64_t programs = std::max<int64_t>(1, get_argument(arguments, "programs", 4));
+        const int64_t compile_ms = std::max<int64_t>(0, get_argument(arguments, "compile-ms", 20));
+        const size_t num_contexts = size_t(contexts);
+        const size_t num_programs = size_t(programs);
+
+        std::cout << "Program registry, " << contexts << " context(s) requesting " << programs << " program(s) and 1 failing, "
+            << compile_ms << " ms per compile" << std::endl << std::endl;
+
+        toolbox::FakeProgramBackend::Counts counts;
+        std::vector<std::vector<uint32_t>> names(num_contexts, std::vector<uint32_t>(num_programs, 0));
+        std::vector<std::vector<uint32_t>> reflections(num_contexts, std::vector<uint32_t>(num_programs, 0));
+        std::atomic<uint64_t> num_failed(0);
+        toolbox::ProgramRegistry<toolbox::FakeProgramBackend>::Statistics statistics;
+        double elapsed_ms = 0.0;
+
+        {
+            toolbox::FakeProgramBackend backend;
+            backend.m_counts = &counts;
+            backend.m_compile_time = std::chrono::milliseconds(compile_ms);
+
+            toolbox::ProgramRegistry<toolbox::FakeProgramBackend> registry(backend);
+            std::vector<std::thread> threads;
+            const auto start_time = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < num_contexts; ++i) {
+                threads.emplace_back([&, i]() {
+                    for (size_t j = 0; j < num_programs; ++j) {
+                        registry.request(("program " + std::to_string(j)), ("vertex " + std::to_string(j)), "fragment");
+                    }
+
+                    registry.request("failing", "#error", "fragment");
+
+                    for (size_t j = 0; j < num_programs; ++j) {
+                        names[i][j] = registry.program("program " + std::to_string(j));
+                        reflections[i][j] = registry.reflection(i, ("program " + std::to_string(j)));
+                    }
+
+                    try {
+                        registry.program("failing");
+                    }
+                    catch (std::exception&) {
+                        ++num_failed;
+                    }
+                });
+            }
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+            statistics = registry.statistics();
+        }
+
+        bool is_valid = ((counts.m_compiles == num_programs) && (statistics.m_failures == 1) && (num_failed == num_contexts) &&
+            (counts.m_shaders_created == counts.m_shaders_deleted) && (counts.m_programs_deleted == num_programs) &&
+            (counts.m_reflections == (num_contexts * num_programs)) && (counts.m_off_loader_calls == 0));
+
+        for (size_t i = 0; i < num_contexts; ++i) {
+            is_valid &= ((names[i] == names[0]) && (reflections[i] == names[0]));
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  " << statistics.m_requests << " request(s), " << counts.m_compiles << " compile(s), " << statistics.m_failures << " failure(s), "
+            << counts.m_reflections << " reflection(s), " << counts.m_shaders_created << " shader(s) created, " << counts.m_shaders_deleted << " deleted, "
+            << counts.m_programs_deleted << " program(s) deleted, " << counts.m_off_loader_calls << " call(s) off the loader thread" << std::endl;
+        std::cout << "  " << elapsed_ms << " ms till every context had every program, "
+            << double(contexts * (programs + 1) * compile_ms) << " ms compiling per context one after another" << std::endl;
+
+        if (!is_valid) {
+            std::cerr << "Error: The contexts did not share exactly one compile of every program!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Program locations
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Creating programs with the given number of attributes, half of them bound,
+    // and 2 fragment outputs against a fake OpenGL, so only the bookkeeping is
+    // measured: the location lists of strings against the bindings and locations
+    // in storage on the stack. Checks both report the same locations and the
+    // latter does not allocate.
+    int benchmark_locations(const arguments_t& arguments)
+    {
+        static const size_t MAX_ATTRIBUTES = 32;
+        static const char* const FRAG_OUTPUTS[] = { "f_color", "f_normal_and_depth" };
+
+        const int64_t iterations = std::max<int64_t>(1, get_argument(arguments, "iterations", 100000));
+        const int64_t attributes = std::min<int64_t>(std::max<int64_t>(1, get_argument(arguments, "attributes", 8)), MAX_ATTRIBUTES);
+        const size_t num_attributes = size_t(attributes);
+
+        std::cout << "Program locations, " << iterations << " program(s) of " << attributes << " attribute(s) and 2 fragment outputs against a fake OpenGL" << std::endl << std::endl;
+
+        //------------------------------------------------------------------------------
+        // Names too long for the small string optimization, as most are.
+        std::vector<std::string> attribute_names;
+        std::vector<const char*> attribute_name_pointers;
+
+        for (size_t i = 0; i < num_attributes; ++i) {
+            attribute_names.push_back("a_vertex_attribute_" + std::to_string(i));
+        }
+
+        for (const std::string& name : attribute_names) {
+            attribute_name_pointers.push_back(name.c_str());
+        }
+
+        toolbox::set_fake_opengl_program(attribute_name_pointers.data(), num_attributes, FRAG_OUTPUTS, 2);
+
+        const auto bound_location = [num_attributes](size_t i) { return (((i % 2) == 0) ? GLint(num_attributes - 1 - i) : -1); };
+
+        //------------------------------------------------------------------------------
+        // The lists are in and out, so every program starts from a new pair.
+        toolbox::OpenGLProgram::attribute_location_list_t attribute_locations;
+        toolbox::OpenGLProgram::frag_data_location_list_t frag_data_locations;
+
+        const uint64_t list_start_allocations = num_allocations.load();
+        const auto list_start_time = std::chrono::steady_clock::now();
+
+        for (int64_t i = 0; i < iterations; ++i) {
+            attribute_locations.clear();
+            frag_data_locations.clear();
+
+            for (size_t j = 0; j < num_attributes; ++j) {
+                attribute_locations.emplace_back(bound_location(j), attribute_names[j]);
+            }
+
+            frag_data_locations.emplace_back(0, 0, FRAG_OUTPUTS[0]);
+            frag_data_locations.emplace_back(1, 0, FRAG_OUTPUTS[1]);
+
+            toolbox::OpenGLProgram::create_from_shaders(1, 2, attribute_locations, frag_data_locations);
+        }
+
+        const double list_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - list_start_time).count() / double(iterations));
+        const double list_allocations = (double(num_allocations.load() - list_start_allocations) / double(iterations));
+
+        //------------------------------------------------------------------------------
+        // The bindings are set up once, like a table of permutations would be.
+        std::vector<toolbox::AttributeBinding> attribute_bindings;
+        const toolbox::FragDataBinding frag_data_bindings[] = { { 0, 0, FRAG_OUTPUTS[0] }, { 1, 0, FRAG_OUTPUTS[1] } };
+
+        for (size_t j = 0; j < num_attributes; ++j) {
+            attribute_bindings.push_back({ bound_location(j), attribute_name_pointers[j] });
+        }
+
+        toolbox::ProgramLocations::Attribute attribute_storage[MAX_ATTRIBUTES];
+        toolbox::ProgramLocations::FragData frag_data_storage[4];
+        char name_storage[2048];
+        toolbox::ProgramLocations locations(attribute_storage, frag_data_storage, name_storage);
+
+        const uint64_t binding_start_allocations = num_allocations.load();
+        const auto binding_start_time = std::chrono::steady_clock::now();
+
+        for (int64_t i = 0; i < iterations; ++i) {
+            toolbox::OpenGLProgram::create_from_shaders(1, 2, attribute_bindings.data(), attribute_bindings.size(), frag_data_bindings, 2, locations);
+        }
+
+        const double binding_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - binding_start_time).count() / double(iterations));
+        const uint64_t binding_allocations = (num_allocations.load() - binding_start_allocations);
+
+        //------------------------------------------------------------------------------
+        // Both must agree on the last program.
+        bool is_valid = (!locations.is_truncated() && (binding_allocations == 0) &&
+            (locations.num_attributes() == attribute_locations.size()) && (locations.num_frag_data() == frag_data_locations.size()));
+
+        for (size_t i = 0; is_valid && (i < locations.num_attributes()); ++i) {
+            is_valid &= ((locations.attributes()[i].m_location == std::get<0>(attribute_locations[i])) &&
+                (strcmp(locations.attributes()[i].m_name, std::get<1>(attribute_locations[i]).c_str()) == 0));
+        }
+
+        for (size_t i = 0; is_valid && (i < locations.num_frag_data()); ++i) {
+            is_valid &= ((locations.frag_data()[i].m_location == std::get<0>(frag_data_locations[i])) &&
+                (locations.frag_data()[i].m_index == std::get<1>(frag_data_locations[i])) &&
+                (strcmp(locations.frag_data()[i].m_name, std::get<2>(frag_data_locations[i]).c_str()) == 0));
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  " << std::left << std::setw(24) << "location lists" << std::right << std::setw(12) << list_ns << " ns" << std::setw(12) << list_allocations << " allocation(s) per program" << std::endl;
+        std::cout << "  " << std::left << std::setw(24) << "bindings" << std::right << std::setw(12) << binding_ns << " ns" << std::setw(12) << (double(binding_allocations) / double(iterations)) << " allocation(s) per program" << std::endl;
+
+        if (!is_valid) {
+            std::cerr << "Error: The bindings reported other locations than the lists, or allocated!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Program reflection
+    //------------------------------------------------------------------------------
+
+    constexpr toolbox::ShaderName POINT_GRID_UNIFORM_BLOCK(toolbox::POINT_GRID_UNIFORM_BLOCK);
+
+    //------------------------------------------------------------------------------
+    // The OpenGL calls asking about a program, and the time, to create it through
+    // the program cache on a miss, on a hit of a reopened cache (as in the next
+    // run) and to reflect it without the cache. Then the cost of looking up a
+    // uniform of the reflection by comparing strings, by a name hashed per lookup
+    // and by a constexpr handle. Checks hits make no introspection calls and
+    // return what the miss reflected.
+    int benchmark_reflection(const arguments_t& arguments)
+    {
+        static const char CACHE_DIRECTORY[] = "Benchmarks.ProgramCache";
+        static const char* const ATTRIBUTES[] = { "a_position", "a_normal", "a_uv", "a_color" };
+        static const char* const FRAG_OUTPUTS[] = { "f_color" };
+        static const char* const UNIFORM_BLOCKS[] = { toolbox::POINT_GRID_UNIFORM_BLOCK, "LightingFrame" };
+        static const size_t MAX_UNIFORMS = 60;
+        static const size_t LOOKUPS_PER_ITERATION = 64;
+
+        const int64_t iterations = std::max<int64_t>(1, get_argument(arguments, "iterations", 10000));
+        const int64_t uniforms = std::min<int64_t>(std::max<int64_t>(1, get_argument(arguments, "uniforms", 16)), MAX_UNIFORMS);
+        const size_t num_uniforms = size_t(uniforms);
+
+        std::cout << "Program reflection, " << iterations << " program(s) of 4 attributes, " << uniforms << " uniform(s) and 2 uniform blocks against a fake OpenGL" << std::endl << std::endl;
+
+        std::vector<std::string> uniform_names;
+        std::vector<const char*> uniform_name_pointers;
+
+        for (size_t i = 0; i < num_uniforms; ++i) {
+            uniform_names.push_back("u_material_parameter_" + std::to_string(i));
+        }
+
+        for (const std::string& name : uniform_names) {
+            uniform_name_pointers.push_back(name.c_str());
+        }
+
+        toolbox::set_fake_opengl_program(ATTRIBUTES, 4, FRAG_OUTPUTS, 1);
+        toolbox::set_fake_opengl_uniforms(uniform_name_pointers.data(), num_uniforms, UNIFORM_BLOCKS, 2);
+
+        //------------------------------------------------------------------------------
+        // Start from an empty cache, a previous run would turn the miss into a hit.
+        remove((std::string(CACHE_DIRECTORY) + "/index.bin").c_str());
+        remove((std::string(CACHE_DIRECTORY) + "/blobs.bin").c_str());
+
+        const auto create = [](toolbox::OpenGLProgramCache& cache, toolbox::ProgramReflection& reflection) {
+            toolbox::OpenGLProgram::attribute_location_list_t attribute_locations;
+            toolbox::OpenGLProgram::frag_data_location_list_t frag_data_locations;
+            frag_data_locations.emplace_back(0, 0, FRAG_OUTPUTS[0]);
+            cache.create_from_sources("vertex", "fragment", attribute_locations, frag_data_locations, &reflection);
+            return std::make_pair(attribute_locations, frag_data_locations);
+        };
+
+        toolbox::ProgramReflection miss_reflection;
+        std::string miss_data;
+        uint64_t miss_calls = 0;
+        uint64_t miss_introspection_calls = 0;
+        double miss_ns = 0.0;
+
+        {
+            toolbox::OpenGLProgramCache cache(CACHE_DIRECTORY);
+            toolbox::set_fake_opengl_program(ATTRIBUTES, 4, FRAG_OUTPUTS, 1);
+
+            const auto start_time = std::chrono::steady_clock::now();
+            create(cache, miss_reflection);
+            miss_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+
+            miss_calls = toolbox::fake_opengl_calls();
+            miss_introspection_calls = toolbox::fake_opengl_introspection_calls();
+            miss_reflection.serialize(miss_data);
+        }
+
+        //------------------------------------------------------------------------------
+        // Every hit must match the miss, the last is compared.
+        toolbox::OpenGLProgramCache cache(CACHE_DIRECTORY);
+        toolbox::ProgramReflection hit_reflection;
+        toolbox::set_fake_opengl_program(ATTRIBUTES, 4, FRAG_OUTPUTS, 1);
+
+        const auto hit_start_time = std::chrono::steady_clock::now();
+        std::pair<toolbox::OpenGLProgram::attribute_location_list_t, toolbox::OpenGLProgram::frag_data_location_list_t> hit_locations;
+
+        for (int64_t i = 0; i < iterations; ++i) {
+            hit_locations = create(cache, hit_reflection);
+        }
+
+        const double hit_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - hit_start_time).count() / double(iterations));
+        const double hit_calls = (double(toolbox::fake_opengl_calls()) / double(iterations));
+        const uint64_t hit_introspection_calls = toolbox::fake_opengl_introspection_calls();
+
+        std::string hit_data;
+        hit_reflection.serialize(hit_data);
+
+        //------------------------------------------------------------------------------
+        // What every context would do without the reflection in the cache.
+        toolbox::OpenGLProgram::frag_data_location_list_t frag_data_names;
+        frag_data_names.emplace_back(0, 0, FRAG_OUTPUTS[0]);
+        toolbox::ProgramReflection reflection;
+        toolbox::set_fake_opengl_program(ATTRIBUTES, 4, FRAG_OUTPUTS, 1);
+
+        const auto reflect_start_time = std::chrono::steady_clock::now();
+
+        for (int64_t i = 0; i < iterations; ++i) {
+            toolbox::OpenGLProgram::reflect(1, frag_data_names, reflection);
+        }
+
+        const double reflect_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - reflect_start_time).count() / double(iterations));
+        const double reflect_calls = (double(toolbox::fake_opengl_calls()) / double(iterations));
+        const double reflect_introspection_calls = (double(toolbox::fake_opengl_introspection_calls()) / double(iterations));
+
+        const toolbox::OpenGLProgramCache::statistics_t statistics = cache.statistics();
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  " << std::left << std::setw(24) << "" << std::right << std::setw(12) << "ns" << std::setw(12) << "GL calls" << std::setw(16) << "introspection" << std::endl;
+        std::cout << "  " << std::left << std::setw(24) << "cache miss" << std::right << std::setw(12) << miss_ns << std::setw(12) << miss_calls << std::setw(16) << miss_introspection_calls << std::endl;
+        std::cout << "  " << std::left << std::setw(24) << "cache hit" << std::right << std::setw(12) << hit_ns << std::setw(12) << hit_calls << std::setw(16) << (double(hit_introspection_calls) / double(iterations)) << std::endl;
+        std::cout << "  " << std::left << std::setw(24) << "reflect" << std::right << std::setw(12) << reflect_ns << std::setw(12) << reflect_calls << std::setw(16) << reflect_introspection_calls << std::endl;
+        std::cout << std::endl << "  Reflection stored with the binary: " << miss_data.size() << " bytes" << std::endl << std::endl;
+
+        //------------------------------------------------------------------------------
+        // Each lookup goes for the next uniform, the last always for the block.
+        const toolbox::ShaderName handles[] = { "u_material_parameter_0", "u_material_parameter_1", "u_material_parameter_2", "u_material_parameter_3" };
+        const int64_t lookups = (iterations * int64_t(LOOKUPS_PER_ITERATION));
+        int64_t string_sum = 0;
+        int64_t runtime_sum = 0;
+        int64_t handle_sum = 0;
+
+        const auto string_start_time = std::chrono::steady_clock::now();
+
+        for (int64_t i = 0; i < lookups; ++i) {
+            const char* const name = uniform_name_pointers[size_t(i) % std::min<size_t>(num_uniforms, 4)];
+
+            for (const toolbox::ProgramReflection::Uniform& uniform : hit_reflection.uniforms()) {
+                if (uniform.m_name == name) {
+                    string_sum += uniform.m_location;
+                    break;
+                }
+            }
+        }
+
+        const double string_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - string_start_time).count() / double(lookups));
+        const auto runtime_start_time = std::chrono::steady_clock::now();
+
+        for (int64_t i = 0; i < lookups; ++i) {
+            runtime_sum += hit_reflection.uniform_location(uniform_name_pointers[size_t(i) % std::min<size_t>(num_uniforms, 4)]);
+        }
+
+        const double runtime_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - runtime_start_time).count() / double(lookups));
+        const auto handle_start_time = std::chrono::steady_clock::now();
+
+        for (int64_t i = 0; i < lookups; ++i) {
+            handle_sum += hit_reflection.uniform_location(handles[size_t(i) % std::min<size_t>(num_uniforms, 4)]);
+        }
+
+        const double handle_ns = (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - handle_start_time).count() / double(lookups));
+
+        std::cout << std::setprecision(2);
+        std::cout << "  " << std::left << std::setw(24) << "lookup by string" << std::right << std::setw(12) << string_ns << " ns" << std::endl;
+        std::cout << "  " << std::left << std::setw(24) << "lookup hashing the name" << std::right << std::setw(12) << runtime_ns << " ns" << std::endl;
+        std::cout << "  " << std::left << std::setw(24) << "lookup by handle" << std::right << std::setw(12) << handle_ns << " ns" << std::endl << std::endl;
+
+        //------------------------------------------------------------------------------
+        // The fake assigns the uniforms locations in order, the attributes too.
+        const toolbox::ProgramReflection::UniformBlock* const block = hit_reflection.find_uniform_block(POINT_GRID_UNIFORM_BLOCK);
+        bool is_valid = ((miss_data == hit_data) && (hit_introspection_calls == 0) && (statistics.hits == size_t(iterations)) && (statistics.reflections == 0) &&
+            (hit_reflection.uniforms().size() == num_uniforms) && (hit_reflection.attributes().size() == 4) && (hit_reflection.frag_outputs().size() == 1) &&
+            block && (block->m_index == 0) && (hit_reflection.uniform_block_index("LightingFrame") == 1) &&
+            (hit_reflection.uniform_location("u_material_parameter_missing") == -1) &&
+            (string_sum == runtime_sum) && (runtime_sum == handle_sum));
+
+        for (size_t i = 0; is_valid && (i < num_uniforms); ++i) {
+            is_valid &= (hit_reflection.uniform_location(uniform_name_pointers[i]) == int32_t(i));
+        }
+
+        is_valid &= ((hit_locations.first.size() == 4) && (hit_locations.second.size() == 1));
+
+        for (size_t i = 0; is_valid && (i < hit_locations.first.size()); ++i) {
+            const toolbox::ProgramReflection::Attribute* const attribute = hit_reflection.find_attribute(std::get<1>(hit_locations.first[i]).c_str());
+            is_valid &= (attribute && (attribute->m_location == std::get<0>(hit_locations.first[i])));
+        }
+
+        if (!is_valid) {
+            std::cerr << "Error: A cache hit introspected the program or returned another reflection than the miss!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Program cache
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Two programs stored in a fresh program cache, against a fake OpenGL, then
+    // looked up after reopening it, with another driver version, with the driver
+    // rejecting the binaries and, last, reopened with room for 2 binaries. Checks
+    // the hits, misses, invalidations and stores of every step, and the superseded
+    // and least recently stored binaries are dropped from the files.
+    int benchmark_cache(const arguments_t&)
+    {
+        static const char CACHE_DIRECTORY[] = "Benchmarks.ProgramCache.Check";
+        static const char* const ATTRIBUTES[] = { "a_position" };
+        static const char* const FRAG_OUTPUTS[] = { "f_color" };
+
+        typedef toolbox::OpenGLProgramCache::statistics_t statistics_t;
+
+        std::cout << "Program cache, 2 programs stored, looked up after reopening, with another driver, with binaries rejected and compacted, against a fake OpenGL" << std::endl << std::endl;
+
+        const std::string index_path = (std::string(CACHE_DIRECTORY) + "/index.bin");
+        const std::string blob_path = (std::string(CACHE_DIRECTORY) + "/blobs.bin");
+        remove(index_path.c_str());
+        remove(blob_path.c_str());
+
+        const auto file_size = [](const std::string& path) {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            return (file ? int64_t(file.tellg()) : int64_t(-1));
+        };
+
+        const auto create = [](toolbox::OpenGLProgramCache& cache, const char* vertex_shader_source) {
+            toolbox::OpenGLProgram::attribute_location_list_t attribute_locations;
+            toolbox::OpenGLProgram::frag_data_location_list_t frag_data_locations;
+            frag_data_locations.emplace_back(0, 0, FRAG_OUTPUTS[0]);
+            toolbox::set_fake_opengl_program(ATTRIBUTES, 1, FRAG_OUTPUTS, 1);
+            cache.create_from_sources(vertex_shader_source, "fragment", attribute_locations, frag_data_locations);
+        };
+
+        const auto print = [](const char* step, const statistics_t& statistics) {
+            std::cout << "  " << std::left << std::setw(28) << step << std::right << std::setw(6) << statistics.hits << std::setw(8) << statistics.misses
+                      << std::setw(15) << statistics.invalidations << std::setw(8) << statistics.stores << std::setw(13) << statistics.compactions
+                      << std::setw(11) << statistics.evictions << std::endl;
+        };
+
+        const auto matches = [](const statistics_t& statistics, size_t hits, size_t misses, size_t invalidations, size_t stores, size_t compactions, size_t evictions) {
+            return ((statistics.hits == hits) && (statistics.misses == misses) && (statistics.invalidations == invalidations) && (statistics.stores == stores) &&
+                    (statistics.compactions == compactions) && (statistics.evictions == evictions));
+        };
+
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right << std::setw(6) << "hits" << std::setw(8) << "misses"
+                  << std::setw(15) << "invalidations" << std::setw(8) << "stores" << std::setw(13) << "compactions" << std::setw(11) << "evictions" << std::endl;
+
+        bool is_valid = true;
+        int64_t entry_size = 0;
+
+        {
+            toolbox::OpenGLProgramCache cache(CACHE_DIRECTORY);
+            create(cache, "vertex 1");
+            create(cache, "vertex 2");
+            print("stored", cache.statistics());
+            is_valid &= matches(cache.statistics(), 0, 2, 0, 2, 0, 0);
+        }
+
+        entry_size = (std::max<int64_t>(0, file_size(blob_path)) / 2);
+        is_valid &= (entry_size > 0);
+
+        {
+            toolbox::OpenGLProgramCache cache(CACHE_DIRECTORY);
+            create(cache, "vertex 1");
+            print("reopened", cache.statistics());
+            is_valid &= matches(cache.statistics(), 1, 0, 0, 0, 0, 0);
+        }
+
+        //------------------------------------------------------------------------------
+        // Another driver version gets programs of its own, the old ones are kept.
+        {
+            toolbox::set_fake_opengl_driver("Fake", "Fake", "Fake 2");
+            toolbox::OpenGLProgramCache cache(CACHE_DIRECTORY);
+            create(cache, "vertex 1");
+            print("another driver version", cache.statistics());
+            is_valid &= matches(cache.statistics(), 0, 1, 0, 1, 0, 0);
+            toolbox::set_fake_opengl_driver("Fake", "Fake", "Fake");
+        }
+
+        //------------------------------------------------------------------------------
+        // A rejected binary is recompiled and stored again, superseding the old one.
+        {
+            toolbox::set_fake_opengl_rejects_binaries(true);
+            toolbox::OpenGLProgramCache cache(CACHE_DIRECTORY);
+            create(cache, "vertex 2");
+            toolbox::set_fake_opengl_rejects_binaries(false);
+            create(cache, "vertex 2");
+            print("binary rejected", cache.statistics());
+            is_valid &= matches(cache.statistics(), 1, 1, 1, 1, 0, 0);
+        }
+
+        is_valid &= (file_size(blob_path) == (4 * entry_size));
+
+        //------------------------------------------------------------------------------
+        // Of the 3 binaries still needed the one of program 1 stored first is dropped,
+        // the superseded one of program 2 too.
+        {
+            toolbox::OpenGLProgramCache cache(CACHE_DIRECTORY, uint64_t(2 * entry_size));
+            is_valid &= (file_size(blob_path) == (2 * entry_size));
+            create(cache, "vertex 2");
+            create(cache, "vertex 1");
+            print("compacted to 2 binaries", cache.statistics());
+            is_valid &= matches(cache.statistics(), 1, 1, 0, 1, 1, 1);
+        }
+
+        std::cout << std::endl << "  Binary and reflection: " << entry_size << " bytes" << std::endl << std::endl;
+
+        if (!is_valid) {
+            std::cerr << "Error: The program cache missed, invalidated, stored or dropped other binaries than expected!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Shader variants
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // A matrix of 2 grids, every shading, with and without points and 1 or 4
+    // threads, its variants compiled up front in the given number of share groups
+    // at once, against a fake backend taking the given time to compile. Checks
+    // only the variants the matrix draws are compiled, each once per group, and
+    // their sources carry the defines of their features.
+    int benchmark_variants(const arguments_t& arguments)
+    {
+        const int64_t groups = std::max<int64_t>(1, get_argument(arguments, "groups", 4));
+        const int64_t compile_ms = std::max<int64_t>(0, get_argument(arguments, "compile-ms", 20));
+        const size_t num_groups = size_t(groups);
+
+        constexpr toolbox::PointShaderKey DEFAULT_KEY = toolbox::point_shader_key(toolbox::StaticPointGrid<1024, 1024>::grid());
+        static_assert((DEFAULT_KEY.m_features == (toolbox::POINT_FEATURE_UV_COLOR | toolbox::POINT_FEATURE_VIGNETTE)), "Unexpected features of the default grid!");
+
+        const toolbox::PointGrid grids[] = { toolbox::StaticPointGrid<1024, 1024>::grid(), toolbox::StaticPointGrid<2048, 2048, 2>::grid() };
+        const toolbox::PointShading shadings[] = { toolbox::PointShading::flat, toolbox::PointShading::uv, toolbox::PointShading::vignette };
+        const uint32_t workloads[] = { toolbox::WORKLOAD_SCISSOR_CLEAR, (toolbox::WORKLOAD_SCISSOR_CLEAR | toolbox::WORKLOAD_POINTS) };
+        const size_t threads[] = { 1, 4 };
+        std::vector<toolbox::Scenario> scenarios;
+
+        for (const toolbox::PointGrid& grid : grids) {
+            for (toolbox::PointShading shading : shadings) {
+                for (uint32_t workload : workloads) {
+                    for (size_t num_threads : threads) {
+                        toolbox::Scenario scenario;
+                        scenario.m_workload = workload;
+                        scenario.m_point_grid = grid;
+                        scenario.m_point_grid.m_shading = shading;
+                        scenario.m_num_threads = num_threads;
+                        scenarios.push_back(scenario);
+                    }
+                }
+            }
+        }
+
+        const std::vector<toolbox::PointShaderKey> keys = toolbox::point_shader_keys(scenarios);
+        const size_t num_points_scenarios = size_t(std::count_if(scenarios.begin(), scenarios.end(), [](const toolbox::Scenario& scenario) {
+            return ((scenario.m_workload & toolbox::WORKLOAD_POINTS) != 0);
+        }));
+
+        //------------------------------------------------------------------------------
+        // Every combination of the features is a variant, of every grid.
+        const size_t num_possible_keys = ((sizeof(grids) / sizeof(grids[0])) * (size_t(toolbox::POINT_FEATURE_VIGNETTE) << 1));
+
+        std::cout << "Shader variants, " << scenarios.size() << " scenario(s), " << num_points_scenarios << " drawing points, "
+            << keys.size() << " variant(s) of " << num_possible_keys << " possible, compiled in " << groups << " share group(s), "
+            << compile_ms << " ms per compile" << std::endl << std::endl;
+
+        bool is_valid = (keys.size() == ((sizeof(grids) / sizeof(grids[0])) * (sizeof(shadings) / sizeof(shadings[0]))));
+        std::map<std::string, toolbox::PointShaderKey> names;
+
+        for (const toolbox::PointShaderKey& key : keys) {
+            const std::string vertex_shader = toolbox::point_vertex_shader(key);
+            const std::string fragment_shader = toolbox::point_fragment_shader(key);
+            const bool has_uv_color = (fragment_shader.find("#define POINT_UV_COLOR") != std::string::npos);
+            const bool has_vignette = (fragment_shader.find("#define POINT_VIGNETTE ") != std::string::npos);
+
+            is_valid &= (names.emplace(toolbox::point_shader_key_to_string(key), key).second &&
+                (vertex_shader.find("#define POINT_GRID_COLUMNS " + std::to_string(key.m_columns)) != std::string::npos) &&
+                (has_uv_color == ((key.m_features & toolbox::POINT_FEATURE_UV_COLOR) != 0)) &&
+                (has_vignette == ((key.m_features & toolbox::POINT_FEATURE_VIGNETTE) != 0)));
+        }
+
+        typedef toolbox::ProgramRegistry<toolbox::FakeProgramBackend> registry_t;
+
+        toolbox::FakeProgramBackend::Counts counts;
+        std::vector<std::vector<registry_t::ProgramStatistics>> statistics(num_groups);
+        double elapsed_ms = 0.0;
+
+        {
+            toolbox::FakeProgramBackend backend;
+            backend.m_counts = &counts;
+            backend.m_compile_time = std::chrono::milliseconds(compile_ms);
+
+            std::vector<std::unique_ptr<registry_t>> registries;
+
+            for (size_t i = 0; i < num_groups; ++i) {
+                registries.emplace_back(new registry_t(backend));
+            }
+
+            //------------------------------------------------------------------------------
+            // As RenderPoints::precompile_programs(): every group's loader is given
+            // all of them before waiting for any.
+            const auto start_time = std::chrono::steady_clock::now();
+
+            for (const std::unique_ptr<registry_t>& registry : registries) {
+                for (const toolbox::PointShaderKey& key : keys) {
+                    registry->request(toolbox::point_shader_key_to_string(key), toolbox::point_vertex_shader(key), toolbox::point_fragment_shader(key));
+                }
+            }
+
+            for (const std::unique_ptr<registry_t>& registry : registries) {
+                for (const toolbox::PointShaderKey& key : keys) {
+                    registry->program(toolbox::point_shader_key_to_string(key));
+                }
+            }
+
+            elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+            for (size_t i = 0; i < num_groups; ++i) {
+                statistics[i] = registries[i]->program_statistics();
+            }
+        }
+
+        is_valid &= (counts.m_compiles == (keys.size() * num_groups));
+
+        for (const std::vector<registry_t::ProgramStatistics>& group : statistics) {
+            is_valid &= (group.size() == keys.size());
+
+            for (const registry_t::ProgramStatistics& program : group) {
+                is_valid &= ((names.count(program.m_name) == 1) && (program.m_compiles == 1) && (program.m_failures == 0) &&
+                    (program.m_compile_time >= std::chrono::milliseconds(compile_ms)) && (program.m_max_compile_time == program.m_compile_time));
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  program\tcompiles\tfailures\tcompile_ms (of share group 1)" << std::endl;
+
+        for (const registry_t::ProgramStatistics& program : statistics[0]) {
+            std::cout << "  " << program.m_name << "\t" << program.m_compiles << "\t" << program.m_failures << "\t"
+                << std::chrono::duration<double, std::milli>(program.m_compile_time).count() << std::endl;
+        }
+
+        std::cout << std::endl;
+        std::cout << "  " << counts.m_compiles << " compile(s), " << elapsed_ms << " ms till every group had every variant, "
+            << double(keys.size() * num_groups * compile_ms) << " ms compiling them one after another, "
+            << double(num_points_scenarios * num_groups * compile_ms) << " ms compiling one per scenario" << std::endl;
+
+        if (!is_valid) {
+            std::cerr << "Error: The variants compiled do not match those of the matrix!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Shader hot reload
+    //------------------------------------------------------------------------------
+
+    bool write_text_file(const std::string& path, const std::string& text)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << text;
+        return static_cast<bool>(file);
+    }
+
+    //------------------------------------------------------------------------------
+    // Render threads at about 1 kHz swapping in a program reloaded whenever its
+    // vertex shader file (in the working directory) is edited, against a fake
+    // backend taking the given time to compile. Checks every edit is swapped in by
+    // every thread, a broken edit keeps the program in use and no frame boundary
+    // waited for a compile.
+    int benchmark_reload(const arguments_t& arguments)
+    {
+        static const char VERTEX_SHADER_PATH[] = "Benchmarks.reload.vert";
+        static const char FRAGMENT_SHADER_PATH[] = "Benchmarks.reload.frag";
+        static const std::chrono::seconds TIMEOUT(5);
+
+        const int64_t threads = std::max<int64_t>(1, get_argument(arguments, "threads", 4));
+        const int64_t edits = std::max<int64_t>(1, get_argument(arguments, "edits", 5));
+        const int64_t compile_ms = std::max<int64_t>(1, get_argument(arguments, "compile-ms", 50));
+        const size_t num_threads = size_t(threads);
+
+        if (!write_text_file(VERTEX_SHADER_PATH, "vertex 0\n") || !write_text_file(FRAGMENT_SHADER_PATH, "fragment\n")) {
+            std::cerr << "Error: Failed to write the shaders to the working directory!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        typedef toolbox::ProgramRegistry<toolbox::FakeProgramBackend> registry_t;
+
+        //------------------------------------------------------------------------------
+        // What a render thread swapped in, kept by the thread till joined but the
+        // program in use.
+        struct RenderThread
+        {
+            std::atomic<uint32_t>   m_program { 0 };
+            uint64_t                m_num_frames = 0;
+            std::vector<double>     m_latencies;            // From linking to swapping in, ms.
+            std::vector<double>     m_swap_times;           // Of the frame boundaries swapping, us.
+            double                  m_max_boundary_time = 0.0;
+        };
+
+        toolbox::FakeProgramBackend::Counts counts;
+        std::vector<RenderThread> render_threads(num_threads);
+        registry_t::Statistics statistics;
+        std::string mechanism;
+        bool is_valid = true;
+
+        {
+            toolbox::FakeProgramBackend backend;
+            backend.m_counts = &counts;
+            backend.m_compile_time = std::chrono::milliseconds(compile_ms);
+
+            registry_t registry(backend);
+            registry.request("points", "vertex 0\n", "fragment\n");
+
+            std::atomic<bool> stop(false);
+            std::vector<std::thread> workers;
+
+            for (size_t i = 0; i < num_threads; ++i) {
+                workers.emplace_back([&registry, &stop, &render_threads, i]() {
+                    RenderThread& thread = render_threads[i];
+                    std::chrono::steady_clock::time_point linked_at;
+                    uint64_t generation = registry.generation();
+
+                    thread.m_program = registry.program("points");
+
+                    while (!stop) {
+                        const auto start_time = std::chrono::steady_clock::now();
+
+                        if (registry.generation() != generation) {
+                            generation = registry.generation();
+                            const uint32_t program = registry.program("points", &linked_at);
+
+                            if (program != thread.m_program) {
+                                thread.m_program = program;
+                                thread.m_latencies.push_back(std::chrono::duration<double, std::milli>(start_time - linked_at).count());
+                                thread.m_swap_times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count());
+                            }
+                        }
+
+                        thread.m_max_boundary_time = std::max(thread.m_max_boundary_time, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count());
+                        ++thread.m_num_frames;
+
+                        std::this_thread::sleep_until(start_time + std::chrono::milliseconds(1));
+                    }
+                });
+            }
+
+            //------------------------------------------------------------------------------
+            // Reload as the application does, reading both shaders on every change.
+            toolbox::FileWatcher watcher({ VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH }, [&registry](const std::string&) {
+                std::ifstream vertex_file(VERTEX_SHADER_PATH, std::ios::binary);
+                std::ifstream fragment_file(FRAGMENT_SHADER_PATH, std::ios::binary);
+                std::ostringstream vertex_shader;
+                std::ostringstream fragment_shader;
+                vertex_shader << vertex_file.rdbuf();
+                fragment_shader << fragment_file.rdbuf();
+
+                registry.reload("points", vertex_shader.str(), fragment_shader.str());
+            });
+
+            mechanism = watcher.mechanism();
+
+            //------------------------------------------------------------------------------
+            // True once the registry's statistic reached the count and every thread
+            // uses its program.
+            const auto wait_for = [&registry, &render_threads](uint64_t registry_t::Statistics::* statistic, uint64_t count) {
+                const auto end_time = (std::chrono::steady_clock::now() + TIMEOUT);
+
+                while (std::chrono::steady_clock::now() < end_time) {
+                    if ((registry.statistics().*statistic >= count) &&
+                        std::all_of(begin(render_threads), end(render_threads), [&registry](const RenderThread& thread) { return (thread.m_program == registry.program("points")); })) {
+                        return true;
+                    }
+
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+
+                return false;
+            };
+
+            is_valid &= wait_for(&registry_t::Statistics::m_compiles, 1);
+
+            for (int64_t edit = 1; edit <= edits; ++edit) {
+                is_valid &= write_text_file(VERTEX_SHADER_PATH, ("vertex " + std::to_string(edit) + "\n"));
+                is_valid &= wait_for(&registry_t::Statistics::m_reloads, uint64_t(edit));
+            }
+
+            //------------------------------------------------------------------------------
+            // A broken edit, then a fix.
+            const uint32_t last_program = registry.program("points");
+
+            is_valid &= write_text_file(VERTEX_SHADER_PATH, "#error\n");
+            is_valid &= wait_for(&registry_t::Statistics::m_reload_failures, 1);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            for (const RenderThread& thread : render_threads) {
+                is_valid &= (thread.m_program == last_program);
+            }
+
+            is_valid &= write_text_file(VERTEX_SHADER_PATH, "vertex fixed\n");
+            is_valid &= wait_for(&registry_t::Statistics::m_reloads, uint64_t(edits + 1));
+
+            stop = true;
+
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            statistics = registry.statistics();
+        }
+
+        std::remove(VERTEX_SHADER_PATH);
+        std::remove(FRAGMENT_SHADER_PATH);
+
+        std::vector<double> latencies;
+        std::vector<double> swap_times;
+        double max_boundary_time = 0.0;
+        uint64_t num_frames = 0;
+
+        for (const RenderThread& thread : render_threads) {
+            latencies.insert(end(latencies), begin(thread.m_latencies), end(thread.m_latencies));
+            swap_times.insert(end(swap_times), begin(thread.m_swap_times), end(thread.m_swap_times));
+            max_boundary_time = std::max(max_boundary_time, thread.m_max_boundary_time);
+            num_frames += thread.m_num_frames;
+        }
+
+        is_valid &= ((max_boundary_time < double(compile_ms)) && (counts.m_off_loader_calls == 0) && (counts.m_shaders_created == counts.m_shaders_deleted) &&
+            (counts.m_programs_deleted == statistics.m_compiles));
+
+        std::cout << "Shader hot reload (" << mechanism << "), " << threads << " render thread(s), " << edits << " edit(s), 1 broken, "
+            << compile_ms << " ms per compile" << std::endl << std::endl;
+
+        print_distribution_header(std::cout);
+        print_distribution(std::cout, "swap latency", latencies, "ms");
+        print_distribution(std::cout, "swap at frame boundary", swap_times, "us");
+
+        std::cout << std::endl << std::fixed << std::setprecision(2);
+        std::cout << "  " << statistics.m_reloads << " reload(s) swapped in, " << statistics.m_reload_failures << " failed, "
+            << counts.m_programs_deleted << " program(s) deleted, " << counts.m_off_loader_calls << " call(s) off the loader thread" << std::endl;
+        std::cout << "  " << num_frames << " frame(s), longest frame boundary " << max_boundary_time << " ms" << std::endl;
+
+        if (!is_valid) {
+            std::cerr << "Error: Not every edit was swapped in without waiting, or a broken edit replaced the program!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Uniform ring
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // The uniform ring of a render thread against a fake GPU that lags the given
+    // numbers of frames behind, checking that no allocation overlaps one a frame
+    // in flight still uses. Allocations per frame vary up to the given number, like
+    // per monitor projections or instances would.
+    int benchmark_uniforms(const arguments_t& arguments)
+    {
+        static const size_t FRAMES_IN_FLIGHT = 3;
+        static const size_t ALIGNMENT = 256;
+
+        const int64_t frames = std::max<int64_t>(1, get_argument(arguments, "frames", 100000));
+        const int64_t size = std::max<int64_t>(int64_t(ALIGNMENT), (get_argument(arguments, "size", (64 * 1024)) / int64_t(ALIGNMENT)) * int64_t(ALIGNMENT));
+        const int64_t max_allocations = std::max<int64_t>(1, get_argument(arguments, "allocations", 16));
+
+        std::cout << "Uniform ring, " << frames << " frames of up to " << max_allocations << " allocation(s) of " << sizeof(toolbox::PointGridUniforms)
+            << " bytes, " << size << " bytes " << FRAMES_IN_FLIGHT << " frames deep" << std::endl << std::endl;
+
+        std::cout << "  " << std::left << std::setw(12) << "gpu lag" << std::right << std::setw(14) << "allocations" << std::setw(10) << "wraps"
+            << std::setw(10) << "waits" << std::setw(10) << "stalls" << std::setw(10) << "overlaps" << std::setw(16) << "allocate [ns]" << std::endl;
+
+        uint64_t num_overlaps = 0;
+
+        try {
+            for (const uint64_t gpu_lag : { 0, 1, 2, 3, 5 }) {
+                toolbox::UniformRing<toolbox::FakeFenceApi> ring(size_t(size), ALIGNMENT, FRAMES_IN_FLIGHT);
+                toolbox::FakeFenceApi& gpu = ring.api();
+
+                //------------------------------------------------------------------------------
+                // The allocations of every fenced frame the fake GPU has not completed.
+                std::deque<std::pair<uint64_t, std::vector<std::pair<size_t, size_t>>>> in_flight;
+                std::vector<std::pair<size_t, size_t>> allocations;
+                uint64_t overlaps = 0;
+                double allocate_ns = 0.0;
+
+                for (int64_t frame_index = 0; frame_index < frames; ++frame_index) {
+                    gpu.m_num_completed = std::max(gpu.m_num_completed, ((gpu.m_num_inserted > gpu_lag) ? (gpu.m_num_inserted - gpu_lag) : 0));
+                    ring.begin_frame();
+                    allocations.clear();
+
+                    const size_t num_allocations = (1 + size_t((frame_index * 7) % max_allocations));
+                    const auto start_time = std::chrono::steady_clock::now();
+
+                    for (size_t i = 0; i < num_allocations; ++i) {
+                        allocations.emplace_back(ring.allocate(sizeof(toolbox::PointGridUniforms)), sizeof(toolbox::PointGridUniforms));
+                    }
+
+                    allocate_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+
+                    while (!in_flight.empty() && gpu.is_signaled(in_flight.front().first)) {
+                        in_flight.pop_front();
+                    }
+
+                    for (const auto& frame : in_flight) {
+                        for (const auto& used : frame.second) {
+                            for (const auto& allocation : allocations) {
+                                overlaps += (((allocation.first < (used.first + used.second)) && (used.first < (allocation.first + allocation.second))) ? 1 : 0);
+                            }
+                        }
+                    }
+
+                    ring.end_frame();
+                    in_flight.emplace_back(gpu.m_num_inserted, allocations);
+                }
+
+                const toolbox::UniformRing<toolbox::FakeFenceApi>::Statistics& statistics = ring.statistics();
+                num_overlaps += overlaps;
+
+                std::cout << "  " << std::left << std::setw(12) << gpu_lag << std::right << std::setw(14) << statistics.m_allocations
+                    << std::setw(10) << statistics.m_wraps << std::setw(10) << statistics.m_waits << std::setw(10) << statistics.m_stalls
+                    << std::setw(10) << overlaps << std::fixed << std::setprecision(1)
+                    << std::setw(16) << (allocate_ns / double(std::max<uint64_t>(statistics.m_allocations, 1))) << std::endl;
+            }
+        }
+        catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (num_overlaps > 0) {
+            std::cerr << "Error: " << num_overlaps << " allocation(s) overlapped a frame in flight!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Scene state
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // The size of main.cpp's Scene, every float set to the publication's number so
+    // a torn read shows as a mix.
+    struct BenchmarkScene
+    {
+        float   m_values[20];
+    };
+
+    //------------------------------------------------------------------------------
+    // Cost of picking up the scene at frame start with the given number of render
+    // threads reading as fast as they can while one writer publishes at a fixed
+    // rate, stamped a couple of frames ahead. Compared against a mutex.
+    int benchmark_scene(const arguments_t& arguments)
+    {
+        static const size_t BATCH_SIZE = 256;
+        static const uint64_t LEAD_FRAMES = 2;
+
+        const int64_t readers = std::max<int64_t>(1, get_argument(arguments, "readers", 16));
+        const int64_t writer_hz = std::max<int64_t>(1, get_argument(arguments, "writer-hz", 1000));
+        const int64_t frame_hz = std::max<int64_t>(1, get_argument(arguments, "frame-hz", 60));
+        const int64_t duration_ms = std::max<int64_t>(1, get_argument(arguments, "duration-ms", 2000));
+        const size_t num_readers = size_t(readers);
+
+        std::cout << "Scene state reads, " << readers << " reader(s), writer at " << writer_hz << " Hz, frames at " << frame_hz << " Hz, "
+            << duration_ms << " ms, " << std::thread::hardware_concurrency() << " hardware thread(s)" << std::endl << std::endl;
+
+        print_distribution_header(std::cout);
+
+        //------------------------------------------------------------------------------
+        // read() is given the frame index and the scene to update, returning false if
+        // there was nothing to read for the frame.
+        const auto run = [=](const std::string& label, const std::function<void(const BenchmarkScene&, uint64_t)>& publish,
+            const std::function<bool(uint64_t, BenchmarkScene&)>& read)
+        {
+            const auto start_time = std::chrono::steady_clock::now();
+            const auto end_time = (start_time + std::chrono::milliseconds(duration_ms));
+
+            const auto frame_at = [start_time, frame_hz](std::chrono::steady_clock::time_point time) {
+                return uint64_t(std::max(0.0, (std::chrono::duration<double>(time - start_time).count() * double(frame_hz))));
+            };
+
+            std::vector<std::vector<double>> batches(num_readers);
+            std::atomic<uint64_t> num_reads(0);
+            std::atomic<uint64_t> num_torn(0);
+            std::atomic<uint64_t> num_missed(0);
+            std::vector<std::thread> threads;
+
+            for (size_t i = 0; i < num_readers; ++i) {
+                threads.emplace_back([&, i]() {
+                    BenchmarkScene scene = {};
+                    uint64_t reads = 0;
+                    uint64_t torn = 0;
+                    uint64_t missed = 0;
+
+                    for (auto now = std::chrono::steady_clock::now(); now < end_time; now = std::chrono::steady_clock::now()) {
+                        const uint64_t frame_index = frame_at(now);
+                        const auto batch_start_time = std::chrono::steady_clock::now();
+
+                        for (size_t j = 0; j < BATCH_SIZE; ++j) {
+                            missed += (read(frame_index, scene) ? 0 : 1);
+                        }
+
+                        batches[i].push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - batch_start_time).count() / double(BATCH_SIZE));
+                        reads += BATCH_SIZE;
+                        torn += (std::all_of(std::begin(scene.m_values), std::end(scene.m_values), [&scene](float value) { return (value == scene.m_values[0]); }) ? 0 : 1);
+                    }
+
+                    num_reads += reads;
+                    num_torn += torn;
+                    num_missed += missed;
+                });
+            }
+
+            //------------------------------------------------------------------------------
+            // The writer, on this thread.
+            const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / double(writer_hz)));
+            uint64_t num_publications = 0;
+
+            for (auto next_time = start_time; next_time < end_time; next_time += interval) {
+                std::this_thread::sleep_until(next_time);
+
+                BenchmarkScene scene;
+                std::fill(std::begin(scene.m_values), std::end(scene.m_values), float(++num_publications));
+                publish(scene, (frame_at(std::chrono::steady_clock::now()) + LEAD_FRAMES));
+            }
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            std::vector<double> values;
+
+            for (const auto& reader_batches : batches) {
+                values.insert(end(values), begin(reader_batches), end(reader_batches));
+            }
+
+            print_distribution(std::cout, label, values, "ns/read");
+            std::cout << "  " << std::setw(24) << "" << num_reads.load() << " reads, " << num_publications << " publications, "
+                << num_torn.load() << " torn, " << num_missed.load() << " without a snapshot for the frame" << std::endl;
+        };
+
+        {
+            toolbox::SnapshotRing<BenchmarkScene> ring;
+            ring.publish(BenchmarkScene(), 0);
+
+            run("snapshot ring",
+                [&ring](const BenchmarkScene& scene, uint64_t stamp) { ring.publish(scene, stamp); },
+                [&ring](uint64_t frame_index, BenchmarkScene& scene) { return ring.read_at(frame_index, scene); });
+        }
+
+        {
+            std::mutex mutex;
+            std::vector<std::pair<uint64_t, BenchmarkScene>> history = { { 0, BenchmarkScene() } };
+
+            run("mutex",
+                [&mutex, &history](const BenchmarkScene& scene, uint64_t stamp) {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    if (history.back().first == stamp) {
+                        history.back().second = scene;
+                    }
+                    else {
+                        history.emplace_back(stamp, scene);
+                        history.erase(begin(history), (end(history) - std::min<size_t>(history.size(), 8)));
+                    }
+                },
+                [&mutex, &history](uint64_t frame_index, BenchmarkScene& scene) {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    for (auto it = history.rbegin(); it != history.rend(); ++it) {
+                        if (it->first <= frame_index) {
+                            scene = it->second;
+                            return true;
+                        }
+                    }
+
+                    return false;
+                });
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Benchmark registry
+    //------------------------------------------------------------------------------
+
+    struct benchmark_t {
+        const char*     m_name;
+        const char*     m_arguments;
+        int             (*m_run)(const arguments_t& arguments);
+    };
+
+    const benchmark_t BENCHMARKS[] = {
+        { "wake", "[--iterations=<n>] [--interval-us=<us>] [--load-threads=<n>]", benchmark_wake },
+        { "pacing", "[--frames=<n>] [--latency-us=<us>] [--jitter-us=<us>] [--work-us=<us>]", benchmark_pacing },
+        { "barrier", "[--iterations=<n>] [--max-threads=<n>] [--spin-budget-us=<us>]", benchmark_barrier },
+        { "affinity", "[--mode=none|core|node] [--gpu-nodes=<node>[,<node>...]]", benchmark_affinity },
+        { "scheduling", "[--policy=fifo|rr[:<priority>]] [--iterations=<n>] [--interval-us=<us>] [--load-threads=<n>]", benchmark_scheduling },
+        { "spsc", "[--records=<n>] [--stall-us=<us>] [--stall-every=<batches>]", benchmark_spsc },
+        { "loop", "[--frames=<n>] [--repetitions=<n>] [--timings=file|none]", benchmark_loop },
+        { "startup", "[--scale=<factor>] [--fail=<task>]", benchmark_startup },
+        { "cull", "[--monitors=<n>] [--iterations=<n>]", benchmark_cull },
+        { "glstate", "[--frames=<n>]", benchmark_glstate },
+        { "programs", "[--contexts=<n>] [--programs=<n>] [--compile-ms=<ms>]", benchmark_programs },
+        { "locations", "[--iterations=<n>] [--attributes=<n>]", benchmark_locations },
+        { "reflection", "[--iterations=<n>] [--uniforms=<n>]", benchmark_reflection },
+        { "cache", "", benchmark_cache },
+        { "variants", "[--groups=<n>] [--compile-ms=<ms>]", benchmark_variants },
+        { "reload", "[--threads=<n>] [--edits=<n>] [--compile-ms=<ms>]", benchmark_reload },
+        { "uniforms", "[--frames=<n>] [--size=<bytes>] [--allocations=<n>]", benchmark_uniforms },
+        { "scene", "[--readers=<n>] [--writer-hz=<hz>] [--frame-hz=<hz>] [--duration-ms=<ms>]", benchmark_scene },
+    };
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char* argv[])
+{
+    if (argc >= 2) {
+        for (const benchmark_t& benchmark : BENCHMARKS) {
+            if (strcmp(argv[1], benchmark.m_name) != 0) {
+                continue;
+            }
+
+            arguments_t arguments;
+
+            if (!parse_arguments(argc, argv, 2, arguments)) {
+                return EXIT_FAILURE;
+            }
+
+            return benchmark.m_run(arguments);
+        }
+    }
+
+    std::cerr << "Usage: Benchmarks <benchmark> [<arguments>]" << std::endl;
+
+    for (const benchmark_t& benchmark : BENCHMARKS) {
+        std::cerr << "  " << benchmark.m_name << " " << benchmark.m_arguments << std::endl;
+    }
+
+    return EXIT_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
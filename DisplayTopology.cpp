@@ -0,0 +1,809 @@
+//
+//  DisplayTopology.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DisplayTopology.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define TOOLBOX_LOG_WARNING(...) printf(__VA_ARGS__)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+
+    const uint32_t SNAPSHOT_MAGIC = 0x4f504f54;   // 'TOPO'
+    const uint32_t SNAPSHOT_VERSION = 1;
+
+    template <typename T, typename K>
+    const T* find_by_key(const std::vector<T>& nodes, const K& key)
+    {
+      const auto it = std::find_if(begin(nodes), end(nodes), [&key](const T& node) { return (node.m_key == key); });
+      return ((it != end(nodes)) ? &(*it) : nullptr);
+    }
+
+    template <typename T, typename K>
+    T* find_by_key(std::vector<T>& nodes, const K& key)
+    {
+      const auto it = std::find_if(begin(nodes), end(nodes), [&key](const T& node) { return (node.m_key == key); });
+      return ((it != end(nodes)) ? &(*it) : nullptr);
+    }
+
+    void fill(std::string& value, const std::string& other) { if (value.empty()) { value = other; } }
+    void fill(int32_t& value, int32_t other) { if (value < 0) { value = other; } }
+    void fill(uint32_t& value, uint32_t other) { if (value == 0) { value = other; } }
+    void fill(bool& value, bool other) { value = (value || other); }
+
+    void fill(DisplayRect& value, const DisplayRect& other)
+    {
+      if ((value.m_width == 0) && (value.m_height == 0)) {
+        value = other;
+      }
+    }
+
+    std::string to_string(const DisplayRect& rect)
+    {
+      std::ostringstream text;
+      text << "(" << rect.m_x << " / " << rect.m_y << ") [" << rect.m_width << " x " << rect.m_height << "]";
+      return text.str();
+    }
+
+    std::string display_id_to_string(uint32_t display_id)
+    {
+      std::ostringstream text;
+      text << "0x" << std::hex << std::setfill('0') << std::setw(8) << display_id;
+      return text.str();
+    }
+
+    //------------------------------------------------------------------------------
+    // Snapshot encoding, fixed size values in native byte order like FrameTrace.h.
+    class SnapshotWriter
+    {
+    public:
+
+      template <typename T>
+      void write(T value)
+      {
+        const uint8_t* const bytes = reinterpret_cast<const uint8_t*>(&value);
+        m_data.insert(end(m_data), bytes, (bytes + sizeof(value)));
+      }
+
+      void write(const std::string& value)
+      {
+        write(uint32_t(value.size()));
+        m_data.insert(end(m_data), begin(value), end(value));
+      }
+
+      void write(const DisplayRect& rect)
+      {
+        write(rect.m_x);
+        write(rect.m_y);
+        write(rect.m_width);
+        write(rect.m_height);
+      }
+
+      const std::vector<uint8_t>& data() const { return m_data; }
+
+    private:
+
+      std::vector<uint8_t>    m_data;
+    };
+
+    class SnapshotReader
+    {
+    public:
+
+      explicit SnapshotReader(const std::vector<uint8_t>& data) : m_data(data) {}
+
+      template <typename T>
+      bool read(T& value)
+      {
+        if ((m_data.size() - m_offset) < sizeof(value)) {
+          return false;
+        }
+
+        memcpy(&value, (m_data.data() + m_offset), sizeof(value));
+        m_offset += sizeof(value);
+        return true;
+      }
+
+      bool read(std::string& value)
+      {
+        uint32_t size = 0;
+
+        if (!read(size) || ((m_data.size() - m_offset) < size)) {
+          return false;
+        }
+
+        value.assign(reinterpret_cast<const char*>(m_data.data() + m_offset), size);
+        m_offset += size;
+        return true;
+      }
+
+      bool read(DisplayRect& rect) { return (read(rect.m_x) && read(rect.m_y) && read(rect.m_width) && read(rect.m_height)); }
+
+      bool read(bool& value)
+      {
+        uint8_t byte = 0;
+
+        if (!read(byte)) {
+          return false;
+        }
+
+        value = (byte != 0);
+        return true;
+      }
+
+      //------------------------------------------------------------------------------
+      // Node counts, rejecting ones the remaining data can not possibly hold.
+      bool read_count(size_t& count)
+      {
+        uint32_t value = 0;
+
+        if (!read(value) || (value > (m_data.size() - m_offset))) {
+          return false;
+        }
+
+        count = value;
+        return true;
+      }
+
+      bool is_at_end() const { return (m_offset == m_data.size()); }
+
+    private:
+
+      const std::vector<uint8_t>&     m_data;
+      size_t                          m_offset = 0;
+    };
+
+  } // unnamed namespace
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool
+  operator==(const DisplayRect& a, const DisplayRect& b)
+  {
+    return ((a.m_x == b.m_x) && (a.m_y == b.m_y) && (a.m_width == b.m_width) && (a.m_height == b.m_height));
+  }
+
+  bool
+  operator!=(const DisplayRect& a, const DisplayRect& b)
+  {
+    return !(a == b);
+  }
+
+  const DisplayTopology::PhysicalGpu*
+  DisplayTopology::find_physical_gpu(const std::string& key) const
+  {
+    return find_by_key(m_physical_gpus, key);
+  }
+
+  const DisplayTopology::Output*
+  DisplayTopology::find_output(const std::string& key) const
+  {
+    return find_by_key(m_outputs, key);
+  }
+
+  const DisplayTopology::Output*
+  DisplayTopology::find_output(uint32_t display_id) const
+  {
+    const auto it = std::find_if(begin(m_outputs), end(m_outputs), [display_id](const Output& output) { return (output.m_display_id == display_id); });
+    return ((it != end(m_outputs)) ? &(*it) : nullptr);
+  }
+
+  const DisplayTopology::Monitor*
+  DisplayTopology::find_monitor(const std::string& key) const
+  {
+    return find_by_key(m_monitors, key);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void
+  merge_display_topology(DisplayTopology& topology, const DisplayTopology& fragment)
+  {
+    fill(topology.m_virtual_screen, fragment.m_virtual_screen);
+
+    for (const DisplayTopology::LogicalGpu& logical_gpu : fragment.m_logical_gpus) {
+      if (std::none_of(begin(topology.m_logical_gpus), end(topology.m_logical_gpus), [&logical_gpu](const DisplayTopology::LogicalGpu& other) { return (other.m_index == logical_gpu.m_index); })) {
+        topology.m_logical_gpus.push_back(logical_gpu);
+      }
+    }
+
+    for (const DisplayTopology::PhysicalGpu& physical_gpu : fragment.m_physical_gpus) {
+      DisplayTopology::PhysicalGpu* const existing = find_by_key(topology.m_physical_gpus, physical_gpu.m_key);
+
+      if (existing == nullptr) {
+        topology.m_physical_gpus.push_back(physical_gpu);
+        continue;
+      }
+
+      fill(existing->m_logical_gpu, physical_gpu.m_logical_gpu);
+      fill(existing->m_name, physical_gpu.m_name);
+    }
+
+    for (const DisplayTopology::Output& output : fragment.m_outputs) {
+      DisplayTopology::Output* const existing = find_by_key(topology.m_outputs, output.m_key);
+
+      if (existing == nullptr) {
+        topology.m_outputs.push_back(output);
+        continue;
+      }
+
+      fill(existing->m_gpu, output.m_gpu);
+      fill(existing->m_display_id, output.m_display_id);
+      fill(existing->m_connector, output.m_connector);
+      fill(existing->m_is_active, output.m_is_active);
+    }
+
+    for (const DisplayTopology::Monitor& monitor : fragment.m_monitors) {
+      DisplayTopology::Monitor* const existing = find_by_key(topology.m_monitors, monitor.m_key);
+
+      if (existing == nullptr) {
+        topology.m_monitors.push_back(monitor);
+        continue;
+      }
+
+      fill(existing->m_rect, monitor.m_rect);
+      fill(existing->m_refresh_rate_hz, monitor.m_refresh_rate_hz);
+      fill(existing->m_is_primary, monitor.m_is_primary);
+    }
+
+    //------------------------------------------------------------------------------
+    // Only NVAPI knows about grids, take them as a whole.
+    if (topology.m_mosaic_grids.empty()) {
+      topology.m_mosaic_grids = fragment.m_mosaic_grids;
+    }
+
+    if (topology.m_fingerprint == 0) {
+      topology.m_fingerprint = fragment.m_fingerprint;
+    }
+  }
+
+  std::vector<std::string>
+  diff_display_topologies(const DisplayTopology& before, const DisplayTopology& after)
+  {
+    std::vector<std::string> differences;
+
+    const auto differ = [&differences](const std::string& what, const std::string& from, const std::string& to) {
+      if (from != to) {
+        differences.push_back(what + ": " + from + " -> " + to);
+      }
+    };
+
+    differ("Virtual screen", to_string(before.m_virtual_screen), to_string(after.m_virtual_screen));
+    differ("Logical GPUs", std::to_string(before.m_logical_gpus.size()), std::to_string(after.m_logical_gpus.size()));
+
+    for (const DisplayTopology::PhysicalGpu& gpu : before.m_physical_gpus) {
+      const DisplayTopology::PhysicalGpu* const other = after.find_physical_gpu(gpu.m_key);
+
+      if (other == nullptr) {
+        differences.push_back("Physical GPU " + gpu.m_key + " removed");
+        continue;
+      }
+
+      differ(("Physical GPU " + gpu.m_key + " name"), gpu.m_name, other->m_name);
+      differ(("Physical GPU " + gpu.m_key + " logical GPU"), std::to_string(gpu.m_logical_gpu), std::to_string(other->m_logical_gpu));
+    }
+
+    for (const DisplayTopology::PhysicalGpu& gpu : after.m_physical_gpus) {
+      if (before.find_physical_gpu(gpu.m_key) == nullptr) {
+        differences.push_back("Physical GPU " + gpu.m_key + " added");
+      }
+    }
+
+    for (const DisplayTopology::Output& output : before.m_outputs) {
+      const DisplayTopology::Output* const other = after.find_output(output.m_key);
+
+      if (other == nullptr) {
+        differences.push_back("Output " + output.m_key + " removed");
+        continue;
+      }
+
+      differ(("Output " + output.m_key + " GPU"), output.m_gpu, other->m_gpu);
+      differ(("Output " + output.m_key + " display id"), display_id_to_string(output.m_display_id), display_id_to_string(other->m_display_id));
+      differ(("Output " + output.m_key + " connector"), output.m_connector, other->m_connector);
+      differ(("Output " + output.m_key + " active"), (output.m_is_active ? "yes" : "no"), (other->m_is_active ? "yes" : "no"));
+    }
+
+    for (const DisplayTopology::Output& output : after.m_outputs) {
+      if (before.find_output(output.m_key) == nullptr) {
+        differences.push_back("Output " + output.m_key + " added");
+      }
+    }
+
+    for (const DisplayTopology::Monitor& monitor : before.m_monitors) {
+      const DisplayTopology::Monitor* const other = after.find_monitor(monitor.m_key);
+
+      if (other == nullptr) {
+        differences.push_back("Monitor " + monitor.m_key + " removed");
+        continue;
+      }
+
+      differ(("Monitor " + monitor.m_key + " rect"), to_string(monitor.m_rect), to_string(other->m_rect));
+      differ(("Monitor " + monitor.m_key + " refresh rate"), (std::to_string(monitor.m_refresh_rate_hz) + " Hz"), (std::to_string(other->m_refresh_rate_hz) + " Hz"));
+      differ(("Monitor " + monitor.m_key + " primary"), (monitor.m_is_primary ? "yes" : "no"), (other->m_is_primary ? "yes" : "no"));
+    }
+
+    for (const DisplayTopology::Monitor& monitor : after.m_monitors) {
+      if (before.find_monitor(monitor.m_key) == nullptr) {
+        differences.push_back("Monitor " + monitor.m_key + " added");
+      }
+    }
+
+    differ("Mosaic grids", std::to_string(before.m_mosaic_grids.size()), std::to_string(after.m_mosaic_grids.size()));
+
+    for (size_t i = 0; i < std::min(before.m_mosaic_grids.size(), after.m_mosaic_grids.size()); ++i) {
+      const DisplayTopology::MosaicGrid& grid = before.m_mosaic_grids[i];
+      const DisplayTopology::MosaicGrid& other = after.m_mosaic_grids[i];
+      const std::string name = ("Mosaic grid " + std::to_string(i));
+
+      differ((name + " size"), (std::to_string(grid.m_rows) + "x" + std::to_string(grid.m_columns)), (std::to_string(other.m_rows) + "x" + std::to_string(other.m_columns)));
+      differ((name + " mode"),
+        (std::to_string(grid.m_width) + "x" + std::to_string(grid.m_height) + " @ " + std::to_string(grid.m_refresh_rate_hz) + " Hz"),
+        (std::to_string(other.m_width) + "x" + std::to_string(other.m_height) + " @ " + std::to_string(other.m_refresh_rate_hz) + " Hz"));
+
+      if (grid.m_display_ids != other.m_display_ids) {
+        differences.push_back(name + " displays changed");
+      }
+    }
+
+    return differences;
+  }
+
+  void
+  print_display_topology(std::ostream& stream, const DisplayTopology& topology)
+  {
+    const auto print_monitor = [&stream](const DisplayTopology::Monitor& monitor, const std::string& indent) {
+      stream << indent << "Monitor " << to_string(monitor.m_rect) << " @ " << monitor.m_refresh_rate_hz << " Hz";
+
+      if (monitor.m_is_primary) {
+        stream << " (primary)";
+      }
+
+      stream << std::endl;
+    };
+
+    const auto print_output = [&stream, &topology, &print_monitor](const DisplayTopology::Output& output, const std::string& indent) {
+      stream << indent << "Output " << output.m_key;
+
+      if (!output.m_connector.empty()) {
+        stream << ", " << output.m_connector;
+      }
+
+      if (output.m_display_id != 0) {
+        stream << ", " << display_id_to_string(output.m_display_id);
+      }
+
+      if (output.m_is_active) {
+        stream << ", active";
+      }
+
+      stream << std::endl;
+
+      const DisplayTopology::Monitor* const monitor = topology.find_monitor(output.m_key);
+
+      if (monitor) {
+        print_monitor(*monitor, (indent + "  "));
+      }
+
+      for (size_t grid_index = 0; grid_index < topology.m_mosaic_grids.size(); ++grid_index) {
+        const DisplayTopology::MosaicGrid& grid = topology.m_mosaic_grids[grid_index];
+
+        for (size_t cell = 0; cell < grid.m_display_ids.size(); ++cell) {
+          if ((output.m_display_id != 0) && (grid.m_display_ids[cell] == output.m_display_id) && (grid.m_columns > 0)) {
+            stream << indent << "  Mosaic grid " << grid_index << " [" << (cell / grid.m_columns) << "," << (cell % grid.m_columns) << "] of "
+              << grid.m_rows << "x" << grid.m_columns << ", " << grid.m_width << "x" << grid.m_height << " @ " << grid.m_refresh_rate_hz << " Hz" << std::endl;
+          }
+        }
+      }
+    };
+
+    const auto print_gpu = [&stream, &topology, &print_output](const DisplayTopology::PhysicalGpu& gpu, const std::string& indent) {
+      stream << indent << "Physical GPU " << gpu.m_key << ": " << (gpu.m_name.empty() ? "(unknown)" : gpu.m_name) << std::endl;
+
+      for (const DisplayTopology::Output& output : topology.m_outputs) {
+        if (output.m_gpu == gpu.m_key) {
+          print_output(output, (indent + "  "));
+        }
+      }
+    };
+
+    stream << "Virtual screen " << to_string(topology.m_virtual_screen) << ", " << topology.m_monitors.size() << " monitor(s)" << std::endl;
+
+    for (const DisplayTopology::LogicalGpu& logical_gpu : topology.m_logical_gpus) {
+      stream << "Logical GPU " << logical_gpu.m_index << std::endl;
+
+      for (const DisplayTopology::PhysicalGpu& gpu : topology.m_physical_gpus) {
+        if (gpu.m_logical_gpu == int32_t(logical_gpu.m_index)) {
+          print_gpu(gpu, "  ");
+        }
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Whatever no provider could place in the graph.
+    for (const DisplayTopology::PhysicalGpu& gpu : topology.m_physical_gpus) {
+      if (gpu.m_logical_gpu < 0) {
+        print_gpu(gpu, "");
+      }
+    }
+
+    for (const DisplayTopology::Output& output : topology.m_outputs) {
+      if (topology.find_physical_gpu(output.m_gpu) == nullptr) {
+        print_output(output, "");
+      }
+    }
+
+    for (const DisplayTopology::Monitor& monitor : topology.m_monitors) {
+      if (topology.find_output(monitor.m_key) == nullptr) {
+        stream << "Output " << monitor.m_key << " (no GPU known)" << std::endl;
+        print_monitor(monitor, "  ");
+      }
+    }
+  }
+
+  uint64_t
+  display_topology_fingerprint(const std::string& description)
+  {
+    uint64_t hash = 14695981039346656037ull;   // FNV-1a
+
+    for (const char c : description) {
+      hash = ((hash ^ uint8_t(c)) * 1099511628211ull);
+    }
+
+    return hash;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool
+  save_display_topology(const std::string& path, const DisplayTopology& topology)
+  {
+    SnapshotWriter writer;
+
+    writer.write(SNAPSHOT_MAGIC);
+    writer.write(SNAPSHOT_VERSION);
+    writer.write(topology.m_fingerprint);
+    writer.write(topology.m_virtual_screen);
+
+    writer.write(uint32_t(topology.m_logical_gpus.size()));
+
+    for (const DisplayTopology::LogicalGpu& logical_gpu : topology.m_logical_gpus) {
+      writer.write(logical_gpu.m_index);
+    }
+
+    writer.write(uint32_t(topology.m_physical_gpus.size()));
+
+    for (const DisplayTopology::PhysicalGpu& gpu : topology.m_physical_gpus) {
+      writer.write(gpu.m_key);
+      writer.write(gpu.m_logical_gpu);
+      writer.write(gpu.m_name);
+    }
+
+    writer.write(uint32_t(topology.m_outputs.size()));
+
+    for (const DisplayTopology::Output& output : topology.m_outputs) {
+      writer.write(output.m_key);
+      writer.write(output.m_gpu);
+      writer.write(output.m_display_id);
+      writer.write(output.m_connector);
+      writer.write(uint8_t(output.m_is_active));
+    }
+
+    writer.write(uint32_t(topology.m_monitors.size()));
+
+    for (const DisplayTopology::Monitor& monitor : topology.m_monitors) {
+      writer.write(monitor.m_key);
+      writer.write(monitor.m_rect);
+      writer.write(monitor.m_refresh_rate_hz);
+      writer.write(uint8_t(monitor.m_is_primary));
+    }
+
+    writer.write(uint32_t(topology.m_mosaic_grids.size()));
+
+    for (const DisplayTopology::MosaicGrid& grid : topology.m_mosaic_grids) {
+      writer.write(grid.m_rows);
+      writer.write(grid.m_columns);
+      writer.write(grid.m_width);
+      writer.write(grid.m_height);
+      writer.write(grid.m_refresh_rate_hz);
+      writer.write(uint32_t(grid.m_display_ids.size()));
+
+      for (const uint32_t display_id : grid.m_display_ids) {
+        writer.write(display_id);
+      }
+    }
+
+    FILE* const file = fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+      TOOLBOX_LOG_WARNING("Failed to create display topology snapshot %s\n", path.c_str());
+      return false;
+    }
+
+    const bool is_written = (fwrite(writer.data().data(), 1, writer.data().size(), file) == writer.data().size());
+    const bool is_closed = (fclose(file) == 0);
+
+    if (!is_written || !is_closed) {
+      TOOLBOX_LOG_WARNING("Failed to write display topology snapshot %s\n", path.c_str());
+      remove(path.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  bool
+  load_display_topology(const std::string& path, DisplayTopology& topology)
+  {
+    FILE* const file = fopen(path.c_str(), "rb");
+
+    if (file == nullptr) {
+      return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t size = 0;
+
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      data.insert(end(data), buffer, (buffer + size));
+    }
+
+    fclose(file);
+
+    SnapshotReader reader(data);
+    DisplayTopology loaded;
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    size_t count = 0;
+
+    if (!reader.read(magic) || (magic != SNAPSHOT_MAGIC) || !reader.read(version) || (version != SNAPSHOT_VERSION)) {
+      return false;
+    }
+
+    if (!reader.read(loaded.m_fingerprint) || !reader.read(loaded.m_virtual_screen) || !reader.read_count(count)) {
+      return false;
+    }
+
+    loaded.m_logical_gpus.resize(count);
+
+    for (DisplayTopology::LogicalGpu& logical_gpu : loaded.m_logical_gpus) {
+      if (!reader.read(logical_gpu.m_index)) {
+        return false;
+      }
+    }
+
+    if (!reader.read_count(count)) {
+      return false;
+    }
+
+    loaded.m_physical_gpus.resize(count);
+
+    for (DisplayTopology::PhysicalGpu& gpu : loaded.m_physical_gpus) {
+      if (!reader.read(gpu.m_key) || !reader.read(gpu.m_logical_gpu) || !reader.read(gpu.m_name)) {
+        return false;
+      }
+    }
+
+    if (!reader.read_count(count)) {
+      return false;
+    }
+
+    loaded.m_outputs.resize(count);
+
+    for (DisplayTopology::Output& output : loaded.m_outputs) {
+      if (!reader.read(output.m_key) || !reader.read(output.m_gpu) || !reader.read(output.m_display_id) || !reader.read(output.m_connector) || !reader.read(output.m_is_active)) {
+        return false;
+      }
+    }
+
+    if (!reader.read_count(count)) {
+      return false;
+    }
+
+    loaded.m_monitors.resize(count);
+
+    for (DisplayTopology::Monitor& monitor : loaded.m_monitors) {
+      if (!reader.read(monitor.m_key) || !reader.read(monitor.m_rect) || !reader.read(monitor.m_refresh_rate_hz) || !reader.read(monitor.m_is_primary)) {
+        return false;
+      }
+    }
+
+    if (!reader.read_count(count)) {
+      return false;
+    }
+
+    loaded.m_mosaic_grids.resize(count);
+
+    for (DisplayTopology::MosaicGrid& grid : loaded.m_mosaic_grids) {
+      if (!reader.read(grid.m_rows) || !reader.read(grid.m_columns) || !reader.read(grid.m_width) || !reader.read(grid.m_height) || !reader.read(grid.m_refresh_rate_hz) || !reader.read_count(count)) {
+        return false;
+      }
+
+      grid.m_display_ids.resize(count);
+
+      for (uint32_t& display_id : grid.m_display_ids) {
+        if (!reader.read(display_id)) {
+          return false;
+        }
+      }
+    }
+
+    if (!reader.is_at_end()) {
+      return false;
+    }
+
+    topology = std::move(loaded);
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  DisplayTopology
+  build_display_topology(const display_topology_providers_t& providers)
+  {
+    DisplayTopology topology;
+
+    for (const std::unique_ptr<DisplayTopologyProvider>& provider : providers) {
+      try {
+        merge_display_topology(topology, provider->enumerate());
+      }
+      catch (std::exception& e) {
+        TOOLBOX_LOG_WARNING("Display topology provider %s failed: %s\n", provider->name(), e.what());
+      }
+    }
+
+    return topology;
+  }
+
+  display_topology_providers_t
+  create_mock_display_topology_providers(const MockDisplayLayout& layout)
+  {
+    const size_t num_displays = (layout.m_num_gpus * layout.m_num_monitors_per_gpu);
+
+    const auto gdi_name = [](size_t index) { return ("\\\\.\\DISPLAY" + std::to_string(index + 1)); };
+    const auto gpu_key = [](size_t index) {
+      std::ostringstream key;
+      key << std::hex << std::setfill('0') << std::setw(16) << (0xc1a0 + index);
+      return key.str();
+    };
+    const auto display_id = [](size_t index) { return uint32_t(0x00001000 + index); };
+
+    //------------------------------------------------------------------------------
+    // Windows: the monitors of the virtual screen, one spanning all with mosaic.
+    DisplayTopology windows;
+    {
+      const size_t num_monitors = (layout.m_is_mosaic ? 1 : num_displays);
+      const int32_t width = (layout.m_is_mosaic ? int32_t(layout.m_width * num_displays) : layout.m_width);
+
+      for (size_t i = 0; i < num_monitors; ++i) {
+        DisplayTopology::Monitor monitor;
+        monitor.m_key = gdi_name(i);
+        monitor.m_rect.m_x = int32_t(i * width);
+        monitor.m_rect.m_width = width;
+        monitor.m_rect.m_height = layout.m_height;
+        monitor.m_refresh_rate_hz = layout.m_refresh_rate_hz;
+        monitor.m_is_primary = (i == 0);
+        windows.m_monitors.push_back(monitor);
+      }
+
+      windows.m_virtual_screen.m_width = int32_t(layout.m_width * num_displays);
+      windows.m_virtual_screen.m_height = layout.m_height;
+    }
+
+    //------------------------------------------------------------------------------
+    // NVAPI: GPUs, their outputs by display id (named only where the OS sees a
+    // monitor) and the mosaic grid. One logical GPU per physical GPU, one for all
+    // with mosaic.
+    DisplayTopology nvapi;
+    {
+      for (size_t gpu_index = 0; gpu_index < layout.m_num_gpus; ++gpu_index) {
+        if (!layout.m_is_mosaic || (gpu_index == 0)) {
+          DisplayTopology::LogicalGpu logical_gpu;
+          logical_gpu.m_index = uint32_t(gpu_index);
+          nvapi.m_logical_gpus.push_back(logical_gpu);
+        }
+
+        DisplayTopology::PhysicalGpu gpu;
+        gpu.m_key = gpu_key(gpu_index);
+        gpu.m_logical_gpu = (layout.m_is_mosaic ? 0 : int32_t(gpu_index));
+        gpu.m_name = "Quadro P5000";
+        nvapi.m_physical_gpus.push_back(gpu);
+
+        for (size_t i = 0; i < layout.m_num_monitors_per_gpu; ++i) {
+          const size_t index = ((gpu_index * layout.m_num_monitors_per_gpu) + i);
+
+          DisplayTopology::Output output;
+          output.m_display_id = display_id(index);
+          output.m_key = ((!layout.m_is_mosaic || (index == 0)) ? gdi_name(index) : ("nv:" + display_id_to_string(output.m_display_id)));
+          output.m_gpu = gpu.m_key;
+          output.m_connector = "DP";
+          output.m_is_active = true;
+          nvapi.m_outputs.push_back(output);
+        }
+      }
+
+      if (layout.m_is_mosaic) {
+        DisplayTopology::MosaicGrid grid;
+        grid.m_rows = 1;
+        grid.m_columns = uint32_t(num_displays);
+        grid.m_width = uint32_t(layout.m_width);
+        grid.m_height = uint32_t(layout.m_height);
+        grid.m_refresh_rate_hz = layout.m_refresh_rate_hz;
+
+        for (size_t i = 0; i < num_displays; ++i) {
+          grid.m_display_ids.push_back(display_id(i));
+        }
+
+        nvapi.m_mosaic_grids.push_back(grid);
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // DXGI: adapters and the outputs attached to the desktop.
+    DisplayTopology dxgi;
+    {
+      for (size_t gpu_index = 0; gpu_index < layout.m_num_gpus; ++gpu_index) {
+        DisplayTopology::PhysicalGpu gpu;
+        gpu.m_key = gpu_key(gpu_index);
+        gpu.m_name = "NVIDIA Quadro P5000";
+        dxgi.m_physical_gpus.push_back(gpu);
+
+        for (size_t i = 0; i < layout.m_num_monitors_per_gpu; ++i) {
+          const size_t index = ((gpu_index * layout.m_num_monitors_per_gpu) + i);
+
+          if (!layout.m_is_mosaic || (index == 0)) {
+            DisplayTopology::Output output;
+            output.m_key = gdi_name(index);
+            output.m_gpu = gpu.m_key;
+            output.m_is_active = true;
+            dxgi.m_outputs.push_back(output);
+          }
+        }
+      }
+    }
+
+    display_topology_providers_t providers;
+    providers.emplace_back(new MockDisplayTopologyProvider("windows", windows));
+    providers.emplace_back(new MockDisplayTopologyProvider("nvapi", nvapi));
+    providers.emplace_back(new MockDisplayTopologyProvider("dxgi", dxgi));
+
+    return providers;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
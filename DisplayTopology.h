@@ -0,0 +1,206 @@
+//
+//  DisplayTopology.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Topology
+  //------------------------------------------------------------------------------
+
+  struct DisplayRect
+  {
+    int32_t     m_x = 0;
+    int32_t     m_y = 0;
+    int32_t     m_width = 0;
+    int32_t     m_height = 0;
+  };
+
+  bool operator==(const DisplayRect& a, const DisplayRect& b);
+  bool operator!=(const DisplayRect& a, const DisplayRect& b);
+
+  //------------------------------------------------------------------------------
+  // Logical GPU -> physical GPU -> output -> monitor -> mosaic grid cell.
+  //
+  // Nodes refer to their parent by key instead of index, so fragments from
+  // providers that each see only part of the graph can be merged (see
+  // merge_display_topology()):
+  //
+  //   Physical GPUs are keyed by their adapter LUID (as hex).
+  //   Outputs and monitors are keyed by their GDI device name (\\.\DISPLAY1),
+  //   outputs not visible to the OS by their NVAPI display id (nv:0x...).
+  //   Mosaic grid cells refer to outputs by NVAPI display id.
+  //------------------------------------------------------------------------------
+
+  struct DisplayTopology
+  {
+    struct LogicalGpu
+    {
+      uint32_t        m_index = 0;
+    };
+
+    struct PhysicalGpu
+    {
+      std::string     m_key;
+      int32_t         m_logical_gpu = -1;     // Index of the logical GPU, -1 if unknown.
+      std::string     m_name;
+    };
+
+    struct Output
+    {
+      std::string     m_key;
+      std::string     m_gpu;                  // Key of the physical GPU, empty if unknown.
+      uint32_t        m_display_id = 0;       // NVAPI display id, 0 if unknown.
+      std::string     m_connector;
+      bool            m_is_active = false;
+    };
+
+    struct Monitor
+    {
+      std::string     m_key;                  // Same as the output driving it.
+      DisplayRect     m_rect;                 // Within the virtual screen.
+      uint32_t        m_refresh_rate_hz = 0;
+      bool            m_is_primary = false;
+    };
+
+    struct MosaicGrid
+    {
+      uint32_t                m_rows = 0;
+      uint32_t                m_columns = 0;
+      uint32_t                m_width = 0;    // Per display.
+      uint32_t                m_height = 0;
+      uint32_t                m_refresh_rate_hz = 0;
+      std::vector<uint32_t>   m_display_ids;  // Row major.
+    };
+
+    DisplayRect                 m_virtual_screen;
+    std::vector<LogicalGpu>     m_logical_gpus;
+    std::vector<PhysicalGpu>    m_physical_gpus;
+    std::vector<Output>         m_outputs;
+    std::vector<Monitor>        m_monitors;   // In enumeration order (EnumDisplayMonitors()).
+    std::vector<MosaicGrid>     m_mosaic_grids;
+
+    //------------------------------------------------------------------------------
+    // Of the cheap to query system state the topology was built for (see
+    // display_topology_fingerprint()), 0 if unknown.
+    uint64_t                    m_fingerprint = 0;
+
+    const PhysicalGpu* find_physical_gpu(const std::string& key) const;
+    const Output* find_output(const std::string& key) const;
+    const Output* find_output(uint32_t display_id) const;
+    const Monitor* find_monitor(const std::string& key) const;
+  };
+
+  //------------------------------------------------------------------------------
+  // Add the nodes of a fragment, filling in fields the topology does not know
+  // yet. Where both know a field the topology's value is kept, so providers
+  // merged first take precedence.
+  void merge_display_topology(DisplayTopology& topology, const DisplayTopology& fragment);
+
+  //------------------------------------------------------------------------------
+  // Human readable differences, empty if the topologies are the same.
+  std::vector<std::string> diff_display_topologies(const DisplayTopology& before, const DisplayTopology& after);
+
+  void print_display_topology(std::ostream& stream, const DisplayTopology& topology);
+
+  //------------------------------------------------------------------------------
+  // Hash of a description of the system state that is cheap to query (e.g. the
+  // display devices and their current modes), compared against the one a
+  // snapshot was taken for to tell whether it is still valid.
+  uint64_t display_topology_fingerprint(const std::string& description);
+
+  //------------------------------------------------------------------------------
+  // Snapshots
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // Compact binary form of a topology. Returns false on failure, loading also if
+  // the file is not a snapshot of the current version.
+  bool save_display_topology(const std::string& path, const DisplayTopology& topology);
+  bool load_display_topology(const std::string& path, DisplayTopology& topology);
+
+  //------------------------------------------------------------------------------
+  // Providers
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // Enumerates part of the topology through one API (Windows, NVAPI, DXGI, ...).
+  // Throws if the API is not available or fails.
+  class DisplayTopologyProvider
+  {
+  public:
+
+    virtual ~DisplayTopologyProvider() = default;
+
+    virtual const char* name() const = 0;
+    virtual DisplayTopology enumerate() = 0;
+  };
+
+  typedef std::vector<std::unique_ptr<DisplayTopologyProvider>> display_topology_providers_t;
+
+  //------------------------------------------------------------------------------
+  // Merge the fragments of all providers in order. Providers that fail are
+  // reported and skipped.
+  DisplayTopology build_display_topology(const display_topology_providers_t& providers);
+
+  //------------------------------------------------------------------------------
+  // Returns the given fragment, to build topologies without the real APIs.
+  class MockDisplayTopologyProvider final : public DisplayTopologyProvider
+  {
+  public:
+
+    MockDisplayTopologyProvider(const std::string& name, const DisplayTopology& fragment) : m_name(name), m_fragment(fragment) {}
+
+    const char* name() const override { return m_name.c_str(); }
+    DisplayTopology enumerate() override { return m_fragment; }
+
+  private:
+
+    const std::string       m_name;
+    const DisplayTopology   m_fragment;
+  };
+
+  //------------------------------------------------------------------------------
+  // Mock providers standing in for the Windows, NVAPI and DXGI ones, each seeing
+  // its part of a system with the given number of GPUs and monitors side by side.
+  // With mosaic enabled the monitors of all GPUs form one 1 x n grid that the OS
+  // sees as a single monitor.
+  struct MockDisplayLayout
+  {
+    size_t      m_num_gpus = 2;
+    size_t      m_num_monitors_per_gpu = 2;
+    int32_t     m_width = 1920;
+    int32_t     m_height = 1080;
+    uint32_t    m_refresh_rate_hz = 60;
+    bool        m_is_mosaic = false;
+  };
+
+  display_topology_providers_t create_mock_display_topology_providers(const MockDisplayLayout& layout);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
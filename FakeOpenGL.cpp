@@ -0,0 +1,436 @@
+//
+//  FakeOpenGL.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FakeOpenGL.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+  const size_t MAX_NAMES = 64;
+  const GLenum GL_FLOAT_VEC4 = 0x8B52;
+
+  //------------------------------------------------------------------------------
+  // There is only ever one program, the last created.
+  struct FakeProgram
+  {
+    const char* const*  m_attributes = nullptr;
+    size_t              m_num_attributes = 0;
+    const char* const*  m_frag_outputs = nullptr;
+    size_t              m_num_frag_outputs = 0;
+    const char* const*  m_uniforms = nullptr;
+    size_t              m_num_uniforms = 0;
+    const char* const*  m_uniform_blocks = nullptr;
+    size_t              m_num_uniform_blocks = 0;
+
+    GLint               m_attribute_locations[MAX_NAMES];
+    GLint               m_frag_data_locations[MAX_NAMES];
+    GLint               m_frag_data_indices[MAX_NAMES];
+  };
+
+  //------------------------------------------------------------------------------
+  // What a binary holds, the locations the program was linked with.
+  struct FakeBinary
+  {
+    GLint               m_attribute_locations[MAX_NAMES];
+    GLint               m_frag_data_locations[MAX_NAMES];
+    GLint               m_frag_data_indices[MAX_NAMES];
+  };
+
+  const GLint FAKE_UNIFORM_BLOCK_SIZE = 256;
+  const GLenum FAKE_BINARY_FORMAT = 1;
+
+  FakeProgram fake_program;
+  const char* fake_vendor = "Fake";
+  const char* fake_renderer = "Fake";
+  const char* fake_version = "Fake";
+  bool is_rejecting_binaries = false;
+  GLint link_status = GL_TRUE;
+  uint64_t num_calls = 0;
+  uint64_t num_introspection_calls = 0;
+  GLuint next_name = 1;
+
+  GLint find_name(const char* const* names, size_t num_names, const char* name)
+  {
+    for (size_t i = 0; i < num_names; ++i) {
+      if (strcmp(names[i], name) == 0) {
+        return GLint(i);
+      }
+    }
+
+    return -1;
+  }
+
+  GLint max_name_length(const char* const* names, size_t num_names)
+  {
+    GLint length = 0;
+
+    for (size_t i = 0; i < num_names; ++i) {
+      length = std::max(length, GLint(strlen(names[i]) + 1));
+    }
+
+    return length;
+  }
+
+  void copy_name(const char* source, GLsizei size, GLsizei* length, GLchar* name)
+  {
+    const size_t name_length = std::min(strlen(source), size_t(std::max(0, (size - 1))));
+
+    memcpy(name, source, name_length);
+    name[name_length] = '\0';
+
+    if (length) {
+      *length = GLsizei(name_length);
+    }
+  }
+
+  //------------------------------------------------------------------------------
+  // Give the unbound names the lowest locations not bound.
+  void assign_locations(GLint* locations, size_t num_names)
+  {
+    uint64_t used = 0;
+
+    for (size_t i = 0; i < num_names; ++i) {
+      if ((locations[i] >= 0) && (locations[i] < 64)) {
+        used |= (uint64_t(1) << locations[i]);
+      }
+    }
+
+    GLint next = 0;
+
+    for (size_t i = 0; i < num_names; ++i) {
+      if (locations[i] >= 0) {
+        continue;
+      }
+
+      while ((next < 64) && (used & (uint64_t(1) << next))) {
+        ++next;
+      }
+
+      locations[i] = next++;
+    }
+  }
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const GLubyte*
+glGetString(GLenum name)
+{
+  ++num_calls;
+  const char* const string = ((name == GL_VENDOR) ? fake_vendor : (name == GL_RENDERER) ? fake_renderer : (name == GL_VERSION) ? fake_version : "Fake");
+  return reinterpret_cast<const GLubyte*>(string);
+}
+
+void
+glGetIntegerv(GLenum name, GLint* value)
+{
+  ++num_calls;
+  *value = ((name == GL_NUM_PROGRAM_BINARY_FORMATS) ? 1 : 0);
+}
+
+GLuint glCreateShader(GLenum) { ++num_calls; return next_name++; }
+void glShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) { ++num_calls; }
+void glCompileShader(GLuint) { ++num_calls; }
+void glGetShaderInfoLog(GLuint, GLsizei, GLsizei* length, GLchar*) { ++num_calls; *length = 0; }
+void glDeleteShader(GLuint) { ++num_calls; }
+
+void
+glGetShaderiv(GLuint, GLenum name, GLint* value)
+{
+  ++num_calls;
+  *value = ((name == GL_COMPILE_STATUS) ? GL_TRUE : 0);
+}
+
+GLuint
+glCreateProgram()
+{
+  ++num_calls;
+  std::fill(std::begin(fake_program.m_attribute_locations), std::end(fake_program.m_attribute_locations), -1);
+  std::fill(std::begin(fake_program.m_frag_data_locations), std::end(fake_program.m_frag_data_locations), -1);
+  std::fill(std::begin(fake_program.m_frag_data_indices), std::end(fake_program.m_frag_data_indices), 0);
+  return next_name++;
+}
+
+void glAttachShader(GLuint, GLuint) { ++num_calls; }
+void glProgramParameteri(GLuint, GLenum, GLint) { ++num_calls; }
+void glValidateProgram(GLuint) { ++num_calls; }
+void glGetProgramInfoLog(GLuint, GLsizei, GLsizei* length, GLchar*) { ++num_calls; *length = 0; }
+void glDeleteProgram(GLuint) { ++num_calls; }
+
+void
+glBindAttribLocation(GLuint, GLuint location, const GLchar* name)
+{
+  ++num_calls;
+  const GLint i = find_name(fake_program.m_attributes, fake_program.m_num_attributes, name);
+
+  if (i >= 0) {
+    fake_program.m_attribute_locations[i] = GLint(location);
+  }
+}
+
+void
+glBindFragDataLocationIndexed(GLuint, GLuint location, GLuint index, const GLchar* name)
+{
+  ++num_calls;
+  const GLint i = find_name(fake_program.m_frag_outputs, fake_program.m_num_frag_outputs, name);
+
+  if (i >= 0) {
+    fake_program.m_frag_data_locations[i] = GLint(location);
+    fake_program.m_frag_data_indices[i] = GLint(index);
+  }
+}
+
+void
+glLinkProgram(GLuint)
+{
+  ++num_calls;
+  assign_locations(fake_program.m_attribute_locations, fake_program.m_num_attributes);
+  assign_locations(fake_program.m_frag_data_locations, fake_program.m_num_frag_outputs);
+  link_status = GL_TRUE;
+}
+
+void
+glGetProgramiv(GLuint, GLenum name, GLint* value)
+{
+  ++num_calls;
+
+  switch (name) {
+  case GL_LINK_STATUS:
+    *value = link_status;
+    break;
+
+  case GL_VALIDATE_STATUS:
+    *value = GL_TRUE;
+    break;
+
+  case GL_PROGRAM_BINARY_LENGTH:
+    *value = GLint(sizeof(FakeBinary));
+    break;
+
+  case GL_ACTIVE_ATTRIBUTES:
+    ++num_introspection_calls;
+    *value = GLint(fake_program.m_num_attributes);
+    break;
+
+  case GL_ACTIVE_ATTRIBUTE_MAX_LENGTH:
+    ++num_introspection_calls;
+    *value = max_name_length(fake_program.m_attributes, fake_program.m_num_attributes);
+    break;
+
+  case GL_ACTIVE_UNIFORMS:
+    ++num_introspection_calls;
+    *value = GLint(fake_program.m_num_uniforms);
+    break;
+
+  case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+    ++num_introspection_calls;
+    *value = max_name_length(fake_program.m_uniforms, fake_program.m_num_uniforms);
+    break;
+
+  case GL_ACTIVE_UNIFORM_BLOCKS:
+    ++num_introspection_calls;
+    *value = GLint(fake_program.m_num_uniform_blocks);
+    break;
+
+  case GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH:
+    ++num_introspection_calls;
+    *value = max_name_length(fake_program.m_uniform_blocks, fake_program.m_num_uniform_blocks);
+    break;
+
+  default:
+    *value = 0;
+    break;
+  }
+}
+
+void
+glGetActiveAttrib(GLuint, GLuint index, GLsizei size, GLsizei* length, GLint* attribute_size, GLenum* type, GLchar* name)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  copy_name(fake_program.m_attributes[index], size, length, name);
+  *attribute_size = 1;
+  *type = GL_FLOAT_VEC4;
+}
+
+GLint
+glGetAttribLocation(GLuint, const GLchar* name)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  const GLint i = find_name(fake_program.m_attributes, fake_program.m_num_attributes, name);
+  return ((i >= 0) ? fake_program.m_attribute_locations[i] : -1);
+}
+
+GLint
+glGetFragDataLocation(GLuint, const GLchar* name)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  const GLint i = find_name(fake_program.m_frag_outputs, fake_program.m_num_frag_outputs, name);
+  return ((i >= 0) ? fake_program.m_frag_data_locations[i] : -1);
+}
+
+GLint
+glGetFragDataIndex(GLuint, const GLchar* name)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  const GLint i = find_name(fake_program.m_frag_outputs, fake_program.m_num_frag_outputs, name);
+  return ((i >= 0) ? fake_program.m_frag_data_indices[i] : -1);
+}
+
+GLint
+glGetUniformLocation(GLuint, const GLchar* name)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  return find_name(fake_program.m_uniforms, fake_program.m_num_uniforms, name);
+}
+
+void
+glGetActiveUniform(GLuint, GLuint index, GLsizei size, GLsizei* length, GLint* uniform_size, GLenum* type, GLchar* name)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  copy_name(fake_program.m_uniforms[index], size, length, name);
+  *uniform_size = 1;
+  *type = GL_FLOAT_VEC4;
+}
+
+void
+glGetActiveUniformsiv(GLuint, GLsizei count, const GLuint*, GLenum, GLint* values)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  std::fill_n(values, count, -1);
+}
+
+void
+glGetActiveUniformBlockName(GLuint, GLuint index, GLsizei size, GLsizei* length, GLchar* name)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  copy_name(fake_program.m_uniform_blocks[index], size, length, name);
+}
+
+void
+glGetActiveUniformBlockiv(GLuint, GLuint, GLenum name, GLint* value)
+{
+  ++num_calls;
+  ++num_introspection_calls;
+  *value = ((name == GL_UNIFORM_BLOCK_DATA_SIZE) ? FAKE_UNIFORM_BLOCK_SIZE : 0);
+}
+
+void
+glGetProgramBinary(GLuint, GLsizei size, GLsizei* length, GLenum* format, void* binary)
+{
+  ++num_calls;
+  FakeBinary fake_binary;
+  std::copy(std::begin(fake_program.m_attribute_locations), std::end(fake_program.m_attribute_locations), fake_binary.m_attribute_locations);
+  std::copy(std::begin(fake_program.m_frag_data_locations), std::end(fake_program.m_frag_data_locations), fake_binary.m_frag_data_locations);
+  std::copy(std::begin(fake_program.m_frag_data_indices), std::end(fake_program.m_frag_data_indices), fake_binary.m_frag_data_indices);
+
+  *length = std::min(size, GLsizei(sizeof(fake_binary)));
+  *format = FAKE_BINARY_FORMAT;
+  memcpy(binary, &fake_binary, size_t(*length));
+}
+
+void
+glProgramBinary(GLuint, GLenum format, const void* binary, GLsizei length)
+{
+  ++num_calls;
+  link_status = GL_FALSE;
+
+  if (is_rejecting_binaries || (format != FAKE_BINARY_FORMAT) || (length != GLsizei(sizeof(FakeBinary)))) {
+    return;
+  }
+
+  link_status = GL_TRUE;
+
+  FakeBinary fake_binary;
+  memcpy(&fake_binary, binary, sizeof(fake_binary));
+  std::copy(std::begin(fake_binary.m_attribute_locations), std::end(fake_binary.m_attribute_locations), fake_program.m_attribute_locations);
+  std::copy(std::begin(fake_binary.m_frag_data_locations), std::end(fake_binary.m_frag_data_locations), fake_program.m_frag_data_locations);
+  std::copy(std::begin(fake_binary.m_frag_data_indices), std::end(fake_binary.m_frag_data_indices), fake_program.m_frag_data_indices);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void
+  set_fake_opengl_program(const char* const* attributes, size_t num_attributes, const char* const* frag_outputs, size_t num_frag_outputs)
+  {
+    fake_program.m_attributes = attributes;
+    fake_program.m_num_attributes = std::min(num_attributes, MAX_NAMES);
+    fake_program.m_frag_outputs = frag_outputs;
+    fake_program.m_num_frag_outputs = std::min(num_frag_outputs, MAX_NAMES);
+    num_calls = 0;
+    num_introspection_calls = 0;
+  }
+
+  void
+  set_fake_opengl_uniforms(const char* const* uniforms, size_t num_uniforms, const char* const* uniform_blocks, size_t num_uniform_blocks)
+  {
+    fake_program.m_uniforms = uniforms;
+    fake_program.m_num_uniforms = std::min(num_uniforms, MAX_NAMES);
+    fake_program.m_uniform_blocks = uniform_blocks;
+    fake_program.m_num_uniform_blocks = std::min(num_uniform_blocks, MAX_NAMES);
+  }
+
+  void
+  set_fake_opengl_driver(const char* vendor, const char* renderer, const char* version)
+  {
+    fake_vendor = vendor;
+    fake_renderer = renderer;
+    fake_version = version;
+  }
+
+  void
+  set_fake_opengl_rejects_binaries(bool is_rejecting)
+  {
+    is_rejecting_binaries = is_rejecting;
+  }
+
+  uint64_t
+  fake_opengl_calls()
+  {
+    return num_calls;
+  }
+
+  uint64_t
+  fake_opengl_introspection_calls()
+  {
+    return num_introspection_calls;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,141 @@
+//
+//  FakeOpenGL.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// The part of OpenGL the program utilities use (see OpenGLUtilities.h), standing
+// in for a driver when built with TOOLBOX_FAKE_OPENGL, so the CPU side of creating
+// programs can be measured without a GPU. Shaders always compile, programs always
+// link and have the active attributes and fragment outputs set with
+// toolbox::set_fake_opengl_program() and the uniforms and uniform blocks set with
+// toolbox::set_fake_opengl_uniforms(). Program binaries hold the locations, so
+// the program cache (see OpenGLProgramCache.h) works too, and can be made to be
+// rejected. Nothing allocates. Not thread safe.
+//------------------------------------------------------------------------------
+
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef char GLchar;
+typedef unsigned char GLubyte;
+
+#define GL_NONE                               0
+#define GL_FALSE                              0
+#define GL_TRUE                               1
+#define GL_INVALID_INDEX                      0xFFFFFFFFu
+#define GL_INVALID_ENUM                       0x0500
+#define GL_VENDOR                             0x1F00
+#define GL_RENDERER                           0x1F01
+#define GL_VERSION                            0x1F02
+#define GL_PROGRAM_BINARY_LENGTH              0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS         0x87FE
+#define GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH 0x8A35
+#define GL_ACTIVE_UNIFORM_BLOCKS              0x8A36
+#define GL_UNIFORM_BLOCK_INDEX                0x8A3A
+#define GL_UNIFORM_OFFSET                     0x8A3B
+#define GL_UNIFORM_BLOCK_DATA_SIZE            0x8A40
+#define GL_FRAGMENT_SHADER                    0x8B30
+#define GL_VERTEX_SHADER                      0x8B31
+#define GL_COMPILE_STATUS                     0x8B81
+#define GL_LINK_STATUS                        0x8B82
+#define GL_VALIDATE_STATUS                    0x8B83
+#define GL_INFO_LOG_LENGTH                    0x8B84
+#define GL_ACTIVE_UNIFORMS                    0x8B86
+#define GL_ACTIVE_UNIFORM_MAX_LENGTH          0x8B87
+#define GL_ACTIVE_ATTRIBUTES                  0x8B89
+#define GL_ACTIVE_ATTRIBUTE_MAX_LENGTH        0x8B8A
+#define GL_SHADING_LANGUAGE_VERSION           0x8B8C
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT    0x8257
+#define GL_PROGRAM_SEPARABLE                  0x8258
+
+const GLubyte* glGetString(GLenum name);
+void glGetIntegerv(GLenum name, GLint* value);
+
+GLuint glCreateShader(GLenum type);
+void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* sources, const GLint* lengths);
+void glCompileShader(GLuint shader);
+void glGetShaderiv(GLuint shader, GLenum name, GLint* value);
+void glGetShaderInfoLog(GLuint shader, GLsizei size, GLsizei* length, GLchar* info_log);
+void glDeleteShader(GLuint shader);
+
+GLuint glCreateProgram();
+void glAttachShader(GLuint program, GLuint shader);
+void glProgramParameteri(GLuint program, GLenum name, GLint value);
+void glBindAttribLocation(GLuint program, GLuint location, const GLchar* name);
+void glBindFragDataLocationIndexed(GLuint program, GLuint location, GLuint index, const GLchar* name);
+void glLinkProgram(GLuint program);
+void glValidateProgram(GLuint program);
+void glGetProgramiv(GLuint program, GLenum name, GLint* value);
+void glGetProgramInfoLog(GLuint program, GLsizei size, GLsizei* length, GLchar* info_log);
+void glGetActiveAttrib(GLuint program, GLuint index, GLsizei size, GLsizei* length, GLint* attribute_size, GLenum* type, GLchar* name);
+GLint glGetAttribLocation(GLuint program, const GLchar* name);
+GLint glGetFragDataLocation(GLuint program, const GLchar* name);
+GLint glGetFragDataIndex(GLuint program, const GLchar* name);
+GLint glGetUniformLocation(GLuint program, const GLchar* name);
+void glGetActiveUniform(GLuint program, GLuint index, GLsizei size, GLsizei* length, GLint* uniform_size, GLenum* type, GLchar* name);
+void glGetActiveUniformsiv(GLuint program, GLsizei count, const GLuint* indices, GLenum name, GLint* values);
+void glGetActiveUniformBlockName(GLuint program, GLuint index, GLsizei size, GLsizei* length, GLchar* name);
+void glGetActiveUniformBlockiv(GLuint program, GLuint index, GLenum name, GLint* value);
+void glGetProgramBinary(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary);
+void glProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length);
+void glDeleteProgram(GLuint program);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // The active attributes and fragment outputs of every program linked from now
+  // on, in order. The names must outlive their use. Locations not bound before
+  // linking are assigned in order, skipping bound ones.
+  void set_fake_opengl_program(const char* const* attributes, size_t num_attributes, const char* const* frag_outputs, size_t num_frag_outputs);
+
+  //------------------------------------------------------------------------------
+  // The active uniforms, all vec4s of the default block at consecutive locations,
+  // and uniform blocks, of 256 bytes each, of every program linked from now on.
+  // The names must outlive their use.
+  void set_fake_opengl_uniforms(const char* const* uniforms, size_t num_uniforms, const char* const* uniform_blocks, size_t num_uniform_blocks);
+
+  //------------------------------------------------------------------------------
+  // The strings glGetString() returns for GL_VENDOR, GL_RENDERER and GL_VERSION
+  // ("Fake" by default), which identify the driver to the program cache. The
+  // strings must outlive their use.
+  void set_fake_opengl_driver(const char* vendor, const char* renderer, const char* version);
+
+  //------------------------------------------------------------------------------
+  // Whether glProgramBinary() fails to link every binary, as after a driver
+  // update that kept its strings.
+  void set_fake_opengl_rejects_binaries(bool is_rejecting);
+
+  //------------------------------------------------------------------------------
+  // Calls made since the program was set, all of them and those asking about the
+  // program's attributes, uniforms, uniform blocks and fragment outputs.
+  uint64_t fake_opengl_calls();
+  uint64_t fake_opengl_introspection_calls();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,250 @@
+//
+//  FileWatcher.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <exception>
+#include <set>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+
+    std::string directory_of(const std::string& path)
+    {
+      const size_t separator = path.find_last_of("/\\");
+      return ((separator == std::string::npos) ? "." : ((separator == 0) ? "/" : path.substr(0, separator)));
+    }
+
+  } // unnamed namespace
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  FileWatcher::FileWatcher(const std::vector<std::string>& paths, callback_t on_change, std::chrono::milliseconds settle_time) :
+    m_on_change(std::move(on_change)), m_settle_time(settle_time)
+  {
+    for (const std::string& path : paths) {
+      m_files.push_back(read_state(path));
+    }
+
+    open_watches();
+    m_thread = std::thread(&FileWatcher::run, this);
+  }
+
+  FileWatcher::~FileWatcher()
+  {
+    m_stop = true;
+    m_thread.join();
+    close_watches();
+  }
+
+  const char*
+  FileWatcher::mechanism() const
+  {
+#if defined(_WIN32)
+    return (m_handles.empty() ? "polling" : "change notifications");
+#elif defined(__linux__)
+    return ((m_inotify == -1) ? "polling" : "inotify");
+#else
+    return "polling";
+#endif
+  }
+
+  FileWatcher::FileState
+  FileWatcher::read_state(const std::string& path)
+  {
+    FileState state;
+    state.m_path = path;
+
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+
+    if (GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) {
+      state.m_exists = true;
+      state.m_modification_time = ((int64_t(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime);
+      state.m_size = ((int64_t(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow);
+    }
+#else
+    struct stat attributes = {};
+
+    if (stat(path.c_str(), &attributes) == 0) {
+      state.m_exists = true;
+#if defined(__APPLE__)
+      state.m_modification_time = ((int64_t(attributes.st_mtimespec.tv_sec) * 1000000000) + attributes.st_mtimespec.tv_nsec);
+#else
+      state.m_modification_time = ((int64_t(attributes.st_mtim.tv_sec) * 1000000000) + attributes.st_mtim.tv_nsec);
+#endif
+      state.m_size = int64_t(attributes.st_size);
+    }
+#endif
+
+    return state;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // One watch per directory. If any fails the files are polled instead.
+  void
+  FileWatcher::open_watches()
+  {
+    std::set<std::string> directories;
+
+    for (const FileState& file : m_files) {
+      directories.insert(directory_of(file.m_path));
+    }
+
+#if defined(_WIN32)
+    for (const std::string& directory : directories) {
+      if (m_handles.size() == MAXIMUM_WAIT_OBJECTS) {
+        close_watches();
+        return;
+      }
+
+      const HANDLE handle = FindFirstChangeNotificationA(directory.c_str(), FALSE, (FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE));
+
+      if (handle == INVALID_HANDLE_VALUE) {
+        close_watches();
+        return;
+      }
+
+      m_handles.push_back(handle);
+    }
+#elif defined(__linux__)
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    for (const std::string& directory : directories) {
+      if ((m_inotify == -1) || (inotify_add_watch(m_inotify, directory.c_str(), (IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM)) == -1)) {
+        close_watches();
+        return;
+      }
+    }
+#endif
+  }
+
+  void
+  FileWatcher::close_watches()
+  {
+#if defined(_WIN32)
+    for (void* const handle : m_handles) {
+      FindCloseChangeNotification(handle);
+    }
+
+    m_handles.clear();
+#elif defined(__linux__)
+    if (m_inotify != -1) {
+      close(m_inotify);
+      m_inotify = -1;
+    }
+#endif
+  }
+
+  bool
+  FileWatcher::wait_for_event(std::chrono::milliseconds timeout)
+  {
+#if defined(_WIN32)
+    if (!m_handles.empty()) {
+      const DWORD result = WaitForMultipleObjects(DWORD(m_handles.size()), m_handles.data(), FALSE, DWORD(timeout.count()));
+
+      if ((result >= WAIT_OBJECT_0) && (result < (WAIT_OBJECT_0 + m_handles.size()))) {
+        FindNextChangeNotification(m_handles[result - WAIT_OBJECT_0]);
+        return true;
+      }
+
+      return false;
+    }
+#elif defined(__linux__)
+    if (m_inotify != -1) {
+      pollfd descriptor = { m_inotify, POLLIN, 0 };
+
+      if (poll(&descriptor, 1, int(timeout.count())) <= 0) {
+        return false;
+      }
+
+      //------------------------------------------------------------------------------
+      // Only that something happened matters, the files are compared anyway.
+      alignas(inotify_event) char events[4096];
+
+      while (read(m_inotify, events, sizeof(events)) > 0) {
+      }
+
+      return true;
+    }
+#endif
+
+    std::this_thread::sleep_for(timeout);
+    return true;
+  }
+
+  void
+  FileWatcher::run()
+  {
+    static const std::chrono::milliseconds STOP_CHECK_INTERVAL(100);
+
+    const bool is_polling = (std::string(mechanism()) == "polling");
+
+    while (!m_stop) {
+      if (!wait_for_event(STOP_CHECK_INTERVAL)) {
+        continue;
+      }
+
+      while (!is_polling && !m_stop && wait_for_event(m_settle_time)) {
+      }
+
+      for (FileState& file : m_files) {
+        const FileState state = read_state(file.m_path);
+
+        if ((state.m_exists == file.m_exists) && (state.m_modification_time == file.m_modification_time) && (state.m_size == file.m_size)) {
+          continue;
+        }
+
+        file = state;
+
+        try {
+          m_on_change(file.m_path);
+        }
+        catch (std::exception&) {
+          // The watcher carries on, reporting is up to the callback.
+        }
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,96 @@
+//
+//  FileWatcher.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Watches files on a thread of its own and calls back, on that thread, with the
+  // path of every file whose modification time or size changed (or that appeared
+  // or disappeared). The directories of the files are watched with inotify on
+  // Linux and change notifications on Windows, elsewhere the files are polled.
+  //
+  // Events are collected till none came for the settle time, so a save that
+  // truncates, writes and renames is reported once.
+  //------------------------------------------------------------------------------
+
+  class FileWatcher
+  {
+  public:
+
+    typedef std::function<void(const std::string& path)> callback_t;
+
+    FileWatcher(const std::vector<std::string>& paths, callback_t on_change, std::chrono::milliseconds settle_time = std::chrono::milliseconds(50));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    //------------------------------------------------------------------------------
+    // "inotify", "change notifications" or "polling".
+    const char* mechanism() const;
+
+  private:
+
+    struct FileState
+    {
+      std::string   m_path;
+      bool          m_exists = false;
+      int64_t       m_modification_time = 0;    // In the platform's unit.
+      int64_t       m_size = 0;
+    };
+
+    static FileState read_state(const std::string& path);
+
+    void open_watches();
+    void close_watches();
+
+    //------------------------------------------------------------------------------
+    // True if something may have changed within the timeout, always when polling.
+    bool wait_for_event(std::chrono::milliseconds timeout);
+
+    void run();
+
+    std::vector<FileState>          m_files;
+    const callback_t                m_on_change;
+    const std::chrono::milliseconds m_settle_time;
+
+#if defined(_WIN32)
+    std::vector<void*>              m_handles;
+#elif defined(__linux__)
+    int                             m_inotify = -1;
+#endif
+
+    std::atomic<bool>               m_stop { false };
+    std::thread                     m_thread;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
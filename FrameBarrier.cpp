@@ -0,0 +1,143 @@
+//
+//  FrameBarrier.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameBarrier.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOOLBOX_CPU_RELAX() _mm_pause()
+#else
+#define TOOLBOX_CPU_RELAX() std::this_thread::yield()
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  FrameBarrier::FrameBarrier(size_t num_threads, std::chrono::nanoseconds spin_budget, std::chrono::nanoseconds timeout)
+    : m_num_threads(num_threads)
+    , m_spin_budget(spin_budget)
+    , m_timeout(timeout)
+  {
+    assert(num_threads > 0);
+  }
+
+  bool
+  FrameBarrier::arrive_and_wait()
+  {
+    if (is_broken()) {
+      return false;
+    }
+
+    //------------------------------------------------------------------------------
+    // The generation must be read before arriving, the last thread advances it as
+    // soon as the count is complete.
+    const uint64_t generation = m_generation.load(std::memory_order_acquire);
+
+    if ((m_arrived.fetch_add(1, std::memory_order_acq_rel) + 1) == m_num_threads) {
+      m_arrived.store(0, std::memory_order_relaxed);
+      m_generation.store((generation + 1), std::memory_order_seq_cst);
+
+      if (m_num_blocked.load(std::memory_order_seq_cst) > 0) {
+        wake_blocked_threads();
+      }
+
+      return true;
+    }
+
+    return wait_for_generation(generation);
+  }
+
+  bool
+  FrameBarrier::wait_for_generation(uint64_t generation)
+  {
+    //------------------------------------------------------------------------------
+    // Spin, reading the clock and yielding only every few iterations. Yielding
+    // keeps an oversubscribed machine from spinning away the time slices of the
+    // threads still to arrive.
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto spin_end_time = (start_time + m_spin_budget);
+
+    for (uint32_t i = 1; ; ++i) {
+      if (has_advanced(generation)) {
+        return true;
+      }
+
+      if (is_broken()) {
+        return false;
+      }
+
+      if ((i % 64) == 0) {
+        if (std::chrono::steady_clock::now() >= spin_end_time) {
+          break;
+        }
+
+        std::this_thread::yield();
+      }
+      else {
+        TOOLBOX_CPU_RELAX();
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Block. Announcing the blocked thread before checking the generation pairs
+    // with the last thread advancing the generation before checking for blocked
+    // threads, one of the two always sees the other.
+    m_blocked_waits.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_num_blocked.fetch_add(1, std::memory_order_seq_cst);
+
+    const bool completed = m_event.wait_until(lock, (start_time + m_timeout), [this, generation]() {
+      return (has_advanced(generation) || is_broken());
+    });
+
+    m_num_blocked.fetch_sub(1, std::memory_order_relaxed);
+
+    if (completed && has_advanced(generation)) {
+      return true;
+    }
+
+    //------------------------------------------------------------------------------
+    // Timed out (or another thread did), release everybody else.
+    if (!m_broken.exchange(true, std::memory_order_acq_rel)) {
+      m_event.notify_all();
+    }
+
+    return false;
+  }
+
+  void
+  FrameBarrier::wake_blocked_threads()
+  {
+    //------------------------------------------------------------------------------
+    // Taking the lock ensures a thread between checking the generation and
+    // blocking is not missed.
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_event.notify_all();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
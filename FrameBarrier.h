@@ -0,0 +1,93 @@
+//
+//  FrameBarrier.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Reusable barrier for a fixed number of threads, meant to lock-step render
+  // threads once per frame (or every few frames).
+  //
+  // Sense-reversing: the sense is a generation counter which the last thread to
+  // arrive advances, so the barrier can be reused immediately and callers need
+  // no local sense. Waiting threads spin for up to the spin budget, then block
+  // on a condition variable; the last thread only takes the lock if somebody
+  // is blocked.
+  //
+  // A wait that exceeds the timeout breaks the barrier: that and every later
+  // wait (of any thread) returns false immediately, which lets a stuck thread
+  // be detected without deadlocking the others.
+  //------------------------------------------------------------------------------
+
+  class FrameBarrier
+  {
+  public:
+
+    FrameBarrier(size_t num_threads,
+                 std::chrono::nanoseconds spin_budget = std::chrono::microseconds(100),
+                 std::chrono::nanoseconds timeout = std::chrono::seconds(1));
+
+    FrameBarrier(const FrameBarrier&) = delete;
+    FrameBarrier& operator=(const FrameBarrier&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Returns true once all threads arrived, false if the barrier is broken.
+    bool arrive_and_wait();
+
+    bool is_broken() const { return m_broken.load(std::memory_order_acquire); }
+    size_t num_threads() const { return m_num_threads; }
+
+    //------------------------------------------------------------------------------
+    // Number of completed rendezvous and of waits that had to block.
+    uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+    uint64_t blocked_waits() const { return m_blocked_waits.load(std::memory_order_relaxed); }
+
+  private:
+
+    bool wait_for_generation(uint64_t generation);
+    bool has_advanced(uint64_t generation) const { return (m_generation.load(std::memory_order_acquire) != generation); }
+    void wake_blocked_threads();
+
+    const size_t                    m_num_threads;
+    const std::chrono::nanoseconds  m_spin_budget;
+    const std::chrono::nanoseconds  m_timeout;
+
+    // Written by every arriving thread, kept apart from what the waiters poll.
+    alignas(64) std::atomic<size_t>     m_arrived { 0 };
+    alignas(64) std::atomic<uint64_t>   m_generation { 0 };
+    std::atomic<bool>                   m_broken { false };
+    std::atomic<size_t>                 m_num_blocked { 0 };
+    std::atomic<uint64_t>               m_blocked_waits { 0 };
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_event;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,251 @@
+//
+//  FramePacing.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacing.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOOLBOX_CPU_RELAX() _mm_pause()
+#else
+#define TOOLBOX_CPU_RELAX() std::this_thread::yield()
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void
+  SteadyClock::sleep_until(time_point time)
+  {
+    std::this_thread::sleep_until(time);
+  }
+
+  void
+  SteadyClock::relax()
+  {
+    TOOLBOX_CPU_RELAX();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  SimulatedClock::SimulatedClock(duration sleep_latency, duration sleep_jitter, duration relax_step, time_point start_time)
+    : m_sleep_latency(sleep_latency)
+    , m_sleep_jitter(sleep_jitter)
+    , m_relax_step(relax_step)
+    , m_now(start_time)
+  {
+  }
+
+  void
+  SimulatedClock::sleep_until(time_point time)
+  {
+    //------------------------------------------------------------------------------
+    // xorshift64, the jitter is uniform in [0, m_sleep_jitter].
+    m_random ^= (m_random << 13);
+    m_random ^= (m_random >> 7);
+    m_random ^= (m_random << 17);
+
+    const duration jitter = ((m_sleep_jitter.count() > 0) ? duration(int64_t(m_random % uint64_t(m_sleep_jitter.count() + 1))) : duration(0));
+
+    m_now = (std::max(m_now, time) + m_sleep_latency + jitter);
+    ++m_sleeps;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void
+  WakeStatistics::add(std::chrono::nanoseconds error)
+  {
+    const int64_t error_ns = int64_t(error.count());
+
+    if (m_count == 0) {
+      m_min_ns = error_ns;
+      m_max_ns = error_ns;
+    }
+    else {
+      m_min_ns = std::min(m_min_ns, error_ns);
+      m_max_ns = std::max(m_max_ns, error_ns);
+    }
+
+    if (error_ns < 0) {
+      ++m_early_count;
+    }
+
+    ++m_count;
+
+    const double delta = (double(error_ns) - m_mean_ns);
+    m_mean_ns += (delta / double(m_count));
+    m_m2_ns += (delta * (double(error_ns) - m_mean_ns));
+  }
+
+  double
+  WakeStatistics::standard_deviation_ns() const
+  {
+    return ((m_count > 1) ? std::sqrt(m_m2_ns / double(m_count - 1)) : 0.0);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  PrecisionWaiter::PrecisionWaiter(Clock& clock, Clock::duration initial_margin, Clock::duration min_margin, Clock::duration max_margin)
+    : m_clock(clock)
+    , m_min_margin(min_margin)
+    , m_max_margin(max_margin)
+    , m_margin(std::min(std::max(initial_margin, min_margin), max_margin))
+    , m_latency_mean_ns(double(std::chrono::duration_cast<std::chrono::nanoseconds>(m_margin).count()) / 2.0)
+  {
+  }
+
+  Clock::time_point
+  PrecisionWaiter::wait_until(Clock::time_point deadline)
+  {
+    //------------------------------------------------------------------------------
+    // Coarse sleep, skipped if the deadline is already within the margin.
+    const Clock::time_point sleep_target = (deadline - m_margin);
+    Clock::time_point now = m_clock.now();
+
+    if (now < sleep_target) {
+      m_clock.sleep_until(sleep_target);
+      now = m_clock.now();
+
+      const Clock::duration sleep_latency = (now - sleep_target);
+      m_sleep_statistics.add(std::chrono::duration_cast<std::chrono::nanoseconds>(sleep_latency));
+      adapt(sleep_latency, (now > deadline));
+    }
+
+    //------------------------------------------------------------------------------
+    // Spin for the remainder.
+    while (now < deadline) {
+      m_clock.relax();
+      now = m_clock.now();
+    }
+
+    m_wake_statistics.add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline));
+    return now;
+  }
+
+  void
+  PrecisionWaiter::adapt(Clock::duration sleep_latency, bool overshot)
+  {
+    //------------------------------------------------------------------------------
+    // Exponentially weighted mean and mean absolute deviation of the latency, the
+    // margin covers the mean plus four deviations. Overshooting the deadline
+    // means the estimate is too optimistic, back off immediately.
+    constexpr double ALPHA = (1.0 / 16.0);
+    constexpr double DEVIATIONS = 4.0;
+
+    const double latency_ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(sleep_latency).count());
+    const double error_ns = (latency_ns - m_latency_mean_ns);
+
+    m_latency_mean_ns += (ALPHA * error_ns);
+    m_latency_deviation_ns += (ALPHA * (std::abs(error_ns) - m_latency_deviation_ns));
+
+    Clock::duration margin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::nano>(m_latency_mean_ns + (DEVIATIONS * m_latency_deviation_ns)));
+
+    if (overshot) {
+      margin = std::max(margin, std::chrono::duration_cast<Clock::duration>((sleep_latency * 3) / 2));
+    }
+
+    m_margin = std::min(std::max(margin, m_min_margin), m_max_margin);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void
+  FixedIntervalPacer::wait()
+  {
+    const Clock::time_point target = m_next_frame_time;
+    m_next_frame_time += m_interval;
+
+    m_clock.sleep_until(target);
+    record_wake(target, m_clock.now());
+  }
+
+  void
+  HybridPacer::wait()
+  {
+    const Clock::time_point target = m_next_frame_time;
+    m_next_frame_time += m_interval;
+
+    record_wake(target, m_waiter.wait_until(target));
+  }
+
+  void
+  DelayBeforeSwapPacer::wait()
+  {
+    m_delay_before_swap(m_delay);
+
+    const Clock::time_point now = m_clock.now();
+
+    if (m_has_previous_wake) {
+      record_wake((m_previous_wake + m_refresh_interval), now);
+    }
+
+    m_previous_wake = now;
+    m_has_previous_wake = true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  std::unique_ptr<FramePacer>
+  create_frame_pacer(const std::string& name, Clock& clock, const FramePacerConfig& config)
+  {
+    if (name == "free-run") {
+      return std::unique_ptr<FramePacer>(new FreeRunPacer());
+    }
+
+    if (name == "fixed") {
+      return std::unique_ptr<FramePacer>(new FixedIntervalPacer(clock, config.m_interval));
+    }
+
+    if (name == "hybrid") {
+      return std::unique_ptr<FramePacer>(new HybridPacer(clock, config.m_interval, config.m_spin_margin));
+    }
+
+    if (name == "delay-before-swap") {
+      if (!config.m_delay_before_swap) {
+        throw std::runtime_error("Delay before swap is not available!");
+      }
+
+      return std::unique_ptr<FramePacer>(new DelayBeforeSwapPacer(clock, config.m_interval, config.m_delay_before_swap, config.m_delay));
+    }
+
+    throw std::runtime_error("Unknown frame pacer: " + name);
+  }
+
+  std::vector<std::string>
+  frame_pacer_names()
+  {
+    return { "free-run", "fixed", "hybrid", "delay-before-swap" };
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,312 @@
+//
+//  FramePacing.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Source of time for frame pacing. Pacers only ever read and wait on time
+  // through this interface so they can be driven by a simulated clock.
+  //------------------------------------------------------------------------------
+
+  class Clock
+  {
+  public:
+
+    typedef std::chrono::steady_clock::time_point time_point;
+    typedef std::chrono::steady_clock::duration duration;
+
+    virtual ~Clock() = default;
+
+    virtual time_point now() = 0;
+
+    //------------------------------------------------------------------------------
+    // Block the calling thread until (at least) the given time.
+    virtual void sleep_until(time_point time) = 0;
+
+    //------------------------------------------------------------------------------
+    // Called once per iteration of a busy wait, usually a CPU pause hint.
+    virtual void relax() = 0;
+  };
+
+  class SteadyClock final : public Clock
+  {
+  public:
+
+    time_point now() override { return std::chrono::steady_clock::now(); }
+    void sleep_until(time_point time) override;
+    void relax() override;
+  };
+
+  //------------------------------------------------------------------------------
+  // Virtual time for checking pacers without waiting (see Benchmarks pacing).
+  // Time only moves when advanced, slept or relaxed: a sleep wakes a latency
+  // after its target (the given one plus a pseudo-random share of the jitter,
+  // the same sequence every run), a relax takes a fixed step. For one thread.
+  //------------------------------------------------------------------------------
+
+  class SimulatedClock final : public Clock
+  {
+  public:
+
+    explicit SimulatedClock(duration sleep_latency = std::chrono::microseconds(0),
+                            duration sleep_jitter = std::chrono::microseconds(0),
+                            duration relax_step = std::chrono::microseconds(1),
+                            time_point start_time = time_point());
+
+    time_point now() override { return m_now; }
+    void sleep_until(time_point time) override;
+    void relax() override { m_now += m_relax_step; ++m_relaxes; }
+
+    //------------------------------------------------------------------------------
+    // Time passing outside of the pacer, e.g. encoding a frame.
+    void advance(duration time) { m_now += time; }
+
+    uint64_t sleeps() const { return m_sleeps; }
+    uint64_t relaxes() const { return m_relaxes; }
+
+  private:
+
+    const duration    m_sleep_latency;
+    const duration    m_sleep_jitter;
+    const duration    m_relax_step;
+
+    time_point        m_now;
+    uint64_t          m_random = 0x2545f4914f6cdd1dull;
+    uint64_t          m_sleeps = 0;
+    uint64_t          m_relaxes = 0;
+  };
+
+  //------------------------------------------------------------------------------
+  // Statistics of how far a pacer's actual wake times were from its targets. The
+  // error is (actual - target), positive values are late (overshoot), negative
+  // values early (undershoot).
+  //------------------------------------------------------------------------------
+
+  class WakeStatistics
+  {
+  public:
+
+    void add(std::chrono::nanoseconds error);
+
+    uint64_t count() const { return m_count; }
+    double mean_ns() const { return m_mean_ns; }
+    double standard_deviation_ns() const;
+    int64_t min_ns() const { return m_min_ns; }
+    int64_t max_ns() const { return m_max_ns; }
+    uint64_t early_count() const { return m_early_count; }
+
+  private:
+
+    uint64_t    m_count = 0;
+    uint64_t    m_early_count = 0;
+    double      m_mean_ns = 0.0;
+    double      m_m2_ns = 0.0;          // Sum of squared differences from the mean (Welford).
+    int64_t     m_min_ns = 0;
+    int64_t     m_max_ns = 0;
+  };
+
+  //------------------------------------------------------------------------------
+  // Waits until a deadline with much better accuracy than a plain sleep.
+  //
+  // The thread sleeps until a margin before the deadline and busy waits (with a
+  // CPU pause hint) for the remainder. The margin adapts to the measured OS wake
+  // latency: it tracks a running mean and mean deviation of how late the coarse
+  // sleep wakes and keeps the margin a few deviations above the mean. A coarse
+  // sleep that wakes past the deadline widens the margin immediately.
+  //------------------------------------------------------------------------------
+
+  class PrecisionWaiter
+  {
+  public:
+
+    explicit PrecisionWaiter(Clock& clock,
+                             Clock::duration initial_margin = std::chrono::microseconds(1000),
+                             Clock::duration min_margin = std::chrono::microseconds(50),
+                             Clock::duration max_margin = std::chrono::microseconds(4000));
+
+    //------------------------------------------------------------------------------
+    // Returns the time actually woken up at.
+    Clock::time_point wait_until(Clock::time_point deadline);
+
+    Clock::duration margin() const { return m_margin; }
+
+    //------------------------------------------------------------------------------
+    // Error of the final wake relative to the deadline, and of the coarse sleep
+    // relative to its own target (the OS wake latency).
+    const WakeStatistics& wake_statistics() const { return m_wake_statistics; }
+    const WakeStatistics& sleep_statistics() const { return m_sleep_statistics; }
+
+  private:
+
+    void adapt(Clock::duration sleep_latency, bool overshot);
+
+    Clock&                  m_clock;
+    const Clock::duration   m_min_margin;
+    const Clock::duration   m_max_margin;
+    Clock::duration         m_margin;
+
+    double                  m_latency_mean_ns;
+    double                  m_latency_deviation_ns = 0.0;
+
+    WakeStatistics          m_wake_statistics;
+    WakeStatistics          m_sleep_statistics;
+  };
+
+  //------------------------------------------------------------------------------
+  // Decides when a render thread starts encoding its next frame.
+  //------------------------------------------------------------------------------
+
+  class FramePacer
+  {
+  public:
+
+    virtual ~FramePacer() = default;
+
+    virtual const char* name() const = 0;
+
+    //------------------------------------------------------------------------------
+    // Called once before the first frame with the time that frame should start.
+    virtual void start(Clock::time_point first_frame_time) { m_next_frame_time = first_frame_time; }
+
+    //------------------------------------------------------------------------------
+    // Called at the start of every frame, returns when encoding should begin.
+    virtual void wait() = 0;
+
+    const WakeStatistics& wake_statistics() const { return m_wake_statistics; }
+
+  protected:
+
+    void record_wake(Clock::time_point target, Clock::time_point actual)
+    {
+      m_wake_statistics.add(std::chrono::duration_cast<std::chrono::nanoseconds>(actual - target));
+    }
+
+    Clock::time_point   m_next_frame_time;
+    WakeStatistics      m_wake_statistics;
+  };
+
+  //------------------------------------------------------------------------------
+  // Start encoding as soon as the previous frame was swapped. Wake statistics
+  // remain empty.
+  class FreeRunPacer final : public FramePacer
+  {
+  public:
+
+    const char* name() const override { return "free-run"; }
+    void wait() override {}
+  };
+
+  //------------------------------------------------------------------------------
+  // Sleep until fixed intervals after the first frame time. This relies on the
+  // plain OS sleep and serves as the baseline for the other pacers.
+  class FixedIntervalPacer final : public FramePacer
+  {
+  public:
+
+    FixedIntervalPacer(Clock& clock, Clock::duration interval) : m_clock(clock), m_interval(interval) {}
+
+    const char* name() const override { return "fixed"; }
+    void wait() override;
+
+  private:
+
+    Clock&                  m_clock;
+    const Clock::duration   m_interval;
+  };
+
+  //------------------------------------------------------------------------------
+  // As FixedIntervalPacer but wait with a PrecisionWaiter, trading CPU time for
+  // wake accuracy. The spin margin is the waiter's initial margin.
+  class HybridPacer final : public FramePacer
+  {
+  public:
+
+    HybridPacer(Clock& clock, Clock::duration interval, Clock::duration spin_margin)
+      : m_waiter(clock, spin_margin), m_interval(interval) {}
+
+    const char* name() const override { return "hybrid"; }
+    void wait() override;
+
+    const PrecisionWaiter& waiter() const { return m_waiter; }
+
+  private:
+
+    PrecisionWaiter         m_waiter;
+    const Clock::duration   m_interval;
+  };
+
+  //------------------------------------------------------------------------------
+  // Let the driver wait until the given time before the next vertical blank
+  // (e.g. wglDelayBeforeSwapNV). The wake target is not known up front, the
+  // previous wake plus one refresh interval is used instead so the statistics
+  // measure the jitter of the driver's wake up.
+  class DelayBeforeSwapPacer final : public FramePacer
+  {
+  public:
+
+    typedef std::function<bool(float seconds)> delay_before_swap_t;
+
+    DelayBeforeSwapPacer(Clock& clock, Clock::duration refresh_interval, delay_before_swap_t delay_before_swap, float delay)
+      : m_clock(clock), m_refresh_interval(refresh_interval), m_delay_before_swap(std::move(delay_before_swap)), m_delay(delay) {}
+
+    const char* name() const override { return "delay-before-swap"; }
+    void wait() override;
+
+  private:
+
+    Clock&                      m_clock;
+    const Clock::duration       m_refresh_interval;
+    const delay_before_swap_t   m_delay_before_swap;
+    const float                 m_delay;
+    bool                        m_has_previous_wake = false;
+    Clock::time_point           m_previous_wake;
+  };
+
+  //------------------------------------------------------------------------------
+  // Run time selection.
+  //------------------------------------------------------------------------------
+
+  struct FramePacerConfig
+  {
+    Clock::duration                             m_interval = std::chrono::microseconds(1000000 / 60);
+    Clock::duration                             m_spin_margin = std::chrono::microseconds(1000);
+    DelayBeforeSwapPacer::delay_before_swap_t   m_delay_before_swap;
+    float                                       m_delay = (1.0f / 80.0f);
+  };
+
+  //------------------------------------------------------------------------------
+  // Create the pacer with the given name (see the name() of each pacer). Throws
+  // if the name is unknown or the pacer requires configuration that is missing.
+  std::unique_ptr<FramePacer> create_frame_pacer(const std::string& name, Clock& clock, const FramePacerConfig& config);
+
+  std::vector<std::string> frame_pacer_names();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,168 @@
+//
+//  FrameTimingLog.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTimingLog.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define TOOLBOX_LOG_WARNING(...) printf(__VA_ARGS__)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  FrameTimingLog::FrameTimingLog(std::chrono::milliseconds flush_interval)
+    : m_flush_interval(flush_interval)
+  {
+  }
+
+  FrameTimingLog::~FrameTimingLog()
+  {
+    stop();
+  }
+
+  FrameTimingLog::Channel*
+  FrameTimingLog::open_channel(const std::string& path, const FrameTraceHeader& header)
+  {
+    //------------------------------------------------------------------------------
+    // Opened before it is added, so the file is not created under the lock the
+    // flusher takes.
+    std::list<Channel> channels(1);
+    Channel& channel = channels.back();
+    channel.m_path = path;
+
+    if (!channel.m_writer.open(path, header)) {
+      TOOLBOX_LOG_WARNING("Failed to open frame timing log %s\n", path.c_str());
+      return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_channels.splice(m_channels.end(), channels);
+    return &channel;
+  }
+
+  void
+  FrameTimingLog::start(const SchedulingConfig& scheduling)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_flusher.joinable()) {
+      return;
+    }
+
+    m_stop_flag = false;
+    m_scheduling = scheduling;
+    m_flusher = std::thread(&FrameTimingLog::run, this);
+  }
+
+  void
+  FrameTimingLog::stop()
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_stop_flag = true;
+      m_stop_event.notify_all();
+    }
+
+    if (m_flusher.joinable()) {
+      m_flusher.join();
+    }
+
+    //------------------------------------------------------------------------------
+    // Final drain, the producers are expected to be done by now.
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (Channel& channel : m_channels) {
+      if (!channel.m_writer.is_open()) {
+        continue;
+      }
+
+      flush(channel);
+      channel.m_writer.close();
+
+      if (channel.dropped() > 0) {
+        TOOLBOX_LOG_WARNING("Frame timing log %s: %" PRIu64 " record(s) written, %" PRIu64 " dropped!\n",
+                            channel.m_path.c_str(), channel.m_written, channel.dropped());
+      }
+    }
+  }
+
+  void
+  FrameTimingLog::run()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const ScopedThreadScheduling scheduling(m_scheduling);
+
+    //------------------------------------------------------------------------------
+    // Channels are only ever added and stay where they are, so the ones known are
+    // written without holding the lock and open_channel() never waits for the disk.
+    std::vector<Channel*> channels;
+
+    while (!m_stop_flag) {
+      m_stop_event.wait_for(lock, m_flush_interval, [this]() { return m_stop_flag; });
+
+      channels.clear();
+
+      for (Channel& channel : m_channels) {
+        channels.push_back(&channel);
+      }
+
+      lock.unlock();
+
+      for (Channel* const channel : channels) {
+        if (channel->m_writer.is_open()) {
+          flush(*channel);
+        }
+      }
+
+      lock.lock();
+    }
+
+    m_flusher_report = scheduling.report();
+  }
+
+  std::string
+  FrameTimingLog::flusher_report()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_flusher_report;
+  }
+
+  void
+  FrameTimingLog::flush(Channel& channel)
+  {
+    FrameTimingRecord records[256];
+    size_t count = 0;
+
+    while ((count = channel.m_ring.pop(records, (sizeof(records) / sizeof(records[0])))) > 0) {
+      channel.m_writer.append(records, count);
+      channel.m_written += count;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,124 @@
+//
+//  FrameTimingLog.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTrace.h"
+#include "SpscRingBuffer.h"
+#include "ThreadScheduling.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Collects frame timings from any number of render threads and writes them to
+  // disk from a background thread.
+  //
+  // Each render thread pushes into its own channel, a lock-free SPSC ring, so the
+  // render thread never takes a lock or makes a system call in steady state. The
+  // flusher thread periodically drains all channels and appends to each
+  // channel's binary trace (see FrameTrace.h). Records pushed while a channel
+  // is full are dropped and counted.
+  //------------------------------------------------------------------------------
+
+  class FrameTimingLog
+  {
+  public:
+
+    class Channel
+    {
+    public:
+
+      //------------------------------------------------------------------------------
+      // Render thread side. Returns false if the record was dropped.
+      bool push(const FrameTimingRecord& record) { return m_ring.try_push(record); }
+
+      uint64_t dropped() const { return m_ring.dropped(); }
+      const std::string& path() const { return m_path; }
+
+    private:
+
+      friend class FrameTimingLog;
+
+      // 4096 records cover more than a minute at 60 Hz, plenty of head room for a
+      // flusher stalled on I/O.
+      SpscRingBuffer<FrameTimingRecord, 4096>    m_ring;
+
+      std::string         m_path;
+      FrameTraceWriter    m_writer;
+      uint64_t            m_written = 0;
+    };
+
+    explicit FrameTimingLog(std::chrono::milliseconds flush_interval = std::chrono::milliseconds(100));
+    ~FrameTimingLog();
+
+    FrameTimingLog(const FrameTimingLog&) = delete;
+    FrameTimingLog& operator=(const FrameTimingLog&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Open a channel writing a trace with the given header to the given file.
+    // Returns nullptr if the file could not be opened. Channels remain valid until
+    // the log is destroyed.
+    Channel* open_channel(const std::string& path, const FrameTraceHeader& header);
+
+    //------------------------------------------------------------------------------
+    // Start/stop the flusher thread, running with the given scheduling. Stopping
+    // drains all channels, closes their files and reports dropped records.
+    void start(const SchedulingConfig& scheduling = SchedulingConfig());
+    void stop();
+
+    //------------------------------------------------------------------------------
+    // The scheduling of the flusher thread and its context switches (see
+    // ScopedThreadScheduling::report()), once stopped.
+    std::string flusher_report();
+
+    //------------------------------------------------------------------------------
+    // The flusher thread, for placing it (see ThreadAffinity.h). Valid while started.
+    std::thread::native_handle_type flusher_native_handle() { return m_flusher.native_handle(); }
+
+  private:
+
+    void run();
+    void flush(Channel& channel);
+
+    const std::chrono::milliseconds     m_flush_interval;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_stop_event;
+    bool                                m_stop_flag = false;
+    std::list<Channel>                  m_channels;
+    std::thread                         m_flusher;
+    SchedulingConfig                    m_scheduling;
+    std::string                         m_flusher_report;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,302 @@
+//
+//  FrameTrace.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTrace.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+  //------------------------------------------------------------------------------
+  // Columns in the order they are stored within a block.
+  int64_t toolbox::FrameTimingRecord::* const COLUMNS[] = {
+    &toolbox::FrameTimingRecord::m_frame_us,
+    &toolbox::FrameTimingRecord::m_sync_us,
+    &toolbox::FrameTimingRecord::m_encode_us,
+    &toolbox::FrameTimingRecord::m_swap_us,
+    &toolbox::FrameTimingRecord::m_swap_end_us,
+  };
+
+  struct block_header_t {
+    uint32_t  m_record_count;
+    uint32_t  m_payload_size;
+  };
+
+  //------------------------------------------------------------------------------
+  // The header with the first size bytes taken from data, the rest defaults. Goes
+  // through bytes as the header is not trivial (its fields have initializers).
+  toolbox::FrameTraceHeader read_header(const uint8_t* data, size_t size)
+  {
+    const toolbox::FrameTraceHeader defaults;
+    uint8_t bytes[sizeof(toolbox::FrameTraceHeader)];
+    toolbox::FrameTraceHeader header;
+
+    memcpy(bytes, &defaults, sizeof(bytes));
+    memcpy(bytes, data, std::min(size, sizeof(bytes)));
+    memcpy(&header, bytes, sizeof(header));
+    return header;
+  }
+
+  inline uint64_t zigzag_encode(int64_t value)
+  {
+    return ((uint64_t(value) << 1) ^ uint64_t(value >> 63));
+  }
+
+  inline int64_t zigzag_decode(uint64_t value)
+  {
+    return (int64_t(value >> 1) ^ -int64_t(value & 1));
+  }
+
+  inline void write_varint(std::vector<uint8_t>& buffer, uint64_t value)
+  {
+    while (value >= 0x80) {
+      buffer.push_back(uint8_t(value | 0x80));
+      value >>= 7;
+    }
+
+    buffer.push_back(uint8_t(value));
+  }
+
+  inline bool read_varint(const uint8_t*& p, const uint8_t* const end, uint64_t& value)
+  {
+    value = 0;
+
+    for (unsigned shift = 0; (p < end) && (shift < 64); shift += 7) {
+      const uint8_t byte = *p++;
+      value |= (uint64_t(byte & 0x7f) << shift);
+
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  constexpr uint32_t FrameTraceHeader::MAGIC;
+  constexpr uint32_t FrameTraceHeader::MIN_VERSION;
+  constexpr uint32_t FrameTraceHeader::VERSION;
+  constexpr size_t FrameTraceWriter::BLOCK_SIZE;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool
+  FrameTraceWriter::open(const std::string& path, const FrameTraceHeader& header)
+  {
+    close();
+
+    m_file = fopen(path.c_str(), "wb");
+
+    if (!m_file) {
+      return false;
+    }
+
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1) {
+      fclose(m_file);
+      m_file = nullptr;
+      return false;
+    }
+
+    m_records.reserve(BLOCK_SIZE);
+    return true;
+  }
+
+  void
+  FrameTraceWriter::append(const FrameTimingRecord* const records, size_t count)
+  {
+    if (!m_file) {
+      return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      m_records.push_back(records[i]);
+
+      if (m_records.size() == BLOCK_SIZE) {
+        write_block();
+      }
+    }
+  }
+
+  void
+  FrameTraceWriter::close()
+  {
+    if (!m_file) {
+      return;
+    }
+
+    write_block();
+    fclose(m_file);
+    m_file = nullptr;
+  }
+
+  void
+  FrameTraceWriter::write_block()
+  {
+    if (m_records.empty()) {
+      return;
+    }
+
+    m_payload.clear();
+
+    uint64_t prev_frame_index = 0;
+
+    for (const FrameTimingRecord& record : m_records) {
+      write_varint(m_payload, zigzag_encode(int64_t(record.m_frame_index - prev_frame_index)));
+      prev_frame_index = record.m_frame_index;
+    }
+
+    for (const auto column : COLUMNS) {
+      int64_t prev_value = 0;
+
+      for (const FrameTimingRecord& record : m_records) {
+        write_varint(m_payload, zigzag_encode(record.*column - prev_value));
+        prev_value = record.*column;
+      }
+    }
+
+    const block_header_t block_header = { uint32_t(m_records.size()), uint32_t(m_payload.size()) };
+
+    fwrite(&block_header, sizeof(block_header), 1, m_file);
+    fwrite(m_payload.data(), 1, m_payload.size(), m_file);
+    fflush(m_file);
+
+    m_records.clear();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool
+  FrameTraceReader::open(const uint8_t* const data, size_t size)
+  {
+    //------------------------------------------------------------------------------
+    // The fields common to all versions come first, check those before copying as
+    // much of the header as the file provides.
+    constexpr size_t MIN_HEADER_SIZE = offsetof(FrameTraceHeader, m_epoch_ns);
+
+    if (size < MIN_HEADER_SIZE) {
+      return false;
+    }
+
+    m_header = read_header(data, MIN_HEADER_SIZE);
+
+    if ((m_header.m_magic != FrameTraceHeader::MAGIC) ||
+        (m_header.m_version < FrameTraceHeader::MIN_VERSION) ||
+        (m_header.m_version > FrameTraceHeader::VERSION) ||
+        (m_header.m_header_size < MIN_HEADER_SIZE) ||
+        (m_header.m_header_size > size))
+    {
+      return false;
+    }
+
+    m_header = read_header(data, m_header.m_header_size);
+
+    m_header.m_gpu_name[sizeof(m_header.m_gpu_name) - 1] = '\0';
+
+    m_blocks = (data + m_header.m_header_size);
+    m_blocks_size = (size - m_header.m_header_size);
+    return true;
+  }
+
+  bool
+  FrameTraceReader::read_all(std::vector<FrameTimingRecord>& records) const
+  {
+    return for_each_block([&records](const FrameTimingRecord* const block_records, size_t count) {
+      records.insert(records.end(), block_records, (block_records + count));
+    });
+  }
+
+  bool
+  FrameTraceReader::for_each_block(const std::function<void(const FrameTimingRecord* records, size_t count)>& f) const
+  {
+    std::vector<FrameTimingRecord> records;
+    const uint8_t* p = m_blocks;
+    const uint8_t* const end = (m_blocks + m_blocks_size);
+
+    while (p < end) {
+      block_header_t block_header;
+
+      if (size_t(end - p) < sizeof(block_header)) {
+        return false;
+      }
+
+      memcpy(&block_header, p, sizeof(block_header));
+      p += sizeof(block_header);
+
+      //------------------------------------------------------------------------------
+      // Every value takes at least one byte, which also bounds the record count of
+      // a corrupt block.
+      if ((size_t(end - p) < block_header.m_payload_size) ||
+          ((size_t(block_header.m_record_count) * (1 + (sizeof(COLUMNS) / sizeof(COLUMNS[0])))) > block_header.m_payload_size))
+      {
+        return false;
+      }
+
+      const uint8_t* const block_end = (p + block_header.m_payload_size);
+      records.resize(block_header.m_record_count);
+
+      FrameTimingRecord* const block_records = records.data();
+      uint64_t value = 0;
+      uint64_t prev_frame_index = 0;
+
+      for (size_t i = 0; i < block_header.m_record_count; ++i) {
+        if (!read_varint(p, block_end, value)) {
+          return false;
+        }
+
+        prev_frame_index += uint64_t(zigzag_decode(value));
+        block_records[i].m_frame_index = prev_frame_index;
+      }
+
+      for (const auto column : COLUMNS) {
+        int64_t prev_value = 0;
+
+        for (size_t i = 0; i < block_header.m_record_count; ++i) {
+          if (!read_varint(p, block_end, value)) {
+            return false;
+          }
+
+          prev_value += zigzag_decode(value);
+          block_records[i].*column = prev_value;
+        }
+      }
+
+      f(block_records, records.size());
+      p = block_end;
+    }
+
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
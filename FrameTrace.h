@@ -0,0 +1,160 @@
+//
+//  FrameTrace.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Timings of a single frame of a render thread, all in microseconds. The swap
+  // end time is taken when the swap returns and is relative to the start time
+  // shared by all render threads (the epoch), so it can be compared across
+  // threads to determine how far apart the monitors flip.
+  //------------------------------------------------------------------------------
+
+  struct FrameTimingRecord
+  {
+    uint64_t    m_frame_index;
+    int64_t     m_frame_us;
+    int64_t     m_sync_us;
+    int64_t     m_encode_us;
+    int64_t     m_swap_us;
+    int64_t     m_swap_end_us;
+  };
+
+  //------------------------------------------------------------------------------
+  // Binary frame timing trace, one file per render thread.
+  //
+  // A fixed size header identifies the thread, monitor and GPU and is followed
+  // by blocks of records. Each block starts with its record count and payload
+  // size, the payload stores the record fields column by column. Every value is
+  // delta encoded against the previous value of the same column within the
+  // block, zig-zag mapped and written as a LEB128 varint. Blocks are
+  // independent so a trace cut short by a crash is readable up to its last
+  // complete block. Readers accept older (shorter) headers, fields missing from
+  // those keep their defaults. Fixed size fields are stored in native byte order
+  // (little endian on all platforms this runs on).
+  //------------------------------------------------------------------------------
+
+  struct FrameTraceHeader
+  {
+    static constexpr uint32_t MAGIC = 0x43525446;   // 'FTRC'
+    static constexpr uint32_t MIN_VERSION = 1;
+    static constexpr uint32_t VERSION = 2;
+
+    uint32_t    m_magic = MAGIC;
+    uint32_t    m_version = VERSION;
+    uint32_t    m_header_size = sizeof(FrameTraceHeader);
+    uint32_t    m_thread_index = 0;
+    uint32_t    m_monitor_index = 0;
+    int32_t     m_gpu_index = -1;           // CUDA device ordinal, -1 if unknown.
+    int32_t     m_monitor_x = 0;            // Monitor rect within the virtual screen.
+    int32_t     m_monitor_y = 0;
+    int32_t     m_monitor_width = 0;
+    int32_t     m_monitor_height = 0;
+    uint32_t    m_refresh_rate_mhz = 0;     // Millihertz, 0 if unknown.
+    uint32_t    m_reserved = 0;
+    char        m_gpu_name[64] = {};
+
+    //------------------------------------------------------------------------------
+    // Version 2.
+    uint64_t    m_epoch_ns = 0;             // Shared start time (steady clock), 0 if unknown.
+  };
+
+  static_assert(sizeof(FrameTraceHeader) == 120, "Unexpected trace header layout!");
+  static_assert(offsetof(FrameTraceHeader, m_epoch_ns) == 112, "Unexpected trace header layout!");
+
+  class FrameTraceWriter
+  {
+  public:
+
+    FrameTraceWriter() = default;
+    ~FrameTraceWriter() { close(); }
+
+    FrameTraceWriter(const FrameTraceWriter&) = delete;
+    FrameTraceWriter& operator=(const FrameTraceWriter&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Create the file and write the header. Returns false on failure.
+    bool open(const std::string& path, const FrameTraceHeader& header);
+
+    //------------------------------------------------------------------------------
+    // Buffer records, complete blocks are encoded and written as they fill up.
+    void append(const FrameTimingRecord* records, size_t count);
+
+    //------------------------------------------------------------------------------
+    // Write any buffered records as a final (partial) block and close the file.
+    void close();
+
+    bool is_open() const { return (m_file != nullptr); }
+
+  private:
+
+    static constexpr size_t BLOCK_SIZE = 4096;
+
+    void write_block();
+
+    FILE*                           m_file = nullptr;
+    std::vector<FrameTimingRecord>  m_records;
+    std::vector<uint8_t>            m_payload;
+  };
+
+  //------------------------------------------------------------------------------
+  // Decoder for a trace held in memory (usually a MappedFile).
+  //------------------------------------------------------------------------------
+
+  class FrameTraceReader
+  {
+  public:
+
+    //------------------------------------------------------------------------------
+    // Parse the header. Returns false if the data is not a supported trace.
+    bool open(const uint8_t* data, size_t size);
+
+    const FrameTraceHeader& header() const { return m_header; }
+
+    //------------------------------------------------------------------------------
+    // Decode all complete blocks, appending to the given records. Returns false if
+    // a corrupt or truncated block was encountered, all records before it are
+    // still returned.
+    bool read_all(std::vector<FrameTimingRecord>& records) const;
+
+    //------------------------------------------------------------------------------
+    // Decode block by block, handing each block's records to the given function.
+    // This avoids holding the whole trace in memory. Returns false as read_all().
+    bool for_each_block(const std::function<void(const FrameTimingRecord* records, size_t count)>& f) const;
+
+  private:
+
+    FrameTraceHeader    m_header;
+    const uint8_t*      m_blocks = nullptr;
+    size_t              m_blocks_size = 0;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
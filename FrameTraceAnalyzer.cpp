@@ -0,0 +1,615 @@
+//
+//  FrameTraceAnalyzer.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTrace.h"
+#include "MappedFile.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Options
+    //------------------------------------------------------------------------------
+
+    struct options_t {
+        double                      m_refresh_rate = 0.0;   // Overrides the rate in the trace header if non-zero.
+        bool                        m_skew = false;
+        int64_t                     m_skew_threshold_us = 100;
+        std::vector<std::string>    m_paths;
+    };
+
+    void print_usage(std::ostream& stream)
+    {
+        stream << "Usage: FrameTraceAnalyzer [--refresh-rate=<Hz>] <trace> [<trace> ...]" << std::endl;
+        stream << "       FrameTraceAnalyzer --skew [--skew-threshold=<us>] [--refresh-rate=<Hz>] <trace> <trace> [<trace> ...]" << std::endl;
+    }
+
+    bool parse_options(int argc, char* argv[], options_t& options)
+    {
+        static const char REFRESH_RATE_OPTION[] = "--refresh-rate=";
+        static const char SKEW_THRESHOLD_OPTION[] = "--skew-threshold=";
+
+        for (int i = 1; i < argc; ++i) {
+            if (strncmp(argv[i], REFRESH_RATE_OPTION, (sizeof(REFRESH_RATE_OPTION) - 1)) == 0) {
+                options.m_refresh_rate = atof(argv[i] + (sizeof(REFRESH_RATE_OPTION) - 1));
+
+                if (options.m_refresh_rate <= 0.0) {
+                    std::cerr << "Error: Invalid refresh rate: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strncmp(argv[i], SKEW_THRESHOLD_OPTION, (sizeof(SKEW_THRESHOLD_OPTION) - 1)) == 0) {
+                options.m_skew_threshold_us = atoll(argv[i] + (sizeof(SKEW_THRESHOLD_OPTION) - 1));
+
+                if (options.m_skew_threshold_us < 0) {
+                    std::cerr << "Error: Invalid skew threshold: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strcmp(argv[i], "--skew") == 0) {
+                options.m_skew = true;
+            }
+            else if (strncmp(argv[i], "--", 2) == 0) {
+                std::cerr << "Error: Unknown option: " << argv[i] << std::endl;
+                return false;
+            }
+            else {
+                options.m_paths.push_back(argv[i]);
+            }
+        }
+
+        return (options.m_paths.size() >= (options.m_skew ? 2 : 1));
+    }
+
+    //------------------------------------------------------------------------------
+    // Statistics
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Nearest-rank percentiles of the given values, which are reordered in the
+    // process. Percentiles must be given in ascending order.
+    template <typename T, size_t N>
+    std::array<T, N> percentiles(std::vector<T>& values, const std::array<double, N>& ps)
+    {
+        std::array<T, N> result = {};
+
+        if (values.empty()) {
+            return result;
+        }
+
+        auto first = begin(values);
+
+        for (size_t i = 0; i < N; ++i) {
+            const size_t rank = std::max<size_t>(1, size_t(std::ceil(ps[i] * double(values.size()))));
+            const auto nth = (begin(values) + (std::min(rank, values.size()) - 1));
+
+            //------------------------------------------------------------------------------
+            // Each nth_element() only needs to partition what is right of the previous.
+            std::nth_element(first, nth, end(values));
+            result[i] = *nth;
+            first = nth;
+        }
+
+        return result;
+    }
+
+    int32_t clamp_to_int32(int64_t value)
+    {
+        return int32_t(std::max<int64_t>(INT32_MIN, std::min<int64_t>(INT32_MAX, value)));
+    }
+
+    std::string analyze(const std::string& path, const options_t& options)
+    {
+        std::ostringstream stream;
+        stream << path << ": ";
+
+        toolbox::MappedFile file;
+        toolbox::FrameTraceReader reader;
+
+        if (!file.open(path) || !reader.open(file.data(), file.size())) {
+            stream << "not a readable frame trace" << std::endl;
+            return stream.str();
+        }
+
+        //------------------------------------------------------------------------------
+        // Decode into one compact column per phase, the analysis needs nothing else.
+        // Typical records take 8-10 bytes encoded, reserve accordingly.
+        static const char* const PHASE_NAMES[] = { "frame", "sync", "encode", "swap" };
+        constexpr size_t NUM_PHASES = (sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]));
+        constexpr size_t FRAME_PHASE = 0;
+
+        std::array<std::vector<int32_t>, NUM_PHASES> phases;
+
+        for (auto& phase : phases) {
+            phase.reserve(file.size() / 8);
+        }
+
+        const bool is_complete = reader.for_each_block([&phases](const toolbox::FrameTimingRecord* const records, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                phases[0].push_back(clamp_to_int32(records[i].m_frame_us));
+                phases[1].push_back(clamp_to_int32(records[i].m_sync_us));
+                phases[2].push_back(clamp_to_int32(records[i].m_encode_us));
+                phases[3].push_back(clamp_to_int32(records[i].m_swap_us));
+            }
+        });
+
+        const toolbox::FrameTraceHeader header = reader.header();
+        file.close();
+
+        //------------------------------------------------------------------------------
+        // Identity.
+        stream << "thread " << header.m_thread_index
+            << ", monitor " << header.m_monitor_index
+            << " (" << header.m_monitor_x << " / " << header.m_monitor_y << ") [" << header.m_monitor_width << " x " << header.m_monitor_height << "]"
+            << ", GPU " << header.m_gpu_index << " " << header.m_gpu_name << std::endl;
+
+        if (!is_complete) {
+            stream << "  Warning: trace is truncated or corrupt, analyzing the readable part only" << std::endl;
+        }
+
+        const size_t num_frames = phases[FRAME_PHASE].size();
+        stream << "  " << num_frames << " frame(s)" << std::endl;
+
+        if (num_frames == 0) {
+            return stream.str();
+        }
+
+        //------------------------------------------------------------------------------
+        // Frame intervals in refresh periods, computed before the percentiles reorder
+        // the values. Without a known refresh rate the median frame interval is the
+        // best guess.
+        double refresh_rate = options.m_refresh_rate;
+        bool is_refresh_rate_assumed = false;
+
+        if ((refresh_rate <= 0.0) && (header.m_refresh_rate_mhz > 0)) {
+            refresh_rate = (header.m_refresh_rate_mhz / 1000.0);
+        }
+
+        if (refresh_rate <= 0.0) {
+            std::vector<int32_t> values(phases[FRAME_PHASE]);
+            const auto median = percentiles(values, std::array<double, 1>{ { 0.5 } });
+            refresh_rate = ((median[0] > 0) ? (1000000.0 / double(median[0])) : 60.0);
+            is_refresh_rate_assumed = true;
+        }
+
+        constexpr size_t BINS_PER_PERIOD = 4;
+        constexpr size_t NUM_BINS = (BINS_PER_PERIOD * 4);  // Last bin collects everything beyond.
+
+        const double period_us = (1000000.0 / refresh_rate);
+        std::array<size_t, NUM_BINS> histogram = {};
+        size_t missed_refreshes = 0;
+        size_t frames_with_missed_refreshes = 0;
+
+        for (const int32_t frame_us : phases[FRAME_PHASE]) {
+            const double periods = (double(frame_us) / period_us);
+            const size_t bin = std::min((NUM_BINS - 1), size_t(std::max(0.0, (periods * BINS_PER_PERIOD))));
+            ++histogram[bin];
+
+            const long long whole_periods = std::llround(periods);
+
+            if (whole_periods > 1) {
+                missed_refreshes += size_t(whole_periods - 1);
+                ++frames_with_missed_refreshes;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Per phase percentiles.
+        static const std::array<double, 5> PERCENTILES = { { 0.5, 0.9, 0.99, 0.999, 1.0 } };
+
+        stream << "  " << std::left << std::setw(8) << "[us]" << std::right;
+        stream << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::endl;
+
+        for (size_t phase_index = 0; phase_index < NUM_PHASES; ++phase_index) {
+            const auto ps = percentiles(phases[phase_index], PERCENTILES);
+
+            stream << "  " << std::left << std::setw(8) << PHASE_NAMES[phase_index] << std::right;
+
+            for (const int32_t p : ps) {
+                stream << std::setw(10) << p;
+            }
+
+            stream << std::endl;
+        }
+
+        //------------------------------------------------------------------------------
+        // Frame interval histogram and missed refreshes.
+        stream << "  Refresh rate " << std::fixed << std::setprecision(3) << refresh_rate << " Hz";
+
+        if (is_refresh_rate_assumed) {
+            stream << " (unknown, assuming median frame interval)";
+        }
+
+        stream << std::endl;
+        stream << "  Frame interval histogram [refresh periods]:" << std::endl;
+
+        for (size_t bin = 0; bin < NUM_BINS; ++bin) {
+            if (histogram[bin] == 0) {
+                continue;
+            }
+
+            const double lower = (double(bin) / BINS_PER_PERIOD);
+
+            stream << "    " << std::setprecision(2) << std::setw(5) << lower;
+
+            if (bin == (NUM_BINS - 1)) {
+                stream << " -      ";
+            }
+            else {
+                stream << " - " << std::setw(5) << (lower + (1.0 / BINS_PER_PERIOD));
+            }
+
+            stream << std::setw(12) << histogram[bin] << std::setw(9) << std::setprecision(3) << ((100.0 * histogram[bin]) / num_frames) << " %" << std::endl;
+        }
+
+        stream << "  Missed refreshes: " << missed_refreshes << " in " << frames_with_missed_refreshes << " frame(s)" << std::endl;
+
+        return stream.str();
+    }
+
+    //------------------------------------------------------------------------------
+    // Cross-monitor skew
+    //------------------------------------------------------------------------------
+
+    struct swap_trace_t {
+        std::string             m_path;
+        bool                    m_is_valid = false;
+        bool                    m_is_complete = false;
+        toolbox::FrameTraceHeader m_header;
+        std::vector<uint64_t>   m_frame_indices;
+        std::vector<int64_t>    m_swap_end_us;
+    };
+
+    swap_trace_t load_swap_trace(const std::string& path)
+    {
+        swap_trace_t trace;
+        trace.m_path = path;
+
+        toolbox::MappedFile file;
+        toolbox::FrameTraceReader reader;
+
+        if (!file.open(path) || !reader.open(file.data(), file.size())) {
+            return trace;
+        }
+
+        trace.m_is_valid = true;
+        trace.m_header = reader.header();
+        trace.m_frame_indices.reserve(file.size() / 8);
+        trace.m_swap_end_us.reserve(file.size() / 8);
+
+        trace.m_is_complete = reader.for_each_block([&trace](const toolbox::FrameTimingRecord* const records, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                trace.m_frame_indices.push_back(records[i].m_frame_index);
+                trace.m_swap_end_us.push_back(records[i].m_swap_end_us);
+            }
+        });
+
+        return trace;
+    }
+
+    //------------------------------------------------------------------------------
+    // Line up the swaps of all traces against the first trace: for each of its
+    // frames the nearest swap of every other trace within half a refresh period is
+    // taken as the same frame. Frames without a match in every trace (dropped or
+    // repeated frames) are counted but not included in the skew statistics. The
+    // skew of a frame is the spread between the earliest and latest swap.
+    std::string analyze_skew(const options_t& options)
+    {
+        std::ostringstream stream;
+
+        //------------------------------------------------------------------------------
+        // Load all traces concurrently.
+        std::vector<std::future<swap_trace_t>> loads;
+
+        for (const std::string& path : options.m_paths) {
+            loads.push_back(std::async(std::launch::async, load_swap_trace, path));
+        }
+
+        std::vector<swap_trace_t> traces;
+
+        for (auto& load : loads) {
+            traces.push_back(load.get());
+            const swap_trace_t& trace = traces.back();
+
+            if (!trace.m_is_valid) {
+                stream << trace.m_path << ": not a readable frame trace" << std::endl;
+                return stream.str();
+            }
+
+            stream << trace.m_path << ": thread " << trace.m_header.m_thread_index << ", monitor " << trace.m_header.m_monitor_index
+                << ", GPU " << trace.m_header.m_gpu_index << ", " << trace.m_swap_end_us.size() << " frame(s)";
+
+            if (!trace.m_is_complete) {
+                stream << " (truncated)";
+            }
+
+            stream << std::endl;
+        }
+
+        //------------------------------------------------------------------------------
+        // Swap times are only comparable if all traces share the same epoch.
+        const uint64_t epoch_ns = traces.front().m_header.m_epoch_ns;
+
+        for (const swap_trace_t& trace : traces) {
+            if (trace.m_header.m_epoch_ns == 0) {
+                stream << "Warning: " << trace.m_path << " does not record its epoch, assuming it is shared" << std::endl;
+            }
+            else if ((epoch_ns != 0) && (trace.m_header.m_epoch_ns != epoch_ns)) {
+                stream << "Error: " << trace.m_path << " was recorded relative to a different epoch (different run?)" << std::endl;
+                return stream.str();
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Refresh period for matching frames.
+        const swap_trace_t& reference = traces.front();
+        double refresh_rate = options.m_refresh_rate;
+
+        if ((refresh_rate <= 0.0) && (reference.m_header.m_refresh_rate_mhz > 0)) {
+            refresh_rate = (reference.m_header.m_refresh_rate_mhz / 1000.0);
+        }
+
+        if ((refresh_rate <= 0.0) && (reference.m_swap_end_us.size() > 1)) {
+            std::vector<int64_t> intervals(reference.m_swap_end_us.size());
+            std::adjacent_difference(begin(reference.m_swap_end_us), end(reference.m_swap_end_us), begin(intervals));
+            intervals.erase(begin(intervals));
+
+            const auto median = percentiles(intervals, std::array<double, 1>{ { 0.5 } });
+            refresh_rate = ((median[0] > 0) ? (1000000.0 / double(median[0])) : 0.0);
+        }
+
+        if (refresh_rate <= 0.0) {
+            refresh_rate = 60.0;
+        }
+
+        const int64_t max_match_distance_us = int64_t(500000.0 / refresh_rate);
+
+        stream << std::endl << "Refresh rate " << std::fixed << std::setprecision(3) << refresh_rate << " Hz, skew threshold " << options.m_skew_threshold_us << " us" << std::endl;
+
+        //------------------------------------------------------------------------------
+        // Match frames.
+        struct aligned_frame_t {
+            uint32_t    m_reference_index;
+            uint16_t    m_earliest;
+            uint16_t    m_latest;
+            int64_t     m_skew_us;
+        };
+
+        const size_t num_traces = traces.size();
+        std::vector<size_t> cursors(num_traces, 0);
+        std::vector<int64_t> offsets(num_traces, 0);
+        std::vector<double> offset_sums(num_traces, 0.0);
+        std::vector<int64_t> max_abs_offsets(num_traces, 0);
+        std::vector<aligned_frame_t> aligned_frames;
+        aligned_frames.reserve(reference.m_swap_end_us.size());
+        size_t num_unmatched = 0;
+
+        for (size_t i = 0; i < reference.m_swap_end_us.size(); ++i) {
+            const int64_t t = reference.m_swap_end_us[i];
+            bool is_matched = true;
+
+            for (size_t k = 1; k < num_traces; ++k) {
+                const std::vector<int64_t>& times = traces[k].m_swap_end_us;
+                size_t& c = cursors[k];
+
+                while (((c + 1) < times.size()) && (times[c + 1] <= t)) {
+                    ++c;
+                }
+
+                if (times.empty()) {
+                    is_matched = false;
+                    break;
+                }
+
+                int64_t offset = (times[c] - t);
+
+                if (((c + 1) < times.size()) && (std::llabs(times[c + 1] - t) < std::llabs(offset))) {
+                    offset = (times[c + 1] - t);
+                }
+
+                if (std::llabs(offset) > max_match_distance_us) {
+                    is_matched = false;
+                    break;
+                }
+
+                offsets[k] = offset;
+            }
+
+            if (!is_matched) {
+                ++num_unmatched;
+                continue;
+            }
+
+            aligned_frame_t frame = { uint32_t(i), 0, 0, 0 };
+            int64_t earliest = 0;
+            int64_t latest = 0;
+
+            for (size_t k = 1; k < num_traces; ++k) {
+                offset_sums[k] += double(offsets[k]);
+                max_abs_offsets[k] = std::max(max_abs_offsets[k], int64_t(std::llabs(offsets[k])));
+
+                if (offsets[k] < earliest) { earliest = offsets[k]; frame.m_earliest = uint16_t(k); }
+                if (offsets[k] > latest) { latest = offsets[k]; frame.m_latest = uint16_t(k); }
+            }
+
+            frame.m_skew_us = (latest - earliest);
+            aligned_frames.push_back(frame);
+        }
+
+        stream << aligned_frames.size() << " frame(s) aligned across all " << num_traces << " traces, " << num_unmatched << " frame(s) of the reference without a match in every trace" << std::endl;
+
+        if (aligned_frames.empty()) {
+            return stream.str();
+        }
+
+        //------------------------------------------------------------------------------
+        // Skew distribution.
+        std::vector<int64_t> skews(aligned_frames.size());
+        std::transform(begin(aligned_frames), end(aligned_frames), begin(skews), [](const aligned_frame_t& frame) { return frame.m_skew_us; });
+
+        static const std::array<double, 5> PERCENTILES = { { 0.5, 0.9, 0.99, 0.999, 1.0 } };
+        const auto ps = percentiles(skews, PERCENTILES);
+
+        stream << std::endl;
+        stream << "  " << std::left << std::setw(8) << "[us]" << std::right;
+        stream << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::endl;
+        stream << "  " << std::left << std::setw(8) << "skew" << std::right;
+
+        for (const int64_t p : ps) {
+            stream << std::setw(10) << p;
+        }
+
+        stream << std::endl;
+
+        //------------------------------------------------------------------------------
+        // Systematic per-thread offsets relative to the reference.
+        stream << std::endl << "  Offset relative to " << reference.m_path << " [us]:" << std::endl;
+
+        for (size_t k = 1; k < num_traces; ++k) {
+            stream << "    thread " << traces[k].m_header.m_thread_index << ": mean " << std::setprecision(1) << (offset_sums[k] / double(aligned_frames.size()))
+                << ", max |offset| " << max_abs_offsets[k] << std::endl;
+        }
+
+        //------------------------------------------------------------------------------
+        // Worst offenders.
+        constexpr size_t NUM_WORST = 10;
+        std::vector<aligned_frame_t> worst(aligned_frames);
+        const size_t num_worst = std::min(NUM_WORST, worst.size());
+
+        std::partial_sort(begin(worst), (begin(worst) + num_worst), end(worst), [](const aligned_frame_t& a, const aligned_frame_t& b) {
+            return (a.m_skew_us > b.m_skew_us);
+        });
+
+        stream << std::endl << "  Worst frames:" << std::endl;
+
+        for (size_t i = 0; i < num_worst; ++i) {
+            const aligned_frame_t& frame = worst[i];
+
+            stream << "    frame " << reference.m_frame_indices[frame.m_reference_index]
+                << " @ " << std::setprecision(3) << (double(reference.m_swap_end_us[frame.m_reference_index]) / 1000000.0) << " s"
+                << ": skew " << frame.m_skew_us << " us"
+                << ", earliest thread " << traces[frame.m_earliest].m_header.m_thread_index
+                << ", latest thread " << traces[frame.m_latest].m_header.m_thread_index << std::endl;
+        }
+
+        //------------------------------------------------------------------------------
+        // Drift: runs of consecutive frames with skew above the threshold. A frame
+        // without a match ends a run.
+        struct run_t {
+            size_t      m_first;            // Index into aligned_frames.
+            size_t      m_length = 0;
+            int64_t     m_max_skew_us = 0;
+        };
+
+        std::vector<run_t> runs;
+
+        for (size_t i = 0; i < aligned_frames.size(); ++i) {
+            const aligned_frame_t& frame = aligned_frames[i];
+
+            if (frame.m_skew_us <= options.m_skew_threshold_us) {
+                continue;
+            }
+
+            const bool continues_run = (!runs.empty() &&
+                ((runs.back().m_first + runs.back().m_length) == i) &&
+                (aligned_frames[i - 1].m_reference_index == (frame.m_reference_index - 1)));
+
+            if (!continues_run) {
+                runs.push_back(run_t{ i });
+            }
+
+            runs.back().m_length += 1;
+            runs.back().m_max_skew_us = std::max(runs.back().m_max_skew_us, frame.m_skew_us);
+        }
+
+        size_t frames_in_runs = 0;
+
+        for (const run_t& run : runs) {
+            frames_in_runs += run.m_length;
+        }
+
+        stream << std::endl << "  " << runs.size() << " run(s) above threshold covering " << frames_in_runs << " frame(s)" << std::endl;
+
+        constexpr size_t NUM_LONGEST = 10;
+        const size_t num_longest = std::min(NUM_LONGEST, runs.size());
+
+        std::partial_sort(begin(runs), (begin(runs) + num_longest), end(runs), [](const run_t& a, const run_t& b) {
+            return (a.m_length > b.m_length);
+        });
+
+        for (size_t i = 0; i < num_longest; ++i) {
+            const run_t& run = runs[i];
+            const uint32_t reference_index = aligned_frames[run.m_first].m_reference_index;
+
+            stream << "    frame " << reference.m_frame_indices[reference_index]
+                << " @ " << std::setprecision(3) << (double(reference.m_swap_end_us[reference_index]) / 1000000.0) << " s"
+                << ": " << run.m_length << " frame(s), max skew " << run.m_max_skew_us << " us" << std::endl;
+        }
+
+        return stream.str();
+    }
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char* argv[])
+{
+    options_t options;
+
+    if (!parse_options(argc, argv, options)) {
+        print_usage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    if (options.m_skew) {
+        std::cout << analyze_skew(options) << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Traces are independent, analyze them concurrently but report in order.
+    std::vector<std::future<std::string>> reports;
+
+    for (const std::string& path : options.m_paths) {
+        reports.push_back(std::async(std::launch::async, analyze, path, std::cref(options)));
+    }
+
+    for (auto& report : reports) {
+        std::cout << report.get() << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
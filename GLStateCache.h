@@ -0,0 +1,301 @@
+//
+//  GLStateCache.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramReflection.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Shadows the state of one OpenGL context that the render threads set every
+  // frame and only passes on calls that change it. Owned by the thread the
+  // context is current on, one per context.
+  //
+  // The calls go to ApiT, so the cache can be measured without a GPU (see
+  // CountingGLApi):
+  //
+  //   void use_program(uint32_t program)
+  //   void bind_vertex_array(uint32_t vertex_array)
+  //   void bind_draw_framebuffer(uint32_t framebuffer)
+  //   void enable_scissor_test(bool is_enabled)
+  //   void enable_program_point_size(bool is_enabled)
+  //   void scissor(int32_t x, int32_t y, int32_t width, int32_t height)
+  //   void clear_color(float r, float g, float b, float a)
+  //   int32_t get_uniform_location(uint32_t program, const char* name)
+  //   void uniform_4fv(int32_t location, const float* value)
+  //   void uniform_matrix_4fv(int32_t location, const float* value)
+  //   void bind_uniform_buffer_range(uint32_t index, uint32_t buffer, intptr_t offset, intptr_t size)
+  //
+  // Uniform values are shadowed per program, assuming no other context changes
+  // the uniforms of the programs used here. Anything set around the cache must
+  // be followed by invalidate().
+  //------------------------------------------------------------------------------
+
+  template <typename ApiT>
+  class GLStateCache
+  {
+  public:
+
+    struct Statistics
+    {
+      uint64_t    m_calls = 0;      // Made through the cache.
+      uint64_t    m_elided = 0;     // Of those, not passed on as redundant.
+    };
+
+    GLStateCache() = default;
+    explicit GLStateCache(const ApiT& api) : m_api(api) {}
+
+    ApiT& api() { return m_api; }
+    const Statistics& statistics() const { return m_statistics; }
+
+    //------------------------------------------------------------------------------
+    // Forget all shadowed values (not the uniform locations), the next call of
+    // each is passed on.
+    void invalidate()
+    {
+      m_program.m_is_known = false;
+      m_vertex_array.m_is_known = false;
+      m_draw_framebuffer.m_is_known = false;
+      m_is_scissor_test_enabled.m_is_known = false;
+      m_is_program_point_size_enabled.m_is_known = false;
+      m_scissor.m_is_known = false;
+      m_clear_color.m_is_known = false;
+      m_uniforms.clear();
+
+      for (Shadow<std::array<intptr_t, 3>>& binding : m_uniform_buffer_bindings) {
+        binding.m_is_known = false;
+      }
+    }
+
+    void use_program(uint32_t program)
+    {
+      if (update(m_program, program)) {
+        m_api.use_program(program);
+      }
+    }
+
+    void bind_vertex_array(uint32_t vertex_array)
+    {
+      if (update(m_vertex_array, vertex_array)) {
+        m_api.bind_vertex_array(vertex_array);
+      }
+    }
+
+    void bind_draw_framebuffer(uint32_t framebuffer)
+    {
+      if (update(m_draw_framebuffer, framebuffer)) {
+        m_api.bind_draw_framebuffer(framebuffer);
+      }
+    }
+
+    void enable_scissor_test(bool is_enabled)
+    {
+      if (update(m_is_scissor_test_enabled, is_enabled)) {
+        m_api.enable_scissor_test(is_enabled);
+      }
+    }
+
+    void enable_program_point_size(bool is_enabled)
+    {
+      if (update(m_is_program_point_size_enabled, is_enabled)) {
+        m_api.enable_program_point_size(is_enabled);
+      }
+    }
+
+    void scissor(int32_t x, int32_t y, int32_t width, int32_t height)
+    {
+      if (update(m_scissor, std::array<int32_t, 4>{ { x, y, width, height } })) {
+        m_api.scissor(x, y, width, height);
+      }
+    }
+
+    void clear_color(float r, float g, float b, float a)
+    {
+      if (update(m_clear_color, std::array<float, 4>{ { r, g, b, a } })) {
+        m_api.clear_color(r, g, b, a);
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Looked up once per program and name, -1 if the program has no such uniform.
+    // Names are compared by hash, declare them constexpr (see ShaderName).
+    int32_t uniform_location(uint32_t program, ShaderName name)
+    {
+      for (const UniformLocation& location : m_uniform_locations) {
+        if ((location.m_program == program) && (location.m_name_hash == name.hash())) {
+          return location.m_location;
+        }
+      }
+
+      UniformLocation location;
+      location.m_program = program;
+      location.m_name_hash = name.hash();
+      location.m_location = m_api.get_uniform_location(program, name.name());
+      m_uniform_locations.push_back(location);
+
+      return location.m_location;
+    }
+
+    //------------------------------------------------------------------------------
+    // Of the current program, ignored for location -1 like by OpenGL.
+    void uniform_4fv(int32_t location, const float* value)
+    {
+      if ((location != -1) && update_uniform(location, value, 4)) {
+        m_api.uniform_4fv(location, value);
+      }
+    }
+
+    void uniform_matrix_4fv(int32_t location, const float* value)
+    {
+      if ((location != -1) && update_uniform(location, value, 16)) {
+        m_api.uniform_matrix_4fv(location, value);
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Indices from MAX_UNIFORM_BUFFER_BINDINGS on are passed on unshadowed.
+    void bind_uniform_buffer_range(uint32_t index, uint32_t buffer, intptr_t offset, intptr_t size)
+    {
+      if ((index >= MAX_UNIFORM_BUFFER_BINDINGS) || update(m_uniform_buffer_bindings[index], std::array<intptr_t, 3>{ { intptr_t(buffer), offset, size } })) {
+        m_api.bind_uniform_buffer_range(index, buffer, offset, size);
+      }
+    }
+
+  private:
+
+    static const uint32_t MAX_UNIFORM_BUFFER_BINDINGS = 4;
+
+    template <typename T>
+    struct Shadow
+    {
+      T       m_value = T();
+      bool    m_is_known = false;
+    };
+
+    struct UniformLocation
+    {
+      uint32_t      m_program = 0;
+      uint64_t      m_name_hash = 0;
+      int32_t       m_location = -1;
+    };
+
+    struct Uniform
+    {
+      uint32_t                m_program = 0;
+      int32_t                 m_location = -1;
+      std::array<float, 16>   m_value;
+    };
+
+    //------------------------------------------------------------------------------
+    // True if the value changed (or was unknown), i.e. the call must be made.
+    template <typename T>
+    bool update(Shadow<T>& shadow, const T& value)
+    {
+      ++m_statistics.m_calls;
+
+      if (shadow.m_is_known && (shadow.m_value == value)) {
+        ++m_statistics.m_elided;
+        return false;
+      }
+
+      shadow.m_value = value;
+      shadow.m_is_known = true;
+
+      return true;
+    }
+
+    bool update_uniform(int32_t location, const float* value, size_t size)
+    {
+      ++m_statistics.m_calls;
+
+      const uint32_t program = (m_program.m_is_known ? m_program.m_value : 0);
+      const auto it = std::find_if(begin(m_uniforms), end(m_uniforms), [program, location](const Uniform& uniform) {
+        return ((uniform.m_program == program) && (uniform.m_location == location));
+      });
+
+      if (it == end(m_uniforms)) {
+        Uniform uniform;
+        uniform.m_program = program;
+        uniform.m_location = location;
+        std::copy(value, (value + size), begin(uniform.m_value));
+        m_uniforms.push_back(uniform);
+
+        return true;
+      }
+
+      if (std::memcmp(it->m_value.data(), value, (size * sizeof(float))) == 0) {
+        ++m_statistics.m_elided;
+        return false;
+      }
+
+      std::copy(value, (value + size), begin(it->m_value));
+      return true;
+    }
+
+    ApiT                            m_api;
+    Statistics                      m_statistics;
+
+    Shadow<uint32_t>                m_program;
+    Shadow<uint32_t>                m_vertex_array;
+    Shadow<uint32_t>                m_draw_framebuffer;
+    Shadow<bool>                    m_is_scissor_test_enabled;
+    Shadow<bool>                    m_is_program_point_size_enabled;
+    Shadow<std::array<int32_t, 4>>  m_scissor;
+    Shadow<std::array<float, 4>>    m_clear_color;
+
+    std::array<Shadow<std::array<intptr_t, 3>>, MAX_UNIFORM_BUFFER_BINDINGS>  m_uniform_buffer_bindings;
+
+    std::vector<UniformLocation>    m_uniform_locations;
+    std::vector<Uniform>            m_uniforms;
+  };
+
+  //------------------------------------------------------------------------------
+  // Stands in for OpenGL, counting the calls that reach it.
+  struct CountingGLApi
+  {
+    uint64_t    m_num_calls = 0;
+    int32_t     m_next_uniform_location = 0;
+
+    void use_program(uint32_t) { ++m_num_calls; }
+    void bind_vertex_array(uint32_t) { ++m_num_calls; }
+    void bind_draw_framebuffer(uint32_t) { ++m_num_calls; }
+    void enable_scissor_test(bool) { ++m_num_calls; }
+    void enable_program_point_size(bool) { ++m_num_calls; }
+    void scissor(int32_t, int32_t, int32_t, int32_t) { ++m_num_calls; }
+    void clear_color(float, float, float, float) { ++m_num_calls; }
+    int32_t get_uniform_location(uint32_t, const char*) { ++m_num_calls; return m_next_uniform_location++; }
+    void uniform_4fv(int32_t, const float*) { ++m_num_calls; }
+    void uniform_matrix_4fv(int32_t, const float*) { ++m_num_calls; }
+    void bind_uniform_buffer_range(uint32_t, uint32_t, intptr_t, intptr_t) { ++m_num_calls; }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,158 @@
+//
+//  MappedFile.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  MappedFile::MappedFile(MappedFile&& other) noexcept
+  {
+    *this = std::move(other);
+  }
+
+  MappedFile&
+  MappedFile::operator=(MappedFile&& other) noexcept
+  {
+    if (this != &other) {
+      close();
+
+      std::swap(m_data, other.m_data);
+      std::swap(m_size, other.m_size);
+#if defined(_WIN32)
+      std::swap(m_file, other.m_file);
+      std::swap(m_mapping, other.m_mapping);
+#endif
+    }
+
+    return *this;
+  }
+
+  bool
+  MappedFile::open(const std::string& path)
+  {
+    close();
+
+#if defined(_WIN32)
+    const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, (FILE_SHARE_READ | FILE_SHARE_WRITE), nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+
+    LARGE_INTEGER file_size = {};
+
+    if ((GetFileSizeEx(file, &file_size) == FALSE) || (file_size.QuadPart <= 0)) {
+      CloseHandle(file);
+      return false;
+    }
+
+    const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == NULL) {
+      CloseHandle(file);
+      return false;
+    }
+
+    const void* const data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (data == nullptr) {
+      CloseHandle(mapping);
+      CloseHandle(file);
+      return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = size_t(file_size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat file_stat = {};
+
+    if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size <= 0)) {
+      ::close(fd);
+      return false;
+    }
+
+    void* const data = mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // The mapping keeps its own reference to the file.
+
+    if (data == MAP_FAILED) {
+      return false;
+    }
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = size_t(file_stat.st_size);
+#endif
+
+    return true;
+  }
+
+  void
+  MappedFile::close()
+  {
+#if defined(_WIN32)
+    if (m_data) {
+      UnmapViewOfFile(m_data);
+    }
+
+    if (m_mapping) {
+      CloseHandle(m_mapping);
+    }
+
+    if (m_file) {
+      CloseHandle(m_file);
+    }
+
+    m_file = nullptr;
+    m_mapping = nullptr;
+#else
+    if (m_data) {
+      munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
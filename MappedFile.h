@@ -0,0 +1,72 @@
+//
+//  MappedFile.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Read-only memory mapping of an entire file.
+  //------------------------------------------------------------------------------
+
+  class MappedFile
+  {
+  public:
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    //------------------------------------------------------------------------------
+    // Map the file at the given path. Returns false if the file does not exist,
+    // can not be mapped or is empty (empty files can not be mapped on all
+    // platforms), in which case the object remains closed.
+    bool open(const std::string& path);
+
+    void close();
+
+    bool is_open() const { return (m_data != nullptr); }
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+
+    const uint8_t*  m_data = nullptr;
+    size_t          m_size = 0;
+
+#if defined(_WIN32)
+    void*           m_file = nullptr;
+    void*           m_mapping = nullptr;
+#endif
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,636 @@
+//
+//  OpenGLProgramCache.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "OpenGLProgramCache.h"
+#include "MappedFile.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define TOOLBOX_LOG_WARNING(...) printf(__VA_ARGS__)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+  //------------------------------------------------------------------------------
+  // On-disk layout. All values are stored in native byte order, the cache is
+  // not meant to be shared between machines (the driver identity is part of
+  // the key anyway).
+  constexpr uint32_t INDEX_MAGIC = 0x43504c47;  // 'GLPC'
+  constexpr uint32_t INDEX_VERSION = 2;
+
+  struct index_header_t {
+    uint32_t  m_magic;
+    uint32_t  m_version;
+  };
+
+  struct index_entry_t {
+    uint64_t  m_key;
+    uint64_t  m_offset;
+    uint32_t  m_size;
+    uint32_t  m_format;
+    uint32_t  m_reflection_size;
+    uint32_t  m_reserved;
+  };
+
+  static_assert(sizeof(index_header_t) == 8, "Unexpected index header layout!");
+  static_assert(sizeof(index_entry_t) == 32, "Unexpected index entry layout!");
+
+  //------------------------------------------------------------------------------
+  // 64-bit FNV-1a.
+  constexpr uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ull;
+  constexpr uint64_t FNV1A_PRIME = 0x100000001b3ull;
+
+  uint64_t
+  fnv1a(uint64_t hash, const void* const data, size_t size)
+  {
+    const uint8_t* const bytes = static_cast<const uint8_t*>(data);
+
+    for (size_t i = 0; i < size; ++i) {
+      hash = ((hash ^ bytes[i]) * FNV1A_PRIME);
+    }
+
+    return hash;
+  }
+
+  uint64_t
+  fnv1a(uint64_t hash, const std::string& string)
+  {
+    //------------------------------------------------------------------------------
+    // Include the length so that consecutive strings can not alias each other.
+    const uint64_t length = string.length();
+    hash = fnv1a(hash, &length, sizeof(length));
+    return fnv1a(hash, string.data(), string.length());
+  }
+
+  uint64_t
+  fnv1a(uint64_t hash, GLint value)
+  {
+    const int64_t value64 = value;
+    return fnv1a(hash, &value64, sizeof(value64));
+  }
+
+  uint64_t
+  fnv1a(uint64_t hash, const GLubyte* const string)
+  {
+    return fnv1a(hash, std::string(string ? reinterpret_cast<const char*>(string) : ""));
+  }
+
+  uint64_t
+  compute_key(const std::string& vertex_shader_source,
+              const std::string& fragment_shader_source,
+              const toolbox::OpenGLProgram::attribute_location_list_t& attribute_locations,
+              const toolbox::OpenGLProgram::frag_data_location_list_t& frag_data_locations)
+  {
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+
+    hash = fnv1a(hash, glGetString(GL_VENDOR));
+    hash = fnv1a(hash, glGetString(GL_RENDERER));
+    hash = fnv1a(hash, glGetString(GL_VERSION));
+    hash = fnv1a(hash, glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+    hash = fnv1a(hash, vertex_shader_source);
+    hash = fnv1a(hash, fragment_shader_source);
+
+    for (const auto& tuple : attribute_locations) {
+      hash = fnv1a(hash, std::get<0>(tuple));
+      hash = fnv1a(hash, std::get<1>(tuple));
+    }
+
+    for (const auto& tuple : frag_data_locations) {
+      hash = fnv1a(hash, std::get<0>(tuple));
+      hash = fnv1a(hash, std::get<1>(tuple));
+      hash = fnv1a(hash, std::get<2>(tuple));
+    }
+
+    return hash;
+  }
+
+  //------------------------------------------------------------------------------
+  // The lists as OpenGLProgram::query_locations() would return them, the
+  // fragment data locations in the order given.
+  void
+  locations_from_reflection(const toolbox::ProgramReflection& reflection,
+                            toolbox::OpenGLProgram::attribute_location_list_t& attribute_locations,
+                            toolbox::OpenGLProgram::frag_data_location_list_t& frag_data_locations)
+  {
+    attribute_locations.clear();
+
+    for (const toolbox::ProgramReflection::Attribute& attribute : reflection.attributes()) {
+      attribute_locations.emplace_back(attribute.m_location, attribute.m_name);
+    }
+
+    toolbox::OpenGLProgram::frag_data_location_list_t actual_frag_data_locations;
+
+    for (auto& tuple : frag_data_locations) {
+      std::string& name = std::get<2>(tuple);
+      const toolbox::ProgramReflection::FragOutput* const frag_output = (name.empty() ? nullptr : reflection.find_frag_output(name.c_str()));
+
+      if (frag_output) {
+        actual_frag_data_locations.emplace_back(frag_output->m_location, frag_output->m_index, std::move(name));
+      }
+    }
+
+    frag_data_locations = std::move(actual_frag_data_locations);
+  }
+
+  //------------------------------------------------------------------------------
+  // 64-bit offsets, long is 32 bits on Windows and the blob file may grow beyond.
+  bool
+  seek_file(FILE* const file, uint64_t offset)
+  {
+#if defined(_WIN32)
+    return (_fseeki64(file, int64_t(offset), SEEK_SET) == 0);
+#else
+    return (fseeko(file, off_t(offset), SEEK_SET) == 0);
+#endif
+  }
+
+  //------------------------------------------------------------------------------
+  // Moves to the end, -1 on failure.
+  int64_t
+  seek_file_end(FILE* const file)
+  {
+#if defined(_WIN32)
+    return ((_fseeki64(file, 0, SEEK_END) == 0) ? int64_t(_ftelli64(file)) : -1);
+#else
+    return ((fseeko(file, 0, SEEK_END) == 0) ? int64_t(ftello(file)) : -1);
+#endif
+  }
+
+  int64_t
+  file_size(const std::string& path)
+  {
+    FILE* const file = fopen(path.c_str(), "rb");
+
+    if (!file) {
+      return -1;
+    }
+
+    const int64_t size = seek_file_end(file);
+    fclose(file);
+    return size;
+  }
+
+  void
+  create_directory(const std::string& path)
+  {
+    //------------------------------------------------------------------------------
+    // Failure (most likely because it already exists) is detected when the files
+    // within are accessed.
+#if defined(_WIN32)
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+  }
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  constexpr uint64_t OpenGLProgramCache::DEFAULT_MAX_SIZE;
+
+  OpenGLProgramCache::OpenGLProgramCache(std::string directory, uint64_t max_size)
+    : m_directory(std::move(directory))
+    , m_index_path(m_directory + "/index.bin")
+    , m_blob_path(m_directory + "/blobs.bin")
+    , m_max_size(max_size)
+  {
+    create_directory(m_directory);
+    load_index();
+  }
+
+  GLuint
+  OpenGLProgramCache::create_from_sources(const std::string& vertex_shader_source,
+                                          const std::string& fragment_shader_source,
+                                          OpenGLProgram::attribute_location_list_t& attribute_locations,
+                                          OpenGLProgram::frag_data_location_list_t& frag_data_locations,
+                                          ProgramReflection* reflection)
+  {
+    //------------------------------------------------------------------------------
+    // The key depends on the requested locations, compute it before the lists get
+    // replaced with the actual locations.
+    const uint64_t key = compute_key(vertex_shader_source, fragment_shader_source, attribute_locations, frag_data_locations);
+
+    GLint num_binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+    const bool is_cacheable = (num_binary_formats > 0);
+
+    //------------------------------------------------------------------------------
+    // Wait for any other thread compiling the same program, then try the cached
+    // binary.
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (is_cacheable) {
+      m_pending_done.wait(lock, [this, key]() { return (m_pending_keys.count(key) == 0); });
+
+      const auto it = m_entries.find(key);
+
+      if (it != m_entries.end()) {
+        const entry_t entry = it->second;
+        lock.unlock();
+
+        std::string binary;
+        std::string reflection_data;
+
+        if (load_binary(entry, binary, reflection_data)) {
+          const GLuint program = glCreateProgram();
+          glProgramBinary(program, GLenum(entry.m_format), binary.data(), GLsizei(binary.size()));
+
+          GLint link_status = GL_FALSE;
+          glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+
+          if (link_status == GL_TRUE) {
+            //------------------------------------------------------------------------------
+            // A reflection that does not deserialize is taken from the program again,
+            // it matches the binary the driver just accepted either way.
+            ProgramReflection loaded_reflection;
+            const bool is_reflection_loaded = loaded_reflection.deserialize(reflection_data.data(), reflection_data.size());
+
+            if (!is_reflection_loaded) {
+              OpenGLProgram::reflect(program, frag_data_locations, loaded_reflection);
+            }
+
+            locations_from_reflection(loaded_reflection, attribute_locations, frag_data_locations);
+
+            if (reflection) {
+              *reflection = std::move(loaded_reflection);
+            }
+
+            lock.lock();
+            ++m_statistics.hits;
+            m_statistics.reflections += (is_reflection_loaded ? 0 : 1);
+            return program;
+          }
+
+          glDeleteProgram(program);
+        }
+
+        //------------------------------------------------------------------------------
+        // The driver rejected the binary (or it could not be read), forget about it
+        // and fall through to compiling. Storing the new binary supersedes the stale
+        // index entry.
+        lock.lock();
+        m_entries.erase(key);
+        ++m_statistics.invalidations;
+      }
+
+      m_pending_keys.insert(key);
+    }
+
+    ++m_statistics.misses;
+    lock.unlock();
+
+    //------------------------------------------------------------------------------
+    // Compile and link. Shaders are no longer needed once the program is linked.
+    GLuint program = 0;
+    std::string binary;
+    GLenum binary_format = GL_NONE;
+    ProgramReflection compiled_reflection;
+    std::string reflection_data;
+
+    try {
+      const GLuint vertex_shader = OpenGLShader::create_from_source(GL_VERTEX_SHADER, vertex_shader_source);
+      GLuint fragment_shader = 0;
+
+      try {
+        fragment_shader = OpenGLShader::create_from_source(GL_FRAGMENT_SHADER, fragment_shader_source);
+        program = OpenGLProgram::create_from_shaders(vertex_shader, fragment_shader, attribute_locations, frag_data_locations);
+      }
+      catch (...) {
+        glDeleteShader(fragment_shader);
+        glDeleteShader(vertex_shader);
+        throw;
+      }
+
+      glDeleteShader(fragment_shader);
+      glDeleteShader(vertex_shader);
+
+      if (is_cacheable || reflection) {
+        OpenGLProgram::reflect(program, frag_data_locations, compiled_reflection);
+      }
+
+      if (is_cacheable) {
+        compiled_reflection.serialize(reflection_data);
+
+        GLint binary_length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+
+        if (binary_length > 0) {
+          binary.resize(size_t(binary_length));
+          GLsizei actual_length = 0;
+          glGetProgramBinary(program, binary_length, &actual_length, &binary_format, &binary[0]);
+          binary.resize(size_t(actual_length));
+        }
+      }
+    }
+    catch (...) {
+      if (program != 0) {
+        glDeleteProgram(program);
+      }
+
+      if (is_cacheable) {
+        lock.lock();
+        m_pending_keys.erase(key);
+        m_pending_done.notify_all();
+      }
+
+      throw;
+    }
+
+    //------------------------------------------------------------------------------
+    // Store the binary and release any threads waiting for this key.
+    lock.lock();
+    m_statistics.reflections += ((is_cacheable || reflection) ? 1 : 0);
+
+    if (is_cacheable) {
+      if (!binary.empty()) {
+        store_binary(key, binary_format, binary, reflection_data);
+      }
+
+      m_pending_keys.erase(key);
+      m_pending_done.notify_all();
+    }
+
+    lock.unlock();
+
+    if (reflection) {
+      *reflection = std::move(compiled_reflection);
+    }
+
+    return program;
+  }
+
+  OpenGLProgramCache::statistics_t
+  OpenGLProgramCache::statistics() const
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_statistics;
+  }
+
+  void
+  OpenGLProgramCache::load_index()
+  {
+    MappedFile index;
+
+    //------------------------------------------------------------------------------
+    // Binaries without an index (it was lost) can never be found.
+    if (!index.open(m_index_path)) {
+      remove(m_blob_path.c_str());
+      return;
+    }
+
+    index_header_t header = {};
+
+    if (index.size() >= sizeof(header)) {
+      memcpy(&header, index.data(), sizeof(header));
+    }
+
+    if ((header.m_magic != INDEX_MAGIC) || (header.m_version != INDEX_VERSION)) {
+      TOOLBOX_LOG_WARNING("Discarding incompatible program cache in %s\n", m_directory.c_str());
+      index.close();
+      remove(m_index_path.c_str());
+      remove(m_blob_path.c_str());
+      return;
+    }
+
+    //------------------------------------------------------------------------------
+    // Later entries supersede earlier ones. A trailing partial entry (interrupted
+    // write) is ignored.
+    const size_t num_entries = ((index.size() - sizeof(header)) / sizeof(index_entry_t));
+    const uint8_t* const entries = (index.data() + sizeof(header));
+
+    for (size_t i = 0; i < num_entries; ++i) {
+      index_entry_t index_entry;
+      memcpy(&index_entry, (entries + (i * sizeof(index_entry_t))), sizeof(index_entry));
+
+      entry_t& entry = m_entries[index_entry.m_key];
+      entry.m_offset = index_entry.m_offset;
+      entry.m_size = index_entry.m_size;
+      entry.m_format = index_entry.m_format;
+      entry.m_reflection_size = index_entry.m_reflection_size;
+    }
+
+    index.close();
+
+    //------------------------------------------------------------------------------
+    // Entries beyond the end of the blob file (it was lost or cut short) can never
+    // load. Rewrite the files if anything in them is not needed any more.
+    const int64_t blob_size = std::max<int64_t>(0, file_size(m_blob_path));
+    uint64_t live_size = 0;
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+      const uint64_t end = (it->second.m_offset + it->second.m_size + it->second.m_reflection_size);
+
+      if (end > uint64_t(blob_size)) {
+        it = m_entries.erase(it);
+      }
+      else {
+        live_size += (it->second.m_size + it->second.m_reflection_size);
+        ++it;
+      }
+    }
+
+    if ((num_entries > m_entries.size()) || (live_size < uint64_t(blob_size)) || (live_size > m_max_size)) {
+      compact(uint64_t(blob_size));
+    }
+  }
+
+  void
+  OpenGLProgramCache::compact(uint64_t blob_size)
+  {
+    //------------------------------------------------------------------------------
+    // Keep the most recently stored binaries (the furthest into the blob file) that
+    // fit, in the order they were stored.
+    std::vector<std::pair<uint64_t, entry_t>> entries(m_entries.begin(), m_entries.end());
+    std::sort(entries.begin(), entries.end(), [](const std::pair<uint64_t, entry_t>& a, const std::pair<uint64_t, entry_t>& b) {
+      return (a.second.m_offset > b.second.m_offset);
+    });
+
+    uint64_t kept_size = 0;
+    size_t num_kept = 0;
+
+    while ((num_kept < entries.size()) && ((kept_size + entries[num_kept].second.m_size + entries[num_kept].second.m_reflection_size) <= m_max_size)) {
+      kept_size += (entries[num_kept].second.m_size + entries[num_kept].second.m_reflection_size);
+      ++num_kept;
+    }
+
+    m_statistics.evictions += (entries.size() - num_kept);
+    entries.resize(num_kept);
+    std::reverse(entries.begin(), entries.end());
+
+    //------------------------------------------------------------------------------
+    // Write both files anew next to the old ones, then replace them, removing the
+    // old index first and renaming the new one last so an index never points into
+    // a blob file it was not written for.
+    const std::string index_path = (m_index_path + ".tmp");
+    const std::string blob_path = (m_blob_path + ".tmp");
+
+    FILE* const old_blob_file = fopen(m_blob_path.c_str(), "rb");
+    FILE* const blob_file = fopen(blob_path.c_str(), "wb");
+    FILE* const index_file = fopen(index_path.c_str(), "wb");
+
+    const index_header_t header = { INDEX_MAGIC, INDEX_VERSION };
+    bool success = (((old_blob_file != nullptr) || entries.empty()) && (blob_file != nullptr) && (index_file != nullptr) &&
+                    (fwrite(&header, sizeof(header), 1, index_file) == 1));
+
+    std::vector<char> data;
+    uint64_t offset = 0;
+
+    for (std::pair<uint64_t, entry_t>& key_entry : entries) {
+      entry_t& entry = key_entry.second;
+      data.resize(size_t(entry.m_size) + entry.m_reflection_size);
+
+      success = (success && seek_file(old_blob_file, entry.m_offset) &&
+                 (data.empty() || ((fread(data.data(), 1, data.size(), old_blob_file) == data.size()) &&
+                                   (fwrite(data.data(), 1, data.size(), blob_file) == data.size()))));
+
+      entry.m_offset = offset;
+      offset += data.size();
+
+      const index_entry_t index_entry = { key_entry.first, entry.m_offset, entry.m_size, entry.m_format, entry.m_reflection_size, 0 };
+      success = (success && (fwrite(&index_entry, sizeof(index_entry), 1, index_file) == 1));
+    }
+
+    success = (((old_blob_file == nullptr) || (fclose(old_blob_file) == 0)) && success);
+    success = (((blob_file == nullptr) || (fclose(blob_file) == 0)) && success);
+    success = (((index_file == nullptr) || (fclose(index_file) == 0)) && success);
+
+    if (!success) {
+      TOOLBOX_LOG_WARNING("Failed to compact program cache in %s, continuing with %" PRIu64 " byte(s)\n", m_directory.c_str(), blob_size);
+      remove(index_path.c_str());
+      remove(blob_path.c_str());
+      return;
+    }
+
+    remove(m_index_path.c_str());
+    remove(m_blob_path.c_str());
+
+    if ((rename(blob_path.c_str(), m_blob_path.c_str()) != 0) || (rename(index_path.c_str(), m_index_path.c_str()) != 0)) {
+      TOOLBOX_LOG_WARNING("Failed to replace the files of program cache in %s, starting out empty\n", m_directory.c_str());
+      remove(index_path.c_str());
+      remove(blob_path.c_str());
+      remove(m_index_path.c_str());
+      remove(m_blob_path.c_str());
+      m_entries.clear();
+      return;
+    }
+
+    m_entries.clear();
+    m_entries.insert(entries.begin(), entries.end());
+    ++m_statistics.compactions;
+  }
+
+  bool
+  OpenGLProgramCache::load_binary(const entry_t& entry, std::string& binary, std::string& reflection) const
+  {
+    FILE* const f = fopen(m_blob_path.c_str(), "rb");
+
+    if (!f) {
+      return false;
+    }
+
+    binary.resize(entry.m_size);
+    reflection.resize(entry.m_reflection_size);
+
+    const bool success = (seek_file(f, entry.m_offset) &&
+                          (fread(&binary[0], 1, binary.size(), f) == binary.size()) &&
+                          (reflection.empty() || (fread(&reflection[0], 1, reflection.size(), f) == reflection.size())));
+
+    fclose(f);
+    return success;
+  }
+
+  void
+  OpenGLProgramCache::store_binary(uint64_t key, GLenum format, const std::string& binary, const std::string& reflection)
+  {
+    //------------------------------------------------------------------------------
+    // Append the blob first so an interrupted write can never leave an index entry
+    // pointing beyond the end of the blob file.
+    FILE* const blob_file = fopen(m_blob_path.c_str(), "ab");
+
+    if (!blob_file) {
+      TOOLBOX_LOG_WARNING("Failed to open program cache blob file %s\n", m_blob_path.c_str());
+      return;
+    }
+
+    const int64_t offset = seek_file_end(blob_file);
+    const bool blob_written = ((offset >= 0) &&
+                               (fwrite(binary.data(), 1, binary.size(), blob_file) == binary.size()) &&
+                               (fwrite(reflection.data(), 1, reflection.size(), blob_file) == reflection.size()));
+    fclose(blob_file);
+
+    if (!blob_written) {
+      TOOLBOX_LOG_WARNING("Failed to write program cache blob file %s\n", m_blob_path.c_str());
+      return;
+    }
+
+    FILE* const index_file = fopen(m_index_path.c_str(), "ab");
+
+    if (!index_file) {
+      TOOLBOX_LOG_WARNING("Failed to open program cache index file %s\n", m_index_path.c_str());
+      return;
+    }
+
+    if (seek_file_end(index_file) == 0) {
+      const index_header_t header = { INDEX_MAGIC, INDEX_VERSION };
+      fwrite(&header, sizeof(header), 1, index_file);
+    }
+
+    const index_entry_t index_entry = { key, uint64_t(offset), uint32_t(binary.size()), uint32_t(format), uint32_t(reflection.size()), 0 };
+    const bool index_written = (fwrite(&index_entry, sizeof(index_entry), 1, index_file) == 1);
+    fclose(index_file);
+
+    if (!index_written) {
+      TOOLBOX_LOG_WARNING("Failed to write program cache index file %s\n", m_index_path.c_str());
+      return;
+    }
+
+    entry_t& entry = m_entries[key];
+    entry.m_offset = uint64_t(offset);
+    entry.m_size = uint32_t(binary.size());
+    entry.m_format = uint32_t(format);
+    entry.m_reflection_size = uint32_t(reflection.size());
+
+    ++m_statistics.stores;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
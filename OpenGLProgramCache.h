@@ -0,0 +1,127 @@
+//
+//  OpenGLProgramCache.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "OpenGLUtilities.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Persistent, content addressed cache of OpenGL program binaries.
+  //
+  // Programs are keyed by a hash of the shader sources, the requested attribute
+  // and fragment data locations and the identity of the driver (vendor, renderer
+  // and version strings) of the current context. The cache directory holds an
+  // append-only index (memory mapped when the cache is opened) and a blob file
+  // with the program binaries, each followed by the program's serialized
+  // reflection. The most recent index entry for a key wins.
+  //
+  // Both files only grow while the cache is open. When opened, entries that were
+  // superseded are dropped and, if the binaries exceed the size limit, the least
+  // recently stored ones too, by rewriting the files.
+  //
+  // The cache is thread safe and may be shared by render threads using different
+  // contexts. Concurrent requests for the same key compile the program only once,
+  // the other threads wait and then load the resulting binary.
+  //------------------------------------------------------------------------------
+
+  class OpenGLProgramCache
+  {
+  public:
+
+    struct statistics_t {
+      size_t    hits = 0;
+      size_t    misses = 0;
+      size_t    invalidations = 0;   // Binaries rejected by the driver.
+      size_t    stores = 0;
+      size_t    reflections = 0;     // Programs introspected, on misses and hits without a reflection.
+      size_t    compactions = 0;     // Rewrites of the files when opened.
+      size_t    evictions = 0;       // Binaries dropped when opened to stay within the size limit.
+    };
+
+    static constexpr uint64_t DEFAULT_MAX_SIZE = (uint64_t(256) << 20);
+
+    //------------------------------------------------------------------------------
+    // Open (or create) the cache in the given directory, keeping at most about
+    // max_size bytes of binaries from previous runs. A missing or unreadable cache
+    // is not an error, the cache simply starts out empty.
+    explicit OpenGLProgramCache(std::string directory, uint64_t max_size = DEFAULT_MAX_SIZE);
+
+    OpenGLProgramCache(const OpenGLProgramCache&) = delete;
+    OpenGLProgramCache& operator=(const OpenGLProgramCache&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Create a program from the given shader sources. A valid program is returned
+    // or an exception thrown. A cached binary is tried first, if there is none or
+    // the driver rejects it the shaders are compiled and linked as per
+    // OpenGLProgram::create_from_shaders() and the resulting binary is stored. The
+    // location lists are updated as for OpenGLProgram::create_from_shaders().
+    //
+    // The reflection of the program (see OpenGLProgram::reflect()) is stored with
+    // the binary and optionally returned. A hit takes the locations and reflection
+    // from the cache, without asking OpenGL about the program.
+    GLuint create_from_sources(const std::string& vertex_shader_source,
+                               const std::string& fragment_shader_source,
+                               OpenGLProgram::attribute_location_list_t& attribute_locations,
+                               OpenGLProgram::frag_data_location_list_t& frag_data_locations,
+                               ProgramReflection* reflection = nullptr);
+
+    statistics_t statistics() const;
+
+  private:
+
+    struct entry_t {
+      uint64_t  m_offset = 0;
+      uint32_t  m_size = 0;
+      uint32_t  m_format = 0;
+      uint32_t  m_reflection_size = 0;    // Following the binary.
+    };
+
+    void load_index();
+    void compact(uint64_t blob_size);
+    bool load_binary(const entry_t& entry, std::string& binary, std::string& reflection) const;
+    void store_binary(uint64_t key, GLenum format, const std::string& binary, const std::string& reflection);
+
+    const std::string                       m_directory;
+    const std::string                       m_index_path;
+    const std::string                       m_blob_path;
+    const uint64_t                          m_max_size;
+
+    mutable std::mutex                      m_mutex;
+    std::condition_variable                 m_pending_done;
+    std::unordered_map<uint64_t, entry_t>   m_entries;
+    std::set<uint64_t>                      m_pending_keys;
+    statistics_t                            m_statistics;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -14,8 +14,12 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <cassert>
-#include <set>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
 #include <tuple>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -35,17 +39,40 @@
 
 namespace {
 
+  //------------------------------------------------------------------------------
+  // Logs the info log of the given length, read by get_info_log(size, buffer) into
+  // a buffer on the stack unless it is too long for it.
+  template <typename GetInfoLogT>
+  void
+  log_info(GLint info_log_length, GetInfoLogT get_info_log)
+  {
+    char buffer[1024];
+
+    if (info_log_length <= 0) {
+      return;
+    }
+
+    if (info_log_length <= GLint(sizeof(buffer))) {
+      get_info_log(GLsizei(sizeof(buffer)), buffer);
+      TOOLBOX_LOG_ERROR("%s", buffer);
+      return;
+    }
+
+    std::string info_log(info_log_length, '\0');
+    get_info_log(GLsizei(info_log_length), &info_log[0]);
+    TOOLBOX_LOG_ERROR("%s", info_log.data());
+  }
+
   void
   log_shader_info(GLuint shader)
   {
     GLint info_log_length = 0;
     glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
 
-    if (info_log_length > 0) {
-      std::string info_log(info_log_length, '.');
-      glGetShaderInfoLog(shader, info_log_length, &info_log_length, &info_log[0]);
-      TOOLBOX_LOG_ERROR("%s", info_log.data());
-    }
+    log_info(info_log_length, [shader](GLsizei size, GLchar* info_log) {
+      GLsizei length = 0;
+      glGetShaderInfoLog(shader, size, &length, info_log);
+    });
   }
 
   void
@@ -54,13 +81,41 @@ namespace {
     GLint info_log_length = 0;
     glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
 
-    if (info_log_length > 0) {
-      std::string info_log(info_log_length, '.');
-      glGetProgramInfoLog(program, info_log_length, &info_log_length, &info_log[0]);
-      TOOLBOX_LOG_ERROR("%s", info_log.data());
-    }
+    log_info(info_log_length, [program](GLsizei size, GLchar* info_log) {
+      GLsizei length = 0;
+      glGetProgramInfoLog(program, size, &length, info_log);
+    });
   }
 
+  //------------------------------------------------------------------------------
+  // Locations bound so far, for warning about binding one twice. Locations past
+  // the capacity (far beyond GL_MAX_VERTEX_ATTRIBS and GL_MAX_DRAW_BUFFERS of any
+  // GPU) are not tracked.
+  class LocationSet
+  {
+  public:
+
+    //------------------------------------------------------------------------------
+    // False if the location was in the set already.
+    bool insert(GLint location)
+    {
+      if ((location < 0) || (location >= GLint(64 * (sizeof(m_words) / sizeof(m_words[0]))))) {
+        return true;
+      }
+
+      uint64_t& word = m_words[location / 64];
+      const uint64_t bit = (uint64_t(1) << (location % 64));
+      const bool is_new = ((word & bit) == 0);
+
+      word |= bit;
+      return is_new;
+    }
+
+  private:
+
+    uint64_t    m_words[2] = {};
+  };
+
 } // unnamed namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -96,13 +151,77 @@ namespace toolbox {
   ////////////////////////////////////////////////////////////////////////////////
   ////////////////////////////////////////////////////////////////////////////////
 
+  ProgramLocations::ProgramLocations(Attribute* attributes, size_t max_attributes, FragData* frag_data, size_t max_frag_data, char* names, size_t names_size) :
+    m_attributes(attributes), m_max_attributes(max_attributes), m_frag_data(frag_data), m_max_frag_data(max_frag_data), m_names(names), m_names_size(names_size)
+  {
+  }
+
+  void
+  ProgramLocations::clear()
+  {
+    m_num_attributes = 0;
+    m_num_frag_data = 0;
+    m_names_used = 0;
+    m_is_truncated = false;
+  }
+
+  char*
+  ProgramLocations::name_buffer(size_t size)
+  {
+    if (size > (m_names_size - m_names_used)) {
+      m_is_truncated = true;
+      return nullptr;
+    }
+
+    return (m_names + m_names_used);
+  }
+
+  void
+  ProgramLocations::add_attribute(GLint location, size_t name_length)
+  {
+    if (m_num_attributes == m_max_attributes) {
+      m_is_truncated = true;
+      return;
+    }
+
+    m_attributes[m_num_attributes].m_location = location;
+    m_attributes[m_num_attributes].m_name = (m_names + m_names_used);
+    ++m_num_attributes;
+
+    m_names_used += (name_length + 1);
+  }
+
+  void
+  ProgramLocations::add_frag_data(GLint location, GLint index, const char* name, size_t name_length)
+  {
+    char* const buffer = name_buffer(name_length + 1);
+
+    if ((buffer == nullptr) || (m_num_frag_data == m_max_frag_data)) {
+      m_is_truncated = true;
+      return;
+    }
+
+    memcpy(buffer, name, name_length);
+    buffer[name_length] = '\0';
+
+    m_frag_data[m_num_frag_data].m_location = location;
+    m_frag_data[m_num_frag_data].m_index = index;
+    m_frag_data[m_num_frag_data].m_name = buffer;
+    ++m_num_frag_data;
+
+    m_names_used += (name_length + 1);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
   GLuint
   OpenGLProgram::create_from_shaders(GLuint vertex_shader,
                                      GLuint fragment_shader,
                                      attribute_location_list_t& attribute_locations,
                                      frag_data_location_list_t& frag_data_locations)
   {
-    std::set<GLint> used_indices;
+    LocationSet used_indices;
 
     //------------------------------------------------------------------------------
     // Create program and attach shaders.
@@ -116,10 +235,6 @@ namespace toolbox {
 
     //------------------------------------------------------------------------------
     // Attempt to bind valid attribute locations (must be done before linking).
-    if ((TOOLBOX_DEBUG)) {
-      used_indices.clear();
-    }
-
     for (const auto& tuple : attribute_locations) {
       const GLint location = std::get<0>(tuple);
       const std::string& name = std::get<1>(tuple);
@@ -129,22 +244,18 @@ namespace toolbox {
       }
 
       if ((TOOLBOX_DEBUG)) {
-        if (used_indices.find(location) != used_indices.end()) {
+        if (!used_indices.insert(location)) {
           TOOLBOX_LOG_WARNING("Attribute location %ji was already bound!", intmax_t(location));
         }
       }
 
       glBindAttribLocation(program, location, name.c_str());
-
-      if ((TOOLBOX_DEBUG)) {
-        used_indices.insert(location);
-      }
     }
 
     //------------------------------------------------------------------------------
     // Attempt to bind valid fragment data locations (must be done before linking).
     if ((TOOLBOX_DEBUG)) {
-      used_indices.clear();
+      used_indices = LocationSet();
     }
 
     for (const auto& tuple : frag_data_locations) {
@@ -157,16 +268,12 @@ namespace toolbox {
       }
 
       if ((TOOLBOX_DEBUG)) {
-        if (used_indices.find(location) != used_indices.end()) {
+        if (!used_indices.insert(location)) {
           TOOLBOX_LOG_WARNING("Fragment data location %ji was already bound!", intmax_t(location));
         }
       }
 
       glBindFragDataLocationIndexed(program, location, index, name.c_str());
-
-      if ((TOOLBOX_DEBUG)) {
-        used_indices.insert(location);
-      }
     }
 
     //------------------------------------------------------------------------------
@@ -182,6 +289,20 @@ namespace toolbox {
       throw std::runtime_error("Failed to link binary!");
     }
 
+    //------------------------------------------------------------------------------
+    // Report the locations actually in use.
+    query_locations(program, attribute_locations, frag_data_locations);
+
+    //------------------------------------------------------------------------------
+    // ...
+    return program;
+  }
+
+  void
+  OpenGLProgram::query_locations(GLuint program,
+                                 attribute_location_list_t& attribute_locations,
+                                 frag_data_location_list_t& frag_data_locations)
+  {
     //------------------------------------------------------------------------------
     // Check actual attribute locations for the names we have been given.
     GLint num_active_attributes = 0;
@@ -233,12 +354,258 @@ namespace toolbox {
     }
 
     frag_data_locations = std::move(actual_frag_data_locations);
+  }
+
+  GLuint
+  OpenGLProgram::create_from_shaders(GLuint vertex_shader,
+                                     GLuint fragment_shader,
+                                     const AttributeBinding* attribute_bindings,
+                                     size_t num_attribute_bindings,
+                                     const FragDataBinding* frag_data_bindings,
+                                     size_t num_frag_data_bindings,
+                                     ProgramLocations& locations)
+  {
+    LocationSet used_indices;
+
+    //------------------------------------------------------------------------------
+    // Create program and attach shaders.
+    GLuint program = glCreateProgram();
+
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_FALSE);
+
+    //------------------------------------------------------------------------------
+    // Attempt to bind valid attribute locations (must be done before linking).
+    for (size_t i = 0; i < num_attribute_bindings; ++i) {
+      const AttributeBinding& binding = attribute_bindings[i];
+
+      if ((binding.m_location < 0) || (binding.m_name == nullptr) || (binding.m_name[0] == '\0')) {
+        continue;
+      }
+
+      if ((TOOLBOX_DEBUG)) {
+        if (!used_indices.insert(binding.m_location)) {
+          TOOLBOX_LOG_WARNING("Attribute location %ji was already bound!", intmax_t(binding.m_location));
+        }
+      }
+
+      glBindAttribLocation(program, binding.m_location, binding.m_name);
+    }
+
+    //------------------------------------------------------------------------------
+    // Attempt to bind valid fragment data locations (must be done before linking).
+    if ((TOOLBOX_DEBUG)) {
+      used_indices = LocationSet();
+    }
+
+    for (size_t i = 0; i < num_frag_data_bindings; ++i) {
+      const FragDataBinding& binding = frag_data_bindings[i];
+
+      if ((binding.m_location < 0) || (binding.m_index < 0) || (binding.m_name == nullptr) || (binding.m_name[0] == '\0')) {
+        continue;
+      }
+
+      if ((TOOLBOX_DEBUG)) {
+        if (!used_indices.insert(binding.m_location)) {
+          TOOLBOX_LOG_WARNING("Fragment data location %ji was already bound!", intmax_t(binding.m_location));
+        }
+      }
+
+      glBindFragDataLocationIndexed(program, binding.m_location, binding.m_index, binding.m_name);
+    }
+
+    //------------------------------------------------------------------------------
+    // Link program and check result.
+    glLinkProgram(program);
+
+    GLint link_status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+
+    if (link_status != GL_TRUE) {
+      log_program_info(program);
+      glDeleteProgram(program);
+      throw std::runtime_error("Failed to link binary!");
+    }
+
+    //------------------------------------------------------------------------------
+    // Report the locations actually in use.
+    query_locations(program, frag_data_bindings, num_frag_data_bindings, locations);
 
     //------------------------------------------------------------------------------
     // ...
     return program;
   }
 
+  void
+  OpenGLProgram::query_locations(GLuint program,
+                                 const FragDataBinding* frag_data_bindings,
+                                 size_t num_frag_data_bindings,
+                                 ProgramLocations& locations)
+  {
+    locations.clear();
+
+    //------------------------------------------------------------------------------
+    // Active attribute names are written straight into the locations' storage.
+    GLint num_active_attributes = 0;
+    GLint max_attribute_length = 0;   // Includes terminator.
+
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &num_active_attributes);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_attribute_length);
+
+    for (GLint attribute_index = 0; attribute_index < num_active_attributes; ++attribute_index) {
+      char* const attribute_name = locations.name_buffer(size_t(max_attribute_length));
+
+      if (attribute_name == nullptr) {
+        break;
+      }
+
+      GLsizei length = 0;   // Does not include terminator.
+      GLint size = 0;
+      GLenum type = GL_INVALID_ENUM;
+
+      glGetActiveAttrib(program, attribute_index, max_attribute_length, &length, &size, &type, attribute_name);
+      const GLint location = glGetAttribLocation(program, attribute_name);
+
+      if (location >= 0) {
+        locations.add_attribute(location, size_t(length));
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Check actual fragment data locations for the names we have been given.
+    for (size_t i = 0; i < num_frag_data_bindings; ++i) {
+      const char* const name = frag_data_bindings[i].m_name;
+
+      if ((name == nullptr) || (name[0] == '\0')) {
+        continue;
+      }
+
+      const GLint location = glGetFragDataLocation(program, name);
+
+      if (location < 0) {
+        continue;
+      }
+
+      const GLint index = glGetFragDataIndex(program, name);
+      assert((index == 0) || (index == 1));
+
+      locations.add_frag_data(location, index, name, strlen(name));
+    }
+  }
+
+  void
+  OpenGLProgram::reflect(GLuint program,
+                         const frag_data_location_list_t& frag_data_locations,
+                         ProgramReflection& reflection)
+  {
+    reflection.clear();
+
+    //------------------------------------------------------------------------------
+    // Uniforms, the block and offset of all of them in one call each. Those in a
+    // block have no location.
+    GLint num_active_uniforms = 0;
+    GLint max_uniform_length = 0;     // Includes terminator.
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_active_uniforms);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_uniform_length);
+
+    if (num_active_uniforms > 0) {
+      std::vector<GLuint> uniform_indices(num_active_uniforms);
+      std::vector<GLint> block_indices(num_active_uniforms, -1);
+      std::vector<GLint> block_offsets(num_active_uniforms, -1);
+
+      for (GLint uniform_index = 0; uniform_index < num_active_uniforms; ++uniform_index) {
+        uniform_indices[uniform_index] = GLuint(uniform_index);
+      }
+
+      glGetActiveUniformsiv(program, num_active_uniforms, uniform_indices.data(), GL_UNIFORM_BLOCK_INDEX, block_indices.data());
+      glGetActiveUniformsiv(program, num_active_uniforms, uniform_indices.data(), GL_UNIFORM_OFFSET, block_offsets.data());
+
+      std::string uniform_name(std::max(max_uniform_length, 1), '\0');
+
+      for (GLint uniform_index = 0; uniform_index < num_active_uniforms; ++uniform_index) {
+        GLsizei length = 0;   // Does not include terminator.
+        GLint size = 0;
+        GLenum type = GL_INVALID_ENUM;
+
+        glGetActiveUniform(program, GLuint(uniform_index), GLsizei(uniform_name.size()), &length, &size, &type, &uniform_name[0]);
+
+        const bool is_in_block = (block_indices[uniform_index] >= 0);
+        const GLint location = (is_in_block ? -1 : glGetUniformLocation(program, uniform_name.c_str()));
+
+        reflection.add_uniform(uniform_name.substr(0, size_t(length)), location, type, size,
+                               (is_in_block ? uint32_t(block_indices[uniform_index]) : ProgramReflection::INVALID_INDEX),
+                               (is_in_block ? block_offsets[uniform_index] : -1));
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Uniform blocks.
+    GLint num_active_uniform_blocks = 0;
+    GLint max_uniform_block_length = 0;   // Includes terminator.
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &num_active_uniform_blocks);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_uniform_block_length);
+
+    std::string block_name(std::max(max_uniform_block_length, 1), '\0');
+
+    for (GLint block_index = 0; block_index < num_active_uniform_blocks; ++block_index) {
+      GLsizei length = 0;   // Does not include terminator.
+      GLint data_size = 0;
+
+      glGetActiveUniformBlockName(program, GLuint(block_index), GLsizei(block_name.size()), &length, &block_name[0]);
+      glGetActiveUniformBlockiv(program, GLuint(block_index), GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+
+      reflection.add_uniform_block(block_name.substr(0, size_t(length)), uint32_t(block_index), data_size);
+    }
+
+    //------------------------------------------------------------------------------
+    // Attributes.
+    GLint num_active_attributes = 0;
+    GLint max_attribute_length = 0;   // Includes terminator.
+
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &num_active_attributes);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_attribute_length);
+
+    std::string attribute_name(std::max(max_attribute_length, 1), '\0');
+
+    for (GLint attribute_index = 0; attribute_index < num_active_attributes; ++attribute_index) {
+      GLsizei length = 0;   // Does not include terminator.
+      GLint size = 0;
+      GLenum type = GL_INVALID_ENUM;
+
+      glGetActiveAttrib(program, GLuint(attribute_index), GLsizei(attribute_name.size()), &length, &size, &type, &attribute_name[0]);
+      const GLint location = glGetAttribLocation(program, attribute_name.c_str());
+
+      //------------------------------------------------------------------------------
+      // Built-ins (gl_VertexID, ...) are active but have no location.
+      if (location >= 0) {
+        reflection.add_attribute(attribute_name.substr(0, size_t(length)), location, type, size);
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Fragment outputs of the given names.
+    for (const auto& tuple : frag_data_locations) {
+      const std::string& name = std::get<2>(tuple);
+
+      if (name.empty()) {
+        continue;
+      }
+
+      const GLint location = glGetFragDataLocation(program, name.c_str());
+
+      if (location < 0) {
+        continue;
+      }
+
+      reflection.add_frag_output(name, location, glGetFragDataIndex(program, name.c_str()));
+    }
+  }
+
   bool
   OpenGLProgram::validate(GLuint program)
   {
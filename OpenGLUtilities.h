@@ -6,16 +6,27 @@
 //  Copyright © 2018 Chris Birkhold. All rights reserved.
 //
 
+#pragma once
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#include <vector>
+#include <cstddef>
 #include <string>
+#include <tuple>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramReflection.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#if defined(__APPLE__)
+#if defined(TOOLBOX_FAKE_OPENGL)
+#include "FakeOpenGL.h"
+#elif defined(__APPLE__)
 #include <OpenGL/gl3.h>
 #include <OpenGL/gl3ext.h>
 #elif defined(_WIN32)
@@ -44,6 +55,94 @@ namespace toolbox {
   ////////////////////////////////////////////////////////////////////////////////
   ////////////////////////////////////////////////////////////////////////////////
 
+  //------------------------------------------------------------------------------
+  // A name to bind to a location before linking (see OpenGLProgram). Names are
+  // NUL-terminated, as OpenGL takes them, and owned by the caller.
+  //------------------------------------------------------------------------------
+
+  struct AttributeBinding
+  {
+    GLint         m_location;
+    const char*   m_name;
+  };
+
+  struct FragDataBinding
+  {
+    GLint         m_location;
+    GLint         m_index;
+    const char*   m_name;
+  };
+
+  //------------------------------------------------------------------------------
+  // The locations of a linked program, names included, in storage the caller
+  // provides (e.g. arrays on the stack reused for every program). Locations or
+  // names that do not fit are dropped and flagged as truncated.
+  //------------------------------------------------------------------------------
+
+  class ProgramLocations
+  {
+  public:
+
+    struct Attribute
+    {
+      GLint         m_location;
+      const char*   m_name;       // Within the names storage.
+    };
+
+    struct FragData
+    {
+      GLint         m_location;
+      GLint         m_index;
+      const char*   m_name;       // Within the names storage.
+    };
+
+    ProgramLocations(Attribute* attributes, size_t max_attributes, FragData* frag_data, size_t max_frag_data, char* names, size_t names_size);
+
+    template <size_t MAX_ATTRIBUTES, size_t MAX_FRAG_DATA, size_t NAMES_SIZE>
+    ProgramLocations(Attribute (&attributes)[MAX_ATTRIBUTES], FragData (&frag_data)[MAX_FRAG_DATA], char (&names)[NAMES_SIZE]) :
+      ProgramLocations(attributes, MAX_ATTRIBUTES, frag_data, MAX_FRAG_DATA, names, NAMES_SIZE)
+    {
+    }
+
+    ProgramLocations(const ProgramLocations&) = delete;
+    ProgramLocations& operator=(const ProgramLocations&) = delete;
+
+    void clear();
+
+    const Attribute* attributes() const { return m_attributes; }
+    size_t num_attributes() const { return m_num_attributes; }
+    const FragData* frag_data() const { return m_frag_data; }
+    size_t num_frag_data() const { return m_num_frag_data; }
+    bool is_truncated() const { return m_is_truncated; }
+
+  private:
+
+    friend class OpenGLProgram;
+
+    //------------------------------------------------------------------------------
+    // Room for a name of up to size bytes (terminator included), for OpenGL to
+    // write to, null if full. Kept by the next add_attribute().
+    char* name_buffer(size_t size);
+
+    void add_attribute(GLint location, size_t name_length);
+    void add_frag_data(GLint location, GLint index, const char* name, size_t name_length);
+
+    Attribute* const  m_attributes;
+    const size_t      m_max_attributes;
+    FragData* const   m_frag_data;
+    const size_t      m_max_frag_data;
+    char* const       m_names;
+    const size_t      m_names_size;
+
+    size_t            m_num_attributes = 0;
+    size_t            m_num_frag_data = 0;
+    size_t            m_names_used = 0;
+    bool              m_is_truncated = false;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
   //------------------------------------------------------------------------------
   // Utility functions for creating and using OpenGL programs.
   //------------------------------------------------------------------------------
@@ -81,6 +180,40 @@ namespace toolbox {
                                       attribute_location_list_t& attribute_locations,
                                       frag_data_location_list_t& frag_data_locations);
 
+    //------------------------------------------------------------------------------
+    // Query the active attribute locations and the fragment data locations for the
+    // given names of an already linked program. The lists are updated as described
+    // for create_from_shaders(). This is also used for programs that were loaded
+    // from a binary and thus never had their locations bound explicitly.
+    static void query_locations(GLuint program,
+                                attribute_location_list_t& attribute_locations,
+                                frag_data_location_list_t& frag_data_locations);
+
+    //------------------------------------------------------------------------------
+    // The same as the above without allocating, for creating many programs (e.g.
+    // shader permutations) at startup: the bindings are taken as arrays, the
+    // locations actually in use returned in the caller's storage.
+    static GLuint create_from_shaders(GLuint vertex_shader,
+                                      GLuint fragment_shader,
+                                      const AttributeBinding* attribute_bindings,
+                                      size_t num_attribute_bindings,
+                                      const FragDataBinding* frag_data_bindings,
+                                      size_t num_frag_data_bindings,
+                                      ProgramLocations& locations);
+
+    static void query_locations(GLuint program,
+                                const FragDataBinding* frag_data_bindings,
+                                size_t num_frag_data_bindings,
+                                ProgramLocations& locations);
+
+    //------------------------------------------------------------------------------
+    // Replace the reflection with that of the given linked program: its active
+    // uniforms, uniform blocks and attributes and, as they can not be enumerated,
+    // the fragment outputs of the given names that are in use.
+    static void reflect(GLuint program,
+                        const frag_data_location_list_t& frag_data_locations,
+                        ProgramReflection& reflection);
+
     //------------------------------------------------------------------------------
     // Validate the program within the current OpenGL state, usually just before a
     // draw call is made. This can be costly and should be reserved for debugging.
@@ -0,0 +1,384 @@
+//
+//  PointGrid.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PointGrid.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+
+    //------------------------------------------------------------------------------
+    // (a * column) + (b * row) + c >= 0, in double as the grid spans millions of
+    // points.
+    struct HalfPlane
+    {
+      double  m_a;
+      double  m_b;
+      double  m_c;
+    };
+
+    //------------------------------------------------------------------------------
+    // Points exactly on a plane must not be lost to rounding, so the intervals are
+    // grown by this much (in columns).
+    const double EPSILON = 1e-6;
+
+    //------------------------------------------------------------------------------
+    // The clip volume planes (grown by the margin) as half planes over the grid's
+    // columns and rows. A clip space coordinate is linear in both:
+    //
+    //   clip[k] = mvp[k][0] * (rect.x + column * dx) + mvp[k][1] * (rect.y + row * dy) + mvp[k][3]
+    std::array<HalfPlane, 6> clip_half_planes(const PointGrid& grid, const float* rect, const float* mvp, const float* viewport, float margin)
+    {
+      const double dx = ((grid.m_columns > 1) ? (double(rect[2]) / (grid.m_columns - 1)) : 0.0);
+      const double dy = ((grid.m_rows > 1) ? (double(rect[3]) / (grid.m_rows - 1)) : 0.0);
+
+      HalfPlane clip[4];
+
+      for (size_t k = 0; k < 4; ++k) {
+        clip[k].m_a = (double(mvp[0 + k]) * dx);
+        clip[k].m_b = (double(mvp[4 + k]) * dy);
+        clip[k].m_c = ((double(mvp[0 + k]) * rect[0]) + (double(mvp[4 + k]) * rect[1]) + double(mvp[12 + k]));
+      }
+
+      //------------------------------------------------------------------------------
+      // (s * clip[k]) + (t * w) >= 0
+      const auto combine = [&clip](size_t k, double s, double t) {
+        HalfPlane half_plane;
+        half_plane.m_a = ((s * clip[k].m_a) + (t * clip[3].m_a));
+        half_plane.m_b = ((s * clip[k].m_b) + (t * clip[3].m_b));
+        half_plane.m_c = ((s * clip[k].m_c) + (t * clip[3].m_c));
+        return half_plane;
+      };
+
+      return {{
+        combine(0, 1.0, -(double(viewport[0]) - margin)),   // x >= x0 * w
+        combine(0, -1.0, (double(viewport[2]) + margin)),   // x <= x1 * w
+        combine(1, 1.0, -(double(viewport[1]) - margin)),   // y >= y0 * w
+        combine(1, -1.0, (double(viewport[3]) + margin)),   // y <= y1 * w
+        combine(2, 1.0, 1.0),                               // z >= -w
+        combine(2, -1.0, 1.0),                              // z <= w
+      }};
+    }
+
+    const char* const SHADING_NAMES[] = { "flat", "uv", "vignette" };
+
+    //------------------------------------------------------------------------------
+    // Names and defines of the point_shader_feature_t bits, in order.
+    const char* const FEATURE_NAMES[] = { "uv", "vignette" };
+    const char* const FEATURE_DEFINES[] = { "POINT_UV_COLOR", "POINT_VIGNETTE" };
+
+    //------------------------------------------------------------------------------
+    // The built-in points shaders, as in shaders/ but for the comments. The block
+    // is POINT_GRID_UNIFORM_BLOCK.
+    const char POINT_VERTEX_SHADER[] =
+      "#version 410\n"
+      "layout(std140) uniform PointGridFrame {\n"
+      "    vec4 u_rect;\n"
+      "    mat4 u_mvp;\n"
+      "};\n"
+      "out vec2 v_uv;\n"
+      "void main() {\n"
+      "    int x = (gl_VertexID % POINT_GRID_COLUMNS);\n"
+      "    int y = (gl_VertexID / POINT_GRID_COLUMNS);\n"
+      "    vec2 uv = (vec2(x, y) * vec2((1.0 / float(POINT_GRID_COLUMNS - 1)), (1.0 / float(POINT_GRID_ROWS - 1))));\n"
+      "    gl_Position = (u_mvp * vec4((u_rect.xy + (uv * u_rect.zw)), 0.0, 1.0));\n"
+      "    gl_PointSize = float(POINT_SIZE);\n"
+      "    v_uv = vec2(uv.x, uv.y);\n"
+      "}\n";
+
+    const char POINT_FRAGMENT_SHADER[] =
+      "#version 410\n"
+      "#if !defined(POINT_VIGNETTE_FACTOR)\n"
+      "#define POINT_VIGNETTE_FACTOR 36.0\n"
+      "#endif\n"
+      "#if !defined(POINT_VIGNETTE_EXPONENT)\n"
+      "#define POINT_VIGNETTE_EXPONENT 4.0\n"
+      "#endif\n"
+      "in vec2 v_uv;\n"
+      "out vec4 f_color;\n"
+      "void main() {\n"
+      "#if defined(POINT_UV_COLOR)\n"
+      "    vec3 color = vec3(v_uv.rg, 0.0);\n"
+      "#else\n"
+      "    vec3 color = vec3(0.8, 0.8, 0.8);\n"
+      "#endif\n"
+      "#if defined(POINT_VIGNETTE)\n"
+      "    color *= pow(clamp(((v_uv.x * (1.0 - v_uv.x)) * (v_uv.y * (1.0 - v_uv.y)) * POINT_VIGNETTE_FACTOR), 0.0, 1.0), POINT_VIGNETTE_EXPONENT);\n"
+      "#endif\n"
+      "    f_color = vec4(color, 1.0);\n"
+      "}\n";
+
+    static_assert(sizeof(FEATURE_NAMES) == sizeof(FEATURE_DEFINES), "A feature lacks its name or define!");
+
+    uint32_t parse_dimension(const std::string& text, const std::string& grid_text)
+    {
+      char* end = nullptr;
+      const unsigned long value = strtoul(text.c_str(), &end, 10);
+
+      if (text.empty() || (text[0] == '-') || (*end != '\0') || (value > 0xffffffff)) {
+        throw std::runtime_error("Invalid point grid: " + grid_text);
+      }
+
+      return uint32_t(value);
+    }
+
+  } // unnamed namespace
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  PointGrid
+  point_grid_from_string(const std::string& text)
+  {
+    PointGrid grid;
+
+    const size_t x = text.find('x');
+    const size_t first_colon = text.find(':');
+    const size_t second_colon = ((first_colon != std::string::npos) ? text.find(':', (first_colon + 1)) : std::string::npos);
+
+    if ((x == std::string::npos) || (x > first_colon)) {
+      throw std::runtime_error("Invalid point grid: " + text);
+    }
+
+    grid.m_columns = parse_dimension(text.substr(0, x), text);
+    grid.m_rows = parse_dimension(text.substr((x + 1), (first_colon - (x + 1))), text);
+
+    //------------------------------------------------------------------------------
+    // Then the point size and/or shading, in that order.
+    std::string shading;
+
+    if (first_colon != std::string::npos) {
+      const std::string option = text.substr(first_colon + 1, (second_colon - (first_colon + 1)));
+
+      if (!option.empty() && isdigit(static_cast<unsigned char>(option[0]))) {
+        grid.m_point_size = parse_dimension(option, text);
+        shading = ((second_colon != std::string::npos) ? text.substr(second_colon + 1) : std::string());
+      }
+      else if (second_colon == std::string::npos) {
+        shading = option;
+      }
+      else {
+        throw std::runtime_error("Invalid point grid: " + text);
+      }
+
+      if (shading.empty() && (second_colon != std::string::npos)) {
+        throw std::runtime_error("Invalid point grid: " + text);
+      }
+    }
+
+    if (!shading.empty()) {
+      const auto it = std::find(std::begin(SHADING_NAMES), std::end(SHADING_NAMES), shading);
+
+      if (it == std::end(SHADING_NAMES)) {
+        throw std::runtime_error("Unknown point shading: " + shading);
+      }
+
+      grid.m_shading = PointShading(it - std::begin(SHADING_NAMES));
+    }
+
+    if (!is_valid_point_grid(grid)) {
+      throw std::runtime_error("Point grid exceeds the limits: " + text);
+    }
+
+    return grid;
+  }
+
+  std::string
+  point_grid_to_string(const PointGrid& grid)
+  {
+    return (std::to_string(grid.m_columns) + "x" + std::to_string(grid.m_rows) + ":" + std::to_string(grid.m_point_size) + ":" + SHADING_NAMES[uint32_t(grid.m_shading)]);
+  }
+
+  std::string
+  point_shader_key_to_string(const PointShaderKey& key)
+  {
+    std::string features;
+
+    for (size_t i = 0; i < (sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0])); ++i) {
+      if (key.m_features & (1u << i)) {
+        features += ((features.empty() ? "" : "+") + std::string(FEATURE_NAMES[i]));
+      }
+    }
+
+    return (std::to_string(key.m_columns) + "x" + std::to_string(key.m_rows) + ":" + std::to_string(key.m_point_size) + ":" + (features.empty() ? "flat" : features));
+  }
+
+  std::string
+  point_vertex_shader(const PointShaderKey& key)
+  {
+    return point_shader_with_defines(key, POINT_VERTEX_SHADER);
+  }
+
+  std::string
+  point_fragment_shader(const PointShaderKey& key)
+  {
+    return point_shader_with_defines(key, POINT_FRAGMENT_SHADER);
+  }
+
+  std::string
+  point_shader_with_defines(const PointShaderKey& key, const std::string& source)
+  {
+    std::string defines =
+      "#define POINT_GRID_COLUMNS " + std::to_string(key.m_columns) + "\n"
+      "#define POINT_GRID_ROWS " + std::to_string(key.m_rows) + "\n"
+      "#define POINT_SIZE " + std::to_string(key.m_point_size) + "\n";
+
+    for (size_t i = 0; i < (sizeof(FEATURE_DEFINES) / sizeof(FEATURE_DEFINES[0])); ++i) {
+      if (key.m_features & (1u << i)) {
+        defines += ("#define " + std::string(FEATURE_DEFINES[i]) + " 1\n");
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // #version must come first, anything before it (comments) stays before it.
+    const size_t version = source.find("#version");
+    const size_t line_end = ((version != std::string::npos) ? source.find('\n', version) : std::string::npos);
+
+    if (line_end == std::string::npos) {
+      return (defines + source);
+    }
+
+    return (source.substr(0, (line_end + 1)) + defines + source.substr(line_end + 1));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  uint32_t
+  PointGridRanges::num_points() const
+  {
+    uint32_t num_points = 0;
+
+    for (const int32_t count : m_counts) {
+      num_points += uint32_t(count);
+    }
+
+    return num_points;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void
+  cull_point_grid(const PointGrid& grid, const float* rect, const float* mvp, const float* viewport, float margin, PointGridRanges& ranges)
+  {
+    ranges.m_firsts.clear();
+    ranges.m_counts.clear();
+
+    const std::array<HalfPlane, 6> half_planes = clip_half_planes(grid, rect, mvp, viewport, margin);
+    const double last_column = (double(grid.m_columns) - 1.0);
+
+    for (uint32_t row = 0; row < grid.m_rows; ++row) {
+      double first = 0.0;
+      double last = last_column;
+
+      //------------------------------------------------------------------------------
+      // a * column >= -(b * row + c), bounding the column from below or above.
+      for (const HalfPlane& half_plane : half_planes) {
+        const double d = -((half_plane.m_b * row) + half_plane.m_c);
+
+        if (half_plane.m_a > 0.0) {
+          first = std::max(first, ((d / half_plane.m_a) - EPSILON));
+        }
+        else if (half_plane.m_a < 0.0) {
+          last = std::min(last, ((d / half_plane.m_a) + EPSILON));
+        }
+        else if (d > 0.0) {
+          last = -1.0;
+        }
+      }
+
+      if (!(first <= last)) {
+        continue;
+      }
+
+      const int32_t first_column = int32_t(std::ceil(first));
+      const int32_t last_column_visible = int32_t(std::floor(last));
+
+      if (first_column > last_column_visible) {
+        continue;
+      }
+
+      const int32_t first_index = int32_t((row * grid.m_columns) + uint32_t(first_column));
+      const int32_t count = ((last_column_visible - first_column) + 1);
+
+      if (!ranges.empty() && ((ranges.m_firsts.back() + ranges.m_counts.back()) == first_index)) {
+        ranges.m_counts.back() += count;
+      }
+      else {
+        ranges.m_firsts.push_back(first_index);
+        ranges.m_counts.push_back(count);
+      }
+    }
+  }
+
+  bool
+  is_point_visible(const PointGrid& grid, const float* rect, const float* mvp, const float* viewport, float margin, uint32_t index)
+  {
+    const double u = ((grid.m_columns > 1) ? (double(index % grid.m_columns) / (grid.m_columns - 1)) : 0.0);
+    const double v = ((grid.m_rows > 1) ? (double(index / grid.m_columns) / (grid.m_rows - 1)) : 0.0);
+    const double x = (rect[0] + (u * rect[2]));
+    const double y = (rect[1] + (v * rect[3]));
+
+    double clip[4];
+
+    for (size_t k = 0; k < 4; ++k) {
+      clip[k] = ((mvp[0 + k] * x) + (mvp[4 + k] * y) + mvp[12 + k]);
+    }
+
+    const double w = clip[3];
+
+    return ((clip[0] >= ((viewport[0] - margin) * w)) && (clip[0] <= ((viewport[2] + margin) * w)) &&
+      (clip[1] >= ((viewport[1] - margin) * w)) && (clip[1] <= ((viewport[3] + margin) * w)) &&
+      (clip[2] >= -w) && (clip[2] <= w));
+  }
+
+  void
+  viewport_mvp(const float* viewport, const float* mvp, float* viewport_mvp)
+  {
+    const float sx = (2.0f / (viewport[2] - viewport[0]));
+    const float sy = (2.0f / (viewport[3] - viewport[1]));
+    const float tx = -((viewport[2] + viewport[0]) / (viewport[2] - viewport[0]));
+    const float ty = -((viewport[3] + viewport[1]) / (viewport[3] - viewport[1]));
+
+    for (size_t column = 0; column < 4; ++column) {
+      const float* const in = (mvp + (column * 4));
+      float* const out = (viewport_mvp + (column * 4));
+
+      out[0] = ((sx * in[0]) + (tx * in[3]));
+      out[1] = ((sy * in[1]) + (ty * in[3]));
+      out[2] = in[2];
+      out[3] = in[3];
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,208 @@
+//
+//  PointGrid.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // A grid of points drawn without vertex data: vertex i is at column
+  // (i % columns) and row (i / columns), spread evenly over a rect (x, y, width,
+  // height) which is then transformed by an mvp (column major, like OpenGL).
+  //
+  // The grid is the single definition of the workload, the shaders (see
+  // PointShaderKey) and draw counts are derived from it.
+  //------------------------------------------------------------------------------
+
+  enum class PointShading : uint32_t
+  {
+    flat,           // One color.
+    uv,             // Colored by position within the grid.
+    vignette        // As uv, darkened towards the edges (pow() per fragment).
+  };
+
+  struct PointGrid
+  {
+    uint32_t        m_columns = 1024;
+    uint32_t        m_rows = 1024;
+    uint32_t        m_point_size = 1;       // In pixels.
+    PointShading    m_shading = PointShading::vignette;
+
+    constexpr uint32_t num_points() const { return (m_columns * m_rows); }
+  };
+
+  constexpr bool operator==(const PointGrid& a, const PointGrid& b)
+  {
+    return ((a.m_columns == b.m_columns) && (a.m_rows == b.m_rows) && (a.m_point_size == b.m_point_size) && (a.m_shading == b.m_shading));
+  }
+
+  constexpr bool operator!=(const PointGrid& a, const PointGrid& b) { return !(a == b); }
+
+  //------------------------------------------------------------------------------
+  // Vertex ids and draw counts are GLint, point sizes beyond 64 pixels are not
+  // supported by all GPUs.
+  constexpr uint64_t MAX_POINT_GRID_POINTS = 0x7fffffff;
+  constexpr uint32_t MAX_POINT_SIZE = 64;
+
+  constexpr bool
+  is_valid_point_grid(const PointGrid& grid)
+  {
+    return ((grid.m_columns >= 2) && (grid.m_rows >= 2) &&
+      ((uint64_t(grid.m_columns) * grid.m_rows) <= MAX_POINT_GRID_POINTS) &&
+      (grid.m_point_size >= 1) && (grid.m_point_size <= MAX_POINT_SIZE));
+  }
+
+  //------------------------------------------------------------------------------
+  // A grid fixed at compile time, checked against the limits at compile time.
+  template <uint32_t COLUMNS, uint32_t ROWS, uint32_t POINT_SIZE = 1, PointShading SHADING = PointShading::vignette>
+  struct StaticPointGrid
+  {
+    static constexpr PointGrid grid() { return PointGrid{ COLUMNS, ROWS, POINT_SIZE, SHADING }; }
+
+    static_assert(is_valid_point_grid(grid()), "Point grid exceeds the limits!");
+  };
+
+  //------------------------------------------------------------------------------
+  // Shader variants
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // What the points shaders are assembled from besides the grid's dimensions and
+  // point size, each a #define of their source (see point_shader_with_defines()).
+  enum point_shader_feature_t : uint32_t
+  {
+    POINT_FEATURE_UV_COLOR  = (1 << 0),     // POINT_UV_COLOR: colored by position within the grid, else flat.
+    POINT_FEATURE_VIGNETTE  = (1 << 1),     // POINT_VIGNETTE: darkened towards the edges (pow() per fragment).
+  };
+
+  //------------------------------------------------------------------------------
+  // Identifies a variant of the points shaders, a program is compiled once per
+  // key (and share group). Grids of the same key share the program, e.g. the
+  // key of a grid known at compile time:
+  //
+  //   constexpr PointShaderKey key = point_shader_key(StaticPointGrid<1024, 1024>::grid());
+  struct PointShaderKey
+  {
+    uint32_t    m_columns = 0;
+    uint32_t    m_rows = 0;
+    uint32_t    m_point_size = 0;
+    uint32_t    m_features = 0;         // See point_shader_feature_t.
+  };
+
+  constexpr uint32_t
+  point_shading_features(PointShading shading)
+  {
+    return ((shading == PointShading::flat) ? 0 :
+      ((shading == PointShading::uv) ? POINT_FEATURE_UV_COLOR : (POINT_FEATURE_UV_COLOR | POINT_FEATURE_VIGNETTE)));
+  }
+
+  constexpr PointShaderKey
+  point_shader_key(const PointGrid& grid)
+  {
+    return PointShaderKey{ grid.m_columns, grid.m_rows, grid.m_point_size, point_shading_features(grid.m_shading) };
+  }
+
+  constexpr bool operator==(const PointShaderKey& a, const PointShaderKey& b)
+  {
+    return ((a.m_columns == b.m_columns) && (a.m_rows == b.m_rows) && (a.m_point_size == b.m_point_size) && (a.m_features == b.m_features));
+  }
+
+  constexpr bool operator!=(const PointShaderKey& a, const PointShaderKey& b) { return !(a == b); }
+
+  constexpr bool operator<(const PointShaderKey& a, const PointShaderKey& b)
+  {
+    return ((a.m_columns != b.m_columns) ? (a.m_columns < b.m_columns) :
+      ((a.m_rows != b.m_rows) ? (a.m_rows < b.m_rows) :
+      ((a.m_point_size != b.m_point_size) ? (a.m_point_size < b.m_point_size) : (a.m_features < b.m_features))));
+  }
+
+  //------------------------------------------------------------------------------
+  // <columns>x<rows>:<point size>:<features>, the features joined with '+' (e.g.
+  // "1024x1024:1:uv+vignette") or "flat" if none. Names the variant's program.
+  std::string point_shader_key_to_string(const PointShaderKey& key);
+
+  //------------------------------------------------------------------------------
+  // The uniform block of the shaders (std140), written per frame.
+  struct PointGridUniforms
+  {
+    float   m_rect[4];
+    float   m_mvp[16];
+  };
+
+  constexpr char POINT_GRID_UNIFORM_BLOCK[] = "PointGridFrame";
+
+  //------------------------------------------------------------------------------
+  // <columns>x<rows>[:<point size>][:flat|uv|vignette], e.g. "2048x2048:2:flat".
+  // Parsing throws if the text is invalid or the grid exceeds the limits.
+  PointGrid point_grid_from_string(const std::string& text);
+  std::string point_grid_to_string(const PointGrid& grid);
+
+  //------------------------------------------------------------------------------
+  // GLSL 4.10 of the variant, with the uniforms u_rect and u_mvp in a block laid
+  // out like PointGridUniforms: the built-in sources (the same as shaders/) with
+  // the key's defines.
+  std::string point_vertex_shader(const PointShaderKey& key);
+  std::string point_fragment_shader(const PointShaderKey& key);
+
+  //------------------------------------------------------------------------------
+  // A shader written against the key's defines (POINT_GRID_COLUMNS,
+  // POINT_GRID_ROWS, POINT_SIZE and those of the features), e.g.
+  // shaders/points.vert, with those inserted after its #version line.
+  std::string point_shader_with_defines(const PointShaderKey& key, const std::string& source);
+
+  //------------------------------------------------------------------------------
+  // Ranges of vertices as taken by glMultiDrawArrays().
+  struct PointGridRanges
+  {
+    std::vector<int32_t>    m_firsts;
+    std::vector<int32_t>    m_counts;
+
+    size_t size() const { return m_firsts.size(); }
+    bool empty() const { return m_firsts.empty(); }
+    uint32_t num_points() const;
+  };
+
+  //------------------------------------------------------------------------------
+  // The points of the grid that can land within the viewport, given in NDC of the
+  // mvp's output (x0, y0, x1, y1) and grown by margin on all sides (e.g. for the
+  // point size). Every plane of the clip volume is linear in the grid's column
+  // and row, so the visible points of every row form one interval; rows that
+  // follow on from each other are merged.
+  //
+  // Replaces the ranges' content, reusing their storage.
+  void cull_point_grid(const PointGrid& grid, const float* rect, const float* mvp, const float* viewport, float margin, PointGridRanges& ranges);
+
+  //------------------------------------------------------------------------------
+  // Same as cull_point_grid() by transforming every point, for checking it.
+  bool is_point_visible(const PointGrid& grid, const float* rect, const float* mvp, const float* viewport, float margin, uint32_t index);
+
+  //------------------------------------------------------------------------------
+  // The mvp that shows only the viewport (see cull_point_grid()), scaled to fill
+  // the clip volume. For drawing the part of the virtual screen a monitor covers.
+  void viewport_mvp(const float* viewport, const float* mvp, float* viewport_mvp);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,346 @@
+//
+//  ProgramReflection.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramReflection.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+  //------------------------------------------------------------------------------
+  // Serialized layout: a header, the number of entries of each kind and then the
+  // entries, each as its values followed by the length and characters of its
+  // name. Hashes are not stored but recomputed from the names.
+  constexpr uint32_t REFLECTION_MAGIC = 0x52504c47;   // 'GLPR'
+  constexpr uint32_t REFLECTION_VERSION = 1;
+
+  //------------------------------------------------------------------------------
+  // Names longer than this are taken as corruption.
+  const uint32_t MAX_NAME_LENGTH = 4096;
+
+  template <typename EntryT>
+  typename std::vector<EntryT>::const_iterator
+  lower_bound(const std::vector<EntryT>& entries, uint64_t hash)
+  {
+    return std::lower_bound(entries.begin(), entries.end(), hash, [](const EntryT& entry, uint64_t value) { return (entry.m_hash < value); });
+  }
+
+  template <typename EntryT>
+  const EntryT*
+  find(const std::vector<EntryT>& entries, toolbox::ShaderName name)
+  {
+    const auto it = lower_bound(entries, name.hash());
+    return (((it != entries.end()) && (it->m_hash == name.hash())) ? &(*it) : nullptr);
+  }
+
+  template <typename EntryT>
+  void
+  insert(std::vector<EntryT>& entries, EntryT entry, const char* kind)
+  {
+    const auto it = lower_bound(entries, entry.m_hash);
+
+    if ((it != entries.end()) && (it->m_hash == entry.m_hash)) {
+      throw std::runtime_error(std::string(kind) + " " + entry.m_name + " is a duplicate or hashes like " + it->m_name + "!");
+    }
+
+    entries.insert((entries.begin() + (it - entries.begin())), std::move(entry));
+  }
+
+  class Writer
+  {
+  public:
+
+    explicit Writer(std::string& data) : m_data(data) {}
+
+    void value(uint32_t value) { m_data.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void value(int32_t value) { m_data.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+    void name(const std::string& name)
+    {
+      value(uint32_t(name.size()));
+      m_data.append(name);
+    }
+
+  private:
+
+    std::string&  m_data;
+  };
+
+  //------------------------------------------------------------------------------
+  // Once anything is out of bounds every read fails.
+  class Reader
+  {
+  public:
+
+    Reader(const void* data, size_t size) : m_data(static_cast<const char*>(data)), m_size(size) {}
+
+    template <typename T>
+    bool value(T& value)
+    {
+      if (!m_is_valid || ((m_size - m_offset) < sizeof(value))) {
+        return (m_is_valid = false);
+      }
+
+      memcpy(&value, (m_data + m_offset), sizeof(value));
+      m_offset += sizeof(value);
+      return true;
+    }
+
+    bool name(std::string& name)
+    {
+      uint32_t length = 0;
+
+      if (!value(length) || (length > MAX_NAME_LENGTH) || ((m_size - m_offset) < length)) {
+        return (m_is_valid = false);
+      }
+
+      name.assign((m_data + m_offset), length);
+      m_offset += length;
+      return true;
+    }
+
+    bool is_at_end() const { return (m_is_valid && (m_offset == m_size)); }
+
+  private:
+
+    const char* const   m_data;
+    const size_t        m_size;
+    size_t              m_offset = 0;
+    bool                m_is_valid = true;
+  };
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  const int32_t ProgramReflection::INVALID_LOCATION;
+  const uint32_t ProgramReflection::INVALID_INDEX;
+
+  void
+  ProgramReflection::add_uniform(std::string name, int32_t location, uint32_t type, int32_t size, uint32_t block_index, int32_t block_offset)
+  {
+    if ((name.size() > 3) && (name.compare((name.size() - 3), 3, "[0]") == 0)) {
+      name.resize(name.size() - 3);
+    }
+
+    const uint64_t hash = ShaderName::hash(name.data(), name.size());
+    insert(m_uniforms, Uniform{ hash, location, type, size, block_index, block_offset, std::move(name) }, "Uniform");
+  }
+
+  void
+  ProgramReflection::add_uniform_block(std::string name, uint32_t index, int32_t data_size)
+  {
+    const uint64_t hash = ShaderName::hash(name.data(), name.size());
+    insert(m_uniform_blocks, UniformBlock{ hash, index, data_size, std::move(name) }, "Uniform block");
+  }
+
+  void
+  ProgramReflection::add_attribute(std::string name, int32_t location, uint32_t type, int32_t size)
+  {
+    if ((name.size() > 3) && (name.compare((name.size() - 3), 3, "[0]") == 0)) {
+      name.resize(name.size() - 3);
+    }
+
+    const uint64_t hash = ShaderName::hash(name.data(), name.size());
+    insert(m_attributes, Attribute{ hash, location, type, size, std::move(name) }, "Attribute");
+  }
+
+  void
+  ProgramReflection::add_frag_output(std::string name, int32_t location, int32_t index)
+  {
+    const uint64_t hash = ShaderName::hash(name.data(), name.size());
+    insert(m_frag_outputs, FragOutput{ hash, location, index, std::move(name) }, "Fragment output");
+  }
+
+  void
+  ProgramReflection::clear()
+  {
+    m_uniforms.clear();
+    m_uniform_blocks.clear();
+    m_attributes.clear();
+    m_frag_outputs.clear();
+  }
+
+  const ProgramReflection::Uniform*
+  ProgramReflection::find_uniform(ShaderName name) const
+  {
+    return find(m_uniforms, name);
+  }
+
+  const ProgramReflection::UniformBlock*
+  ProgramReflection::find_uniform_block(ShaderName name) const
+  {
+    return find(m_uniform_blocks, name);
+  }
+
+  const ProgramReflection::Attribute*
+  ProgramReflection::find_attribute(ShaderName name) const
+  {
+    return find(m_attributes, name);
+  }
+
+  const ProgramReflection::FragOutput*
+  ProgramReflection::find_frag_output(ShaderName name) const
+  {
+    return find(m_frag_outputs, name);
+  }
+
+  int32_t
+  ProgramReflection::uniform_location(ShaderName name) const
+  {
+    const Uniform* const uniform = find_uniform(name);
+    return (uniform ? uniform->m_location : INVALID_LOCATION);
+  }
+
+  uint32_t
+  ProgramReflection::uniform_block_index(ShaderName name) const
+  {
+    const UniformBlock* const block = find_uniform_block(name);
+    return (block ? block->m_index : INVALID_INDEX);
+  }
+
+  void
+  ProgramReflection::serialize(std::string& data) const
+  {
+    Writer writer(data);
+
+    writer.value(REFLECTION_MAGIC);
+    writer.value(REFLECTION_VERSION);
+    writer.value(uint32_t(m_uniforms.size()));
+    writer.value(uint32_t(m_uniform_blocks.size()));
+    writer.value(uint32_t(m_attributes.size()));
+    writer.value(uint32_t(m_frag_outputs.size()));
+
+    for (const Uniform& uniform : m_uniforms) {
+      writer.value(uniform.m_location);
+      writer.value(uniform.m_type);
+      writer.value(uniform.m_size);
+      writer.value(uniform.m_block_index);
+      writer.value(uniform.m_block_offset);
+      writer.name(uniform.m_name);
+    }
+
+    for (const UniformBlock& block : m_uniform_blocks) {
+      writer.value(block.m_index);
+      writer.value(block.m_data_size);
+      writer.name(block.m_name);
+    }
+
+    for (const Attribute& attribute : m_attributes) {
+      writer.value(attribute.m_location);
+      writer.value(attribute.m_type);
+      writer.value(attribute.m_size);
+      writer.name(attribute.m_name);
+    }
+
+    for (const FragOutput& frag_output : m_frag_outputs) {
+      writer.value(frag_output.m_location);
+      writer.value(frag_output.m_index);
+      writer.name(frag_output.m_name);
+    }
+  }
+
+  bool
+  ProgramReflection::deserialize(const void* data, size_t size)
+  {
+    clear();
+
+    Reader reader(data, size);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t num_uniforms = 0;
+    uint32_t num_uniform_blocks = 0;
+    uint32_t num_attributes = 0;
+    uint32_t num_frag_outputs = 0;
+
+    if (!reader.value(magic) || !reader.value(version) || (magic != REFLECTION_MAGIC) || (version != REFLECTION_VERSION) ||
+        !reader.value(num_uniforms) || !reader.value(num_uniform_blocks) || !reader.value(num_attributes) || !reader.value(num_frag_outputs)) {
+      return false;
+    }
+
+    //------------------------------------------------------------------------------
+    // The entries go through add_*() as when reflected, so a corrupt name that
+    // makes a duplicate is caught too.
+    try {
+      for (uint32_t i = 0; i < num_uniforms; ++i) {
+        Uniform uniform = {};
+
+        if (!reader.value(uniform.m_location) || !reader.value(uniform.m_type) || !reader.value(uniform.m_size) ||
+            !reader.value(uniform.m_block_index) || !reader.value(uniform.m_block_offset) || !reader.name(uniform.m_name)) {
+          break;
+        }
+
+        add_uniform(std::move(uniform.m_name), uniform.m_location, uniform.m_type, uniform.m_size, uniform.m_block_index, uniform.m_block_offset);
+      }
+
+      for (uint32_t i = 0; i < num_uniform_blocks; ++i) {
+        UniformBlock block = {};
+
+        if (!reader.value(block.m_index) || !reader.value(block.m_data_size) || !reader.name(block.m_name)) {
+          break;
+        }
+
+        add_uniform_block(std::move(block.m_name), block.m_index, block.m_data_size);
+      }
+
+      for (uint32_t i = 0; i < num_attributes; ++i) {
+        Attribute attribute = {};
+
+        if (!reader.value(attribute.m_location) || !reader.value(attribute.m_type) || !reader.value(attribute.m_size) || !reader.name(attribute.m_name)) {
+          break;
+        }
+
+        add_attribute(std::move(attribute.m_name), attribute.m_location, attribute.m_type, attribute.m_size);
+      }
+
+      for (uint32_t i = 0; i < num_frag_outputs; ++i) {
+        FragOutput frag_output = {};
+
+        if (!reader.value(frag_output.m_location) || !reader.value(frag_output.m_index) || !reader.name(frag_output.m_name)) {
+          break;
+        }
+
+        add_frag_output(std::move(frag_output.m_name), frag_output.m_location, frag_output.m_index);
+      }
+    }
+    catch (std::runtime_error&) {
+      clear();
+      return false;
+    }
+
+    if (!reader.is_at_end()) {
+      clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,184 @@
+//
+//  ProgramReflection.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // The name of a uniform, uniform block, attribute or fragment output, hashed
+  // (64-bit FNV-1a) at compile time when declared constexpr:
+  //
+  //   constexpr ShaderName POINT_GRID_FRAME("PointGridFrame");
+  //
+  // Lookups by name then compare hashes only. The name itself is kept (not
+  // copied) for asking OpenGL, so it must outlive the handle.
+  //------------------------------------------------------------------------------
+
+  class ShaderName
+  {
+  public:
+
+    constexpr ShaderName(const char* name) :
+      m_hash(hash(name)), m_name(name)
+    {
+    }
+
+    constexpr uint64_t hash() const { return m_hash; }
+    constexpr const char* name() const { return m_name; }
+
+    static constexpr uint64_t hash(const char* name)
+    {
+      uint64_t hash = 0xcbf29ce484222325ull;
+
+      for (; *name != '\0'; ++name) {
+        hash = ((hash ^ uint8_t(*name)) * 0x100000001b3ull);
+      }
+
+      return hash;
+    }
+
+    static constexpr uint64_t hash(const char* name, size_t length)
+    {
+      uint64_t hash = 0xcbf29ce484222325ull;
+
+      for (size_t i = 0; i < length; ++i) {
+        hash = ((hash ^ uint8_t(name[i])) * 0x100000001b3ull);
+      }
+
+      return hash;
+    }
+
+  private:
+
+    uint64_t      m_hash;
+    const char*   m_name;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // What a linked program has: its active uniforms (those of the default block
+  // with a location, those of uniform blocks with the block's index and their
+  // offset), uniform blocks, attributes and the fragment outputs asked for (see
+  // OpenGLProgram::reflect()). Arrays are named without the trailing "[0]".
+  //
+  // Entries are kept sorted by the hash of their name and looked up by a
+  // ShaderName. Names hashing alike within one kind are rejected when added.
+  //
+  // The reflection serializes into a few hundred bytes stored with the program
+  // binary (see OpenGLProgramCache), so a program loaded from the cache needs
+  // no introspection at all. Values are plain integers (OpenGL's enums and
+  // indices), so the reflection does not depend on the OpenGL headers.
+  //------------------------------------------------------------------------------
+
+  class ProgramReflection
+  {
+  public:
+
+    static const int32_t  INVALID_LOCATION = -1;
+    static const uint32_t INVALID_INDEX = 0xffffffffu;    // GL_INVALID_INDEX
+
+    struct Uniform
+    {
+      uint64_t      m_hash;
+      int32_t       m_location;       // INVALID_LOCATION within a block.
+      uint32_t      m_type;
+      int32_t       m_size;           // Of arrays, else 1.
+      uint32_t      m_block_index;    // INVALID_INDEX in the default block.
+      int32_t       m_block_offset;   // -1 in the default block.
+      std::string   m_name;
+    };
+
+    struct UniformBlock
+    {
+      uint64_t      m_hash;
+      uint32_t      m_index;
+      int32_t       m_data_size;
+      std::string   m_name;
+    };
+
+    struct Attribute
+    {
+      uint64_t      m_hash;
+      int32_t       m_location;
+      uint32_t      m_type;
+      int32_t       m_size;
+      std::string   m_name;
+    };
+
+    struct FragOutput
+    {
+      uint64_t      m_hash;
+      int32_t       m_location;
+      int32_t       m_index;
+      std::string   m_name;
+    };
+
+    //------------------------------------------------------------------------------
+    // Throw if an entry of the same kind hashes alike.
+    void add_uniform(std::string name, int32_t location, uint32_t type, int32_t size, uint32_t block_index, int32_t block_offset);
+    void add_uniform_block(std::string name, uint32_t index, int32_t data_size);
+    void add_attribute(std::string name, int32_t location, uint32_t type, int32_t size);
+    void add_frag_output(std::string name, int32_t location, int32_t index);
+
+    void clear();
+
+    //------------------------------------------------------------------------------
+    // Null if the program has no such entry.
+    const Uniform* find_uniform(ShaderName name) const;
+    const UniformBlock* find_uniform_block(ShaderName name) const;
+    const Attribute* find_attribute(ShaderName name) const;
+    const FragOutput* find_frag_output(ShaderName name) const;
+
+    int32_t uniform_location(ShaderName name) const;
+    uint32_t uniform_block_index(ShaderName name) const;
+
+    const std::vector<Uniform>& uniforms() const { return m_uniforms; }
+    const std::vector<UniformBlock>& uniform_blocks() const { return m_uniform_blocks; }
+    const std::vector<Attribute>& attributes() const { return m_attributes; }
+    const std::vector<FragOutput>& frag_outputs() const { return m_frag_outputs; }
+
+    //------------------------------------------------------------------------------
+    // Appends the reflection to data, in native byte order.
+    void serialize(std::string& data) const;
+
+    //------------------------------------------------------------------------------
+    // Replaces the reflection with the serialized one, false (and left empty) if
+    // the data is truncated, corrupt or of another version.
+    bool deserialize(const void* data, size_t size);
+
+  private:
+
+    std::vector<Uniform>        m_uniforms;
+    std::vector<UniformBlock>   m_uniform_blocks;
+    std::vector<Attribute>      m_attributes;
+    std::vector<FragOutput>     m_frag_outputs;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
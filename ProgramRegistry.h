@@ -0,0 +1,493 @@
+//
+//  ProgramRegistry.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // The programs of one share group: each is compiled and linked once, on a loader
+  // thread with a context of the group current, and the same program name handed
+  // to every context of the group. Reflection data is queried once per context and
+  // program, in that context.
+  //
+  // Programs are created and deleted through BackendT, so the registry runs
+  // without a GPU (see FakeProgramBackend):
+  //
+  //   typedef ... program_t
+  //   typedef ... reflection_t
+  //   void begin_loader()                    Makes the loader context current.
+  //   void end_loader()
+  //   program_t create_program(const std::string& vertex_shader, const std::string& fragment_shader)
+  //                                          Throws on failure. The program must
+  //                                          be usable by the other contexts on
+  //                                          return, the shaders deleted.
+  //   void delete_program(program_t program)
+  //   reflection_t reflect(program_t program)
+  //
+  // A program can be reloaded from new sources while in use: the loader compiles
+  // them in the background and, if they link, the entry points to the new program
+  // and the generation counts up. Render threads compare generation() at a frame
+  // boundary and fetch the new program then, never waiting for a compile. If the
+  // sources fail, the entry keeps the program it had.
+  //
+  // Programs, including those replaced by reloads, live until the registry is
+  // destroyed, which must be before the contexts of the group are. Replaced ones
+  // may still be bound in some context, and a reused name would look unchanged
+  // to the state caches.
+  //------------------------------------------------------------------------------
+
+  template <typename BackendT>
+  class ProgramRegistry
+  {
+  public:
+
+    typedef typename BackendT::program_t program_t;
+    typedef typename BackendT::reflection_t reflection_t;
+    typedef std::function<void(const std::string& error)> reload_callback_t;
+
+    struct Statistics
+    {
+      uint64_t    m_requests = 0;       // Including those for programs already requested.
+      uint64_t    m_compiles = 0;       // Programs linked by the loader.
+      uint64_t    m_failures = 0;
+      uint64_t    m_reflections = 0;    // Queried, once per context and program.
+      uint64_t    m_reloads = 0;        // Reloaded programs that linked (swapped in).
+      uint64_t    m_reload_failures = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Of one program (e.g. a shader variant), reloads included.
+    struct ProgramStatistics
+    {
+      std::string                 m_name;
+      uint64_t                    m_compiles = 0;
+      uint64_t                    m_failures = 0;
+      std::chrono::nanoseconds    m_compile_time { 0 };     // Of all, failed ones included.
+      std::chrono::nanoseconds    m_max_compile_time { 0 };
+    };
+
+    explicit ProgramRegistry(const BackendT& backend = BackendT()) :
+      m_backend(backend)
+    {
+      m_loader = std::thread(&ProgramRegistry::run_loader, this);
+    }
+
+    ~ProgramRegistry()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_is_stopping = true;
+      }
+
+      m_changed.notify_all();
+      m_loader.join();
+    }
+
+    ProgramRegistry(const ProgramRegistry&) = delete;
+    ProgramRegistry& operator=(const ProgramRegistry&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Queue the program for the loader (once per name), returns right away.
+    void request(const std::string& name, const std::string& vertex_shader, const std::string& fragment_shader)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      ++m_statistics.m_requests;
+
+      if (m_entries.count(name) > 0) {
+        return;
+      }
+
+      Entry& entry = m_entries[name];
+      entry.m_vertex_shader = vertex_shader;
+      entry.m_fragment_shader = fragment_shader;
+
+      m_queue.push_back(name);
+      m_changed.notify_all();
+    }
+
+    //------------------------------------------------------------------------------
+    // Queue new sources for a requested program, returns right away. The callback
+    // is called on the loader thread with the error, empty if the new program is
+    // swapped in. Reloads queued before the loader got to the last are merged, the
+    // latest sources win and every callback is called.
+    void reload(const std::string& name, const std::string& vertex_shader, const std::string& fragment_shader, reload_callback_t on_done = nullptr)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const auto it = m_entries.find(name);
+
+      if (it == m_entries.end()) {
+        throw std::runtime_error("Program " + name + " was never requested!");
+      }
+
+      Entry& entry = it->second;
+      entry.m_reload_vertex_shader = vertex_shader;
+      entry.m_reload_fragment_shader = fragment_shader;
+
+      if (on_done) {
+        entry.m_reload_callbacks.push_back(std::move(on_done));
+      }
+
+      if (!entry.m_is_reload_queued) {
+        entry.m_is_reload_queued = true;
+        m_queue.push_back(name);
+        m_changed.notify_all();
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Counts the programs swapped in by reloads, without locking, for render threads
+    // to check once per frame.
+    uint64_t generation() const
+    {
+      return m_generation.load(std::memory_order_acquire);
+    }
+
+    //------------------------------------------------------------------------------
+    // Waits for the loader, throws if the program failed or was never requested.
+    // Optionally returns when the program was linked, for measuring swap latency.
+    program_t program(const std::string& name, std::chrono::steady_clock::time_point* linked_at = nullptr)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      const Entry& entry = wait_for_entry(lock, name);
+
+      if (linked_at) {
+        *linked_at = entry.m_linked_at;
+      }
+
+      return entry.m_program;
+    }
+
+    //------------------------------------------------------------------------------
+    // Of the program in the calling thread's context, given by its index in the
+    // group. Waits for the loader like program().
+    reflection_t reflection(size_t context_index, const std::string& name)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      const program_t program = wait_for_entry(lock, name).m_program;
+      const std::pair<size_t, program_t> key(context_index, program);
+
+      const auto it = m_reflections.find(key);
+
+      if (it != m_reflections.end()) {
+        return it->second;
+      }
+
+      lock.unlock();
+      const reflection_t reflection = m_backend.reflect(program);
+      lock.lock();
+
+      ++m_statistics.m_reflections;
+      m_reflections[key] = reflection;
+
+      return reflection;
+    }
+
+    Statistics statistics() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_statistics;
+    }
+
+    //------------------------------------------------------------------------------
+    // Of every requested program, by name.
+    std::vector<ProgramStatistics> program_statistics() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      std::vector<ProgramStatistics> statistics;
+
+      for (const auto& entry : m_entries) {
+        statistics.push_back(entry.second.m_statistics);
+        statistics.back().m_name = entry.first;
+      }
+
+      return statistics;
+    }
+
+  private:
+
+    enum class State
+    {
+      pending,
+      linked,
+      failed
+    };
+
+    struct Entry
+    {
+      std::string   m_vertex_shader;
+      std::string   m_fragment_shader;
+      State         m_state = State::pending;
+      program_t     m_program = program_t();
+      std::string   m_error;
+
+      std::chrono::steady_clock::time_point   m_linked_at;
+      ProgramStatistics                       m_statistics;     // But for the name.
+
+      // Sources queued by reload().
+      bool                            m_is_reload_queued = false;
+      std::string                     m_reload_vertex_shader;
+      std::string                     m_reload_fragment_shader;
+      std::vector<reload_callback_t>  m_reload_callbacks;
+    };
+
+    Entry& wait_for_entry(std::unique_lock<std::mutex>& lock, const std::string& name)
+    {
+      const auto it = m_entries.find(name);
+
+      if (it == m_entries.end()) {
+        throw std::runtime_error("Program " + name + " was never requested!");
+      }
+
+      m_changed.wait(lock, [&it]() { return (it->second.m_state != State::pending); });
+
+      if (it->second.m_state == State::failed) {
+        throw std::runtime_error("Program " + name + " failed: " + it->second.m_error);
+      }
+
+      return it->second;
+    }
+
+    //------------------------------------------------------------------------------
+    // Compiles the queued programs till stopped, then deletes them all. Without a
+    // loader context every program fails.
+    void run_loader()
+    {
+      std::string loader_error;
+
+      try {
+        m_backend.begin_loader();
+      }
+      catch (std::exception& e) {
+        loader_error = e.what();
+      }
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      for (;;) {
+        m_changed.wait(lock, [this]() { return (m_is_stopping || !m_queue.empty()); });
+
+        if (m_queue.empty()) {
+          break;
+        }
+
+        Entry& entry = m_entries[m_queue.front()];
+        m_queue.pop_front();
+
+        //------------------------------------------------------------------------------
+        // The first compile of an entry comes before any reload queued meanwhile.
+        const bool is_reload = (entry.m_state != State::pending);
+        std::vector<reload_callback_t> callbacks;
+
+        if (is_reload) {
+          entry.m_is_reload_queued = false;
+          entry.m_vertex_shader = std::move(entry.m_reload_vertex_shader);
+          entry.m_fragment_shader = std::move(entry.m_reload_fragment_shader);
+          callbacks.swap(entry.m_reload_callbacks);
+        }
+
+        const std::string vertex_shader = entry.m_vertex_shader;
+        const std::string fragment_shader = entry.m_fragment_shader;
+        program_t program = program_t();
+        std::string error = loader_error;
+
+        lock.unlock();
+
+        const auto start_time = std::chrono::steady_clock::now();
+
+        if (error.empty()) {
+          try {
+            program = m_backend.create_program(vertex_shader, fragment_shader);
+          }
+          catch (std::exception& e) {
+            error = e.what();
+          }
+          catch (...) {
+            error = "unknown exception";
+          }
+        }
+
+        const std::chrono::nanoseconds compile_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time);
+
+        lock.lock();
+
+        if (error.empty()) {
+          ++m_statistics.m_compiles;
+          ++entry.m_statistics.m_compiles;
+        }
+        else {
+          ++m_statistics.m_failures;
+          ++entry.m_statistics.m_failures;
+        }
+
+        entry.m_statistics.m_compile_time += compile_time;
+        entry.m_statistics.m_max_compile_time = std::max(entry.m_statistics.m_max_compile_time, compile_time);
+
+        if (!is_reload) {
+          entry.m_program = program;
+          entry.m_error = error;
+          entry.m_state = (error.empty() ? State::linked : State::failed);
+          entry.m_linked_at = std::chrono::steady_clock::now();
+        }
+        else if (error.empty()) {
+          if (entry.m_state == State::linked) {
+            m_retired.push_back(entry.m_program);
+          }
+
+          entry.m_program = program;
+          entry.m_error.clear();
+          entry.m_state = State::linked;
+          entry.m_linked_at = std::chrono::steady_clock::now();
+
+          ++m_statistics.m_reloads;
+          m_generation.fetch_add(1, std::memory_order_release);
+        }
+        else {
+          ++m_statistics.m_reload_failures;
+        }
+
+        m_changed.notify_all();
+
+        //------------------------------------------------------------------------------
+        // Callbacks may reload again (e.g. a watcher), so not under the lock.
+        if (!callbacks.empty()) {
+          lock.unlock();
+
+          for (const reload_callback_t& callback : callbacks) {
+            callback(error);
+          }
+
+          lock.lock();
+        }
+      }
+
+      if (loader_error.empty()) {
+        for (const auto& entry : m_entries) {
+          if (entry.second.m_state == State::linked) {
+            m_backend.delete_program(entry.second.m_program);
+          }
+        }
+
+        for (const program_t program : m_retired) {
+          m_backend.delete_program(program);
+        }
+
+        m_backend.end_loader();
+      }
+    }
+
+    BackendT                                                m_backend;
+
+    mutable std::mutex                                      m_mutex;
+    std::condition_variable                                 m_changed;
+    std::map<std::string, Entry>                            m_entries;
+    std::deque<std::string>                                 m_queue;
+    std::map<std::pair<size_t, program_t>, reflection_t>    m_reflections;
+    std::vector<program_t>                                  m_retired;
+    Statistics                                              m_statistics;
+    bool                                                    m_is_stopping = false;
+    std::atomic<uint64_t>                                   m_generation { 0 };
+
+    std::thread                                             m_loader;
+  };
+
+  //------------------------------------------------------------------------------
+  // Stands in for OpenGL, counting into counts the caller keeps, including calls
+  // that must be made on the loader thread but were not. Compiling takes the given
+  // time and fails for a vertex shader containing "#error". Program names count up
+  // from 1, reflect() returns the program name.
+  struct FakeProgramBackend
+  {
+    typedef uint32_t program_t;
+    typedef uint32_t reflection_t;
+
+    struct Counts
+    {
+      std::atomic<uint64_t>   m_compiles { 0 };
+      std::atomic<uint64_t>   m_shaders_created { 0 };
+      std::atomic<uint64_t>   m_shaders_deleted { 0 };
+      std::atomic<uint64_t>   m_programs_deleted { 0 };
+      std::atomic<uint64_t>   m_reflections { 0 };
+      std::atomic<uint64_t>   m_off_loader_calls { 0 };
+    };
+
+    Counts*                     m_counts = nullptr;
+    std::chrono::microseconds   m_compile_time { 0 };
+    std::thread::id             m_loader_thread;
+    program_t                   m_next_program = 1;
+
+    void begin_loader() { m_loader_thread = std::this_thread::get_id(); }
+    void end_loader() { m_loader_thread = std::thread::id(); }
+
+    program_t create_program(const std::string& vertex_shader, const std::string&)
+    {
+      check_loader_thread();
+      m_counts->m_shaders_created += 2;
+      std::this_thread::sleep_for(m_compile_time);
+      m_counts->m_shaders_deleted += 2;
+
+      if (vertex_shader.find("#error") != std::string::npos) {
+        throw std::runtime_error("Vertex shader failed to compile!");
+      }
+
+      ++m_counts->m_compiles;
+      return m_next_program++;
+    }
+
+    void delete_program(program_t)
+    {
+      check_loader_thread();
+      ++m_counts->m_programs_deleted;
+    }
+
+    reflection_t reflect(program_t program)
+    {
+      ++m_counts->m_reflections;
+      return program;
+    }
+
+    void check_loader_thread()
+    {
+      if (std::this_thread::get_id() != m_loader_thread) {
+        ++m_counts->m_off_loader_calls;
+      }
+    }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
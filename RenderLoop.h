@@ -0,0 +1,207 @@
+//
+//  RenderLoop.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacing.h"
+#include "FrameTrace.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // The per-frame loop of a render thread, specialized at compile time over its
+  // policies:
+  //
+  //   ClockT       static Clock::time_point now()
+  //   PacerT       void start(Clock::time_point first_frame_time), void wait()
+  //   EncoderT     void encode(size_t frame_index)
+  //   TimingSinkT  static constexpr bool IS_ENABLED, void push(const FrameTimingRecord&)
+  //   SwapT        void swap()
+  //
+  // The clock is only read for a sink that is enabled, so with NullTimingSink the
+  // loop is reduced to wait, encode and swap. Pick among a fixed set of
+  // instantiations at runtime (see main.cpp) rather than branching per frame.
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // Clocks
+  //------------------------------------------------------------------------------
+
+  struct SteadyClockPolicy
+  {
+    static Clock::time_point now() { return std::chrono::steady_clock::now(); }
+  };
+
+  //------------------------------------------------------------------------------
+  // Pacers
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // Start encoding as soon as the previous frame was swapped, without a call.
+  struct FreeRunPacing
+  {
+    void start(Clock::time_point) {}
+    void wait() {}
+  };
+
+  //------------------------------------------------------------------------------
+  // Any pacer selected at runtime (see create_frame_pacer()).
+  class DynamicPacing
+  {
+  public:
+
+    explicit DynamicPacing(FramePacer& pacer) : m_pacer(pacer) {}
+
+    void start(Clock::time_point first_frame_time) { m_pacer.start(first_frame_time); }
+    void wait() { m_pacer.wait(); }
+
+  private:
+
+    FramePacer&     m_pacer;
+  };
+
+  //------------------------------------------------------------------------------
+  // Timing sinks
+  //------------------------------------------------------------------------------
+
+  struct NullTimingSink
+  {
+    static constexpr bool IS_ENABLED = false;
+
+    void push(const FrameTimingRecord&) {}
+  };
+
+  //------------------------------------------------------------------------------
+  // Hands records to a channel (e.g. FrameTimingLog::Channel), skipping the
+  // frames before the given one while the pipeline warms up.
+  template <typename ChannelT>
+  class ChannelTimingSink
+  {
+  public:
+
+    static constexpr bool IS_ENABLED = true;
+
+    ChannelTimingSink(ChannelT& channel, uint64_t first_frame_index) : m_channel(channel), m_first_frame_index(first_frame_index) {}
+
+    void push(const FrameTimingRecord& record)
+    {
+      if (record.m_frame_index >= m_first_frame_index) {
+        m_channel.push(record);
+      }
+    }
+
+  private:
+
+    ChannelT&       m_channel;
+    const uint64_t  m_first_frame_index;
+  };
+
+  //------------------------------------------------------------------------------
+  // Prints every record, for watching a single thread while debugging.
+  struct ConsoleTimingSink
+  {
+    static constexpr bool IS_ENABLED = true;
+
+    void push(const FrameTimingRecord& record)
+    {
+      std::ostringstream line;
+      line << "Frame: " << record.m_frame_us << " Sync: " << record.m_sync_us << " Encode: " << record.m_encode_us << " Swap: " << record.m_swap_us << std::endl;
+      std::cout << line.str();
+    }
+  };
+
+  //------------------------------------------------------------------------------
+  // Loop
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // Render the given number of frames, the first starting at first_frame_time.
+  // Swap end times are recorded relative to the given epoch. The end of a swap
+  // doubles as the start of the next frame, three clock reads per frame.
+  template <typename ClockT, typename PacerT, typename EncoderT, typename TimingSinkT, typename SwapT>
+  void run_render_loop(size_t num_frames, Clock::time_point first_frame_time, Clock::time_point epoch, PacerT& pacer, EncoderT& encoder, TimingSinkT& timing_sink, SwapT& swap)
+  {
+    typedef std::chrono::microseconds us;
+
+    FrameTimingRecord timing_record = {};
+    Clock::time_point prev_frame_start_time;
+    Clock::time_point frame_start_time;
+
+    pacer.start(first_frame_time);
+
+    if (TimingSinkT::IS_ENABLED) {
+      frame_start_time = ClockT::now();
+      prev_frame_start_time = frame_start_time;
+    }
+
+    for (size_t frame_index = 0; frame_index < num_frames; ++frame_index) {
+      //------------------------------------------------------------------------------
+      // Wait till encoding of this frame should start.
+      pacer.wait();
+
+      Clock::time_point encode_start_time;
+
+      if (TimingSinkT::IS_ENABLED) {
+        encode_start_time = ClockT::now();
+
+        timing_record.m_frame_index = frame_index;
+        timing_record.m_frame_us = std::chrono::duration_cast<us>(frame_start_time - prev_frame_start_time).count();
+        timing_record.m_sync_us = std::chrono::duration_cast<us>(encode_start_time - frame_start_time).count();
+      }
+
+      //------------------------------------------------------------------------------
+      // Encode the frame.
+      encoder.encode(frame_index);
+
+      Clock::time_point swap_start_time;
+
+      if (TimingSinkT::IS_ENABLED) {
+        swap_start_time = ClockT::now();
+        timing_record.m_encode_us = std::chrono::duration_cast<us>(swap_start_time - encode_start_time).count();
+      }
+
+      //------------------------------------------------------------------------------
+      // Swap buffers.
+      swap.swap();
+
+      if (TimingSinkT::IS_ENABLED) {
+        const Clock::time_point swap_end_time = ClockT::now();
+
+        timing_record.m_swap_us = std::chrono::duration_cast<us>(swap_end_time - swap_start_time).count();
+        timing_record.m_swap_end_us = std::chrono::duration_cast<us>(swap_end_time - epoch).count();
+        timing_sink.push(timing_record);
+
+        prev_frame_start_time = frame_start_time;
+        frame_start_time = swap_end_time;
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
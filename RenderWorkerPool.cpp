@@ -0,0 +1,143 @@
+//
+//  RenderWorkerPool.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "RenderWorkerPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  RenderWorkerPool::RenderWorkerPool(size_t num_workers, task_t bind_context, task_t unbind_context)
+    : m_bind_context(std::move(bind_context))
+    , m_unbind_context(std::move(unbind_context))
+  {
+    //------------------------------------------------------------------------------
+    // All workers exist before any thread starts, tasks look their worker up.
+    for (size_t i = 0; i < num_workers; ++i) {
+      m_workers.emplace_back(new Worker());
+    }
+
+    for (size_t i = 0; i < num_workers; ++i) {
+      m_workers[i]->m_thread = std::thread(&RenderWorkerPool::run, this, i);
+    }
+  }
+
+  RenderWorkerPool::~RenderWorkerPool()
+  {
+    stop();
+  }
+
+  std::future<void>
+  RenderWorkerPool::submit(size_t worker_index, task_t task)
+  {
+    assert(worker_index < m_workers.size());
+    Worker& worker = *m_workers[worker_index];
+
+    //------------------------------------------------------------------------------
+    // A worker that failed to bind its context fails every task with that error.
+    std::packaged_task<void()> packaged_task([&worker, worker_index, task]() {
+      if (worker.m_bind_error) {
+        std::rethrow_exception(worker.m_bind_error);
+      }
+
+      task(worker_index);
+    });
+
+    std::future<void> future = packaged_task.get_future();
+
+    {
+      std::lock_guard<std::mutex> lock(worker.m_mutex);
+
+      if (worker.m_stop) {
+        throw std::runtime_error("Render worker pool is stopped!");
+      }
+
+      worker.m_tasks.push_back(std::move(packaged_task));
+    }
+
+    worker.m_event.notify_one();
+    return future;
+  }
+
+  void
+  RenderWorkerPool::stop()
+  {
+    for (auto& worker : m_workers) {
+      std::lock_guard<std::mutex> lock(worker->m_mutex);
+      worker->m_stop = true;
+      worker->m_event.notify_one();
+    }
+
+    for (auto& worker : m_workers) {
+      if (worker->m_thread.joinable()) {
+        worker->m_thread.join();
+      }
+    }
+  }
+
+  void
+  RenderWorkerPool::run(size_t worker_index)
+  {
+    Worker& worker = *m_workers[worker_index];
+
+    try {
+      m_bind_context(worker_index);
+    }
+    catch (...) {
+      worker.m_bind_error = std::current_exception();
+    }
+
+    //------------------------------------------------------------------------------
+    // Run tasks until stopped and the queue is drained. Exceptions of the tasks end
+    // up in their futures.
+    for (;;) {
+      std::packaged_task<void()> task;
+
+      {
+        std::unique_lock<std::mutex> lock(worker.m_mutex);
+        worker.m_event.wait(lock, [&worker]() { return (worker.m_stop || !worker.m_tasks.empty()); });
+
+        if (worker.m_tasks.empty()) {
+          break;
+        }
+
+        task = std::move(worker.m_tasks.front());
+        worker.m_tasks.pop_front();
+      }
+
+      task();
+    }
+
+    if (!worker.m_bind_error) {
+      try {
+        m_unbind_context(worker_index);
+      }
+      catch (...) {
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,96 @@
+//
+//  RenderWorkerPool.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Long-lived render threads, one per rendering context.
+  //
+  // Each worker binds its context once when it starts (e.g. wglMakeCurrent) and
+  // unbinds it when the pool stops, tasks submitted to the worker run in order
+  // with the context current. This lets scenarios run back to back without
+  // creating threads or rebinding contexts. The future of a task carries its
+  // exception, including a failure to bind the worker's context.
+  //------------------------------------------------------------------------------
+
+  class RenderWorkerPool
+  {
+  public:
+
+    typedef std::function<void(size_t worker_index)> task_t;
+
+    //------------------------------------------------------------------------------
+    // The bind function is called on each worker thread before its first task and
+    // may throw, the unbind function after its last task.
+    RenderWorkerPool(size_t num_workers, task_t bind_context, task_t unbind_context);
+    ~RenderWorkerPool();
+
+    RenderWorkerPool(const RenderWorkerPool&) = delete;
+    RenderWorkerPool& operator=(const RenderWorkerPool&) = delete;
+
+    size_t size() const { return m_workers.size(); }
+
+    //------------------------------------------------------------------------------
+    // For placing a worker thread (see ThreadAffinity.h).
+    std::thread::native_handle_type native_handle(size_t worker_index) { return m_workers[worker_index]->m_thread.native_handle(); }
+
+    //------------------------------------------------------------------------------
+    // Queue a task for the given worker.
+    std::future<void> submit(size_t worker_index, task_t task);
+
+    //------------------------------------------------------------------------------
+    // Finish all queued tasks, unbind the contexts and join the threads. Must be
+    // called (or the pool destroyed) before the contexts are deleted.
+    void stop();
+
+  private:
+
+    struct Worker
+    {
+      std::mutex                              m_mutex;
+      std::condition_variable                 m_event;
+      std::deque<std::packaged_task<void()>>  m_tasks;
+      bool                                    m_stop = false;
+      std::exception_ptr                      m_bind_error;     // Only accessed by the worker thread.
+      std::thread                             m_thread;
+    };
+
+    void run(size_t worker_index);
+
+    const task_t                            m_bind_context;
+    const task_t                            m_unbind_context;
+    std::vector<std::unique_ptr<Worker>>    m_workers;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,224 @@
+//
+//  ScenarioRunner.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Scenarios.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Options
+    //------------------------------------------------------------------------------
+
+    struct options_t {
+        double          m_refresh_rate = 60.0;
+        std::string     m_output_path;          // Standard output if empty.
+        std::string     m_matrix_path;
+        std::string     m_sweep_point_grid;     // Sweep from this grid instead of running a matrix, if not empty.
+        std::string     m_baseline_path;        // Results table to compare with, if not empty.
+        double          m_threshold_percent = 20.0;
+    };
+
+    void print_usage(std::ostream& stream)
+    {
+        stream << "Usage: ScenarioRunner [--refresh-rate=<Hz>] [--output=<path>] [--baseline=<table> [--threshold=<percent>]] <matrix>" << std::endl;
+        stream << "       ScenarioRunner [--refresh-rate=<Hz>] --sweep-points=<grid>" << std::endl;
+        stream << "  Runs every scenario of the matrix on the headless backend, see Scenarios.h for the format (Scenarios.ci.cfg" << std::endl;
+        stream << "  runs in about a minute), and fails if one regressed by more than the threshold (20%) over the baseline," << std::endl;
+        stream << "  or finds the largest point grid (<columns>x<rows>[:<point size>][:<shading>]) sustained at the refresh rate." << std::endl;
+    }
+
+    bool parse_options(int argc, char* argv[], options_t& options)
+    {
+        static const char REFRESH_RATE_OPTION[] = "--refresh-rate=";
+        static const char OUTPUT_OPTION[] = "--output=";
+        static const char SWEEP_POINTS_OPTION[] = "--sweep-points=";
+        static const char BASELINE_OPTION[] = "--baseline=";
+        static const char THRESHOLD_OPTION[] = "--threshold=";
+
+        for (int i = 1; i < argc; ++i) {
+            if (strncmp(argv[i], REFRESH_RATE_OPTION, (sizeof(REFRESH_RATE_OPTION) - 1)) == 0) {
+                options.m_refresh_rate = atof(argv[i] + (sizeof(REFRESH_RATE_OPTION) - 1));
+
+                if (options.m_refresh_rate <= 0.0) {
+                    std::cerr << "Error: Invalid refresh rate: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (strncmp(argv[i], OUTPUT_OPTION, (sizeof(OUTPUT_OPTION) - 1)) == 0) {
+                options.m_output_path = (argv[i] + (sizeof(OUTPUT_OPTION) - 1));
+            }
+            else if (strncmp(argv[i], SWEEP_POINTS_OPTION, (sizeof(SWEEP_POINTS_OPTION) - 1)) == 0) {
+                options.m_sweep_point_grid = (argv[i] + (sizeof(SWEEP_POINTS_OPTION) - 1));
+            }
+            else if (strncmp(argv[i], BASELINE_OPTION, (sizeof(BASELINE_OPTION) - 1)) == 0) {
+                options.m_baseline_path = (argv[i] + (sizeof(BASELINE_OPTION) - 1));
+            }
+            else if (strncmp(argv[i], THRESHOLD_OPTION, (sizeof(THRESHOLD_OPTION) - 1)) == 0) {
+                options.m_threshold_percent = atof(argv[i] + (sizeof(THRESHOLD_OPTION) - 1));
+
+                if (options.m_threshold_percent < 0.0) {
+                    std::cerr << "Error: Invalid threshold: " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if ((strncmp(argv[i], "--", 2) == 0) || !options.m_matrix_path.empty()) {
+                std::cerr << "Error: Unexpected argument: " << argv[i] << std::endl;
+                return false;
+            }
+            else {
+                options.m_matrix_path = argv[i];
+            }
+        }
+
+        return ((options.m_matrix_path.empty() != options.m_sweep_point_grid.empty()) && (options.m_baseline_path.empty() || !options.m_matrix_path.empty()));
+    }
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char* argv[])
+{
+    options_t options;
+
+    if (!parse_options(argc, argv, options)) {
+        print_usage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        if (!options.m_sweep_point_grid.empty()) {
+            toolbox::Scenario scenario;
+            scenario.m_workload = toolbox::WORKLOAD_POINTS;
+            scenario.m_point_grid = toolbox::point_grid_from_string(options.m_sweep_point_grid);
+            scenario.m_num_frames = 120;
+            scenario.m_num_warmup_frames = 30;
+            scenario.m_num_repetitions = 1;
+
+            const std::unique_ptr<toolbox::RenderBackend> backend = toolbox::create_headless_backend(1, options.m_refresh_rate);
+            toolbox::print_point_grid_sweep(std::cout, toolbox::sweep_point_grid(*backend, 0, scenario));
+
+            return EXIT_SUCCESS;
+        }
+
+        const std::vector<toolbox::Scenario> scenarios = toolbox::load_scenario_matrix(options.m_matrix_path);
+
+        //------------------------------------------------------------------------------
+        // One output per thread of the largest scenario.
+        size_t num_outputs = 1;
+
+        for (const toolbox::Scenario& scenario : scenarios) {
+            num_outputs = std::max(num_outputs, scenario.m_num_threads);
+        }
+
+        const std::unique_ptr<toolbox::RenderBackend> backend = toolbox::create_headless_backend(num_outputs, options.m_refresh_rate);
+        std::vector<toolbox::ScenarioResult> results;
+
+        for (size_t i = 0; i < scenarios.size(); ++i) {
+            const toolbox::Scenario& scenario = scenarios[i];
+
+            std::cerr << "Scenario " << (i + 1) << " of " << scenarios.size() << ": " << scenario.m_pacing
+                << ", swap interval " << scenario.m_swap_interval << ", " << toolbox::workload_to_string(scenario.m_workload)
+                << ", " << scenario.m_num_threads << " thread(s), " << scenario.m_num_frames << " frame(s)" << std::endl;
+
+            results.push_back(toolbox::run_scenario(*backend, scenario));
+        }
+
+        //------------------------------------------------------------------------------
+        // Results.
+        if (options.m_output_path.empty()) {
+            toolbox::write_results_table(std::cout, backend->name(), scenarios, results);
+        }
+        else {
+            std::ofstream file(options.m_output_path);
+
+            if (!file) {
+                std::cerr << "Error: Failed to open " << options.m_output_path << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            toolbox::write_results_table(file, backend->name(), scenarios, results);
+        }
+
+        //------------------------------------------------------------------------------
+        // Regressions fail the run, e.g. on CI.
+        if (!options.m_baseline_path.empty()) {
+            toolbox::BaselineComparison comparison = toolbox::compare_with_baseline(options.m_baseline_path, backend->name(), scenarios, results, options.m_threshold_percent);
+
+            //------------------------------------------------------------------------------
+            // The headless backend shares the machine with whatever else runs, a scenario
+            // only regressed if it does so again when re-run. The others are left out of
+            // the re-run's comparison as skipped.
+            if (!comparison.m_regressions.empty()) {
+                std::vector<toolbox::ScenarioResult> rerun_results(results.size());
+
+                for (toolbox::ScenarioResult& result : rerun_results) {
+                    result.m_is_skipped = true;
+                }
+
+                for (const toolbox::ScenarioRegression& regression : comparison.m_regressions) {
+                    const size_t index = regression.m_scenario_index;
+
+                    if (rerun_results[index].m_is_skipped) {
+                        std::cerr << "Re-running scenario " << (index + 1) << " of " << scenarios.size() << std::endl;
+                        rerun_results[index] = toolbox::run_scenario(*backend, scenarios[index]);
+                    }
+                }
+
+                const toolbox::BaselineComparison rerun_comparison = toolbox::compare_with_baseline(options.m_baseline_path, backend->name(), scenarios, rerun_results, options.m_threshold_percent);
+                std::vector<toolbox::ScenarioRegression> confirmed_regressions;
+
+                for (const toolbox::ScenarioRegression& regression : comparison.m_regressions) {
+                    const auto is_confirmed = std::any_of(rerun_comparison.m_regressions.begin(), rerun_comparison.m_regressions.end(), [&regression](const toolbox::ScenarioRegression& rerun_regression) {
+                        return ((rerun_regression.m_scenario_index == regression.m_scenario_index) && (strcmp(rerun_regression.m_metric, regression.m_metric) == 0));
+                    });
+
+                    if (is_confirmed) {
+                        confirmed_regressions.push_back(regression);
+                    }
+                }
+
+                comparison.m_num_unconfirmed = (comparison.m_regressions.size() - confirmed_regressions.size());
+                comparison.m_regressions = std::move(confirmed_regressions);
+            }
+
+            toolbox::print_baseline_comparison(std::cerr, scenarios, comparison);
+
+            if (!comparison.m_regressions.empty()) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,958 @@
+//
+//  Scenarios.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Scenarios.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameBarrier.h"
+#include "RenderWorkerPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+
+    struct workload_name_t {
+      uint32_t      m_flag;
+      const char*   m_name;
+    };
+
+    const workload_name_t WORKLOAD_NAMES[] = {
+      { WORKLOAD_CLEAR, "clear" },
+      { WORKLOAD_SCISSOR_CLEAR, "scissor-clear" },
+      { WORKLOAD_POINTS, "points" },
+      { WORKLOAD_VALIDATE, "validate" },
+    };
+
+    std::string trim(const std::string& text)
+    {
+      const size_t first = text.find_first_not_of(" \t\r\n");
+      const size_t last = text.find_last_not_of(" \t\r\n");
+
+      return ((first != std::string::npos) ? text.substr(first, (last - first + 1)) : std::string());
+    }
+
+    std::vector<std::string> split(const std::string& text, char separator)
+    {
+      std::vector<std::string> items;
+      std::istringstream stream(text);
+      std::string item;
+
+      while (std::getline(stream, item, separator)) {
+        items.push_back(trim(item));
+      }
+
+      return items;
+    }
+
+    uint64_t parse_unsigned(const std::string& text)
+    {
+      char* end = nullptr;
+      const unsigned long long value = strtoull(text.c_str(), &end, 10);
+
+      if (text.empty() || (text[0] == '-') || (*end != '\0')) {
+        throw std::runtime_error("Invalid number: " + text);
+      }
+
+      return uint64_t(value);
+    }
+
+    //------------------------------------------------------------------------------
+    // CPU time consumed by the calling thread.
+    std::chrono::nanoseconds thread_cpu_time()
+    {
+#if defined(_WIN32)
+      FILETIME creation_time = {};
+      FILETIME exit_time = {};
+      FILETIME kernel_time = {};
+      FILETIME user_time = {};
+
+      if (GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time) == FALSE) {
+        return std::chrono::nanoseconds(0);
+      }
+
+      const uint64_t kernel = ((uint64_t(kernel_time.dwHighDateTime) << 32) | kernel_time.dwLowDateTime);
+      const uint64_t user = ((uint64_t(user_time.dwHighDateTime) << 32) | user_time.dwLowDateTime);
+
+      return std::chrono::nanoseconds((kernel + user) * 100);
+#else
+      timespec time = {};
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+      return (std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec));
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    // Headless backend
+    //------------------------------------------------------------------------------
+
+    class HeadlessOutput final : public RenderOutput
+    {
+    public:
+
+      HeadlessOutput(Clock::time_point epoch, Clock::duration refresh_interval)
+        : m_epoch(epoch), m_refresh_interval(refresh_interval), m_pixels(WIDTH * HEIGHT, 0) {}
+
+      Clock::duration refresh_interval() const override { return m_refresh_interval; }
+      void set_swap_interval(int interval) override { m_swap_interval = std::max(interval, 0); }
+      void set_point_grid(const PointGrid& grid) override { m_point_grid = grid; }
+      void encode(size_t frame_index, uint32_t workload) override;
+      void swap() override;
+
+      bool delay_before_swap(float seconds) override;
+      bool has_delay_before_swap() const override { return true; }
+
+    private:
+
+      // A quarter of the on-screen frame in each direction.
+      static constexpr size_t WIDTH = 512;
+      static constexpr size_t HEIGHT = 256;
+
+      void fill(size_t y, size_t height, uint32_t color);
+
+      //------------------------------------------------------------------------------
+      // The first vertical blank at or after the given time.
+      Clock::time_point next_vblank(Clock::time_point time) const
+      {
+        const auto elapsed = std::max((time - m_epoch), Clock::duration(0));
+        const auto count = ((elapsed + m_refresh_interval - Clock::duration(1)) / m_refresh_interval);
+
+        return (m_epoch + (count * m_refresh_interval));
+      }
+
+      const Clock::time_point     m_epoch;
+      const Clock::duration       m_refresh_interval;
+      int                         m_swap_interval = 1;
+      PointGrid                   m_point_grid;
+      Clock::time_point           m_last_vblank;
+      std::vector<uint32_t>       m_pixels;
+      uint32_t                    m_checksum = 0;
+    };
+
+    void
+    HeadlessOutput::fill(size_t y, size_t height, uint32_t color)
+    {
+      std::fill((begin(m_pixels) + (y * WIDTH)), (begin(m_pixels) + ((y + height) * WIDTH)), color);
+    }
+
+    void
+    HeadlessOutput::encode(size_t frame_index, uint32_t workload)
+    {
+      if (workload & WORKLOAD_CLEAR) {
+        fill(0, HEIGHT, 0xff333333);
+      }
+
+      //------------------------------------------------------------------------------
+      // The same bands as on screen, scaled down.
+      if (workload & WORKLOAD_SCISSOR_CLEAR) {
+        static const uint32_t BANDS[6][3] = {
+          { 64, 64, 0xff0000ff }, { 128, 64, 0xff00ff00 }, { 192, 64, 0xffff0000 },
+          { 16, 16, 0xffff0000 }, { 32, 16, 0xffffff00 }, { 48, 16, 0xffff00ff },
+        };
+
+        if ((frame_index % 8) < 6) {
+          const uint32_t* const band = BANDS[frame_index % 8];
+          fill(band[0], band[1], band[2]);
+        }
+        else {
+          fill(0, HEIGHT, 0xff333333);
+        }
+      }
+
+      //------------------------------------------------------------------------------
+      // Shade the point grid, scaled down like the frame, as by the point shader.
+      if (workload & WORKLOAD_POINTS) {
+        const size_t columns = std::max<size_t>((m_point_grid.m_columns / 4), 2);
+        const size_t rows = std::max<size_t>((m_point_grid.m_rows / 4), 2);
+
+        for (size_t y = 0; y < rows; ++y) {
+          for (size_t x = 0; x < columns; ++x) {
+            const float u = (float(x) * (1.0f / (columns - 1)));
+            const float v = (float(y) * (1.0f / (rows - 1)));
+            float shade = 1.0f;
+
+            if (m_point_grid.m_shading == PointShading::flat) {
+              m_pixels[(((y * HEIGHT) / rows) * WIDTH) + ((x * WIDTH) / columns)] = 0xffcccccc;
+              continue;
+            }
+
+            if (m_point_grid.m_shading == PointShading::vignette) {
+              shade = std::pow(std::min(std::max(((u * (1.0f - u)) * (v * (1.0f - v)) * 36.0f), 0.0f), 1.0f), 4.0f);
+            }
+
+            m_pixels[(((y * HEIGHT) / rows) * WIDTH) + ((x * WIDTH) / columns)] = (0xff000000 | (uint32_t(u * shade * 255.0f) << 8) | uint32_t(v * shade * 255.0f));
+          }
+        }
+      }
+
+      if (workload & WORKLOAD_VALIDATE) {
+        for (size_t x = 0; x < WIDTH; ++x) {
+          m_checksum = ((m_checksum * 31) + m_pixels[x]);
+        }
+      }
+    }
+
+    void
+    HeadlessOutput::swap()
+    {
+      if (m_swap_interval == 0) {
+        return;
+      }
+
+      //------------------------------------------------------------------------------
+      // Block until the vertical blank the swap interval allows, at least the next.
+      const Clock::time_point earliest = std::max(std::chrono::steady_clock::now(), (m_last_vblank + ((m_swap_interval - 1) * m_refresh_interval) + Clock::duration(1)));
+      m_last_vblank = next_vblank(earliest);
+
+      std::this_thread::sleep_until(m_last_vblank);
+    }
+
+    bool
+    HeadlessOutput::delay_before_swap(float seconds)
+    {
+      const Clock::time_point now = std::chrono::steady_clock::now();
+      const Clock::duration delay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(seconds));
+      Clock::time_point vblank = next_vblank(now);
+
+      if ((vblank - delay) < now) {
+        vblank += m_refresh_interval;
+      }
+
+      std::this_thread::sleep_until(vblank - delay);
+      return true;
+    }
+
+    class HeadlessBackend final : public RenderBackend
+    {
+    public:
+
+      HeadlessBackend(size_t num_outputs, double refresh_rate)
+      {
+        const Clock::time_point epoch = std::chrono::steady_clock::now();
+        const Clock::duration refresh_interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / refresh_rate));
+
+        for (size_t i = 0; i < num_outputs; ++i) {
+          m_outputs.emplace_back(new HeadlessOutput(epoch, refresh_interval));
+        }
+      }
+
+      const char* name() const override { return "headless"; }
+      size_t num_outputs() const override { return m_outputs.size(); }
+      RenderOutput& output(size_t index) override { return *m_outputs[index]; }
+
+    private:
+
+      std::vector<std::unique_ptr<HeadlessOutput>>    m_outputs;
+    };
+
+    //------------------------------------------------------------------------------
+    // One output of another backend, for running scenarios on it alone.
+    class SingleOutputBackend final : public RenderBackend
+    {
+    public:
+
+      SingleOutputBackend(RenderBackend& backend, size_t index) : m_backend(backend), m_index(index) {}
+
+      const char* name() const override { return m_backend.name(); }
+      size_t num_outputs() const override { return 1; }
+      RenderOutput& output(size_t) override { return m_backend.output(m_index); }
+
+      void bind(size_t) override { m_backend.bind(m_index); }
+      void unbind(size_t) override { m_backend.unbind(m_index); }
+
+    private:
+
+      RenderBackend&  m_backend;
+      const size_t    m_index;
+    };
+
+    //------------------------------------------------------------------------------
+    // Measuring
+    //------------------------------------------------------------------------------
+
+    struct thread_samples_t {
+      std::vector<double>         m_frame_us;
+      double                      m_sync_us = 0.0;
+      double                      m_encode_us = 0.0;
+      double                      m_swap_us = 0.0;
+      std::chrono::nanoseconds    m_cpu_time { 0 };
+    };
+
+    double to_us(Clock::duration duration)
+    {
+      return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    //------------------------------------------------------------------------------
+    // Render one repetition of the scenario on the calling (bound) thread.
+    void render(RenderOutput& output, const Scenario& scenario, FrameBarrier& start_barrier, thread_samples_t& samples)
+    {
+      SteadyClock clock;
+      FramePacerConfig pacer_config;
+      pacer_config.m_interval = output.refresh_interval();
+
+      if (output.has_delay_before_swap()) {
+        pacer_config.m_delay_before_swap = [&output](float seconds) { return output.delay_before_swap(seconds); };
+      }
+
+      const std::unique_ptr<FramePacer> pacer = create_frame_pacer(scenario.m_pacing, clock, pacer_config);
+      output.set_swap_interval(scenario.m_swap_interval);
+      output.set_point_grid(scenario.m_point_grid);
+
+      samples.m_frame_us.reserve(scenario.m_num_frames);
+
+      //------------------------------------------------------------------------------
+      // Start all threads together.
+      if (!start_barrier.arrive_and_wait()) {
+        throw std::runtime_error("Render threads failed to start together!");
+      }
+
+      pacer->start(clock.now());
+
+      Clock::time_point previous_frame_start_time = clock.now();
+      std::chrono::nanoseconds cpu_start_time(0);
+
+      for (size_t frame_index = 0; frame_index < (scenario.m_num_warmup_frames + scenario.m_num_frames); ++frame_index) {
+        const bool is_measured = (frame_index >= scenario.m_num_warmup_frames);
+
+        if (frame_index == scenario.m_num_warmup_frames) {
+          cpu_start_time = thread_cpu_time();
+        }
+
+        const Clock::time_point frame_start_time = clock.now();
+        pacer->wait();
+
+        const Clock::time_point encode_start_time = clock.now();
+        output.encode(frame_index, scenario.m_workload);
+
+        const Clock::time_point swap_start_time = clock.now();
+        output.swap();
+
+        const Clock::time_point swap_end_time = clock.now();
+
+        if (is_measured) {
+          samples.m_frame_us.push_back(to_us(frame_start_time - previous_frame_start_time));
+          samples.m_sync_us += to_us(encode_start_time - frame_start_time);
+          samples.m_encode_us += to_us(swap_start_time - encode_start_time);
+          samples.m_swap_us += to_us(swap_end_time - swap_start_time);
+        }
+
+        previous_frame_start_time = frame_start_time;
+      }
+
+      samples.m_cpu_time = (thread_cpu_time() - cpu_start_time);
+    }
+
+    double percentile(std::vector<double>& values, double p)
+    {
+      if (values.empty()) {
+        return 0.0;
+      }
+
+      const size_t rank = std::max<size_t>(1, size_t(std::ceil(p * double(values.size()))));
+      std::nth_element(begin(values), (begin(values) + (rank - 1)), end(values));
+
+      return values[rank - 1];
+    }
+
+    ScenarioResult summarize(const Scenario& scenario, Clock::duration refresh_interval, std::vector<thread_samples_t>& samples)
+    {
+      ScenarioResult result;
+      std::vector<double> frame_us;
+
+      for (const thread_samples_t& thread_samples : samples) {
+        frame_us.insert(end(frame_us), begin(thread_samples.m_frame_us), end(thread_samples.m_frame_us));
+        result.m_sync_mean_us += thread_samples.m_sync_us;
+        result.m_encode_mean_us += thread_samples.m_encode_us;
+        result.m_swap_mean_us += thread_samples.m_swap_us;
+        result.m_cpu_per_frame_us += std::chrono::duration<double, std::micro>(thread_samples.m_cpu_time).count();
+      }
+
+      if (frame_us.empty()) {
+        return result;
+      }
+
+      const double num_frames = double(frame_us.size());
+
+      result.m_num_frames = uint64_t(frame_us.size());
+      result.m_sync_mean_us /= num_frames;
+      result.m_encode_mean_us /= num_frames;
+      result.m_swap_mean_us /= num_frames;
+      result.m_cpu_per_frame_us /= num_frames;
+
+      //------------------------------------------------------------------------------
+      // Expected frame interval, the vsync or the pacer's.
+      double expected_us = 0.0;
+
+      if (scenario.m_swap_interval > 0) {
+        expected_us = (to_us(refresh_interval) * scenario.m_swap_interval);
+      }
+      else if (scenario.m_pacing != "free-run") {
+        expected_us = to_us(refresh_interval);
+      }
+
+      if (expected_us > 0.0) {
+        const auto missed = std::count_if(begin(frame_us), end(frame_us), [expected_us](double us) { return (us > (1.5 * expected_us)); });
+        result.m_missed_percent = ((100.0 * double(missed)) / num_frames);
+      }
+
+      result.m_frame_p50_us = percentile(frame_us, 0.5);
+      result.m_frame_p99_us = percentile(frame_us, 0.99);
+      result.m_frame_max_us = *std::max_element(begin(frame_us), end(frame_us));
+
+      return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Median of a field over the repetitions.
+    double median(const std::vector<ScenarioResult>& results, double ScenarioResult::* field)
+    {
+      std::vector<double> values;
+
+      for (const ScenarioResult& result : results) {
+        values.push_back(result.*field);
+      }
+
+      return percentile(values, 0.5);
+    }
+
+    //------------------------------------------------------------------------------
+    // The columns of the results table naming a scenario, up to the status.
+    std::string scenario_columns(const std::string& backend_name, const Scenario& scenario)
+    {
+      std::ostringstream stream;
+      stream << backend_name << "\t" << scenario.m_pacing << "\t" << scenario.m_swap_interval << "\t" << workload_to_string(scenario.m_workload)
+             << "\t" << point_grid_to_string(scenario.m_point_grid) << "\t" << scenario.m_num_threads << "\t" << scenario.m_num_frames << "\t" << scenario.m_num_repetitions;
+
+      return stream.str();
+    }
+
+    struct baseline_metric_t {
+      const char*                 m_column;
+      double ScenarioResult::*    m_field;
+      double                      m_min_increase;   // Smaller increases are noise, whatever the threshold.
+    };
+
+    const baseline_metric_t BASELINE_METRICS[] = {
+      { "frame_p99_us", &ScenarioResult::m_frame_p99_us, 2500.0 },
+      { "missed_percent", &ScenarioResult::m_missed_percent, 2.0 },
+      { "cpu_per_frame_us", &ScenarioResult::m_cpu_per_frame_us, 1000.0 },
+    };
+
+  } // unnamed namespace
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  uint32_t
+  workload_from_string(const std::string& text)
+  {
+    uint32_t workload = 0;
+
+    if (text == "none") {
+      return workload;
+    }
+
+    for (const std::string& name : split(text, '+')) {
+      const auto it = std::find_if(std::begin(WORKLOAD_NAMES), std::end(WORKLOAD_NAMES), [&name](const workload_name_t& entry) {
+        return (name == entry.m_name);
+      });
+
+      if (it == std::end(WORKLOAD_NAMES)) {
+        throw std::runtime_error("Unknown workload: " + name);
+      }
+
+      workload |= it->m_flag;
+    }
+
+    return workload;
+  }
+
+  std::string
+  workload_to_string(uint32_t workload)
+  {
+    std::string text;
+
+    for (const workload_name_t& entry : WORKLOAD_NAMES) {
+      if (workload & entry.m_flag) {
+        text += (text.empty() ? "" : "+");
+        text += entry.m_name;
+      }
+    }
+
+    return (text.empty() ? std::string("none") : text);
+  }
+
+  std::vector<Scenario>
+  load_scenario_matrix(const std::string& path)
+  {
+    std::ifstream file(path);
+
+    if (!file) {
+      throw std::runtime_error("Failed to open scenario matrix: " + path);
+    }
+
+    const std::vector<std::string> pacer_names = frame_pacer_names();
+    const Scenario defaults;
+
+    std::vector<std::string> pacings = { defaults.m_pacing };
+    std::vector<int> swap_intervals = { defaults.m_swap_interval };
+    std::vector<uint32_t> workloads = { defaults.m_workload };
+    std::vector<PointGrid> point_grids = { defaults.m_point_grid };
+    std::vector<size_t> thread_counts = { defaults.m_num_threads };
+    std::vector<size_t> frame_counts = { defaults.m_num_frames };
+    size_t num_warmup_frames = defaults.m_num_warmup_frames;
+    size_t num_repetitions = defaults.m_num_repetitions;
+
+    std::string line;
+
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+      line = trim(line.substr(0, line.find('#')));
+
+      if (line.empty()) {
+        continue;
+      }
+
+      try {
+        const size_t equals = line.find('=');
+
+        if (equals == std::string::npos) {
+          throw std::runtime_error("Expected <key> = <value>[, <value> ...]");
+        }
+
+        const std::string key = trim(line.substr(0, equals));
+        const std::vector<std::string> values = split(line.substr(equals + 1), ',');
+
+        if (values.empty() || (std::find(begin(values), end(values), std::string()) != end(values))) {
+          throw std::runtime_error("Missing value for " + key);
+        }
+
+        if (key == "pacing") {
+          for (const std::string& value : values) {
+            if (std::find(begin(pacer_names), end(pacer_names), value) == end(pacer_names)) {
+              throw std::runtime_error("Unknown pacing: " + value);
+            }
+          }
+
+          pacings = values;
+        }
+        else if (key == "swap_interval") {
+          swap_intervals.clear();
+          std::transform(begin(values), end(values), std::back_inserter(swap_intervals), [](const std::string& value) { return int(parse_unsigned(value)); });
+        }
+        else if (key == "workload") {
+          workloads.clear();
+          std::transform(begin(values), end(values), std::back_inserter(workloads), workload_from_string);
+        }
+        else if (key == "points") {
+          point_grids.clear();
+          std::transform(begin(values), end(values), std::back_inserter(point_grids), point_grid_from_string);
+        }
+        else if ((key == "threads") || (key == "frames")) {
+          std::vector<size_t>& counts = ((key == "threads") ? thread_counts : frame_counts);
+          counts.clear();
+
+          for (const std::string& value : values) {
+            counts.push_back(size_t(parse_unsigned(value)));
+
+            if (counts.back() == 0) {
+              throw std::runtime_error("The number of " + key + " must be positive");
+            }
+          }
+        }
+        else if ((key == "warmup") || (key == "repetitions")) {
+          if (values.size() != 1) {
+            throw std::runtime_error("Expected a single value for " + key);
+          }
+
+          ((key == "warmup") ? num_warmup_frames : num_repetitions) = size_t(parse_unsigned(values[0]));
+        }
+        else {
+          throw std::runtime_error("Unknown key: " + key);
+        }
+      }
+      catch (std::exception& e) {
+        throw std::runtime_error(path + ":" + std::to_string(line_number) + ": " + e.what());
+      }
+    }
+
+    std::vector<Scenario> scenarios;
+
+    for (const std::string& pacing : pacings) {
+      for (const int swap_interval : swap_intervals) {
+        for (const uint32_t workload : workloads) {
+          for (const PointGrid& point_grid : point_grids) {
+            for (const size_t num_threads : thread_counts) {
+              for (const size_t num_frames : frame_counts) {
+                Scenario scenario;
+                scenario.m_pacing = pacing;
+                scenario.m_swap_interval = swap_interval;
+                scenario.m_workload = workload;
+                scenario.m_point_grid = point_grid;
+                scenario.m_num_threads = num_threads;
+                scenario.m_num_frames = num_frames;
+                scenario.m_num_warmup_frames = num_warmup_frames;
+                scenario.m_num_repetitions = std::max<size_t>(num_repetitions, 1);
+                scenarios.push_back(scenario);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    return scenarios;
+  }
+
+  std::vector<PointShaderKey>
+  point_shader_keys(const std::vector<Scenario>& scenarios)
+  {
+    std::vector<PointShaderKey> keys;
+
+    for (const Scenario& scenario : scenarios) {
+      const PointShaderKey key = point_shader_key(scenario.m_point_grid);
+
+      if ((scenario.m_workload & WORKLOAD_POINTS) && (std::find(keys.begin(), keys.end(), key) == keys.end())) {
+        keys.push_back(key);
+      }
+    }
+
+    return keys;
+  }
+
+  std::unique_ptr<RenderBackend>
+  create_headless_backend(size_t num_outputs, double refresh_rate)
+  {
+    return std::unique_ptr<RenderBackend>(new HeadlessBackend(num_outputs, refresh_rate));
+  }
+
+  ScenarioResult
+  run_scenario(RenderBackend& backend, const Scenario& scenario)
+  {
+    const size_t num_threads = scenario.m_num_threads;
+
+    if (num_threads > backend.num_outputs()) {
+      ScenarioResult result;
+      result.m_is_skipped = true;
+      return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // The repetitions run back to back on the same render workers.
+    RenderWorkerPool render_workers(num_threads,
+      [&backend](size_t index) { backend.bind(index); },
+      [&backend](size_t index) { backend.unbind(index); });
+
+    std::vector<ScenarioResult> results;
+
+    for (size_t repetition = 0; repetition < scenario.m_num_repetitions; ++repetition) {
+      FrameBarrier start_barrier(num_threads, std::chrono::nanoseconds(0), std::chrono::seconds(10));
+      std::vector<thread_samples_t> samples(num_threads);
+      std::vector<std::future<void>> renders;
+
+      for (size_t i = 0; i < num_threads; ++i) {
+        renders.push_back(render_workers.submit(i, [&backend, &scenario, &start_barrier, &samples](size_t index) {
+          render(backend.output(index), scenario, start_barrier, samples[index]);
+        }));
+      }
+
+      //------------------------------------------------------------------------------
+      // Wait for all before rethrowing, the renders use the state of this loop.
+      std::exception_ptr error;
+
+      for (auto& render : renders) {
+        try {
+          render.get();
+        }
+        catch (...) {
+          error = (error ? error : std::current_exception());
+        }
+      }
+
+      if (error) {
+        std::rethrow_exception(error);
+      }
+
+      results.push_back(summarize(scenario, backend.output(0).refresh_interval(), samples));
+    }
+
+    ScenarioResult result;
+
+    for (const ScenarioResult& repetition_result : results) {
+      result.m_num_frames += repetition_result.m_num_frames;
+    }
+
+    result.m_frame_p50_us = median(results, &ScenarioResult::m_frame_p50_us);
+    result.m_frame_p99_us = median(results, &ScenarioResult::m_frame_p99_us);
+    result.m_frame_max_us = median(results, &ScenarioResult::m_frame_max_us);
+    result.m_missed_percent = median(results, &ScenarioResult::m_missed_percent);
+    result.m_sync_mean_us = median(results, &ScenarioResult::m_sync_mean_us);
+    result.m_encode_mean_us = median(results, &ScenarioResult::m_encode_mean_us);
+    result.m_swap_mean_us = median(results, &ScenarioResult::m_swap_mean_us);
+    result.m_cpu_per_frame_us = median(results, &ScenarioResult::m_cpu_per_frame_us);
+
+    return result;
+  }
+
+  void
+  write_results_table(std::ostream& stream, const std::string& backend_name, const std::vector<Scenario>& scenarios, const std::vector<ScenarioResult>& results)
+  {
+    stream << "backend\tpacing\tswap_interval\tworkload\tpoints\tthreads\tframes\trepetitions\tstatus\tmeasured_frames"
+           << "\tframe_p50_us\tframe_p99_us\tframe_max_us\tmissed_percent\tsync_mean_us\tencode_mean_us\tswap_mean_us\tcpu_per_frame_us" << std::endl;
+
+    for (size_t i = 0; i < std::min(scenarios.size(), results.size()); ++i) {
+      const Scenario& scenario = scenarios[i];
+      const ScenarioResult& result = results[i];
+
+      stream << scenario_columns(backend_name, scenario) << "\t" << (result.m_is_skipped ? "skipped" : "ok") << "\t" << result.m_num_frames;
+
+      stream << std::fixed << std::setprecision(1)
+             << "\t" << result.m_frame_p50_us << "\t" << result.m_frame_p99_us << "\t" << result.m_frame_max_us
+             << "\t" << std::setprecision(2) << result.m_missed_percent << std::setprecision(1)
+             << "\t" << result.m_sync_mean_us << "\t" << result.m_encode_mean_us << "\t" << result.m_swap_mean_us
+             << "\t" << result.m_cpu_per_frame_us << std::defaultfloat << std::endl;
+    }
+  }
+
+  BaselineComparison
+  compare_with_baseline(const std::string& baseline_path, const std::string& backend_name, const std::vector<Scenario>& scenarios,
+                        const std::vector<ScenarioResult>& results, double threshold_percent)
+  {
+    std::ifstream file(baseline_path);
+
+    if (!file) {
+      throw std::runtime_error("Failed to open baseline: " + baseline_path);
+    }
+
+    //------------------------------------------------------------------------------
+    // The columns are looked up by name, a baseline of an older build may have
+    // fewer or more of them.
+    std::string line;
+    std::getline(file, line);
+
+    const std::vector<std::string> header = split(line, '\t');
+    const auto column = [&](const char* name) {
+      const auto it = std::find(header.begin(), header.end(), name);
+
+      if (it == header.end()) {
+        throw std::runtime_error(baseline_path + ": Not a results table, missing column " + name);
+      }
+
+      return size_t(it - header.begin());
+    };
+
+    const size_t status_column = column("status");
+    std::vector<size_t> metric_columns;
+
+    for (const baseline_metric_t& metric : BASELINE_METRICS) {
+      metric_columns.push_back(column(metric.m_column));
+    }
+
+    std::map<std::string, std::vector<std::string>> rows;
+
+    for (size_t line_number = 2; std::getline(file, line); ++line_number) {
+      if (trim(line).empty()) {
+        continue;
+      }
+
+      std::vector<std::string> fields = split(line, '\t');
+
+      if (fields.size() != header.size()) {
+        throw std::runtime_error(baseline_path + ":" + std::to_string(line_number) + ": Expected " + std::to_string(header.size()) + " columns");
+      }
+
+      if (fields[status_column] != "skipped") {
+        std::string key;
+
+        for (size_t i = 0; i < status_column; ++i) {
+          key += (i ? "\t" : "") + fields[i];
+        }
+
+        rows[key] = std::move(fields);
+      }
+    }
+
+    BaselineComparison comparison;
+    comparison.m_threshold_percent = threshold_percent;
+
+    for (size_t i = 0; i < std::min(scenarios.size(), results.size()); ++i) {
+      if (results[i].m_is_skipped) {
+        continue;
+      }
+
+      const auto row = rows.find(scenario_columns(backend_name, scenarios[i]));
+
+      if (row == rows.end()) {
+        ++comparison.m_num_missing;
+        continue;
+      }
+
+      ++comparison.m_num_compared;
+
+      for (size_t j = 0; j < metric_columns.size(); ++j) {
+        const baseline_metric_t& metric = BASELINE_METRICS[j];
+        const double baseline = atof(row->second[metric_columns[j]].c_str());
+        const double value = (results[i].*metric.m_field);
+
+        if ((value - baseline) > std::max((baseline * threshold_percent / 100.0), metric.m_min_increase)) {
+          ScenarioRegression regression;
+          regression.m_scenario_index = i;
+          regression.m_metric = metric.m_column;
+          regression.m_baseline = baseline;
+          regression.m_value = value;
+          comparison.m_regressions.push_back(regression);
+        }
+      }
+    }
+
+    return comparison;
+  }
+
+  void
+  print_baseline_comparison(std::ostream& stream, const std::vector<Scenario>& scenarios, const BaselineComparison& comparison)
+  {
+    stream << "Baseline: " << comparison.m_num_compared << " scenario(s) compared, " << comparison.m_num_missing << " not in the baseline, "
+           << comparison.m_regressions.size() << " regression(s) over " << comparison.m_threshold_percent << "%, "
+           << comparison.m_num_unconfirmed << " more not confirmed by a re-run" << std::endl;
+
+    for (const ScenarioRegression& regression : comparison.m_regressions) {
+      const Scenario& scenario = scenarios[regression.m_scenario_index];
+
+      stream << "  Scenario " << (regression.m_scenario_index + 1) << " (" << scenario.m_pacing << ", swap interval " << scenario.m_swap_interval
+             << ", " << workload_to_string(scenario.m_workload) << ", " << scenario.m_num_threads << " thread(s)): " << regression.m_metric
+             << std::fixed << std::setprecision(1) << " " << regression.m_value << ", baseline " << regression.m_baseline << std::defaultfloat << std::endl;
+    }
+  }
+
+  PointGridSweep
+  sweep_point_grid(RenderBackend& backend, size_t output_index, const Scenario& scenario, double max_missed_percent)
+  {
+    static const uint32_t STEP = 64;
+    static const uint32_t MAX_SIZE = uint32_t(std::sqrt(double(MAX_POINT_GRID_POINTS)));
+
+    PointGridSweep sweep;
+    sweep.m_output_index = output_index;
+
+    SingleOutputBackend single_output_backend(backend, output_index);
+
+    Scenario step_scenario = scenario;
+    step_scenario.m_num_threads = 1;
+    step_scenario.m_swap_interval = std::max(step_scenario.m_swap_interval, 1);
+    step_scenario.m_workload |= WORKLOAD_POINTS;
+
+    const auto is_sustained = [&](uint32_t size) {
+      step_scenario.m_point_grid.m_columns = size;
+      step_scenario.m_point_grid.m_rows = size;
+
+      const ScenarioResult result = run_scenario(single_output_backend, step_scenario);
+      sweep.m_steps.emplace_back(step_scenario.m_point_grid, result);
+
+      return (result.m_missed_percent <= max_missed_percent);
+    };
+
+    //------------------------------------------------------------------------------
+    // Double until not sustained, then bisect the last interval.
+    uint32_t sustained_size = 0;
+    uint32_t failed_size = 0;
+
+    for (uint32_t size = std::min(std::max(scenario.m_point_grid.m_columns, STEP), MAX_SIZE); failed_size == 0; size = std::min((size * 2), MAX_SIZE)) {
+      if (!is_sustained(size)) {
+        failed_size = size;
+      }
+      else if (size == MAX_SIZE) {
+        break;
+      }
+      else {
+        sustained_size = size;
+      }
+    }
+
+    if (failed_size == 0) {
+      sustained_size = MAX_SIZE;
+    }
+    else if (sustained_size == 0) {
+      return sweep;
+    }
+
+    while ((failed_size - sustained_size) > STEP) {
+      const uint32_t size = std::max(((((sustained_size + failed_size) / 2) / STEP) * STEP), (sustained_size + STEP));
+
+      if (size >= failed_size) {
+        break;
+      }
+
+      (is_sustained(size) ? sustained_size : failed_size) = size;
+    }
+
+    sweep.m_is_sustained = true;
+    sweep.m_largest_sustained = step_scenario.m_point_grid;
+    sweep.m_largest_sustained.m_columns = sustained_size;
+    sweep.m_largest_sustained.m_rows = sustained_size;
+
+    return sweep;
+  }
+
+  void
+  print_point_grid_sweep(std::ostream& stream, const PointGridSweep& sweep)
+  {
+    stream << "Output " << sweep.m_output_index << " point grid sweep:" << std::endl;
+
+    for (const auto& step : sweep.m_steps) {
+      stream << "  " << std::left << std::setw(24) << point_grid_to_string(step.first) << std::right << std::fixed << std::setprecision(1)
+             << std::setw(12) << step.first.num_points() << " points, frame p50 " << step.second.m_frame_p50_us << " us, p99 "
+             << step.second.m_frame_p99_us << " us, missed " << std::setprecision(2) << step.second.m_missed_percent << "%" << std::defaultfloat << std::endl;
+    }
+
+    if (sweep.m_is_sustained) {
+      stream << "  Largest sustained: " << point_grid_to_string(sweep.m_largest_sustained) << " (" << sweep.m_largest_sustained.num_points() << " points)" << std::endl;
+    }
+    else {
+      stream << "  Not even the first grid is sustained" << std::endl;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,233 @@
+//
+//  Scenarios.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacing.h"
+#include "PointGrid.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Workloads
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // What a render thread encodes per frame, any combination (joined with '+',
+  // e.g. "scissor-clear+points"). "none" encodes nothing.
+  enum workload_flags_t : uint32_t
+  {
+    WORKLOAD_CLEAR          = (1 << 0),     // Clear the whole frame.
+    WORKLOAD_SCISSOR_CLEAR  = (1 << 1),     // Clear a band changing every frame (8 frame cycle).
+    WORKLOAD_POINTS         = (1 << 2),     // Draw the point grid (see PointGrid).
+    WORKLOAD_VALIDATE       = (1 << 3),     // Validate the program every frame.
+  };
+
+  //------------------------------------------------------------------------------
+  // Throws if a name is unknown.
+  uint32_t workload_from_string(const std::string& text);
+  std::string workload_to_string(uint32_t workload);
+
+  //------------------------------------------------------------------------------
+  // Scenarios
+  //------------------------------------------------------------------------------
+
+  struct Scenario
+  {
+    std::string     m_pacing = "free-run";      // See create_frame_pacer().
+    int             m_swap_interval = 1;
+    uint32_t        m_workload = WORKLOAD_SCISSOR_CLEAR;
+    PointGrid       m_point_grid;
+    size_t          m_num_threads = 1;
+    size_t          m_num_frames = 600;
+    size_t          m_num_warmup_frames = 60;
+    size_t          m_num_repetitions = 3;
+  };
+
+  //------------------------------------------------------------------------------
+  // Load a matrix of scenarios, one per combination of the listed values:
+  //
+  //   # Comment
+  //   pacing = free-run, hybrid
+  //   swap_interval = 0, 1
+  //   workload = scissor-clear, scissor-clear+points
+  //   points = 1024x1024, 2048x2048:2:flat
+  //   threads = 1, 4
+  //   frames = 600
+  //   warmup = 60
+  //   repetitions = 3
+  //
+  // Keys not given keep the defaults of Scenario, warmup and repetitions take a
+  // single value. Throws with the offending line if the file is invalid.
+  std::vector<Scenario> load_scenario_matrix(const std::string& path);
+
+  //------------------------------------------------------------------------------
+  // The shader variants the scenarios draw points with, each once, in the order
+  // the scenarios first need them. Only those need to be compiled.
+  std::vector<PointShaderKey> point_shader_keys(const std::vector<Scenario>& scenarios);
+
+  //------------------------------------------------------------------------------
+  // Backends
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // One output (monitor) rendered by one thread. All calls are made from the
+  // thread the output is bound to.
+  class RenderOutput
+  {
+  public:
+
+    virtual ~RenderOutput() = default;
+
+    virtual Clock::duration refresh_interval() const = 0;
+    virtual void set_swap_interval(int interval) = 0;
+    virtual void set_point_grid(const PointGrid& grid) = 0;
+    virtual void encode(size_t frame_index, uint32_t workload) = 0;
+    virtual void swap() = 0;
+
+    //------------------------------------------------------------------------------
+    // For the delay-before-swap pacer, returns false if not supported.
+    virtual bool delay_before_swap(float seconds) { (void)seconds; return false; }
+    virtual bool has_delay_before_swap() const { return false; }
+  };
+
+  class RenderBackend
+  {
+  public:
+
+    virtual ~RenderBackend() = default;
+
+    virtual const char* name() const = 0;
+    virtual size_t num_outputs() const = 0;
+    virtual RenderOutput& output(size_t index) = 0;
+
+    //------------------------------------------------------------------------------
+    // Make the output's context current on / release it from the calling thread.
+    virtual void bind(size_t index) { (void)index; }
+    virtual void unbind(size_t index) { (void)index; }
+  };
+
+  //------------------------------------------------------------------------------
+  // Renders without a GPU or display, for running scenarios on any machine.
+  // Encoding does CPU work in a small software frame buffer standing in for the
+  // workload and a swap with a non-zero interval blocks until the next simulated
+  // vertical blank, all outputs sharing the same refresh timing.
+  std::unique_ptr<RenderBackend> create_headless_backend(size_t num_outputs, double refresh_rate = 60.0);
+
+  //------------------------------------------------------------------------------
+  // Running
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // Measurements of one scenario, the median over its repetitions. Frame times
+  // pool all threads, missed refreshes count frame intervals longer than 1.5
+  // times the expected interval (not counted when free running without vsync).
+  struct ScenarioResult
+  {
+    bool        m_is_skipped = false;       // More threads than outputs.
+    uint64_t    m_num_frames = 0;           // Measured frames of all threads and repetitions.
+    double      m_frame_p50_us = 0.0;
+    double      m_frame_p99_us = 0.0;
+    double      m_frame_max_us = 0.0;
+    double      m_missed_percent = 0.0;
+    double      m_sync_mean_us = 0.0;
+    double      m_encode_mean_us = 0.0;
+    double      m_swap_mean_us = 0.0;
+    double      m_cpu_per_frame_us = 0.0;   // CPU time of the render threads per frame.
+  };
+
+  ScenarioResult run_scenario(RenderBackend& backend, const Scenario& scenario);
+
+  //------------------------------------------------------------------------------
+  // Tab separated, one header line then one line per scenario.
+  void write_results_table(std::ostream& stream, const std::string& backend_name, const std::vector<Scenario>& scenarios, const std::vector<ScenarioResult>& results);
+
+  //------------------------------------------------------------------------------
+  // Baselines
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // A scenario measured worse than the same scenario (all columns up to the
+  // status match) of a baseline results table: its p99 frame time, missed
+  // refreshes or CPU time per frame more than the threshold (percent) over the
+  // baseline's, and by more than the run to run noise of the headless backend
+  // (2500 us, 2 percentage points and 1000 us, measured over the median of 3
+  // repetitions).
+  struct ScenarioRegression
+  {
+    size_t          m_scenario_index = 0;
+    const char*     m_metric = "";              // Column of the results table.
+    double          m_baseline = 0.0;
+    double          m_value = 0.0;
+  };
+
+  struct BaselineComparison
+  {
+    double                              m_threshold_percent = 0.0;
+    size_t                              m_num_compared = 0;
+    size_t                              m_num_missing = 0;      // Not in the baseline, or skipped there.
+    size_t                              m_num_unconfirmed = 0;  // Regressions dropped, not seen again when re-run.
+    std::vector<ScenarioRegression>     m_regressions;
+  };
+
+  //------------------------------------------------------------------------------
+  // Throws if the baseline cannot be read or is not a results table. Skipped
+  // scenarios are not compared. A runner should re-run the regressed scenarios
+  // and keep only the regressions seen again (see ScenarioRunner).
+  BaselineComparison compare_with_baseline(const std::string& baseline_path, const std::string& backend_name, const std::vector<Scenario>& scenarios,
+                                           const std::vector<ScenarioResult>& results, double threshold_percent);
+
+  void print_baseline_comparison(std::ostream& stream, const std::vector<Scenario>& scenarios, const BaselineComparison& comparison);
+
+  //------------------------------------------------------------------------------
+  // Point grid sweep
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // The largest square grid (of the scenario's point size and shading) one output
+  // renders at the refresh rate, i.e. with at most the given share of missed
+  // refreshes. Grids double from the scenario's until one is not sustained, then
+  // the last interval is bisected to a multiple of 64 columns. Each step runs the
+  // scenario (with vsync and points) on the output alone.
+  struct PointGridSweep
+  {
+    size_t                                              m_output_index = 0;
+    std::vector<std::pair<PointGrid, ScenarioResult>>   m_steps;
+    bool                                                m_is_sustained = false;    // At least the first grid.
+    PointGrid                                           m_largest_sustained;
+  };
+
+  PointGridSweep sweep_point_grid(RenderBackend& backend, size_t output_index, const Scenario& scenario, double max_missed_percent = 1.0);
+
+  void print_point_grid_sweep(std::ostream& stream, const PointGridSweep& sweep);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,219 @@
+//
+//  SnapshotRing.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Publishes snapshots of a value from one writer to any number of readers
+  // without locks. Every snapshot is stamped with the first frame it applies to,
+  // so readers rendering the same frame (on different monitors) pick the same
+  // snapshot, as long as it is one of the last N stamps published.
+  //
+  // Each stamp kept has two slots, like a double buffer: the writer writes the one
+  // readers are not directed to, then directs them to it, so the slot being read
+  // is not rewritten in place. Each slot is also a seqlock (its sequence is odd
+  // while written), which only catches a reader that was overtaken by two
+  // publications of the same stamp, it then looks the slot up again. The value is
+  // copied as relaxed atomic words, so a torn copy is never used and never a data
+  // race.
+  //
+  // Publishing again for the latest stamp replaces that snapshot, so a writer
+  // running faster than the frame rate does not push older frames out.
+  //------------------------------------------------------------------------------
+
+  template <typename T, size_t N = 8>
+  class SnapshotRing
+  {
+  public:
+
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshots are copied as words!");
+    static_assert(N >= 2, "At least the latest and the one before are kept!");
+
+    //------------------------------------------------------------------------------
+    // Stamps must not decrease. From the writer thread only.
+    void publish(const T& value, uint64_t stamp)
+    {
+      const bool is_replacing = ((m_num_stamps > 0) && (stamp <= m_last_stamp));
+      const uint64_t num_stamps = (is_replacing ? m_num_stamps : (m_num_stamps + 1));
+      Entry& entry = m_entries[(num_stamps - 1) % N];
+      const uint32_t slot_index = (entry.m_current.load(std::memory_order_relaxed) ^ 1);
+      Slot& slot = entry.m_slots[slot_index];
+
+      std::array<uint32_t, NUM_WORDS> words = {};
+      std::memcpy(words.data(), &value, sizeof(T));
+
+      const uint64_t sequence = slot.m_sequence.load(std::memory_order_relaxed);
+      slot.m_sequence.store((sequence + 1), std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      slot.m_stamp.store((is_replacing ? m_last_stamp : stamp), std::memory_order_relaxed);
+      slot.m_version.store(++m_version, std::memory_order_relaxed);
+
+      for (size_t i = 0; i < NUM_WORDS; ++i) {
+        slot.m_words[i].store(words[i], std::memory_order_relaxed);
+      }
+
+      slot.m_sequence.store((sequence + 2), std::memory_order_release);
+      entry.m_current.store(slot_index, std::memory_order_release);
+
+      m_last_stamp = (is_replacing ? m_last_stamp : stamp);
+      m_num_stamps = num_stamps;
+      m_published_stamps.store(num_stamps, std::memory_order_release);
+    }
+
+    //------------------------------------------------------------------------------
+    // The latest snapshot stamped at or before the given frame. False (leaving the
+    // value as is) if nothing was published yet or all kept are for later frames.
+    // The version counts publications, for telling whether readers agreed.
+    bool read_at(uint64_t stamp, T& value, uint64_t* version = nullptr) const
+    {
+      const uint64_t num_stamps = m_published_stamps.load(std::memory_order_acquire);
+
+      for (uint64_t i = 0; i < std::min<uint64_t>(num_stamps, N); ++i) {
+        uint64_t slot_stamp = 0;
+
+        if (read_entry(m_entries[((num_stamps - 1) - i) % N], stamp, value, slot_stamp, version)) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    //------------------------------------------------------------------------------
+    // Whatever was published last (or the stamp before, if the writer kept
+    // overtaking the reader), false if nothing was.
+    bool read_latest(T& value, uint64_t* stamp = nullptr, uint64_t* version = nullptr) const
+    {
+      const uint64_t num_stamps = m_published_stamps.load(std::memory_order_acquire);
+
+      for (uint64_t i = 0; i < std::min<uint64_t>(num_stamps, N); ++i) {
+        uint64_t slot_stamp = 0;
+
+        if (read_entry(m_entries[((num_stamps - 1) - i) % N], UINT64_MAX, value, slot_stamp, version)) {
+          if (stamp) {
+            *stamp = slot_stamp;
+          }
+
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+  private:
+
+    static constexpr size_t NUM_WORDS = ((sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    static constexpr size_t MAX_READ_ATTEMPTS = 4;
+
+    struct alignas(64) Slot
+    {
+      std::atomic<uint64_t>                         m_sequence { 0 };
+      std::atomic<uint64_t>                         m_stamp { 0 };
+      std::atomic<uint64_t>                         m_version { 0 };
+      std::array<std::atomic<uint32_t>, NUM_WORDS>  m_words {};
+    };
+
+    struct Entry
+    {
+      std::array<Slot, 2>       m_slots;
+      std::atomic<uint32_t>     m_current { 0 };     // The slot readers copy.
+    };
+
+    //------------------------------------------------------------------------------
+    // Copies the entry's current slot, looking it up again if the writer overtook
+    // the reader (the slot it is directed to then is complete), yielding only if
+    // that keeps happening. False (without copying) if the entry was never written,
+    // is stamped after max_stamp or the writer kept overtaking, the caller then
+    // falls back to an older stamp.
+    static bool read_entry(const Entry& entry, uint64_t max_stamp, T& value, uint64_t& stamp, uint64_t* version)
+    {
+      std::array<uint32_t, NUM_WORDS> words;
+
+      for (size_t attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+        if (attempt > 1) {
+          std::this_thread::yield();
+        }
+
+        const Slot& slot = entry.m_slots[entry.m_current.load(std::memory_order_acquire)];
+        const uint64_t sequence = slot.m_sequence.load(std::memory_order_acquire);
+
+        if (sequence == 0) {
+          return false;
+        }
+
+        if (sequence & 1) {
+          continue;
+        }
+
+        //------------------------------------------------------------------------------
+        // An entry's stamp only ever grows, even if this one is being rewritten.
+        const uint64_t slot_stamp = slot.m_stamp.load(std::memory_order_relaxed);
+
+        if (slot_stamp > max_stamp) {
+          return false;
+        }
+
+        const uint64_t slot_version = slot.m_version.load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < NUM_WORDS; ++i) {
+          words[i] = slot.m_words[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.m_sequence.load(std::memory_order_relaxed) == sequence) {
+          std::memcpy(&value, words.data(), sizeof(T));
+          stamp = slot_stamp;
+
+          if (version) {
+            *version = slot_version;
+          }
+
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    std::array<Entry, N>      m_entries;
+    std::atomic<uint64_t>     m_published_stamps { 0 };
+
+    // Writer only.
+    uint64_t                  m_num_stamps = 0;
+    uint64_t                  m_last_stamp = 0;
+    uint64_t                  m_version = 0;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
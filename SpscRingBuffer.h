@@ -0,0 +1,111 @@
+//
+//  SpscRingBuffer.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Bounded, lock-free single producer/single consumer queue of trivially
+  // copyable values. Neither side ever blocks: a push to a full queue fails and
+  // is counted as dropped, a pop from an empty queue returns nothing.
+  //
+  // The producer and consumer indices live on separate cache lines and each
+  // side caches the other side's index so that in steady state an operation
+  // touches shared state only once per batch.
+  //------------------------------------------------------------------------------
+
+  template <typename T, size_t CAPACITY>
+  class SpscRingBuffer
+  {
+  public:
+
+    static_assert(std::is_trivially_copyable<T>::value, "Values must be trivially copyable!");
+    static_assert(((CAPACITY > 0) && ((CAPACITY & (CAPACITY - 1)) == 0)), "Capacity must be a power of two!");
+
+    static constexpr size_t capacity() { return CAPACITY; }
+
+    //------------------------------------------------------------------------------
+    // Producer side.
+    bool try_push(const T& value)
+    {
+      const size_t head = m_head.load(std::memory_order_relaxed);
+
+      if ((head - m_producer_tail_cache) == CAPACITY) {
+        m_producer_tail_cache = m_tail.load(std::memory_order_acquire);
+
+        if ((head - m_producer_tail_cache) == CAPACITY) {
+          m_dropped.store((m_dropped.load(std::memory_order_relaxed) + 1), std::memory_order_relaxed);
+          return false;
+        }
+      }
+
+      m_values[head & (CAPACITY - 1)] = value;
+      m_head.store((head + 1), std::memory_order_release);
+      return true;
+    }
+
+    //------------------------------------------------------------------------------
+    // Consumer side. Pops up to max_count values into the given array and returns
+    // the number of values popped.
+    size_t pop(T* const values, size_t max_count)
+    {
+      const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+      if (m_consumer_head_cache == tail) {
+        m_consumer_head_cache = m_head.load(std::memory_order_acquire);
+      }
+
+      const size_t available = (m_consumer_head_cache - tail);
+      const size_t count = ((available < max_count) ? available : max_count);
+
+      for (size_t i = 0; i < count; ++i) {
+        values[i] = m_values[(tail + i) & (CAPACITY - 1)];
+      }
+
+      m_tail.store((tail + count), std::memory_order_release);
+      return count;
+    }
+
+    //------------------------------------------------------------------------------
+    // Number of values the producer failed to push because the queue was full.
+    // May be read from any thread.
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+  private:
+
+    alignas(64) std::atomic<size_t>     m_head { 0 };
+    size_t                              m_producer_tail_cache = 0;
+    std::atomic<uint64_t>               m_dropped { 0 };
+
+    alignas(64) std::atomic<size_t>     m_tail { 0 };
+    size_t                              m_consumer_head_cache = 0;
+
+    alignas(64) T                       m_values[CAPACITY];
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,362 @@
+//
+//  StartupOrchestrator.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StartupOrchestrator.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+
+    typedef std::chrono::duration<double, std::milli> milliseconds_t;
+
+    bool is_finished(StartupOrchestrator::Status status)
+    {
+      return ((status == StartupOrchestrator::Status::done) || (status == StartupOrchestrator::Status::failed) || (status == StartupOrchestrator::Status::skipped));
+    }
+
+    const char* status_name(StartupOrchestrator::Status status)
+    {
+      switch (status) {
+        case StartupOrchestrator::Status::pending: return "pending";
+        case StartupOrchestrator::Status::running: return "running";
+        case StartupOrchestrator::Status::done: return "done";
+        case StartupOrchestrator::Status::failed: return "failed";
+        case StartupOrchestrator::Status::skipped: return "skipped";
+      }
+
+      return "?";
+    }
+
+  } // unnamed namespace
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  StartupOrchestrator::StartupOrchestrator(time_point origin) : m_origin(origin)
+  {
+  }
+
+  void
+  StartupOrchestrator::add_task(const std::string& name, const std::vector<std::string>& dependencies, task_t task)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (find(name)) {
+      throw std::runtime_error("Duplicate startup task: " + name);
+    }
+
+    Phase phase;
+    phase.m_name = name;
+    phase.m_dependencies = dependencies;
+    phase.m_is_task = true;
+
+    m_phases.push_back(phase);
+    m_tasks.push_back(std::move(task));
+  }
+
+  bool
+  StartupOrchestrator::run()
+  {
+    std::vector<size_t> pending;
+
+    //------------------------------------------------------------------------------
+    // Validate the graph before running anything: dependencies must be tasks and
+    // a depth first walk must never come back to a task on its own path.
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      for (size_t i = 0; i < m_phases.size(); ++i) {
+        if (!m_phases[i].m_is_task || (m_phases[i].m_status != Status::pending)) {
+          continue;
+        }
+
+        for (const std::string& dependency : m_phases[i].m_dependencies) {
+          const Phase* const phase = find(dependency);
+
+          if ((phase == nullptr) || !phase->m_is_task) {
+            throw std::runtime_error("Startup task " + m_phases[i].m_name + " depends on unknown task " + dependency);
+          }
+        }
+
+        pending.push_back(i);
+      }
+
+      enum { unvisited, on_path, visited };
+      std::vector<int> states(m_phases.size(), unvisited);
+
+      std::function<void(size_t)> visit = [this, &states, &visit](size_t index) {
+        states[index] = on_path;
+
+        for (const std::string& dependency : m_phases[index].m_dependencies) {
+          const size_t dependency_index = size_t(find(dependency) - m_phases.data());
+
+          if (states[dependency_index] == on_path) {
+            throw std::runtime_error("Startup tasks " + m_phases[index].m_name + " and " + dependency + " depend on each other");
+          }
+
+          if (states[dependency_index] == unvisited) {
+            visit(dependency_index);
+          }
+        }
+
+        states[index] = visited;
+      };
+
+      for (const size_t index : pending) {
+        if (states[index] == unvisited) {
+          visit(index);
+        }
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // One thread per task, each waiting for its dependencies.
+    std::vector<std::thread> threads;
+
+    for (const size_t index : pending) {
+      threads.emplace_back(&StartupOrchestrator::run_task, this, index);
+    }
+
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return std::all_of(begin(pending), end(pending), [this](size_t index) { return (m_phases[index].m_status == Status::done); });
+  }
+
+  void
+  StartupOrchestrator::run_task(size_t index)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_finished_event.wait(lock, [this, index]() {
+      return std::all_of(begin(m_phases[index].m_dependencies), end(m_phases[index].m_dependencies), [this](const std::string& dependency) {
+        return is_finished(find(dependency)->m_status);
+      });
+    });
+
+    const bool is_ready = std::all_of(begin(m_phases[index].m_dependencies), end(m_phases[index].m_dependencies), [this](const std::string& dependency) {
+      return (find(dependency)->m_status == Status::done);
+    });
+
+    m_phases[index].m_start_time = std::chrono::steady_clock::now();
+
+    if (!is_ready) {
+      m_phases[index].m_status = Status::skipped;
+      m_phases[index].m_end_time = m_phases[index].m_start_time;
+      m_finished_event.notify_all();
+      return;
+    }
+
+    m_phases[index].m_status = Status::running;
+
+    const task_t task = m_tasks[index];
+    Status status = Status::done;
+    std::string error;
+
+    lock.unlock();
+
+    try {
+      task();
+    }
+    catch (std::exception& e) {
+      status = Status::failed;
+      error = e.what();
+    }
+    catch (...) {
+      status = Status::failed;
+      error = "unknown exception";
+    }
+
+    lock.lock();
+
+    m_phases[index].m_status = status;
+    m_phases[index].m_end_time = std::chrono::steady_clock::now();
+    m_phases[index].m_error = error;
+    m_finished_event.notify_all();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void
+  StartupOrchestrator::begin_phase(const std::string& name)
+  {
+    const time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Phase phase;
+    phase.m_name = name;
+    phase.m_status = Status::running;
+    phase.m_start_time = now;
+
+    m_phases.push_back(phase);
+    m_tasks.push_back(task_t());
+  }
+
+  void
+  StartupOrchestrator::end_phase(const std::string& name)
+  {
+    const time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = std::find_if(m_phases.rbegin(), m_phases.rend(), [&name](const Phase& phase) {
+      return (!phase.m_is_task && (phase.m_status == Status::running) && (phase.m_name == name));
+    });
+
+    if (it != m_phases.rend()) {
+      it->m_status = Status::done;
+      it->m_end_time = now;
+    }
+  }
+
+  void
+  StartupOrchestrator::mark(const std::string& milestone)
+  {
+    const time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = std::find_if(begin(m_milestones), end(m_milestones), [&milestone](const std::pair<std::string, time_point>& other) { return (other.first == milestone); });
+
+    if (it == end(m_milestones)) {
+      m_milestones.emplace_back(milestone, now);
+    }
+  }
+
+  std::chrono::duration<double, std::milli>
+  StartupOrchestrator::time_to(const std::string& milestone) const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& other : m_milestones) {
+      if (other.first == milestone) {
+        return (other.second - m_origin);
+      }
+    }
+
+    return milliseconds_t(-1.0);
+  }
+
+  std::vector<StartupOrchestrator::Phase>
+  StartupOrchestrator::phases() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_phases;
+  }
+
+  void
+  StartupOrchestrator::print_timeline(std::ostream& stream) const
+  {
+    static const size_t BAR_WIDTH = 40;
+
+    std::vector<Phase> phases;
+    std::vector<std::pair<std::string, time_point>> milestones;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      phases = m_phases;
+      milestones = m_milestones;
+    }
+
+    std::stable_sort(begin(phases), end(phases), [](const Phase& a, const Phase& b) { return (a.m_start_time < b.m_start_time); });
+
+    time_point last_time = m_origin;
+    size_t name_width = 8;
+
+    for (const Phase& phase : phases) {
+      last_time = std::max(last_time, std::max(phase.m_start_time, phase.m_end_time));
+      name_width = std::max(name_width, phase.m_name.size());
+    }
+
+    for (const auto& milestone : milestones) {
+      last_time = std::max(last_time, milestone.second);
+      name_width = std::max(name_width, milestone.first.size());
+    }
+
+    const double total_ms = std::max(milliseconds_t(last_time - m_origin).count(), 1e-3);
+
+    const auto column = [total_ms](time_point time, time_point origin) {
+      return std::min(BAR_WIDTH, size_t(double(BAR_WIDTH) * milliseconds_t(time - origin).count() / total_ms));
+    };
+
+    stream << "Startup timeline [ms]:" << std::endl;
+    stream << std::fixed << std::setprecision(1);
+
+    for (const Phase& phase : phases) {
+      const bool is_started = ((phase.m_status != Status::pending) && (phase.m_status != Status::skipped));
+      const time_point end_time = ((phase.m_status == Status::running) ? phase.m_start_time : phase.m_end_time);
+      const size_t first = (is_started ? column(phase.m_start_time, m_origin) : 0);
+      const size_t last = (is_started ? std::max((first + 1), column(end_time, m_origin)) : 0);
+
+      stream << "  " << std::left << std::setw(int(name_width)) << phase.m_name << std::right;
+
+      if (is_started) {
+        stream << std::setw(10) << milliseconds_t(phase.m_start_time - m_origin).count() << std::setw(10) << milliseconds_t(end_time - phase.m_start_time).count();
+      }
+      else {
+        stream << std::setw(10) << "-" << std::setw(10) << "-";
+      }
+
+      stream << "  |" << std::string(first, ' ') << std::string((last - first), '=') << std::string((BAR_WIDTH - last), ' ') << "|";
+
+      if (phase.m_status != Status::done) {
+        stream << " " << status_name(phase.m_status);
+
+        if (!phase.m_error.empty()) {
+          stream << ": " << phase.m_error;
+        }
+      }
+
+      stream << std::endl;
+    }
+
+    for (const auto& milestone : milestones) {
+      const size_t at = std::min((BAR_WIDTH - 1), column(milestone.second, m_origin));
+
+      stream << "  " << std::left << std::setw(int(name_width)) << milestone.first << std::right
+        << std::setw(10) << milliseconds_t(milestone.second - m_origin).count() << std::setw(10) << ""
+        << "  |" << std::string(at, ' ') << "^" << std::string((BAR_WIDTH - at - 1), ' ') << "|" << std::endl;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  StartupOrchestrator::Phase*
+  StartupOrchestrator::find(const std::string& name)
+  {
+    const auto it = std::find_if(begin(m_phases), end(m_phases), [&name](const Phase& phase) { return (phase.m_name == name); });
+    return ((it != end(m_phases)) ? &(*it) : nullptr);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
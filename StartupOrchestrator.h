@@ -0,0 +1,112 @@
+//
+//  StartupOrchestrator.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Runs the independent parts of startup (probing APIs, loading caches, ...) as
+  // concurrent tasks. Each task starts on its own thread as soon as all tasks it
+  // depends on are done. A task that throws fails, and the tasks depending on
+  // it are skipped.
+  //
+  // Besides the tasks, work done elsewhere (e.g. on the main thread) can be
+  // recorded as phases, and one-off events (e.g. the first frame) as milestones.
+  // All are timed relative to the same origin and printed as one timeline.
+  //------------------------------------------------------------------------------
+
+  class StartupOrchestrator
+  {
+  public:
+
+    typedef std::chrono::steady_clock::time_point time_point;
+    typedef std::function<void()> task_t;
+
+    enum class Status
+    {
+      pending,
+      running,
+      done,
+      failed,
+      skipped
+    };
+
+    struct Phase
+    {
+      std::string                 m_name;
+      std::vector<std::string>    m_dependencies;
+      bool                        m_is_task = false;
+      Status                      m_status = Status::pending;
+      time_point                  m_start_time;
+      time_point                  m_end_time;
+      std::string                 m_error;
+    };
+
+    explicit StartupOrchestrator(time_point origin = std::chrono::steady_clock::now());
+
+    StartupOrchestrator(const StartupOrchestrator&) = delete;
+    StartupOrchestrator& operator=(const StartupOrchestrator&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Tasks. run() throws before starting any task if a dependency is unknown or
+    // the dependencies form a cycle, returns false if a task failed or was skipped.
+    void add_task(const std::string& name, const std::vector<std::string>& dependencies, task_t task);
+    bool run();
+
+    //------------------------------------------------------------------------------
+    // Phases and milestones, may be called from any thread. Only the first mark of
+    // a milestone counts.
+    void begin_phase(const std::string& name);
+    void end_phase(const std::string& name);
+    void mark(const std::string& milestone);
+
+    //------------------------------------------------------------------------------
+    // Time from the origin to the milestone, negative if not reached (yet).
+    std::chrono::duration<double, std::milli> time_to(const std::string& milestone) const;
+
+    std::vector<Phase> phases() const;
+    void print_timeline(std::ostream& stream) const;
+
+  private:
+
+    Phase* find(const std::string& name);
+    void run_task(size_t index);
+
+    const time_point                                m_origin;
+
+    mutable std::mutex                              m_mutex;
+    std::condition_variable                         m_finished_event;
+    std::vector<Phase>                              m_phases;
+    std::vector<task_t>                             m_tasks;    // Parallel to m_phases, empty for phases.
+    std::vector<std::pair<std::string, time_point>> m_milestones;
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
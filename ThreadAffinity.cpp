@@ -0,0 +1,545 @@
+//
+//  ThreadAffinity.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadAffinity.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <initguid.h>
+#include <devguid.h>
+#include <devpkey.h>
+#include <SetupAPI.h>
+#else
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+
+#if !defined(_WIN32)
+    //------------------------------------------------------------------------------
+    // First line of a (sysfs) file, empty if it can not be read.
+    std::string read_line(const std::string& path)
+    {
+      std::string line;
+      FILE* const file = fopen(path.c_str(), "r");
+
+      if (file) {
+        char buffer[4096] = {};
+
+        if (fgets(buffer, sizeof(buffer), file)) {
+          line = buffer;
+          line.erase(line.find_last_not_of(" \n") + 1);
+        }
+
+        fclose(file);
+      }
+
+      return line;
+    }
+
+    int64_t read_integer(const std::string& path, int64_t default_value)
+    {
+      const std::string line = read_line(path);
+      return (line.empty() ? default_value : strtoll(line.c_str(), nullptr, 10));
+    }
+
+    //------------------------------------------------------------------------------
+    // Parse a sysfs CPU list, e.g. "0-3,8-11".
+    cpu_list_t parse_cpu_list(const std::string& text)
+    {
+      cpu_list_t cpus;
+      std::istringstream ranges(text);
+      std::string range;
+
+      while (std::getline(ranges, range, ',')) {
+        const size_t dash = range.find('-');
+        const uint32_t first = uint32_t(strtoul(range.c_str(), nullptr, 10));
+        const uint32_t last = ((dash != std::string::npos) ? uint32_t(strtoul(range.c_str() + dash + 1, nullptr, 10)) : first);
+
+        for (uint32_t cpu = first; cpu <= last; ++cpu) {
+          cpus.push_back(cpu);
+        }
+      }
+
+      return cpus;
+    }
+#endif
+
+    //------------------------------------------------------------------------------
+    // Physical cores, in order of their first logical CPU.
+    struct core_t
+    {
+      int32_t     m_numa_node = 0;
+      cpu_list_t  m_cpus;
+    };
+
+    std::vector<core_t> group_by_core(const std::vector<LogicalCpu>& cpus)
+    {
+      std::vector<core_t> cores;
+      std::map<uint32_t, size_t> core_indices;
+
+      for (const LogicalCpu& cpu : cpus) {
+        const auto it = core_indices.insert(std::make_pair(cpu.m_core, cores.size())).first;
+
+        if (it->second == cores.size()) {
+          cores.push_back(core_t());
+          cores.back().m_numa_node = cpu.m_numa_node;
+        }
+
+        cores[it->second].m_cpus.push_back(cpu.m_index);
+      }
+
+      return cores;
+    }
+
+  } // unnamed namespace
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  std::vector<LogicalCpu>
+  detect_cpu_topology()
+  {
+    std::vector<LogicalCpu> cpus;
+
+#if defined(_WIN32)
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) == FALSE) {
+      return cpus;
+    }
+
+    DWORD length = 0;
+    GetLogicalProcessorInformation(nullptr, &length);
+
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+
+    if (GetLogicalProcessorInformation(infos.data(), &length) == FALSE) {
+      return cpus;
+    }
+
+    std::vector<LogicalCpu> all_cpus(sizeof(DWORD_PTR) * 8);
+    uint32_t num_cores = 0;
+
+    for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& info : infos) {
+      for (uint32_t i = 0; i < all_cpus.size(); ++i) {
+        if ((info.ProcessorMask & (DWORD_PTR(1) << i)) == 0) {
+          continue;
+        }
+
+        if (info.Relationship == RelationProcessorCore) {
+          all_cpus[i].m_core = num_cores;
+        }
+        else if (info.Relationship == RelationNumaNode) {
+          all_cpus[i].m_numa_node = int32_t(info.NumaNode.NodeNumber);
+        }
+      }
+
+      if (info.Relationship == RelationProcessorCore) {
+        ++num_cores;
+      }
+    }
+
+    for (uint32_t i = 0; i < all_cpus.size(); ++i) {
+      if (process_mask & (DWORD_PTR(1) << i)) {
+        all_cpus[i].m_index = i;
+        cpus.push_back(all_cpus[i]);
+      }
+    }
+#else
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+      return cpus;
+    }
+
+    //------------------------------------------------------------------------------
+    // Physical cores are identified by package and core id, numbered densely.
+    std::map<std::pair<int64_t, int64_t>, uint32_t> cores;
+
+    for (uint32_t i = 0; i < CPU_SETSIZE; ++i) {
+      if (!CPU_ISSET(i, &allowed)) {
+        continue;
+      }
+
+      const std::string topology = ("/sys/devices/system/cpu/cpu" + std::to_string(i) + "/topology/");
+      const int64_t package = read_integer(topology + "physical_package_id", 0);
+      const int64_t core = read_integer(topology + "core_id", i);
+
+      LogicalCpu cpu;
+      cpu.m_index = i;
+      cpu.m_core = cores.insert(std::make_pair(std::make_pair(package, core), uint32_t(cores.size()))).first->second;
+      cpus.push_back(cpu);
+    }
+
+    //------------------------------------------------------------------------------
+    // NUMA nodes list their CPUs.
+    if (DIR* const nodes = opendir("/sys/devices/system/node")) {
+      while (const dirent* const entry = readdir(nodes)) {
+        if (strncmp(entry->d_name, "node", 4) != 0) {
+          continue;
+        }
+
+        char* end = nullptr;
+        const long node = strtol(entry->d_name + 4, &end, 10);
+
+        if ((end == (entry->d_name + 4)) || (*end != '\0')) {
+          continue;
+        }
+
+        for (const uint32_t index : parse_cpu_list(read_line(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist"))) {
+          for (LogicalCpu& cpu : cpus) {
+            if (cpu.m_index == index) {
+              cpu.m_numa_node = int32_t(node);
+            }
+          }
+        }
+      }
+
+      closedir(nodes);
+    }
+#endif
+
+    return cpus;
+  }
+
+  int32_t
+  pci_device_numa_node(uint32_t domain, uint32_t bus, uint32_t device)
+  {
+#if defined(_WIN32)
+    //------------------------------------------------------------------------------
+    // Look the display adapter up by bus and device number (the address holds the
+    // device in its high word), the domain is not exposed here.
+    (void)domain;
+
+    const HDEVINFO devices = SetupDiGetClassDevs(&GUID_DEVCLASS_DISPLAY, nullptr, nullptr, DIGCF_PRESENT);
+
+    if (devices == INVALID_HANDLE_VALUE) {
+      return -1;
+    }
+
+    int32_t numa_node = -1;
+    SP_DEVINFO_DATA device_info = {};
+    device_info.cbSize = sizeof(device_info);
+
+    for (DWORD i = 0; SetupDiEnumDeviceInfo(devices, i, &device_info); ++i) {
+      DEVPROPTYPE type = 0;
+      UINT32 device_bus = 0;
+      UINT32 device_address = 0;
+      INT32 device_numa_node = -1;
+
+      if ((SetupDiGetDevicePropertyW(devices, &device_info, &DEVPKEY_Device_BusNumber, &type, PBYTE(&device_bus), sizeof(device_bus), nullptr, 0) == TRUE) &&
+          (SetupDiGetDevicePropertyW(devices, &device_info, &DEVPKEY_Device_Address, &type, PBYTE(&device_address), sizeof(device_address), nullptr, 0) == TRUE) &&
+          (device_bus == bus) && ((device_address >> 16) == device)) {
+        if (SetupDiGetDevicePropertyW(devices, &device_info, &DEVPKEY_Device_Numa_Node, &type, PBYTE(&device_numa_node), sizeof(device_numa_node), nullptr, 0) == TRUE) {
+          numa_node = int32_t(device_numa_node);
+        }
+
+        break;
+      }
+    }
+
+    SetupDiDestroyDeviceInfoList(devices);
+    return numa_node;
+#else
+    char path[128] = {};
+    snprintf(path, sizeof(path), "/sys/bus/pci/devices/%04x:%02x:%02x.0/numa_node", domain, bus, device);
+
+    return int32_t(read_integer(path, -1));
+#endif
+  }
+
+  std::string
+  to_string(const cpu_list_t& cpus)
+  {
+    cpu_list_t sorted(cpus);
+    std::sort(begin(sorted), end(sorted));
+    sorted.erase(std::unique(begin(sorted), end(sorted)), end(sorted));
+
+    std::ostringstream stream;
+
+    for (size_t i = 0; i < sorted.size();) {
+      size_t j = i;
+
+      while (((j + 1) < sorted.size()) && (sorted[j + 1] == (sorted[j] + 1))) {
+        ++j;
+      }
+
+      stream << ((i > 0) ? "," : "") << sorted[i];
+
+      if (j > i) {
+        stream << "-" << sorted[j];
+      }
+
+      i = (j + 1);
+    }
+
+    return stream.str();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  AffinityMode
+  affinity_mode_from_name(const std::string& name)
+  {
+    for (const AffinityMode mode : { AffinityMode::none, AffinityMode::core, AffinityMode::node }) {
+      if (name == affinity_mode_name(mode)) {
+        return mode;
+      }
+    }
+
+    throw std::runtime_error("Unknown affinity mode: " + name);
+  }
+
+  const char*
+  affinity_mode_name(AffinityMode mode)
+  {
+    switch (mode) {
+      case AffinityMode::none: return "none";
+      case AffinityMode::core: return "core";
+      case AffinityMode::node: return "node";
+    }
+
+    return "?";
+  }
+
+  std::vector<std::string>
+  affinity_mode_names()
+  {
+    return { "none", "core", "node" };
+  }
+
+  AffinityPlan
+  plan_affinity(const std::vector<LogicalCpu>& cpus, const std::vector<int32_t>& gpu_numa_nodes, AffinityMode mode)
+  {
+    const size_t num_render_threads = gpu_numa_nodes.size();
+
+    AffinityPlan plan;
+    plan.m_mode = mode;
+    plan.m_render_threads.resize(num_render_threads);
+    plan.m_render_thread_nodes.resize(num_render_threads, -1);
+
+    if ((mode == AffinityMode::none) || cpus.empty()) {
+      return plan;
+    }
+
+    //------------------------------------------------------------------------------
+    // The first core stays with the other threads (it also tends to handle most
+    // interrupts), unless it is the only one.
+    const std::vector<core_t> cores = group_by_core(cpus);
+    const size_t reserved_core = ((cores.size() > 1) ? 0 : cores.size());
+
+    std::vector<int32_t> nodes;
+
+    for (const core_t& core : cores) {
+      if (std::find(begin(nodes), end(nodes), core.m_numa_node) == end(nodes)) {
+        nodes.push_back(core.m_numa_node);
+      }
+    }
+
+    std::sort(begin(nodes), end(nodes));
+
+    //------------------------------------------------------------------------------
+    // Node of each render thread: its GPU's if that has CPUs, else spread.
+    for (size_t i = 0; i < num_render_threads; ++i) {
+      const int32_t gpu_numa_node = gpu_numa_nodes[i];
+
+      if (std::find(begin(nodes), end(nodes), gpu_numa_node) != end(nodes)) {
+        plan.m_render_thread_nodes[i] = gpu_numa_node;
+        continue;
+      }
+
+      plan.m_render_thread_nodes[i] = nodes[i % nodes.size()];
+
+      if (gpu_numa_node >= 0) {
+        plan.m_notes.push_back("Render thread " + std::to_string(i) + ": GPU node " + std::to_string(gpu_numa_node) + " has no usable CPUs");
+      }
+    }
+
+    std::vector<bool> is_render_core(cores.size(), false);
+
+    if (mode == AffinityMode::core) {
+      //------------------------------------------------------------------------------
+      // One free physical core per render thread, on its node if possible. Only the
+      // first logical CPU is used so no SMT sibling competes with the thread.
+      for (size_t i = 0; i < num_render_threads; ++i) {
+        const int32_t node = plan.m_render_thread_nodes[i];
+        size_t core_index = cores.size();
+
+        for (size_t pass = 0; (pass < 2) && (core_index == cores.size()); ++pass) {
+          for (size_t j = 0; j < cores.size(); ++j) {
+            if ((j != reserved_core) && !is_render_core[j] && ((pass == 1) || (cores[j].m_numa_node == node))) {
+              core_index = j;
+              break;
+            }
+          }
+        }
+
+        if (core_index == cores.size()) {
+          const size_t num_shared_cores = ((reserved_core < cores.size()) ? (cores.size() - 1) : cores.size());
+          core_index = (((reserved_core < cores.size()) ? 1 : 0) + (i % num_shared_cores));
+          plan.m_notes.push_back("Render thread " + std::to_string(i) + ": no free core, sharing");
+        }
+        else if (cores[core_index].m_numa_node != node) {
+          plan.m_notes.push_back("Render thread " + std::to_string(i) + ": no free core on node " + std::to_string(node));
+        }
+
+        is_render_core[core_index] = true;
+        plan.m_render_threads[i] = cpu_list_t(1, cores[core_index].m_cpus.front());
+        plan.m_render_thread_nodes[i] = cores[core_index].m_numa_node;
+      }
+    }
+    else {
+      //------------------------------------------------------------------------------
+      // All cores of the node but the reserved one.
+      for (size_t i = 0; i < num_render_threads; ++i) {
+        for (size_t j = 0; j < cores.size(); ++j) {
+          if ((j != reserved_core) && (cores[j].m_numa_node == plan.m_render_thread_nodes[i])) {
+            is_render_core[j] = true;
+            plan.m_render_threads[i].insert(end(plan.m_render_threads[i]), begin(cores[j].m_cpus), end(cores[j].m_cpus));
+          }
+        }
+
+        if (plan.m_render_threads[i].empty()) {
+          plan.m_render_threads[i] = cores[reserved_core].m_cpus;
+          plan.m_notes.push_back("Render thread " + std::to_string(i) + ": shares the reserved core");
+        }
+      }
+    }
+
+    //------------------------------------------------------------------------------
+    // Everything else goes to the other threads.
+    for (size_t j = 0; j < cores.size(); ++j) {
+      if (!is_render_core[j]) {
+        plan.m_other_threads.insert(end(plan.m_other_threads), begin(cores[j].m_cpus), end(cores[j].m_cpus));
+      }
+    }
+
+    if (plan.m_other_threads.empty()) {
+      for (const LogicalCpu& cpu : cpus) {
+        plan.m_other_threads.push_back(cpu.m_index);
+      }
+
+      plan.m_notes.push_back("No core left for the other threads");
+    }
+
+    return plan;
+  }
+
+  void
+  print_affinity_plan(std::ostream& stream, const AffinityPlan& plan)
+  {
+    stream << "Affinity (" << affinity_mode_name(plan.m_mode) << "):" << std::endl;
+
+    for (size_t i = 0; i < plan.m_render_threads.size(); ++i) {
+      stream << "  Render thread " << i << ": ";
+
+      if (plan.m_render_threads[i].empty()) {
+        stream << "any CPU" << std::endl;
+      }
+      else {
+        stream << "CPU(s) " << to_string(plan.m_render_threads[i]) << " (node " << plan.m_render_thread_nodes[i] << ")" << std::endl;
+      }
+    }
+
+    stream << "  Other threads: " << (plan.m_other_threads.empty() ? std::string("any CPU") : ("CPU(s) " + to_string(plan.m_other_threads))) << std::endl;
+
+    for (const std::string& note : plan.m_notes) {
+      stream << "  Note: " << note << std::endl;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool
+  set_thread_affinity(std::thread::native_handle_type thread, const cpu_list_t& cpus)
+  {
+    if (cpus.empty()) {
+      return true;
+    }
+
+#if defined(_WIN32)
+    DWORD_PTR mask = 0;
+
+    for (const uint32_t cpu : cpus) {
+      if (cpu < (sizeof(DWORD_PTR) * 8)) {
+        mask |= (DWORD_PTR(1) << cpu);
+      }
+    }
+
+    return ((mask != 0) && (SetThreadAffinityMask(HANDLE(thread), mask) != 0));
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (const uint32_t cpu : cpus) {
+      if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set);
+      }
+    }
+
+    return (pthread_setaffinity_np(thread, sizeof(set), &set) == 0);
+#endif
+  }
+
+  bool
+  set_current_thread_affinity(const cpu_list_t& cpus)
+  {
+#if defined(_WIN32)
+    return set_thread_affinity(GetCurrentThread(), cpus);
+#else
+    return set_thread_affinity(pthread_self(), cpus);
+#endif
+  }
+
+  int32_t
+  current_cpu()
+  {
+#if defined(_WIN32)
+    return int32_t(GetCurrentProcessorNumber());
+#else
+    return int32_t(sched_getcpu());
+#endif
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,112 @@
+//
+//  ThreadAffinity.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // CPU topology
+  //------------------------------------------------------------------------------
+
+  typedef std::vector<uint32_t> cpu_list_t;
+
+  struct LogicalCpu
+  {
+    uint32_t    m_index = 0;        // As used by the OS affinity functions.
+    uint32_t    m_core = 0;         // Physical core, shared by SMT siblings.
+    int32_t     m_numa_node = 0;
+  };
+
+  //------------------------------------------------------------------------------
+  // The logical CPUs the process may run on, ordered by index. Without NUMA
+  // information all CPUs are on node 0. On Windows only the process's processor
+  // group (at most 64 CPUs) is considered.
+  std::vector<LogicalCpu> detect_cpu_topology();
+
+  //------------------------------------------------------------------------------
+  // NUMA node of the PCI device (e.g. a GPU) at the given location, -1 if unknown.
+  int32_t pci_device_numa_node(uint32_t domain, uint32_t bus, uint32_t device);
+
+  //------------------------------------------------------------------------------
+  // Formats as a compact list of ranges, e.g. "0-3,8".
+  std::string to_string(const cpu_list_t& cpus);
+
+  //------------------------------------------------------------------------------
+  // Affinity policy
+  //------------------------------------------------------------------------------
+
+  //------------------------------------------------------------------------------
+  // How render threads are placed:
+  //  "none" leaves placement to the OS,
+  //  "core" pins each render thread to its own physical core, on its GPU's node,
+  //  "node" lets each render thread float over the cores of its GPU's node.
+  // Either way one physical core stays reserved for the remaining threads.
+  enum class AffinityMode
+  {
+    none,
+    core,
+    node
+  };
+
+  //------------------------------------------------------------------------------
+  // Throws if the name is unknown.
+  AffinityMode affinity_mode_from_name(const std::string& name);
+  const char* affinity_mode_name(AffinityMode mode);
+  std::vector<std::string> affinity_mode_names();
+
+  //------------------------------------------------------------------------------
+  // CPUs per render thread and for all other threads (the main and flusher
+  // threads). Empty lists leave a thread's affinity alone.
+  struct AffinityPlan
+  {
+    AffinityMode                m_mode = AffinityMode::none;
+    std::vector<cpu_list_t>     m_render_threads;
+    std::vector<int32_t>        m_render_thread_nodes;      // -1 if not placed by NUMA node.
+    cpu_list_t                  m_other_threads;
+    std::vector<std::string>    m_notes;                    // Where the plan had to compromise.
+  };
+
+  //------------------------------------------------------------------------------
+  // Plan placement for one render thread per entry of gpu_numa_nodes, the NUMA
+  // node of the GPU the thread drives (-1 if unknown, spreads across nodes).
+  AffinityPlan plan_affinity(const std::vector<LogicalCpu>& cpus, const std::vector<int32_t>& gpu_numa_nodes, AffinityMode mode);
+
+  void print_affinity_plan(std::ostream& stream, const AffinityPlan& plan);
+
+  //------------------------------------------------------------------------------
+  // Restrict a thread to the given CPUs, an empty list does nothing. Returns false
+  // on failure.
+  bool set_thread_affinity(std::thread::native_handle_type thread, const cpu_list_t& cpus);
+  bool set_current_thread_affinity(const cpu_list_t& cpus);
+
+  //------------------------------------------------------------------------------
+  // The CPU the calling thread is running on, -1 if unknown.
+  int32_t current_cpu();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,343 @@
+//
+//  ThreadScheduling.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadScheduling.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <avrt.h>
+#include <winternl.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace {
+
+    const char* policy_name(SchedulingPolicy policy)
+    {
+      switch (policy) {
+        case SchedulingPolicy::normal: return "normal";
+        case SchedulingPolicy::fifo: return "fifo";
+        case SchedulingPolicy::round_robin: return "rr";
+      }
+
+      return "?";
+    }
+
+#if defined(_WIN32)
+    //------------------------------------------------------------------------------
+    // The entries following each SYSTEM_PROCESS_INFORMATION, as winternl.h leaves
+    // the context switches unnamed (or the struct out, in older SDKs).
+    struct system_thread_information_t
+    {
+      LARGE_INTEGER   m_kernel_time;
+      LARGE_INTEGER   m_user_time;
+      LARGE_INTEGER   m_create_time;
+      ULONG           m_wait_time;
+      PVOID           m_start_address;
+      HANDLE          m_unique_process;
+      HANDLE          m_unique_thread;
+      LONG            m_priority;
+      LONG            m_base_priority;
+      ULONG           m_context_switches;
+      ULONG           m_thread_state;
+      ULONG           m_wait_reason;
+    };
+
+    typedef NTSTATUS (NTAPI* nt_query_system_information_t)(SYSTEM_INFORMATION_CLASS, PVOID, ULONG, PULONG);
+
+    //------------------------------------------------------------------------------
+    // Of the calling thread from a snapshot of every process (a few hundred KB,
+    // taken when a scheduling scope starts and reports), -1 if not available.
+    int64_t get_thread_context_switches()
+    {
+      static const nt_query_system_information_t nt_query_system_information =
+        reinterpret_cast<nt_query_system_information_t>(GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtQuerySystemInformation"));
+
+      if (!nt_query_system_information) {
+        return -1;
+      }
+
+      const LONG STATUS_INFO_LENGTH_MISMATCH = LONG(0xc0000004);
+      std::vector<uint8_t> buffer(256 * 1024);
+      NTSTATUS status = 0;
+
+      for (;;) {
+        ULONG size = 0;
+        status = nt_query_system_information(SystemProcessInformation, buffer.data(), ULONG(buffer.size()), &size);
+
+        if (status != STATUS_INFO_LENGTH_MISMATCH) {
+          break;
+        }
+
+        buffer.resize(std::max<size_t>((buffer.size() * 2), (size_t(size) + (64 * 1024))));
+      }
+
+      if (status < 0) {
+        return -1;
+      }
+
+      const HANDLE process_id = HANDLE(uintptr_t(GetCurrentProcessId()));
+      const HANDLE thread_id = HANDLE(uintptr_t(GetCurrentThreadId()));
+
+      for (size_t offset = 0; offset < buffer.size(); ) {
+        const SYSTEM_PROCESS_INFORMATION* const process = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION*>(buffer.data() + offset);
+
+        if (process->UniqueProcessId == process_id) {
+          const system_thread_information_t* const threads = reinterpret_cast<const system_thread_information_t*>(process + 1);
+
+          for (ULONG i = 0; i < process->NumberOfThreads; ++i) {
+            if (threads[i].m_unique_thread == thread_id) {
+              return int64_t(threads[i].m_context_switches);
+            }
+          }
+
+          return -1;
+        }
+
+        if (process->NextEntryOffset == 0) {
+          break;
+        }
+
+        offset += process->NextEntryOffset;
+      }
+
+      return -1;
+    }
+#endif
+
+    //------------------------------------------------------------------------------
+    // Context switches of the calling thread so far, -1 if not available. Windows
+    // only counts them all, so neither kind is known there.
+    void get_context_switches(int64_t& involuntary, int64_t& voluntary, int64_t& total)
+    {
+      involuntary = -1;
+      voluntary = -1;
+      total = -1;
+
+#if defined(_WIN32)
+      total = get_thread_context_switches();
+#elif defined(RUSAGE_THREAD)
+      rusage usage = {};
+
+      if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        involuntary = int64_t(usage.ru_nivcsw);
+        voluntary = int64_t(usage.ru_nvcsw);
+        total = (involuntary + voluntary);
+      }
+#endif
+    }
+
+  } // unnamed namespace
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  SchedulingConfig
+  scheduling_config_from_string(const std::string& text)
+  {
+    const size_t colon = text.find(':');
+    const std::string name = text.substr(0, colon);
+
+    SchedulingConfig config;
+
+    for (const SchedulingPolicy policy : { SchedulingPolicy::normal, SchedulingPolicy::fifo, SchedulingPolicy::round_robin }) {
+      if (name == policy_name(policy)) {
+        config.m_policy = policy;
+
+        if (colon == std::string::npos) {
+          config.m_priority = ((policy == SchedulingPolicy::normal) ? 0 : 50);
+          return config;
+        }
+
+        char* end = nullptr;
+        config.m_priority = int(strtol(text.c_str() + colon + 1, &end, 10));
+
+        if ((end != (text.c_str() + colon + 1)) && (*end == '\0')) {
+          return config;
+        }
+      }
+    }
+
+    throw std::runtime_error("Invalid scheduling: " + text);
+  }
+
+  std::string
+  to_string(const SchedulingConfig& config)
+  {
+    if (config.m_policy == SchedulingPolicy::normal) {
+      return policy_name(config.m_policy);
+    }
+
+    return (std::string(policy_name(config.m_policy)) + ":" + std::to_string(config.m_priority));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  ScopedThreadScheduling::ScopedThreadScheduling(const SchedulingConfig& config)
+  {
+    get_context_switches(m_initial_involuntary_context_switches, m_initial_voluntary_context_switches, m_initial_context_switches);
+
+    if (config.m_policy == SchedulingPolicy::normal) {
+      return;
+    }
+
+#if defined(_WIN32)
+    DWORD task_index = 0;
+    m_mmcss_handle = AvSetMmThreadCharacteristicsW(L"Games", &task_index);
+
+    if (m_mmcss_handle == nullptr) {
+      m_status = ("MMCSS registration failed (error " + std::to_string(GetLastError()) + "), staying normal");
+      return;
+    }
+
+    const AVRT_PRIORITY priority = ((config.m_priority >= 90) ? AVRT_PRIORITY_CRITICAL :
+                                    (config.m_priority >= 50) ? AVRT_PRIORITY_HIGH :
+                                    (config.m_priority >= 25) ? AVRT_PRIORITY_NORMAL : AVRT_PRIORITY_LOW);
+
+    if (AvSetMmThreadPriority(m_mmcss_handle, priority) == FALSE) {
+      m_status = ("MMCSS priority not set (error " + std::to_string(GetLastError()) + ")");
+    }
+
+    m_applied = config;
+#else
+    sched_param previous = {};
+
+    if (pthread_getschedparam(pthread_self(), &m_previous_policy, &previous) != 0) {
+      m_status = "Failed to query scheduling, staying normal";
+      return;
+    }
+
+    m_previous_priority = previous.sched_priority;
+
+    const int policy = ((config.m_policy == SchedulingPolicy::fifo) ? SCHED_FIFO : SCHED_RR);
+
+    sched_param parameters = {};
+    parameters.sched_priority = std::min(std::max(config.m_priority, sched_get_priority_min(policy)), sched_get_priority_max(policy));
+
+    const int result = pthread_setschedparam(pthread_self(), policy, &parameters);
+
+    if (result != 0) {
+      m_status = (std::string(policy_name(config.m_policy)) + " not applied (" + strerror(result) + "), staying normal");
+      return;
+    }
+
+    m_is_changed = true;
+    m_applied.m_policy = config.m_policy;
+    m_applied.m_priority = parameters.sched_priority;
+#endif
+  }
+
+  ScopedThreadScheduling::~ScopedThreadScheduling()
+  {
+#if defined(_WIN32)
+    if (m_mmcss_handle) {
+      AvRevertMmThreadCharacteristics(m_mmcss_handle);
+    }
+#else
+    if (m_is_changed) {
+      sched_param previous = {};
+      previous.sched_priority = m_previous_priority;
+      pthread_setschedparam(pthread_self(), m_previous_policy, &previous);
+    }
+#endif
+  }
+
+  int64_t
+  ScopedThreadScheduling::involuntary_context_switches() const
+  {
+    int64_t involuntary = -1;
+    int64_t voluntary = -1;
+    int64_t total = -1;
+    get_context_switches(involuntary, voluntary, total);
+
+    return (((involuntary >= 0) && (m_initial_involuntary_context_switches >= 0)) ? (involuntary - m_initial_involuntary_context_switches) : -1);
+  }
+
+  int64_t
+  ScopedThreadScheduling::voluntary_context_switches() const
+  {
+    int64_t involuntary = -1;
+    int64_t voluntary = -1;
+    int64_t total = -1;
+    get_context_switches(involuntary, voluntary, total);
+
+    return (((voluntary >= 0) && (m_initial_voluntary_context_switches >= 0)) ? (voluntary - m_initial_voluntary_context_switches) : -1);
+  }
+
+  int64_t
+  ScopedThreadScheduling::context_switches() const
+  {
+    int64_t involuntary = -1;
+    int64_t voluntary = -1;
+    int64_t total = -1;
+    get_context_switches(involuntary, voluntary, total);
+
+    return (((total >= 0) && (m_initial_context_switches >= 0)) ? (total - m_initial_context_switches) : -1);
+  }
+
+  std::string
+  ScopedThreadScheduling::report() const
+  {
+    std::ostringstream report;
+    report << "scheduling " << to_string(m_applied);
+
+    if (!m_status.empty()) {
+      report << " (" << m_status << ")";
+    }
+
+    int64_t involuntary = -1;
+    int64_t voluntary = -1;
+    int64_t total = -1;
+    get_context_switches(involuntary, voluntary, total);
+
+    if ((involuntary >= 0) && (m_initial_involuntary_context_switches >= 0)) {
+      report << ", " << (involuntary - m_initial_involuntary_context_switches) << " involuntary / "
+             << (voluntary - m_initial_voluntary_context_switches) << " voluntary context switch(es)";
+    }
+    else if ((total >= 0) && (m_initial_context_switches >= 0)) {
+      report << ", " << (total - m_initial_context_switches) << " context switch(es)";
+    }
+    else {
+      report << ", context switches not available";
+    }
+
+    return report.str();
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
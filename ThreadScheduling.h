@@ -0,0 +1,111 @@
+//
+//  ThreadScheduling.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Scheduling class of a thread. On Linux the real-time policies map to
+  // SCHED_FIFO/SCHED_RR with the given priority (clamped to the valid range).
+  // On Windows both register the thread with MMCSS ("Games" task) with the
+  // priority mapped to low (< 25), normal, high (>= 50) or critical (>= 90).
+  //------------------------------------------------------------------------------
+
+  enum class SchedulingPolicy
+  {
+    normal,
+    fifo,
+    round_robin
+  };
+
+  struct SchedulingConfig
+  {
+    SchedulingPolicy    m_policy = SchedulingPolicy::normal;
+    int                 m_priority = 0;
+  };
+
+  //------------------------------------------------------------------------------
+  // "normal", "fifo[:<priority>]" or "rr[:<priority>]". Throws if invalid.
+  SchedulingConfig scheduling_config_from_string(const std::string& text);
+  std::string to_string(const SchedulingConfig& config);
+
+  //------------------------------------------------------------------------------
+  // Applies a scheduling class to the calling thread for the lifetime of the
+  // object and restores the previous one when destroyed. Failing to apply
+  // (typically for lack of permission) is not an error, the thread stays at
+  // normal scheduling and status() says why.
+  //
+  // Also counts the context switches of the thread over the lifetime of the
+  // object, which shows whether the scheduling class kept other work off the
+  // thread's CPU. Linux tells involuntary from voluntary ones, Windows only
+  // counts them all (from a snapshot of the system's threads, so not for use
+  // per frame). Counts not available are -1.
+  //------------------------------------------------------------------------------
+
+  class ScopedThreadScheduling
+  {
+  public:
+
+    explicit ScopedThreadScheduling(const SchedulingConfig& config);
+    ~ScopedThreadScheduling();
+
+    ScopedThreadScheduling(const ScopedThreadScheduling&) = delete;
+    ScopedThreadScheduling& operator=(const ScopedThreadScheduling&) = delete;
+
+    //------------------------------------------------------------------------------
+    // What is in effect, normal if the requested class could not be applied.
+    const SchedulingConfig& applied() const { return m_applied; }
+    const std::string& status() const { return m_status; }
+
+    //------------------------------------------------------------------------------
+    // Context switches since construction, must be called on the same thread.
+    int64_t involuntary_context_switches() const;
+    int64_t voluntary_context_switches() const;
+    int64_t context_switches() const;
+
+    //------------------------------------------------------------------------------
+    // Summary of the above, e.g. for the end of a thread's run.
+    std::string report() const;
+
+  private:
+
+    SchedulingConfig    m_applied;
+    std::string         m_status;
+
+    int64_t             m_initial_involuntary_context_switches = -1;
+    int64_t             m_initial_voluntary_context_switches = -1;
+    int64_t             m_initial_context_switches = -1;
+
+#if defined(_WIN32)
+    void*               m_mmcss_handle = nullptr;
+#else
+    bool                m_is_changed = false;
+    int                 m_previous_policy = 0;
+    int                 m_previous_priority = 0;
+#endif
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,143 @@
+//
+//  TopologyTool.cpp
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DisplayTopology.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    void print_usage(std::ostream& stream)
+    {
+        stream << "Usage: TopologyTool mock [--gpus=<n>] [--monitors-per-gpu=<n>] [--refresh-rate=<Hz>] [--mosaic] [--output=<snapshot>]" << std::endl;
+        stream << "       TopologyTool print <snapshot>" << std::endl;
+        stream << "       TopologyTool diff <snapshot> <snapshot>" << std::endl;
+    }
+
+    //------------------------------------------------------------------------------
+    // Build a topology from the mock providers, print it and save a snapshot.
+    int mock(int argc, char* argv[])
+    {
+        static const char GPUS_OPTION[] = "--gpus=";
+        static const char MONITORS_PER_GPU_OPTION[] = "--monitors-per-gpu=";
+        static const char REFRESH_RATE_OPTION[] = "--refresh-rate=";
+        static const char OUTPUT_OPTION[] = "--output=";
+
+        toolbox::MockDisplayLayout layout;
+        std::string output_path;
+
+        for (int i = 2; i < argc; ++i) {
+            if (strncmp(argv[i], GPUS_OPTION, (sizeof(GPUS_OPTION) - 1)) == 0) {
+                layout.m_num_gpus = size_t(strtoul(argv[i] + (sizeof(GPUS_OPTION) - 1), nullptr, 10));
+            }
+            else if (strncmp(argv[i], MONITORS_PER_GPU_OPTION, (sizeof(MONITORS_PER_GPU_OPTION) - 1)) == 0) {
+                layout.m_num_monitors_per_gpu = size_t(strtoul(argv[i] + (sizeof(MONITORS_PER_GPU_OPTION) - 1), nullptr, 10));
+            }
+            else if (strncmp(argv[i], REFRESH_RATE_OPTION, (sizeof(REFRESH_RATE_OPTION) - 1)) == 0) {
+                layout.m_refresh_rate_hz = uint32_t(strtoul(argv[i] + (sizeof(REFRESH_RATE_OPTION) - 1), nullptr, 10));
+            }
+            else if (strcmp(argv[i], "--mosaic") == 0) {
+                layout.m_is_mosaic = true;
+            }
+            else if (strncmp(argv[i], OUTPUT_OPTION, (sizeof(OUTPUT_OPTION) - 1)) == 0) {
+                output_path = (argv[i] + (sizeof(OUTPUT_OPTION) - 1));
+            }
+            else {
+                std::cerr << "Error: Unexpected argument: " << argv[i] << std::endl;
+                print_usage(std::cerr);
+                return EXIT_FAILURE;
+            }
+        }
+
+        if ((layout.m_num_gpus == 0) || (layout.m_num_monitors_per_gpu == 0)) {
+            std::cerr << "Error: At least one GPU and monitor are required!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        toolbox::DisplayTopology topology = toolbox::build_display_topology(toolbox::create_mock_display_topology_providers(layout));
+        topology.m_fingerprint = toolbox::display_topology_fingerprint("mock");
+
+        toolbox::print_display_topology(std::cout, topology);
+
+        if (!output_path.empty() && !toolbox::save_display_topology(output_path, topology)) {
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    bool load(const char* path, toolbox::DisplayTopology& topology)
+    {
+        if (!toolbox::load_display_topology(path, topology)) {
+            std::cerr << "Error: " << path << " is not a display topology snapshot!" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char* argv[])
+{
+    if ((argc >= 2) && (strcmp(argv[1], "mock") == 0)) {
+        return mock(argc, argv);
+    }
+
+    if ((argc == 3) && (strcmp(argv[1], "print") == 0)) {
+        toolbox::DisplayTopology topology;
+
+        if (!load(argv[2], topology)) {
+            return EXIT_FAILURE;
+        }
+
+        toolbox::print_display_topology(std::cout, topology);
+        return EXIT_SUCCESS;
+    }
+
+    if ((argc == 4) && (strcmp(argv[1], "diff") == 0)) {
+        toolbox::DisplayTopology before;
+        toolbox::DisplayTopology after;
+
+        if (!load(argv[2], before) || !load(argv[3], after)) {
+            return EXIT_FAILURE;
+        }
+
+        const std::vector<std::string> differences = toolbox::diff_display_topologies(before, after);
+
+        for (const std::string& difference : differences) {
+            std::cout << difference << std::endl;
+        }
+
+        //------------------------------------------------------------------------------
+        // Like diff(1), 1 if the topologies differ.
+        return (differences.empty() ? EXIT_SUCCESS : 1);
+    }
+
+    print_usage(std::cerr);
+    return EXIT_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,211 @@
+//
+//  UniformRing.h
+//  TestMultiGpuMultiMonitor
+//
+//  Copyright © 2018 Chris Birkhold. All rights reserved.
+//
+
+#pragma once
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace toolbox {
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+  //------------------------------------------------------------------------------
+  // Hands out offsets into a buffer of per-frame data (e.g. a persistently mapped
+  // uniform buffer) in ring order. Each frame's allocations are fenced at the end
+  // of the frame, and an allocation waits for the fence of the oldest frame still
+  // using the space it needs. At most num_frames frames are in flight, begin_frame()
+  // waits for the oldest beyond that.
+  //
+  // Only offsets are handled, the buffer and the fences belong to FenceApiT, so
+  // the wrap and fence logic runs without a GPU (see FakeFenceApi):
+  //
+  //   typedef ... fence_t
+  //   fence_t insert_fence()
+  //   bool is_signaled(fence_t fence)
+  //   void wait(fence_t fence)               Blocks until signaled.
+  //   void delete_fence(fence_t fence)
+  //
+  // Owned by the thread the buffer's context is current on.
+  //------------------------------------------------------------------------------
+
+  template <typename FenceApiT>
+  class UniformRing
+  {
+  public:
+
+    typedef typename FenceApiT::fence_t fence_t;
+
+    struct Statistics
+    {
+      uint64_t    m_frames = 0;         // Ended with allocations (and so a fence).
+      uint64_t    m_allocations = 0;
+      uint64_t    m_wraps = 0;          // Back to the start of the buffer.
+      uint64_t    m_waits = 0;          // Fences waited for.
+      uint64_t    m_stalls = 0;         // Of those, not signaled yet.
+    };
+
+    //------------------------------------------------------------------------------
+    // The size must be a multiple of the alignment (a power of two, e.g.
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT).
+    UniformRing(size_t size, size_t alignment, size_t num_frames, const FenceApiT& api = FenceApiT()) :
+      m_api(api), m_size(size), m_alignment(alignment), m_num_frames(num_frames)
+    {
+      if ((alignment == 0) || ((alignment & (alignment - 1)) != 0) || (size == 0) || ((size % alignment) != 0) || (num_frames == 0)) {
+        throw std::runtime_error("Invalid uniform ring size or alignment!");
+      }
+    }
+
+    ~UniformRing()
+    {
+      for (const Frame& frame : m_frames) {
+        m_api.delete_fence(frame.m_fence);
+      }
+    }
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    FenceApiT& api() { return m_api; }
+    const Statistics& statistics() const { return m_statistics; }
+    size_t size() const { return m_size; }
+    size_t num_frames_in_flight() const { return m_frames.size(); }
+
+    void begin_frame()
+    {
+      while (m_frames.size() >= m_num_frames) {
+        retire_oldest_frame();
+      }
+
+      m_frame_start = m_head;
+      m_is_frame_empty = true;
+    }
+
+    //------------------------------------------------------------------------------
+    // Offset of size bytes, aligned. Throws if the frame's allocations do not fit
+    // the buffer.
+    size_t allocate(size_t size)
+    {
+      uint64_t position = align(m_head);
+
+      if (((position % m_size) + size) > m_size) {
+        position = align_to_size(position);
+      }
+
+      if ((position / m_size) > ((m_head > 0) ? ((m_head - 1) / m_size) : 0)) {
+        ++m_statistics.m_wraps;
+      }
+
+      //------------------------------------------------------------------------------
+      // Everything from the oldest frame in flight (or this one) on is in use.
+      while ((position + size) > (oldest_position() + m_size)) {
+        if (m_frames.empty()) {
+          throw std::runtime_error("Uniform ring too small for the allocations of one frame!");
+        }
+
+        retire_oldest_frame();
+      }
+
+      m_head = (position + size);
+      m_is_frame_empty = false;
+      ++m_statistics.m_allocations;
+
+      return size_t(position % m_size);
+    }
+
+    //------------------------------------------------------------------------------
+    // After the commands using the frame's allocations, fences them (if any).
+    void end_frame()
+    {
+      if (m_is_frame_empty) {
+        return;
+      }
+
+      Frame frame;
+      frame.m_position = m_frame_start;
+      frame.m_fence = m_api.insert_fence();
+      m_frames.push_back(frame);
+
+      m_is_frame_empty = true;
+      ++m_statistics.m_frames;
+    }
+
+  private:
+
+    struct Frame
+    {
+      uint64_t    m_position = 0;       // Of its first allocation, counting from the first frame.
+      fence_t     m_fence = fence_t();
+    };
+
+    uint64_t align(uint64_t position) const { return ((position + (m_alignment - 1)) & ~uint64_t(m_alignment - 1)); }
+    uint64_t align_to_size(uint64_t position) const { return (((position + (m_size - 1)) / m_size) * m_size); }
+
+    uint64_t oldest_position() const { return (m_frames.empty() ? m_frame_start : m_frames.front().m_position); }
+
+    void retire_oldest_frame()
+    {
+      const Frame frame = m_frames.front();
+      m_frames.pop_front();
+
+      ++m_statistics.m_waits;
+
+      if (!m_api.is_signaled(frame.m_fence)) {
+        ++m_statistics.m_stalls;
+        m_api.wait(frame.m_fence);
+      }
+
+      m_api.delete_fence(frame.m_fence);
+    }
+
+    FenceApiT           m_api;
+    Statistics          m_statistics;
+
+    const size_t        m_size;
+    const size_t        m_alignment;
+    const size_t        m_num_frames;
+
+    // Positions count bytes from the first frame, the offset is modulo the size.
+    uint64_t            m_head = 0;
+    uint64_t            m_frame_start = 0;
+    bool                m_is_frame_empty = true;
+    std::deque<Frame>   m_frames;
+  };
+
+  //------------------------------------------------------------------------------
+  // Stands in for a GPU that completes fences only when told (or waited for).
+  struct FakeFenceApi
+  {
+    typedef uint64_t fence_t;
+
+    uint64_t    m_num_inserted = 0;
+    uint64_t    m_num_completed = 0;
+    uint64_t    m_num_deleted = 0;
+
+    fence_t insert_fence() { return ++m_num_inserted; }
+    bool is_signaled(fence_t fence) const { return (fence <= m_num_completed); }
+    void wait(fence_t fence) { m_num_completed = std::max(m_num_completed, fence); }
+    void delete_fence(fence_t) { ++m_num_deleted; }
+  };
+
+  ////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////
+
+} // namespace toolbox
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -4,11 +4,20 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <future>
 #include <iostream>
 #include <iomanip>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -31,7 +40,24 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include "DisplayTopology.h"
+#include "FileWatcher.h"
+#include "FrameBarrier.h"
+#include "FramePacing.h"
+#include "GLStateCache.h"
+#include "FrameTimingLog.h"
+#include "OpenGLProgramCache.h"
 #include "OpenGLUtilities.h"
+#include "PointGrid.h"
+#include "ProgramRegistry.h"
+#include "RenderLoop.h"
+#include "RenderWorkerPool.h"
+#include "Scenarios.h"
+#include "SnapshotRing.h"
+#include "StartupOrchestrator.h"
+#include "ThreadAffinity.h"
+#include "ThreadScheduling.h"
+#include "UniformRing.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -105,20 +131,6 @@ namespace {
         return DefWindowProc(hWnd, uMsg, wParam, lParam);
     }
 
-    void print_to_stream(std::ostream& stream, const NV_MOSAIC_GRID_TOPO& display_grid, const std::string& indent)
-    {
-        stream << indent << display_grid.rows << "x" << display_grid.columns << " (" << display_grid.displayCount << (display_grid.displayCount == 1 ? " display)" : " displays)") << std::endl;
-        stream << indent << display_grid.displaySettings.width << "x" << display_grid.displaySettings.height << " @ " << display_grid.displaySettings.freq << " Hz" << std::endl;
-
-        for (size_t r = 0; r < display_grid.rows; ++r) {
-            for (size_t c = 0; c < display_grid.columns; ++c) {
-                std::cout << indent << "[" << r << "," << c << "] 0x" << std::hex << std::setfill('0') << std::setw(8) << display_grid.displays[c + (r * display_grid.columns)].displayId << std::dec << std::endl;
-            }
-
-            std::cout << std::endl;
-        }
-    }
-
     void print_display_flags_to_stream(std::ostream& stream, DWORD flags)
     {
         stream << "0x" << std::hex << std::setfill('0') << std::setw(8) << flags << std::dec;
@@ -190,82 +202,125 @@ namespace {
     std::condition_variable start_render_threads_event;
     bool start_render_threads_flag = false;
 
-    void start_render_threads(std::vector<HDC> display_contexts, std::vector<HGLRC> gl_contexts, const std::function<void(size_t)>& initialize, const std::function<void(size_t)>& render)
+    //------------------------------------------------------------------------------
+    // Render workers bound to the given contexts, one per context.
+    std::unique_ptr<toolbox::RenderWorkerPool> create_render_workers(const std::vector<HDC>& display_contexts, const std::vector<HGLRC>& gl_contexts)
     {
         //------------------------------------------------------------------------------
         // Check arguments.
         assert(display_contexts.size() == gl_contexts.size());
 
+        return std::unique_ptr<toolbox::RenderWorkerPool>(new toolbox::RenderWorkerPool(display_contexts.size(),
+            [display_contexts, gl_contexts](size_t thread_index)
+        {
+            if (wglMakeCurrent(display_contexts[thread_index], gl_contexts[thread_index]) != TRUE) {
+                std::cerr << "Error: Failed to make OpenGL context current: ";
+                log_last_error_message();
+                throw std::runtime_error("Failed to make OpenGL context current!");
+            }
+        },
+            [](size_t)
+        {
+            wglMakeCurrent(NULL, NULL);
+        }));
+    }
+
+    //------------------------------------------------------------------------------
+    // Run initialize on all render workers concurrently, then ready (if any) on the
+    // calling thread once all are done, given the number of workers that will
+    // render (those whose initialize did not throw), then render on those together.
+    void start_render_threads(toolbox::RenderWorkerPool& render_workers, const std::function<void(size_t)>& initialize, const std::function<void(size_t)>& ready, const std::function<void(size_t)>& render)
+    {
         //------------------------------------------------------------------------------
         // Synchronize this function.
         std::unique_lock<std::mutex> lock(render_threads_mutex);
         start_render_threads_flag = false;
 
         //------------------------------------------------------------------------------
-        // Start all threads and let them do their setup.
-        for (size_t thread_index = 0; thread_index < display_contexts.size(); ++thread_index) {
+        // Let all workers do their setup concurrently. Each worker collects its output
+        // and how long the setup took, reported together once all are ready.
+        const size_t num_render_threads = render_workers.size();
+        const auto setup_start_time = std::chrono::steady_clock::now();
+
+        std::vector<std::future<void>> render_threads_ready;
+        std::vector<std::string> setup_reports(num_render_threads);
+        std::vector<std::chrono::steady_clock::duration> setup_durations(num_render_threads);
+
+        for (size_t thread_index = 0; thread_index < num_render_threads; ++thread_index) {
             std::cout << "Starting render thread " << thread_index << std::endl;
 
-            const HDC display_context = display_contexts[thread_index];
-            const HGLRC gl_context = gl_contexts[thread_index];
-            std::promise<void> render_thread_ready;
+            render_threads_ready.emplace_back(render_workers.submit(thread_index, [&initialize, &setup_reports, &setup_durations](size_t thread_index) {
+                const auto start_time = std::chrono::steady_clock::now();
+                std::ostringstream report;
 
-            std::future<void> render_thread = std::async(std::launch::async, [&render_thread_ready](
-                HDC display_context,
-                HGLRC gl_context,
-                const std::function<void(size_t)>& initialize,
-                const std::function<void(size_t)>& render,
-                size_t thread_index)
-            {
-                try {
-                    //------------------------------------------------------------------------------
-                    // Prepare for rendering.
-                    if (wglMakeCurrent(display_context, gl_context) != TRUE) {
-                        std::cerr << "Error: Failed to make OpenGL context current: ";
-                        log_last_error_message();
-                        throw std::runtime_error("Failed to make OpenGL context current!");
+                //------------------------------------------------------------------------------
+                // Check associated CUDA device.
+                unsigned int cuda_device_count = 0;
+                std::array<CUdevice, 4> cuda_devices;
+
+                if (cuGLGetDevices(&cuda_device_count, cuda_devices.data(), unsigned int(cuda_devices.size()), CU_GL_DEVICE_LIST_ALL) == CUDA_SUCCESS) {
+                    for (size_t i = 0; i < cuda_device_count; ++i) {
+                        report << "  CUDA device: " << cuda_devices[i] << std::endl;
                     }
+                }
 
-                    //------------------------------------------------------------------------------
-                    // Check associated CUDA device.
-                    unsigned int cuda_device_count = 0;
-                    std::array<CUdevice, 4> cuda_devices;
+                setup_reports[thread_index] = report.str();
 
-                    if (cuGLGetDevices(&cuda_device_count, cuda_devices.data(), unsigned int(cuda_devices.size()), CU_GL_DEVICE_LIST_ALL) == CUDA_SUCCESS) {
-                        for (size_t i = 0; i < cuda_device_count; ++i) {
-                            std::cout << "  CUDA device: " << cuda_devices[i] << std::endl;
-                        }
-                    }
+                //------------------------------------------------------------------------------
+                // Initialize.
+                initialize(thread_index);
+                setup_durations[thread_index] = (std::chrono::steady_clock::now() - start_time);
+            }));
+        }
+
+        //------------------------------------------------------------------------------
+        // Wait until all workers are ready for rendering, a failed setup skips
+        // rendering on that worker.
+        std::vector<bool> is_ready(num_render_threads, false);
 
-                    //------------------------------------------------------------------------------
-                    // Initialize.
-                    initialize(thread_index);
+        for (size_t thread_index = 0; thread_index < num_render_threads; ++thread_index) {
+            try {
+                render_threads_ready[thread_index].get();
+                is_ready[thread_index] = true;
+            }
+            catch (std::exception& e) {
+                std::cerr << "Exception: Render thread " << thread_index << ": " << e.what() << std::endl;
+            }
+            catch (...) {
+                std::cerr << "Exception: Render thread " << thread_index << ": <unknown>!" << std::endl;
+            }
+        }
+
+        for (size_t thread_index = 0; thread_index < num_render_threads; ++thread_index) {
+            if (is_ready[thread_index]) {
+                std::cout << "Render thread " << thread_index << " ready in "
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(setup_durations[thread_index]).count() << " ms" << std::endl;
+                std::cout << setup_reports[thread_index];
+            }
+        }
 
-                    //------------------------------------------------------------------------------
-                    // Signal we are ready for rendering then wait for signal to start rendering.
-                    render_thread_ready.set_value();
+        std::cout << "All render threads ready in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - setup_start_time).count() << " ms" << std::endl;
 
-                    {
-                        std::unique_lock<std::mutex> lock(render_threads_mutex);
-                        start_render_threads_event.wait(lock, []() { return start_render_threads_flag; });
-                    }
+        if (ready) {
+            ready(size_t(std::count(is_ready.begin(), is_ready.end(), true)));
+        }
 
-                    //------------------------------------------------------------------------------
-                    // Render.
-                    render(thread_index);
-                }
-                catch (std::exception& e) {
-                    std::cerr << "Exception: " << e.what() << std::endl;
-                }
-                catch (...) {
-                    std::cerr << "Exception: <unknown>!" << std::endl;
+        //------------------------------------------------------------------------------
+        // Queue rendering, which waits for the signal to start.
+        for (size_t thread_index = 0; thread_index < num_render_threads; ++thread_index) {
+            if (!is_ready[thread_index]) {
+                continue;
+            }
+
+            render_threads.emplace_back(render_workers.submit(thread_index, [render](size_t thread_index) {
+                {
+                    std::unique_lock<std::mutex> lock(render_threads_mutex);
+                    start_render_threads_event.wait(lock, []() { return start_render_threads_flag; });
                 }
-            }, display_context, gl_context, initialize, render, thread_index);
 
-            //------------------------------------------------------------------------------
-            // Wait for the thread to be ready for rendering.
-            render_thread_ready.get_future().wait();
-            render_threads.emplace_back(std::move(render_thread));
+                render(thread_index);
+            }));
         }
 
         //------------------------------------------------------------------------------
@@ -324,544 +379,1623 @@ namespace {
         return render_threads.empty();
     }
 
-    class RenderPoints
+    //------------------------------------------------------------------------------
+    // Program binaries are cached across runs, shared by all render threads.
+    toolbox::OpenGLProgramCache& program_cache()
     {
-    public:
+        static toolbox::OpenGLProgramCache s_program_cache("ProgramCache");
+        return s_program_cache;
+    }
 
-        static GLuint create_program()
+    //------------------------------------------------------------------------------
+    // The OpenGL calls behind toolbox::GLStateCache.
+    struct WglApi
+    {
+        void use_program(uint32_t program) { glUseProgram(program); }
+        void bind_vertex_array(uint32_t vertex_array) { glBindVertexArray(vertex_array); }
+        void bind_draw_framebuffer(uint32_t framebuffer) { glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer); }
+        void enable_scissor_test(bool is_enabled) { enable(GL_SCISSOR_TEST, is_enabled); }
+        void enable_program_point_size(bool is_enabled) { enable(GL_PROGRAM_POINT_SIZE, is_enabled); }
+        void scissor(int32_t x, int32_t y, int32_t width, int32_t height) { glScissor(x, y, width, height); }
+        void clear_color(float r, float g, float b, float a) { glClearColor(r, g, b, a); }
+        int32_t get_uniform_location(uint32_t program, const char* name) { return glGetUniformLocation(program, name); }
+        void uniform_4fv(int32_t location, const float* value) { glUniform4fv(location, 1, value); }
+        void uniform_matrix_4fv(int32_t location, const float* value) { glUniformMatrix4fv(location, 1, GL_FALSE, value); }
+        void bind_uniform_buffer_range(uint32_t index, uint32_t buffer, intptr_t offset, intptr_t size) { glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size); }
+
+        static void enable(GLenum capability, bool is_enabled)
         {
-            static const char* const vs_string =
-                "#version 410\n"
-                "uniform vec4 u_rect;\n"
-                "uniform mat4 u_mvp;\n"
-                "out vec2 v_uv;\n"
-                "void main() {\n"
-                "    int x = (gl_VertexID % 1024);\n"
-                "    int y = (gl_VertexID / 1024);\n"
-                "    vec2 uv = (vec2(x, y) * (1.0 / 1023.0));\n"
-                "    gl_Position = (u_mvp * vec4((u_rect.xy + (uv * u_rect.zw)), 0.0, 1.0));\n"
-                "    v_uv = vec2(uv.x, uv.y);\n"
-                "}\n";
-
-            static const char* const fs_string =
-                "#version 410\n"
-                "in vec2 v_uv;\n"
-                "out vec4 f_color;\n"
-                "void main() {\n"
-                "    float vignette = pow(clamp(((v_uv.x * (1.0f - v_uv.x)) * (v_uv.y * (1.0f - v_uv.y)) * 36.0f), 0.0, 1.0), 4.0);\n"
-                "    f_color = vec4((v_uv.rg * vignette), 0.0, 1.0);\n"
-                "}\n";
-
-            try {
-                const GLuint vertex_shader = toolbox::OpenGLShader::create_from_source(GL_VERTEX_SHADER, vs_string);
-                const GLuint fragment_shader = toolbox::OpenGLShader::create_from_source(GL_FRAGMENT_SHADER, fs_string);
+            if (is_enabled) {
+                glEnable(capability);
+            }
+            else {
+                glDisable(capability);
+            }
+        }
+    };
 
-                toolbox::OpenGLProgram::attribute_location_list_t attribute_locations;
-                toolbox::OpenGLProgram::frag_data_location_list_t frag_data_locations;
-                const GLuint program = toolbox::OpenGLProgram::create_from_shaders(vertex_shader, fragment_shader, attribute_locations, frag_data_locations);
+    typedef toolbox::GLStateCache<WglApi> gl_state_t;
 
-                s_uniform_location_rect = glGetUniformLocation(program, "u_rect");
-                s_uniform_location_mvp = glGetUniformLocation(program, "u_mvp");
+    //------------------------------------------------------------------------------
+    // The fences behind toolbox::UniformRing.
+    struct WglFenceApi
+    {
+        typedef GLsync fence_t;
 
-                return program;
-            }
-            catch (std::exception& e) {
-                std::cerr << "Exception: " << e.what() << std::endl;
-            }
-            catch (...) {
-                std::cerr << "Exception: <unknown>!" << std::endl;
-            }
+        fence_t insert_fence() { return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
+        void delete_fence(fence_t fence) { glDeleteSync(fence); }
 
-            return 0;
+        bool is_signaled(fence_t fence)
+        {
+            const GLenum result = glClientWaitSync(fence, 0, 0);
+            return ((result == GL_ALREADY_SIGNALED) || (result == GL_CONDITION_SATISFIED));
         }
 
-        static void set_rect(const float* const ndc_rect)
+        void wait(fence_t fence)
         {
-            if (s_uniform_location_rect != -1) {
-                glUniform4fv(s_uniform_location_rect, 1, ndc_rect);
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
             }
         }
+    };
+
+    //------------------------------------------------------------------------------
+    // Per-frame uniforms of one context, written with plain stores into a buffer
+    // mapped persistently (GL_ARB_buffer_storage) and bound by offset. Without
+    // persistent mapping the same ring is filled with glBufferSubData().
+    class FrameUniforms
+    {
+    public:
+
+        static const size_t SIZE = (64 * 1024);
+        static const size_t FRAMES_IN_FLIGHT = 3;
 
-        static void set_mvp(const float* const mvp)
+        GLuint buffer() const { return m_buffer; }
+        const toolbox::UniformRing<WglFenceApi>* ring() const { return m_ring.get(); }
+
+        //------------------------------------------------------------------------------
+        // Creates the buffer on first use, with the context current.
+        void begin_frame()
         {
-            if (s_uniform_location_mvp != -1) {
-                glUniformMatrix4fv(s_uniform_location_mvp, 1, GL_FALSE, mvp);
+            if (!m_ring) {
+                create();
             }
+
+            m_ring->begin_frame();
         }
 
-        static void draw(GLuint& vao)
+        //------------------------------------------------------------------------------
+        // Offset of a copy of the data, valid until end_frame().
+        GLintptr write(const void* data, size_t size)
         {
-            if (!vao) {
-                glGenVertexArrays(1, &vao);
+            const size_t offset = m_ring->allocate(size);
+
+            if (m_mapping) {
+                std::memcpy((m_mapping + offset), data, size);
+            }
+            else {
+                glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+                glBufferSubData(GL_UNIFORM_BUFFER, GLintptr(offset), GLsizeiptr(size), data);
             }
 
-            glBindVertexArray(vao);
-            glDrawArrays(GL_POINTS, 0, (1024 * 1024));
+            return GLintptr(offset);
+        }
+
+        //------------------------------------------------------------------------------
+        // After the draws using the frame's uniforms.
+        void end_frame()
+        {
+            m_ring->end_frame();
         }
 
     private:
 
-        static GLint        s_uniform_location_rect;
-        static GLint        s_uniform_location_mvp;
-    };
+        void create()
+        {
+            GLint alignment = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
 
-    GLint RenderPoints::s_uniform_location_rect = -1;
-    GLint RenderPoints::s_uniform_location_mvp = -1;
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
 
-    //------------------------------------------------------------------------------
-    // Global data.
-    //------------------------------------------------------------------------------
+            if (GLEW_ARB_buffer_storage) {
+                const GLbitfield flags = (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+                glBufferStorage(GL_UNIFORM_BUFFER, SIZE, nullptr, flags);
+                m_mapping = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, SIZE, flags));
+            }
+            else {
+                glBufferData(GL_UNIFORM_BUFFER, SIZE, nullptr, GL_STREAM_DRAW);
+            }
 
-    float rect[4] = { -1.0, -1.0, 2.0, 2.0 };
+            m_ring.reset(new toolbox::UniformRing<WglFenceApi>(SIZE, size_t(std::max(alignment, 1)), FRAMES_IN_FLIGHT));
+        }
 
-    float mvp[16] = {
-        1.0, 0.0, 0.0, 0.0,
-        0.0, 1.0, 0.0, 0.0,
-        0.0, 0.0, 1.0, 0.0,
-        0.0, 0.0, 0.0, 1.0,
+        GLuint                                              m_buffer = 0;
+        uint8_t*                                            m_mapping = nullptr;
+        std::unique_ptr<toolbox::UniformRing<WglFenceApi>>  m_ring;
     };
 
-    uint8_t pixels[4][64 * 64 * 4];
+    //------------------------------------------------------------------------------
+    // Where the point grid's uniform block is bound (see RenderPoints).
+    const GLuint POINT_GRID_UNIFORM_BINDING = 0;
+    constexpr toolbox::ShaderName POINT_GRID_UNIFORM_BLOCK(toolbox::POINT_GRID_UNIFORM_BLOCK);
 
-    typedef struct rect_s {
-        long        m_x = 0;
-        long        m_y = 0;
-        long        m_width = 0;
-        long        m_height = 0;
-    } rect_t;
+    //------------------------------------------------------------------------------
+    // Compiles through the program cache on a context of its own, sharing with the
+    // contexts of the group (see toolbox::ProgramRegistry). Owns that context.
+    //
+    // The reflection of a program is the same in every context of the group, it is
+    // kept from creating the program (loaded from the cache with the binary) and
+    // handed to the contexts without asking OpenGL again.
+    struct WglProgramBackend
+    {
+        typedef GLuint program_t;
+        typedef std::shared_ptr<const toolbox::ProgramReflection> reflection_t;
 
-    rect_t virtual_screen;
-    long num_virtual_screen_monitors = 0;
-    std::vector<rect_t> virtual_screen_monitors;
+        struct Reflections
+        {
+            std::mutex                          m_mutex;
+            std::map<GLuint, reflection_t>      m_reflections;
+        };
 
-    //------------------------------------------------------------------------------
-    // Windows API
-    //------------------------------------------------------------------------------
+        HDC                             m_display_context = NULL;
+        HGLRC                           m_gl_context = NULL;
+        std::shared_ptr<Reflections>    m_reflections = std::make_shared<Reflections>();
 
-    int windows()
-    {
-        std::cout << "[Windows API]" << std::endl;
+        void begin_loader()
+        {
+            if (wglMakeCurrent(m_display_context, m_gl_context) != TRUE) {
+                throw std::runtime_error("Failed to make the program loader's OpenGL context current!");
+            }
+        }
+
+        void end_loader()
+        {
+            wglMakeCurrent(NULL, NULL);
+            wglDeleteContext(m_gl_context);
+        }
 
         //------------------------------------------------------------------------------
-        // Get the Virtual Screen geometry.
-        virtual_screen.m_x = GetSystemMetrics(SM_XVIRTUALSCREEN);
-        virtual_screen.m_y = GetSystemMetrics(SM_YVIRTUALSCREEN);
-        virtual_screen.m_width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
-        virtual_screen.m_height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
-        num_virtual_screen_monitors = GetSystemMetrics(SM_CMONITORS);
+        // The program cache deletes the shaders once linked. The other contexts may
+        // only use the program once it is complete, hence the glFinish().
+        program_t create_program(const std::string& vertex_shader, const std::string& fragment_shader)
+        {
+            toolbox::OpenGLProgram::attribute_location_list_t attribute_locations;
+            toolbox::OpenGLProgram::frag_data_location_list_t frag_data_locations;
+            std::shared_ptr<toolbox::ProgramReflection> reflection = std::make_shared<toolbox::ProgramReflection>();
+            const GLuint program = program_cache().create_from_sources(vertex_shader, fragment_shader, attribute_locations, frag_data_locations, reflection.get());
+            const GLuint block_index = reflection->uniform_block_index(POINT_GRID_UNIFORM_BLOCK);
+
+            if (block_index != GL_INVALID_INDEX) {
+                glUniformBlockBinding(program, block_index, POINT_GRID_UNIFORM_BINDING);
+            }
 
-        std::cout << std::endl;
-        std::cout << "Virtual Screen origin: " << virtual_screen.m_x << " / " << virtual_screen.m_y << std::endl;
-        std::cout << "Virtual Screen size: " << virtual_screen.m_width << " x " << virtual_screen.m_height << std::endl;
-        std::cout << "Virtual Screen spans " << num_virtual_screen_monitors << " monitor(s)" << std::endl;
+            glFinish();
+
+            std::lock_guard<std::mutex> lock(m_reflections->m_mutex);
+            m_reflections->m_reflections[program] = std::move(reflection);
+            return program;
+        }
+
+        void delete_program(program_t program)
+        {
+            glDeleteProgram(program);
+
+            std::lock_guard<std::mutex> lock(m_reflections->m_mutex);
+            m_reflections->m_reflections.erase(program);
+        }
 
         //------------------------------------------------------------------------------
-        // Enumerate display devices.
-        std::cout << std::endl;
+        // Only programs created elsewhere are reflected in the calling context.
+        reflection_t reflect(program_t program)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_reflections->m_mutex);
+                const auto it = m_reflections->m_reflections.find(program);
 
-        DISPLAY_DEVICE display_device = {};
-        display_device.cb = sizeof(display_device);
+                if (it != m_reflections->m_reflections.end()) {
+                    return it->second;
+                }
+            }
+
+            std::shared_ptr<toolbox::ProgramReflection> reflection = std::make_shared<toolbox::ProgramReflection>();
+            toolbox::OpenGLProgram::reflect(program, toolbox::OpenGLProgram::frag_data_location_list_t(), *reflection);
+            return reflection;
+        }
+    };
 
-        DWORD display_device_index = 0;
+    typedef toolbox::ProgramRegistry<WglProgramBackend> program_registry_t;
 
-        while (EnumDisplayDevices(nullptr, display_device_index, &display_device, 0)) {
-            std::cout << "Display " << display_device.DeviceName << ", " << display_device.DeviceString << std::endl;
-            std::cout << "  " << display_device.DeviceID << std::endl;
-            std::cout << "  " << display_device.DeviceKey << std::endl;
-            std::cout << "  "; print_display_flags_to_stream(std::cout, display_device.StateFlags); std::cout << std::endl;
+    //------------------------------------------------------------------------------
+    // The registry of the share group of the given context, with a loader context
+    // on the given display context. Null if the loader context failed.
+    std::unique_ptr<program_registry_t> create_program_registry(HDC display_context, HGLRC shared_gl_context)
+    {
+        WglProgramBackend backend;
+        backend.m_display_context = display_context;
+        backend.m_gl_context = wglCreateContext(display_context);
 
-            ++display_device_index;
+        if (backend.m_gl_context == NULL) {
+            return nullptr;
+        }
 
-            DEVMODE device_mode = {};
-            device_mode.dmSize = sizeof(device_mode);
+        if (wglShareLists(shared_gl_context, backend.m_gl_context) != TRUE) {
+            wglDeleteContext(backend.m_gl_context);
+            return nullptr;
+        }
 
-            //------------------------------------------------------------------------------
-            // Enumerate/Get current display settings.
-            if ((0)) {
-                DWORD mode_index = 0;
+        return std::unique_ptr<program_registry_t>(new program_registry_t(backend));
+    }
 
-                while (EnumDisplaySettingsEx(display_device.DeviceName, mode_index, &device_mode, 0)) {
-                    std::cout << "  " << device_mode.dmPelsWidth << " x " << device_mode.dmPelsHeight << " @ " << device_mode.dmDisplayFrequency << " Hz" << std::endl;
-                    ++mode_index;
-                }
-            }
-            else {
-                if (EnumDisplaySettingsEx(display_device.DeviceName, ENUM_CURRENT_SETTINGS, &device_mode, 0)) {
-                    std::cout << "  " << device_mode.dmPelsWidth << " x " << device_mode.dmPelsHeight << " @ " << device_mode.dmDisplayFrequency << " Hz" << std::endl;
-                }
-            }
+    //------------------------------------------------------------------------------
+    // Load the points shaders from points.vert and points.frag in this directory
+    // (see shaders/) instead of generating them, and reload them while running
+    // whenever they change, if not empty.
+    std::string shader_directory;
+
+    //------------------------------------------------------------------------------
+    // The contents of a text file, false if it could not be read.
+    bool read_text_file(const std::string& path, std::string& text)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            return false;
         }
 
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+        return true;
+    }
+
+    class RenderPoints
+    {
+    public:
+
         //------------------------------------------------------------------------------
-        // Enumerate display monitors.
-        //
-        // Each physical display is represented by a monitor handle of type HMONITOR. 
-        std::cout << std::endl;
+        // The built-in shaders of the grid's variant (see toolbox::PointShaderKey), or
+        // those loaded from the shader directory if given, compiled by the share
+        // group's loader thread once requested. Named after the variant, so grids of
+        // the same variant share the program.
+        static void request_program(program_registry_t& programs, const toolbox::PointGrid& grid)
+        {
+            request_program(programs, toolbox::point_shader_key(grid));
+        }
 
-        if (EnumDisplayMonitors(nullptr, nullptr, [](HMONITOR monitor, HDC display_context, LPRECT virtual_screen_rect, LPARAM user_data) {
-            //------------------------------------------------------------------------------
-            // Add to list of monitors making up the virtual screen.
-            rect_t virtual_screen_monitor = {};
+        static void request_program(program_registry_t& programs, const toolbox::PointShaderKey& key)
+        {
             {
-                virtual_screen_monitor.m_x = virtual_screen_rect->left;
-                virtual_screen_monitor.m_y = virtual_screen_rect->top;
-                virtual_screen_monitor.m_width = (virtual_screen_rect->right - virtual_screen_rect->left);
-                virtual_screen_monitor.m_height = (virtual_screen_rect->bottom - virtual_screen_rect->top);
+                RequestedVariants& requested = requested_variants();
+                std::lock_guard<std::mutex> lock(requested.m_mutex);
+                requested.m_keys.emplace(toolbox::point_shader_key_to_string(key), key);
             }
 
-            virtual_screen_monitors.push_back(virtual_screen_monitor);
+            std::string vertex_shader;
+            std::string fragment_shader;
 
-            //------------------------------------------------------------------------------
-            // Get additional monitor info.
-            MONITORINFOEX monitor_info = {};
-            monitor_info.cbSize = sizeof(monitor_info);
+            if (!load_shaders(key, vertex_shader, fragment_shader)) {
+                vertex_shader = toolbox::point_vertex_shader(key);
+                fragment_shader = toolbox::point_fragment_shader(key);
+            }
 
-            bool is_primary = false;
+            programs.request(toolbox::point_shader_key_to_string(key), vertex_shader, fragment_shader);
+        }
 
-            if (GetMonitorInfo(monitor, &monitor_info) != 0) {
-                std::cout << "Monitor " << monitor_info.szDevice << ": ";
-                is_primary = ((monitor_info.dwFlags & MONITORINFOF_PRIMARY) == MONITORINFOF_PRIMARY);
-            }
-            else {
-                std::cout << "Monitor 0x" << monitor << ": ";
+        //------------------------------------------------------------------------------
+        // Request the variants in every share group before waiting for any, so the
+        // groups' loaders compile them in parallel, and wait for all of them. For
+        // compiling what a scenario matrix needs up front, not during its frames.
+        static void precompile_programs(const std::vector<program_registry_t*>& groups, const std::vector<toolbox::PointShaderKey>& keys)
+        {
+            const auto start_time = std::chrono::steady_clock::now();
+
+            for (program_registry_t* const programs : groups) {
+                for (const toolbox::PointShaderKey& key : keys) {
+                    request_program(*programs, key);
+                }
             }
 
-            std::cout << "(" << virtual_screen_monitor.m_x << " / " << virtual_screen_monitor.m_y << ") [" << virtual_screen_monitor.m_width << " x " << virtual_screen_monitor.m_height << "]";
+            size_t num_failed = 0;
 
-            if (is_primary) {
-                std::cout << " (primary)";
+            for (program_registry_t* const programs : groups) {
+                for (const toolbox::PointShaderKey& key : keys) {
+                    try {
+                        programs->program(toolbox::point_shader_key_to_string(key));
+                    }
+                    catch (std::exception& e) {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                        ++num_failed;
+                    }
+                }
             }
 
-            std::cout << std::endl;
+            const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
 
-            return TRUE;
-        }, 0) == 0)
-        {
-            std::cerr << "Error: Failed to enumerate monitors!" << std::endl;
-            return EXIT_FAILURE;
+            std::cout << "Compiled " << keys.size() << " shader variant(s) for " << groups.size() << " share group(s) in "
+                << std::fixed << std::setprecision(1) << milliseconds << " ms, " << num_failed << " failed" << std::endl;
         }
 
-        if (virtual_screen_monitors.size() != num_virtual_screen_monitors) {
-            std::cerr << "Warning: EnumDisplayMonitors() returned more monitors than GetSystemMetrics() reported to be part of the virtual screen!" << std::endl;
-        }
+        static std::string vertex_shader_path() { return (shader_directory + "\\points.vert"); }
+        static std::string fragment_shader_path() { return (shader_directory + "\\points.frag"); }
 
         //------------------------------------------------------------------------------
-        // ...
-        return EXIT_SUCCESS;
-    }
-
-    //------------------------------------------------------------------------------
-    // NVAPI based GPU query
-    //------------------------------------------------------------------------------
+        // The points shaders from the shader directory with the variant's defines,
+        // false if there is none or either shader could not be read.
+        static bool load_shaders(const toolbox::PointShaderKey& key, std::string& vertex_shader, std::string& fragment_shader)
+        {
+            std::string vertex_source;
+            std::string fragment_source;
 
-    int nvapi()
-    {
-        std::cout << "[NVAPI]" << std::endl;
+            if (shader_directory.empty() || !read_text_file(vertex_shader_path(), vertex_source) || !read_text_file(fragment_shader_path(), fragment_source)) {
+                return false;
+            }
 
-        //------------------------------------------------------------------------------
-        // Initialize NVAPI.
-        if (NvAPI_Initialize() != NVAPI_OK) {
-            std::cerr << "Error: Failed to initialize NVAPI!" << std::endl;
-            return EXIT_FAILURE;
+            vertex_shader = toolbox::point_shader_with_defines(key, vertex_source);
+            fragment_shader = toolbox::point_shader_with_defines(key, fragment_source);
+            return true;
         }
 
         //------------------------------------------------------------------------------
-        // Print interface version string.
-        NvAPI_ShortString interface_version = {};
+        // Recompile every variant requested from the registry (e.g. all those of a
+        // scenario matrix) from the shader directory in the background.
+        static void reload_programs(program_registry_t& programs)
+        {
+            std::vector<toolbox::PointShaderKey> keys;
 
-        if (NvAPI_GetInterfaceVersionString(interface_version) == NVAPI_OK) {
-            std::cout << std::endl;
-            std::cout << "NVAPI interface version: " << interface_version << std::endl;
+            {
+                RequestedVariants& requested = requested_variants();
+                std::lock_guard<std::mutex> lock(requested.m_mutex);
+
+                for (const program_registry_t::ProgramStatistics& program : programs.program_statistics()) {
+                    const auto it = requested.m_keys.find(program.m_name);
+
+                    if (it != requested.m_keys.end()) {
+                        keys.push_back(it->second);
+                    }
+                }
+            }
+
+            for (const toolbox::PointShaderKey& key : keys) {
+                reload_program(programs, key);
+            }
         }
 
         //------------------------------------------------------------------------------
-        // Get brief of current mosaic topology.
-        NV_MOSAIC_TOPO_BRIEF mosaic_topology = {};
-        mosaic_topology.version = NVAPI_MOSAIC_TOPO_BRIEF_VER;
+        // Recompile the variant's program from the shader directory in the background,
+        // the render threads swap it in at their next frame (see ProgramSwapper). If
+        // the shaders fail, the program in use stays.
+        static void reload_program(program_registry_t& programs, const toolbox::PointShaderKey& key)
+        {
+            const std::string name = toolbox::point_shader_key_to_string(key);
+            std::string vertex_shader;
+            std::string fragment_shader;
 
-        NV_MOSAIC_DISPLAY_SETTING mosaic_display_settings = {};
-        mosaic_display_settings.version = NVAPI_MOSAIC_DISPLAY_SETTING_VER;
+            if (!load_shaders(key, vertex_shader, fragment_shader)) {
+                std::cerr << "Error: Failed to read the shaders of program " << name << " from " << shader_directory << ", keeping the one in use" << std::endl;
+                return;
+            }
 
-        NvS32 mosaic_overlap_x = 0;
-        NvS32 mosaic_overlap_y = 0;
+            const auto start_time = std::chrono::steady_clock::now();
 
-        if (NvAPI_Mosaic_GetCurrentTopo(&mosaic_topology, &mosaic_display_settings, &mosaic_overlap_x, &mosaic_overlap_y) != NVAPI_OK) {
-            std::cerr << "Error: Failed to get mosaic topology!" << std::endl;
-            return EXIT_FAILURE;
+            programs.reload(name, vertex_shader, fragment_shader, [name, start_time](const std::string& error) {
+                const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+                std::ostringstream report;
+
+                if (error.empty()) {
+                    report << "Reloaded program " << name << " in " << std::fixed << std::setprecision(1) << milliseconds << " ms" << std::endl;
+                    std::cout << report.str();
+                }
+                else {
+                    report << "Error: Reloading program " << name << " failed, keeping the one in use: " << error << std::endl;
+                    std::cerr << report.str();
+                }
+            });
         }
 
         //------------------------------------------------------------------------------
-        // If a topology is enabled show which one.
-        std::cout << std::endl;
+        // Waits for the requested program and checks its uniform block in the calling
+        // context (the index of which within the group is given), 0 if either failed.
+        // Optionally returns when the program was linked.
+        static GLuint get_program(program_registry_t& programs, size_t context_index, const toolbox::PointGrid& grid, std::chrono::steady_clock::time_point* linked_at = nullptr)
+        {
+            try {
+                const std::string name = toolbox::point_shader_key_to_string(toolbox::point_shader_key(grid));
+                const GLuint program = programs.program(name, linked_at);
+                const WglProgramBackend::reflection_t reflection = programs.reflection(context_index, name);
+                const toolbox::ProgramReflection::UniformBlock* const block = reflection->find_uniform_block(POINT_GRID_UNIFORM_BLOCK);
+
+                if (!block || (block->m_data_size != GLint(sizeof(toolbox::PointGridUniforms)))) {
+                    throw std::runtime_error("Unexpected size of the uniform block of program " + name);
+                }
 
-        if (mosaic_topology.enabled) {
-            std::cout << "Mosaic is ENABLED: ";
-
-            switch (mosaic_topology.topo) {
-            case NV_MOSAIC_TOPO_1x2_BASIC: std::cout << "1x2"; break;
-            case NV_MOSAIC_TOPO_2x1_BASIC: std::cout << "2x1"; break;
-            case NV_MOSAIC_TOPO_1x3_BASIC: std::cout << "1x3"; break;
-            case NV_MOSAIC_TOPO_3x1_BASIC: std::cout << "3x1"; break;
-            case NV_MOSAIC_TOPO_1x4_BASIC: std::cout << "1x4"; break;
-            case NV_MOSAIC_TOPO_4x1_BASIC: std::cout << "4x1"; break;
-            case NV_MOSAIC_TOPO_2x2_BASIC: std::cout << "2x2"; break;
-            case NV_MOSAIC_TOPO_2x3_BASIC: std::cout << "2x3"; break;
-            case NV_MOSAIC_TOPO_2x4_BASIC: std::cout << "2x4"; break;
-            case NV_MOSAIC_TOPO_3x2_BASIC: std::cout << "3x2"; break;
-            case NV_MOSAIC_TOPO_4x2_BASIC: std::cout << "4x2"; break;
-            case NV_MOSAIC_TOPO_1x5_BASIC: std::cout << "1x5"; break;
-            case NV_MOSAIC_TOPO_1x6_BASIC: std::cout << "1x6"; break;
-            case NV_MOSAIC_TOPO_7x1_BASIC: std::cout << "1x7"; break;
-            case NV_MOSAIC_TOPO_1x2_PASSIVE_STEREO: std::cout << "1x2 passive stereo"; break;
-            case NV_MOSAIC_TOPO_2x1_PASSIVE_STEREO: std::cout << "2x1 passive stereo"; break;
-            case NV_MOSAIC_TOPO_1x3_PASSIVE_STEREO: std::cout << "1x3 passive stereo"; break;
-            case NV_MOSAIC_TOPO_3x1_PASSIVE_STEREO: std::cout << "3x1 passive stereo"; break;
-            case NV_MOSAIC_TOPO_1x4_PASSIVE_STEREO: std::cout << "1x4 passive stereo"; break;
-            case NV_MOSAIC_TOPO_4x1_PASSIVE_STEREO: std::cout << "4x1 passive stereo"; break;
-            case NV_MOSAIC_TOPO_2x2_PASSIVE_STEREO: std::cout << "2x2 passive stereo"; break;
-            default: std::cout << "unknown topology"; break;
+                return program;
+            }
+            catch (std::exception& e) {
+                std::cerr << "Exception: " << e.what() << std::endl;
+            }
+            catch (...) {
+                std::cerr << "Exception: <unknown>!" << std::endl;
             }
 
-            std::cout << std::endl;
+            return 0;
         }
-        else if (mosaic_topology.isPossible) {
-            std::cout << "Mosaic is DISABLED but supported" << std::endl;
+
+        //------------------------------------------------------------------------------
+        // Of the frame, written to the context's uniform ring and bound by offset.
+        static void set_uniforms(gl_state_t& gl_state, FrameUniforms& uniforms, const float* const ndc_rect, const float* const mvp)
+        {
+            toolbox::PointGridUniforms values;
+            std::copy(ndc_rect, (ndc_rect + 4), values.m_rect);
+            std::copy(mvp, (mvp + 16), values.m_mvp);
+
+            const GLintptr offset = uniforms.write(&values, sizeof(values));
+            gl_state.bind_uniform_buffer_range(POINT_GRID_UNIFORM_BINDING, uniforms.buffer(), offset, sizeof(values));
         }
 
         //------------------------------------------------------------------------------
-        // Show current display grid (mosaic) configuration, including where mosaic is
-        // disabled and each display is a 1x1 grid.
-        if (mosaic_topology.isPossible) {
-            NvU32 num_grids = 0;
+        // Draw only the rows (or parts of) the grid that can land in the viewport
+        // (see toolbox::cull_point_grid()). The ranges are the caller's so their
+        // storage is reused from frame to frame.
+        //
+        // The margin is a pixel, grown to the grid's point size.
+        static void draw(gl_state_t& gl_state, GLuint& vao, const toolbox::PointGrid& grid, const float* const ndc_rect, const float* const mvp, const float* const viewport, float margin,
+            toolbox::PointGridRanges& ranges)
+        {
+            toolbox::cull_point_grid(grid, ndc_rect, mvp, viewport, (margin * grid.m_point_size), ranges);
 
-            if (NvAPI_Mosaic_EnumDisplayGrids(nullptr, &num_grids) != NVAPI_OK) {
-                std::cerr << "Error: Failed to enumerate display grids!" << std::endl;
-                return EXIT_FAILURE;
+            if (ranges.empty()) {
+                return;
             }
 
-            std::vector<NV_MOSAIC_GRID_TOPO> display_grids(num_grids);
+            if (!vao) {
+                glGenVertexArrays(1, &vao);
+            }
 
-            std::for_each(begin(display_grids), end(display_grids), [](NV_MOSAIC_GRID_TOPO& display_grid) {
-                display_grid.version = NV_MOSAIC_GRID_TOPO_VER;
-            });
+            gl_state.bind_vertex_array(vao);
+            gl_state.enable_program_point_size(true);
 
-            if (NvAPI_Mosaic_EnumDisplayGrids(display_grids.data(), &num_grids) != NVAPI_OK) {
-                std::cerr << "Error: Failed to enumerate display grids!" << std::endl;
-                return EXIT_FAILURE;
+            if (ranges.size() == 1) {
+                glDrawArrays(GL_POINTS, ranges.m_firsts[0], ranges.m_counts[0]);
             }
+            else {
+                glMultiDrawArrays(GL_POINTS, ranges.m_firsts.data(), ranges.m_counts.data(), GLsizei(ranges.size()));
+            }
+        }
+
+    private:
 
-            assert(display_grids.size() >= num_grids);  // In some cases the initially reported number appears to be conservative!
-            display_grids.resize(num_grids);
+        //------------------------------------------------------------------------------
+        // The keys of the variants requested, of any share group, by program name.
+        struct RequestedVariants
+        {
+            std::mutex                                      m_mutex;
+            std::map<std::string, toolbox::PointShaderKey>  m_keys;
+        };
+
+        static RequestedVariants& requested_variants()
+        {
+            static RequestedVariants requested;
+            return requested;
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    // Swaps in the programs reloaded by the registry (see --shaders) at a frame
+    // boundary of a render thread. Checking costs an atomic load per frame, a swap
+    // the registry's lock and the reflection of the new program, never a compile.
+    struct ProgramSwapper
+    {
+        uint64_t                                m_generation = 0;
+        uint64_t                                m_num_swaps = 0;
+        std::chrono::steady_clock::duration     m_max_latency {};      // From linking to swapping in.
+        std::chrono::steady_clock::duration     m_max_swap_time {};
+
+        void swap(program_registry_t& programs, size_t context_index, const toolbox::PointGrid& grid, GLuint& program)
+        {
+            const uint64_t generation = programs.generation();
+
+            if (generation == m_generation) {
+                return;
+            }
+
+            m_generation = generation;
+
+            const auto start_time = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::time_point linked_at;
+            const GLuint reloaded_program = RenderPoints::get_program(programs, context_index, grid, &linked_at);
+
+            if ((reloaded_program == 0) || (reloaded_program == program)) {
+                return;
+            }
+
+            program = reloaded_program;
+            ++m_num_swaps;
+            m_max_latency = std::max(m_max_latency, (start_time - linked_at));
+            m_max_swap_time = std::max(m_max_swap_time, (std::chrono::steady_clock::now() - start_time));
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    // Global data.
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // What the points workload shows. Published by the main thread, stamped with
+    // the first frame it applies to, and picked up by every render thread at the
+    // start of the frame (see toolbox::SnapshotRing).
+    struct Scene
+    {
+        float   m_rect[4];
+        float   m_mvp[16];
+    };
+
+    const Scene INITIAL_SCENE = {
+        { -1.0, -1.0, 2.0, 2.0 },
+        {
+            1.0, 0.0, 0.0, 0.0,
+            0.0, 1.0, 0.0, 0.0,
+            0.0, 0.0, 1.0, 0.0,
+            0.0, 0.0, 0.0, 1.0,
+        }
+    };
+
+    toolbox::SnapshotRing<Scene> scene_state;
+
+    uint8_t pixels[4][64 * 64 * 4];
+
+    typedef struct rect_s {
+        long        m_x = 0;
+        long        m_y = 0;
+        long        m_width = 0;
+        long        m_height = 0;
+    } rect_t;
+
+    rect_t virtual_screen;
+    long num_virtual_screen_monitors = 0;
+    std::vector<rect_t> virtual_screen_monitors;
+
+    //------------------------------------------------------------------------------
+    // Frame pacing per monitor (see toolbox::create_frame_pacer()), the last entry
+    // applies to all remaining monitors.
+    std::vector<std::string> frame_pacing_modes = { "free-run" };
+
+    //------------------------------------------------------------------------------
+    // Lock-step the render threads before swapping every this many frames, 0 lets
+    // them run independently after the start.
+    size_t frame_barrier_interval = 0;
+
+    //------------------------------------------------------------------------------
+    // Placement of the render threads relative to their GPUs.
+    toolbox::AffinityMode render_thread_affinity = toolbox::AffinityMode::none;
+
+    //------------------------------------------------------------------------------
+    // Where the on-screen render threads' frame timings go.
+    enum class FrameTimingOutput
+    {
+        none,
+        file,
+        console
+    };
+
+    FrameTimingOutput frame_timing_output = FrameTimingOutput::file;
+
+    //------------------------------------------------------------------------------
+    // What the on-screen render threads encode per frame (see toolbox::workload_flags_t).
+    uint32_t frame_workload = toolbox::WORKLOAD_SCISSOR_CLEAR;
+
+    //------------------------------------------------------------------------------
+    // The points drawn by the points workload.
+    toolbox::PointGrid point_grid = toolbox::StaticPointGrid<1024, 1024>::grid();
+
+    //------------------------------------------------------------------------------
+    // Instead of the on-screen run, find the largest point grid (of the above's
+    // point size and shading) every monitor sustains at its refresh rate.
+    bool run_point_grid_sweep = false;
+
+    //------------------------------------------------------------------------------
+    // Rotate the scene from the main thread during the on-screen run, publishing
+    // at about 1 kHz this many frames ahead of the render threads.
+    bool animate_scene = false;
+    const uint64_t SCENE_LEAD_FRAMES = 2;
+
+    //------------------------------------------------------------------------------
+    // Render offscreen, one context per GPU, before the on-screen run.
+    bool run_offscreen_benchmark = false;
+
+    //------------------------------------------------------------------------------
+    // Run this scenario matrix (see toolbox::load_scenario_matrix()) instead of the
+    // on-screen run, if not empty.
+    std::string scenario_matrix_path;
+
+    //------------------------------------------------------------------------------
+    // Where the display topology is cached between runs, empty to always enumerate.
+    std::string display_topology_snapshot_path = "TestMultiGpuMultiMonitor.topology";
+
+    //------------------------------------------------------------------------------
+    // Times startup from process start to the first frame. Constructed during
+    // static initialization, which is close enough to the process start.
+    toolbox::StartupOrchestrator startup;
+
+    //------------------------------------------------------------------------------
+    // Set by the "cuda" startup task.
+    bool is_cuda_available = false;
+
+    //------------------------------------------------------------------------------
+    // Scheduling class per thread role.
+    toolbox::SchedulingConfig render_thread_scheduling;
+    toolbox::SchedulingConfig flusher_thread_scheduling;
+    toolbox::SchedulingConfig main_thread_scheduling;
+
+    //------------------------------------------------------------------------------
+    // NUMA node of the GPU of the current OpenGL context, -1 if unknown.
+    int32_t current_gpu_numa_node()
+    {
+        unsigned int cuda_device_count = 0;
+        CUdevice cuda_device = -1;
+
+        if ((cuGLGetDevices(&cuda_device_count, &cuda_device, 1, CU_GL_DEVICE_LIST_ALL) != CUDA_SUCCESS) || (cuda_device_count == 0)) {
+            return -1;
+        }
+
+        int pci_domain = 0;
+        int pci_bus = 0;
+        int pci_device = 0;
+
+        if ((cuDeviceGetAttribute(&pci_domain, CU_DEVICE_ATTRIBUTE_PCI_DOMAIN_ID, cuda_device) != CUDA_SUCCESS) ||
+            (cuDeviceGetAttribute(&pci_bus, CU_DEVICE_ATTRIBUTE_PCI_BUS_ID, cuda_device) != CUDA_SUCCESS) ||
+            (cuDeviceGetAttribute(&pci_device, CU_DEVICE_ATTRIBUTE_PCI_DEVICE_ID, cuda_device) != CUDA_SUCCESS)) {
+            return -1;
+        }
+
+        return toolbox::pci_device_numa_node(uint32_t(pci_domain), uint32_t(pci_bus), uint32_t(pci_device));
+    }
+
+    //------------------------------------------------------------------------------
+    // Identify the calling render thread, its monitor and GPU for its frame trace.
+    // The epoch is the start time shared by all render threads. Requires the
+    // thread's OpenGL context to be current.
+    toolbox::FrameTraceHeader make_frame_trace_header(size_t thread_index, HDC display_context, std::chrono::steady_clock::time_point epoch)
+    {
+        toolbox::FrameTraceHeader header;
+
+        header.m_epoch_ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(epoch.time_since_epoch()).count());
+        header.m_thread_index = uint32_t(thread_index);
+        header.m_monitor_index = uint32_t(thread_index);
+
+        if (thread_index < virtual_screen_monitors.size()) {
+            header.m_monitor_x = int32_t(virtual_screen_monitors[thread_index].m_x);
+            header.m_monitor_y = int32_t(virtual_screen_monitors[thread_index].m_y);
+            header.m_monitor_width = int32_t(virtual_screen_monitors[thread_index].m_width);
+            header.m_monitor_height = int32_t(virtual_screen_monitors[thread_index].m_height);
+        }
+
+        const int refresh_rate = GetDeviceCaps(display_context, VREFRESH);
+
+        if (refresh_rate > 1) {   // 0 and 1 indicate the hardware default.
+            header.m_refresh_rate_mhz = uint32_t(refresh_rate * 1000);
+        }
+
+        unsigned int cuda_device_count = 0;
+        CUdevice cuda_device = -1;
+
+        if ((cuGLGetDevices(&cuda_device_count, &cuda_device, 1, CU_GL_DEVICE_LIST_ALL) == CUDA_SUCCESS) && (cuda_device_count > 0)) {
+            header.m_gpu_index = int32_t(cuda_device);
+        }
+
+        const char* const renderer = (const char*)glGetString(GL_RENDERER);
+
+        if (renderer) {
+            strncpy(header.m_gpu_name, renderer, (sizeof(header.m_gpu_name) - 1));
+        }
+
+        return header;
+    }
+
+    //------------------------------------------------------------------------------
+    // The part of the virtual screen a context shows, in NDC of the virtual screen,
+    // and the points culled to it.
+    struct PointsView
+    {
+        float                       m_viewport[4] = { -1.0f, -1.0f, 1.0f, 1.0f };
+        float                       m_margin = 0.0f;    // About a pixel, for the point size.
+        toolbox::PointGridRanges    m_ranges;
+    };
+
+    //------------------------------------------------------------------------------
+    // View of the monitor within the virtual screen, all of it if unknown.
+    PointsView monitor_points_view(size_t monitor_index)
+    {
+        PointsView view;
+
+        if ((monitor_index >= virtual_screen_monitors.size()) || (virtual_screen.m_width <= 0) || (virtual_screen.m_height <= 0)) {
+            return view;
+        }
+
+        const rect_t& monitor = virtual_screen_monitors[monitor_index];
+        const float width = float(virtual_screen.m_width);
+        const float height = float(virtual_screen.m_height);
+
+        //------------------------------------------------------------------------------
+        // Screen coordinates grow downwards, NDC upwards.
+        view.m_viewport[0] = (-1.0f + ((2.0f * (monitor.m_x - virtual_screen.m_x)) / width));
+        view.m_viewport[1] = (1.0f - ((2.0f * ((monitor.m_y + monitor.m_height) - virtual_screen.m_y)) / height));
+        view.m_viewport[2] = (-1.0f + ((2.0f * ((monitor.m_x + monitor.m_width) - virtual_screen.m_x)) / width));
+        view.m_viewport[3] = (1.0f - ((2.0f * (monitor.m_y - virtual_screen.m_y)) / height));
+        view.m_margin = std::max((2.0f / width), (2.0f / height));
+
+        return view;
+    }
+
+    //------------------------------------------------------------------------------
+    // Kept by a render thread for its context from frame to frame.
+    struct RenderContextState
+    {
+        gl_state_t      m_gl_state;
+        GLuint          m_vao = 0;
+        PointsView      m_points_view;
+        FrameUniforms   m_uniforms;
+        Scene           m_scene = INITIAL_SCENE;
+        uint64_t        m_scene_version = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Publish the scene rotated by the time since the first frame, stamped
+    // SCENE_LEAD_FRAMES ahead of the frame the render threads should be at so they
+    // all switch to it at the same frame.
+    void publish_animated_scene(std::chrono::steady_clock::time_point first_frame_time, double frames_per_second)
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - first_frame_time).count();
+        const double angle = (0.25 * seconds);    // A turn in about 25 seconds.
+
+        Scene scene = INITIAL_SCENE;
+        scene.m_mvp[0] = float(std::cos(angle));
+        scene.m_mvp[1] = float(std::sin(angle));
+        scene.m_mvp[4] = float(-std::sin(angle));
+        scene.m_mvp[5] = float(std::cos(angle));
+
+        scene_state.publish(scene, (uint64_t(std::max(0.0, (seconds * frames_per_second))) + SCENE_LEAD_FRAMES));
+    }
+
+    //------------------------------------------------------------------------------
+    // Encode one frame of the given workload (see toolbox::workload_flags_t) into
+    // the current context, drawing the points of its view with the given program.
+    void encode_frame(size_t frame_index, uint32_t workload, GLuint program, const toolbox::PointGrid& grid, RenderContextState& context)
+    {
+        gl_state_t& gl_state = context.m_gl_state;
+
+        //------------------------------------------------------------------------------
+        // The scene stamped for this frame, the previous one if it is not available
+        // (yet or any more).
+        scene_state.read_at(frame_index, context.m_scene, &context.m_scene_version);
+
+        const float* const rect = context.m_scene.m_rect;
+        const float* const mvp = context.m_scene.m_mvp;
+
+        if (workload & toolbox::WORKLOAD_CLEAR) {
+            gl_state.enable_scissor_test(false);
+            gl_state.clear_color(0.2f, 0.2f, 0.2f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        if (workload & toolbox::WORKLOAD_SCISSOR_CLEAR) {
+            switch (frame_index % 8) {
+            case 0:
+                gl_state.enable_scissor_test(true);
+                gl_state.scissor(0, 256, 2048, 256);
+                gl_state.clear_color(1.0f, 0.0f, 0.0f, 1.0f);
+                break;
+
+            case 1:
+                gl_state.enable_scissor_test(true);
+                gl_state.scissor(0, 512, 2048, 256);
+                gl_state.clear_color(0.0f, 1.0f, 0.0f, 1.0f);
+                break;
+
+            case 2:
+                gl_state.enable_scissor_test(true);
+                gl_state.scissor(0, 768, 2048, 256);
+                gl_state.clear_color(0.0f, 0.0f, 1.0f, 1.0f);
+                break;
+
+            case 3:
+                gl_state.enable_scissor_test(true);
+                gl_state.scissor(0, 64, 2048, 64);
+                gl_state.clear_color(0.0f, 0.0f, 1.0f, 1.0f);
+                break;
+
+            case 4:
+                gl_state.enable_scissor_test(true);
+                gl_state.scissor(0, 128, 2048, 64);
+                gl_state.clear_color(0.0f, 1.0f, 1.0f, 1.0f);
+                break;
+
+            case 5:
+                gl_state.enable_scissor_test(true);
+                gl_state.scissor(0, 192, 2048, 64);
+                gl_state.clear_color(1.0f, 0.0f, 1.0f, 1.0f);
+                break;
+
+            default:
+                gl_state.enable_scissor_test(false);
+                gl_state.clear_color(0.2f, 0.2f, 0.2f, 1.0f);
+                break;
+            }
+
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        if (workload & toolbox::WORKLOAD_VALIDATE) {
+            toolbox::OpenGLProgram::validate(program);
+        }
+
+        if (workload & toolbox::WORKLOAD_POINTS) {
+            gl_state.enable_scissor_test(false);
+            gl_state.use_program(program);
+
+            float view_mvp[16];
+            toolbox::viewport_mvp(context.m_points_view.m_viewport, mvp, view_mvp);
+
+            context.m_uniforms.begin_frame();
+            RenderPoints::set_uniforms(gl_state, context.m_uniforms, rect, view_mvp);
+            RenderPoints::draw(gl_state, context.m_vao, grid, rect, mvp, context.m_points_view.m_viewport, context.m_points_view.m_margin, context.m_points_view.m_ranges);
+            context.m_uniforms.end_frame();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Render loop policies (see toolbox::run_render_loop()).
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Encodes the selected workload, then rendezvous with the other render threads
+    // every frame_barrier_interval frames (if enabled) so the wait counts towards
+    // encoding. A broken barrier means a render thread got stuck, carry on
+    // unsynchronized.
+    struct FrameEncoder
+    {
+        GLuint                  m_program = 0;
+        program_registry_t*     m_programs = nullptr;
+        size_t                  m_context_index = 0;
+        ProgramSwapper          m_program_swapper;
+        RenderContextState      m_context;
+        toolbox::FrameBarrier*  m_frame_barrier = nullptr;
+        size_t                  m_frame_barrier_timeout_frame_index = SIZE_MAX;
+
+        void encode(size_t frame_index)
+        {
+            if (m_programs) {
+                m_program_swapper.swap(*m_programs, m_context_index, point_grid, m_program);
+            }
+
+            encode_frame(frame_index, frame_workload, m_program, point_grid, m_context);
+
+            if (m_frame_barrier && ((frame_index % frame_barrier_interval) == 0)) {
+                if (!m_frame_barrier->arrive_and_wait() && (m_frame_barrier_timeout_frame_index == SIZE_MAX)) {
+                    m_frame_barrier_timeout_frame_index = frame_index;
+                }
+            }
+        }
+    };
+
+    struct WglSwap
+    {
+        HDC     m_display_context = NULL;
+        bool    m_is_first_frame_marked = false;
+
+        void swap()
+        {
+            SwapBuffers(m_display_context);
+
+            if (!m_is_first_frame_marked) {
+                startup.mark("first frame");
+                m_is_first_frame_marked = true;
+            }
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    // Run the instantiation of the render loop for the given pacer and the selected
+    // timing output. Timings go to the console for the first render thread only.
+    template <typename PacerT>
+    void render_frames(size_t thread_index, size_t num_frames, toolbox::Clock::time_point first_frame_time, toolbox::Clock::time_point epoch,
+        PacerT& pacer, FrameEncoder& encoder, WglSwap& swap, toolbox::FrameTimingLog::Channel* timing_channel)
+    {
+        switch (frame_timing_output) {
+        case FrameTimingOutput::file:
+            if (timing_channel) {
+                toolbox::ChannelTimingSink<toolbox::FrameTimingLog::Channel> timing_sink(*timing_channel, 61);
+                toolbox::run_render_loop<toolbox::SteadyClockPolicy>(num_frames, first_frame_time, epoch, pacer, encoder, timing_sink, swap);
+                return;
+            }
+            break;
+
+        case FrameTimingOutput::console:
+            if (thread_index == 0) {
+                toolbox::ConsoleTimingSink timing_sink;
+                toolbox::run_render_loop<toolbox::SteadyClockPolicy>(num_frames, first_frame_time, epoch, pacer, encoder, timing_sink, swap);
+                return;
+            }
+            break;
+
+        case FrameTimingOutput::none:
+            break;
+        }
+
+        toolbox::NullTimingSink timing_sink;
+        toolbox::run_render_loop<toolbox::SteadyClockPolicy>(num_frames, first_frame_time, epoch, pacer, encoder, timing_sink, swap);
+    }
+
+    //------------------------------------------------------------------------------
+    // Scenarios
+    //------------------------------------------------------------------------------
+
+    //------------------------------------------------------------------------------
+    // Renders scenarios into the on-screen windows, one output per monitor. Programs
+    // reloaded meanwhile (see --shaders) are swapped in at the next frame.
+    class WglRenderOutput final : public toolbox::RenderOutput
+    {
+    public:
+
+        WglRenderOutput(HDC display_context, HGLRC gl_context, program_registry_t& programs, size_t context_index, const PointsView& points_view) :
+            m_display_context(display_context), m_gl_context(gl_context), m_programs(programs), m_context_index(context_index)
+        {
+            m_context.m_points_view = points_view;
+
+            const int refresh_rate = GetDeviceCaps(display_context, VREFRESH);
+
+            if (refresh_rate > 1) {   // 0 and 1 mean the hardware default.
+                m_refresh_interval = std::chrono::duration_cast<toolbox::Clock::duration>(std::chrono::duration<double>(1.0 / refresh_rate));
+            }
+        }
+
+        void bind()
+        {
+            if (wglMakeCurrent(m_display_context, m_gl_context) != TRUE) {
+                throw std::runtime_error("Failed to make OpenGL context current!");
+            }
+
+            if (m_program == 0) {
+                RenderPoints::request_program(m_programs, m_point_grid);
+                m_program = RenderPoints::get_program(m_programs, m_context_index, m_point_grid);
+            }
+        }
+
+        toolbox::Clock::duration refresh_interval() const override { return m_refresh_interval; }
+        void set_swap_interval(int interval) override { wglSwapIntervalEXT(interval); }
+
+        void encode(size_t frame_index, uint32_t workload) override
+        {
+            m_program_swapper.swap(m_programs, m_context_index, m_point_grid, m_program);
+            encode_frame(frame_index, workload, m_program, m_point_grid, m_context);
+        }
+
+        //------------------------------------------------------------------------------
+        // The program is generated for the grid, the old one stays in the registry.
+        void set_point_grid(const toolbox::PointGrid& grid) override
+        {
+            if (grid != m_point_grid) {
+                m_point_grid = grid;
+                RenderPoints::request_program(m_programs, m_point_grid);
+                m_program = RenderPoints::get_program(m_programs, m_context_index, m_point_grid);
+            }
+        }
+        void swap() override { SwapBuffers(m_display_context); }
+
+        bool delay_before_swap(float seconds) override { return (wglDelayBeforeSwapNV && (wglDelayBeforeSwapNV(m_display_context, GLfloat(seconds)) == TRUE)); }
+        bool has_delay_before_swap() const override { return (wglDelayBeforeSwapNV != nullptr); }
+
+    private:
+
+        const HDC                   m_display_context;
+        const HGLRC                 m_gl_context;
+        program_registry_t&         m_programs;
+        const size_t                m_context_index;
+        toolbox::Clock::duration    m_refresh_interval = std::chrono::microseconds(1000000 / 60);
+        toolbox::PointGrid          m_point_grid = point_grid;
+        GLuint                      m_program = 0;
+        ProgramSwapper              m_program_swapper;
+        RenderContextState          m_context;
+    };
+
+    class WglRenderBackend final : public toolbox::RenderBackend
+    {
+    public:
+
+        WglRenderBackend(const std::vector<HDC>& display_contexts, const std::vector<HGLRC>& gl_contexts, program_registry_t& programs)
+        {
+            for (size_t i = 0; i < display_contexts.size(); ++i) {
+                m_outputs.emplace_back(new WglRenderOutput(display_contexts[i], gl_contexts[i], programs, i, monitor_points_view(i)));
+            }
+        }
+
+        const char* name() const override { return "wgl"; }
+        size_t num_outputs() const override { return m_outputs.size(); }
+        toolbox::RenderOutput& output(size_t index) override { return *m_outputs[index]; }
+
+        void bind(size_t index) override { m_outputs[index]->bind(); }
+        void unbind(size_t) override { wglMakeCurrent(NULL, NULL); }
+
+    private:
+
+        std::vector<std::unique_ptr<WglRenderOutput>>   m_outputs;
+    };
+
+    //------------------------------------------------------------------------------
+    // Wait for work running against the backend on other threads, handling the
+    // messages of the windows meanwhile.
+    template <typename T>
+    T wait_handling_messages(std::future<T>& result)
+    {
+        MSG message = {};
+
+        while (result.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+            while (PeekMessage(&message, nullptr, 0, 0, PM_REMOVE)) {
+                TranslateMessage(&message);
+                DispatchMessage(&message);
+            }
+        }
+
+        return result.get();
+    }
+
+    //------------------------------------------------------------------------------
+    // Tab separated, one header line then one line per program (shader variant).
+    void write_program_statistics(std::ostream& stream, const std::vector<program_registry_t::ProgramStatistics>& statistics)
+    {
+        stream << "program\tcompiles\tfailures\tcompile_ms\tmax_compile_ms" << std::endl;
+        stream << std::fixed << std::setprecision(2);
+
+        for (const program_registry_t::ProgramStatistics& program : statistics) {
+            stream << program.m_name << "\t" << program.m_compiles << "\t" << program.m_failures << "\t"
+                << std::chrono::duration<double, std::milli>(program.m_compile_time).count() << "\t"
+                << std::chrono::duration<double, std::milli>(program.m_max_compile_time).count() << std::endl;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Run the scenario matrix on the windows' contexts and print the results table.
+    // The scenarios run on another thread so this one keeps handling the windows'
+    // messages.
+    int run_scenarios(const std::string& path, const std::vector<HDC>& display_contexts, const std::vector<HGLRC>& gl_contexts, program_registry_t& programs)
+    {
+        try {
+            const std::vector<toolbox::Scenario> scenarios = toolbox::load_scenario_matrix(path);
+            WglRenderBackend backend(display_contexts, gl_contexts, programs);
+
+            RenderPoints::precompile_programs({ &programs }, toolbox::point_shader_keys(scenarios));
+
+            std::future<std::vector<toolbox::ScenarioResult>> results = std::async(std::launch::async, [&scenarios, &backend]() {
+                std::vector<toolbox::ScenarioResult> results;
+
+                for (size_t i = 0; i < scenarios.size(); ++i) {
+                    std::cerr << "Scenario " << (i + 1) << " of " << scenarios.size() << std::endl;
+                    results.push_back(toolbox::run_scenario(backend, scenarios[i]));
+                }
+
+                return results;
+            });
+
+            toolbox::write_results_table(std::cout, backend.name(), scenarios, wait_handling_messages(results));
+            std::cout << std::endl;
+            write_program_statistics(std::cout, programs.program_statistics());
+        }
+        catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Sweep the point grid on every monitor in turn, starting from half the columns
+    // and rows of the selected grid.
+    int run_point_grid_sweeps(const std::vector<HDC>& display_contexts, const std::vector<HGLRC>& gl_contexts, program_registry_t& programs)
+    {
+        try {
+            WglRenderBackend backend(display_contexts, gl_contexts, programs);
+
+            toolbox::Scenario scenario;
+            scenario.m_workload = (toolbox::WORKLOAD_CLEAR | toolbox::WORKLOAD_POINTS);
+            scenario.m_point_grid = point_grid;
+            scenario.m_point_grid.m_columns = std::max<uint32_t>((point_grid.m_columns / 2), 64);
+            scenario.m_point_grid.m_rows = scenario.m_point_grid.m_columns;
+            scenario.m_num_frames = 120;
+            scenario.m_num_warmup_frames = 30;
+            scenario.m_num_repetitions = 1;
+
+            std::future<std::vector<toolbox::PointGridSweep>> sweeps = std::async(std::launch::async, [&scenario, &backend]() {
+                std::vector<toolbox::PointGridSweep> sweeps;
+
+                for (size_t i = 0; i < backend.num_outputs(); ++i) {
+                    std::cerr << "Sweeping monitor " << i << std::endl;
+                    sweeps.push_back(toolbox::sweep_point_grid(backend, i, scenario));
+                }
+
+                return sweeps;
+            });
+
+            for (const toolbox::PointGridSweep& sweep : wait_handling_messages(sweeps)) {
+                toolbox::print_point_grid_sweep(std::cout, sweep);
+            }
+        }
+        catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    //------------------------------------------------------------------------------
+    // Display topology providers
+    //------------------------------------------------------------------------------
+
+    std::string to_utf8(const WCHAR* text)
+    {
+        const int size = WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr);
+
+        if (size <= 1) {
+            return std::string();
+        }
+
+        std::string result(size_t(size - 1), '\0');
+        WideCharToMultiByte(CP_UTF8, 0, text, -1, &result[0], size, nullptr, nullptr);
+        return result;
+    }
+
+    std::string luid_to_key(const LUID& luid)
+    {
+        std::ostringstream key;
+        key << std::hex << std::setfill('0') << std::setw(8) << luid.HighPart << std::setw(8) << luid.LowPart;
+        return key.str();
+    }
+
+    //------------------------------------------------------------------------------
+    // The virtual screen and the monitors making it up (Windows API).
+    class WindowsTopologyProvider final : public toolbox::DisplayTopologyProvider
+    {
+    public:
+
+        const char* name() const override { return "Windows"; }
+
+        toolbox::DisplayTopology enumerate() override
+        {
+            toolbox::DisplayTopology topology;
+
+            topology.m_virtual_screen.m_x = GetSystemMetrics(SM_XVIRTUALSCREEN);
+            topology.m_virtual_screen.m_y = GetSystemMetrics(SM_YVIRTUALSCREEN);
+            topology.m_virtual_screen.m_width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+            topology.m_virtual_screen.m_height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+
+            //------------------------------------------------------------------------------
+            // Each physical display is represented by a monitor handle of type HMONITOR.
+            if (EnumDisplayMonitors(nullptr, nullptr, [](HMONITOR monitor, HDC display_context, LPRECT virtual_screen_rect, LPARAM user_data) {
+                toolbox::DisplayTopology* const topology = (toolbox::DisplayTopology*)user_data;
+
+                toolbox::DisplayTopology::Monitor virtual_screen_monitor;
+                {
+                    virtual_screen_monitor.m_rect.m_x = virtual_screen_rect->left;
+                    virtual_screen_monitor.m_rect.m_y = virtual_screen_rect->top;
+                    virtual_screen_monitor.m_rect.m_width = (virtual_screen_rect->right - virtual_screen_rect->left);
+                    virtual_screen_monitor.m_rect.m_height = (virtual_screen_rect->bottom - virtual_screen_rect->top);
+                }
+
+                MONITORINFOEXA monitor_info = {};
+                monitor_info.cbSize = sizeof(monitor_info);
+
+                if (GetMonitorInfoA(monitor, &monitor_info) != 0) {
+                    virtual_screen_monitor.m_key = monitor_info.szDevice;
+                    virtual_screen_monitor.m_is_primary = ((monitor_info.dwFlags & MONITORINFOF_PRIMARY) == MONITORINFOF_PRIMARY);
+
+                    DEVMODEA device_mode = {};
+                    device_mode.dmSize = sizeof(device_mode);
+
+                    if (EnumDisplaySettingsExA(monitor_info.szDevice, ENUM_CURRENT_SETTINGS, &device_mode, 0)) {
+                        virtual_screen_monitor.m_refresh_rate_hz = device_mode.dmDisplayFrequency;
+                    }
+                }
+                else {
+                    std::ostringstream key;
+                    key << "monitor:" << monitor;
+                    virtual_screen_monitor.m_key = key.str();
+                }
+
+                topology->m_monitors.push_back(virtual_screen_monitor);
+                return TRUE;
+            }, (LPARAM)&topology) == 0)
+            {
+                throw std::runtime_error("Failed to enumerate monitors!");
+            }
+
+            if (topology.m_monitors.size() != size_t(GetSystemMetrics(SM_CMONITORS))) {
+                std::cerr << "Warning: EnumDisplayMonitors() returned more monitors than GetSystemMetrics() reported to be part of the virtual screen!" << std::endl;
+            }
+
+            return topology;
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    // Logical and physical GPUs, their outputs and the mosaic grids (NVAPI).
+    class NvapiTopologyProvider final : public toolbox::DisplayTopologyProvider
+    {
+    public:
+
+        const char* name() const override { return "NVAPI"; }
+
+        toolbox::DisplayTopology enumerate() override
+        {
+            toolbox::DisplayTopology topology;
+
+            if (NvAPI_Initialize() != NVAPI_OK) {
+                throw std::runtime_error("Failed to initialize NVAPI!");
+            }
+
+            //------------------------------------------------------------------------------
+            // GDI names of the displays the OS sees, by display id.
+            std::map<NvU32, std::string> display_names;
+            NvDisplayHandle display_handle = nullptr;
+
+            for (NvU32 i = 0; NvAPI_EnumNvidiaDisplayHandle(i, &display_handle) == NVAPI_OK; ++i) {
+                NvAPI_ShortString display_name = {};
+                NvU32 display_id = 0;
+
+                if ((NvAPI_GetAssociatedNvidiaDisplayName(display_handle, display_name) == NVAPI_OK) &&
+                    (NvAPI_DISP_GetDisplayIdByDisplayName(display_name, &display_id) == NVAPI_OK)) {
+                    display_names[display_id] = display_name;
+                }
+            }
+
+            //------------------------------------------------------------------------------
+            // Display grids, including where mosaic is disabled and each display is a 1x1
+            // grid.
+            NV_MOSAIC_TOPO_BRIEF mosaic_topology = {};
+            mosaic_topology.version = NVAPI_MOSAIC_TOPO_BRIEF_VER;
+
+            NV_MOSAIC_DISPLAY_SETTING mosaic_display_settings = {};
+            mosaic_display_settings.version = NVAPI_MOSAIC_DISPLAY_SETTING_VER;
+
+            NvS32 mosaic_overlap_x = 0;
+            NvS32 mosaic_overlap_y = 0;
+
+            if ((NvAPI_Mosaic_GetCurrentTopo(&mosaic_topology, &mosaic_display_settings, &mosaic_overlap_x, &mosaic_overlap_y) == NVAPI_OK) && mosaic_topology.isPossible) {
+                NvU32 num_grids = 0;
+
+                if (NvAPI_Mosaic_EnumDisplayGrids(nullptr, &num_grids) != NVAPI_OK) {
+                    throw std::runtime_error("Failed to enumerate display grids!");
+                }
+
+                std::vector<NV_MOSAIC_GRID_TOPO> display_grids(num_grids);
+
+                std::for_each(begin(display_grids), end(display_grids), [](NV_MOSAIC_GRID_TOPO& display_grid) {
+                    display_grid.version = NV_MOSAIC_GRID_TOPO_VER;
+                });
+
+                if (NvAPI_Mosaic_EnumDisplayGrids(display_grids.data(), &num_grids) != NVAPI_OK) {
+                    throw std::runtime_error("Failed to enumerate display grids!");
+                }
+
+                assert(display_grids.size() >= num_grids);  // In some cases the initially reported number appears to be conservative!
+                display_grids.resize(num_grids);
+
+                for (const NV_MOSAIC_GRID_TOPO& display_grid : display_grids) {
+                    toolbox::DisplayTopology::MosaicGrid grid;
+                    grid.m_rows = display_grid.rows;
+                    grid.m_columns = display_grid.columns;
+                    grid.m_width = display_grid.displaySettings.width;
+                    grid.m_height = display_grid.displaySettings.height;
+                    grid.m_refresh_rate_hz = display_grid.displaySettings.freq;
+
+                    for (NvU32 i = 0; i < display_grid.displayCount; ++i) {
+                        grid.m_display_ids.push_back(display_grid.displays[i].displayId);
+                    }
+
+                    topology.m_mosaic_grids.push_back(grid);
+                }
+            }
+
+            //------------------------------------------------------------------------------
+            // Logical GPUs, the physical GPUs underneath them and their displays.
+            NvLogicalGpuHandle logical_gpus[NVAPI_MAX_LOGICAL_GPUS] = {};
+            NvU32 num_logical_gpus = 0;
+
+            if (NvAPI_EnumLogicalGPUs(logical_gpus, &num_logical_gpus) != NVAPI_OK) {
+                throw std::runtime_error("Failed to enumerate logical GPUs!");
+            }
+
+            for (NvU32 logical_gpu_index = 0; logical_gpu_index < num_logical_gpus; ++logical_gpu_index) {
+                toolbox::DisplayTopology::LogicalGpu logical_gpu;
+                logical_gpu.m_index = logical_gpu_index;
+                topology.m_logical_gpus.push_back(logical_gpu);
+
+                NvPhysicalGpuHandle physical_gpus[NVAPI_MAX_PHYSICAL_GPUS] = {};
+                NvU32 num_physical_gpus = 0;
+
+                if (NvAPI_GetPhysicalGPUsFromLogicalGPU(logical_gpus[logical_gpu_index], physical_gpus, &num_physical_gpus) != NVAPI_OK) {
+                    std::cerr << "Error: Failed to enumerate physical GPUs!" << std::endl;
+                    continue;
+                }
+
+                for (NvU32 physical_gpu_index = 0; physical_gpu_index < num_physical_gpus; ++physical_gpu_index) {
+                    toolbox::DisplayTopology::PhysicalGpu gpu;
+                    gpu.m_logical_gpu = int32_t(logical_gpu_index);
+
+                    LUID adapter_luid = {};
+
+                    if (NvAPI_GPU_GetAdapterIdFromPhysicalGpu(physical_gpus[physical_gpu_index], &adapter_luid) == NVAPI_OK) {
+                        gpu.m_key = luid_to_key(adapter_luid);
+                    }
+                    else {
+                        gpu.m_key = ("nv:" + std::to_string(logical_gpu_index) + "." + std::to_string(physical_gpu_index));
+                    }
+
+                    NvAPI_ShortString name = {};
+
+                    if (NvAPI_GPU_GetFullName(physical_gpus[physical_gpu_index], name) == NVAPI_OK) {
+                        gpu.m_name = name;
+                    }
+
+                    topology.m_physical_gpus.push_back(gpu);
+
+                    NvU32 num_displays = 0;
+
+                    if (NvAPI_GPU_GetAllDisplayIds(physical_gpus[physical_gpu_index], nullptr, &num_displays) != NVAPI_OK) {
+                        std::cerr << "Error: Failed to get connected displays!" << std::endl;
+                        continue;
+                    }
+
+                    std::vector<NV_GPU_DISPLAYIDS> displays(num_displays);
+
+                    std::for_each(begin(displays), end(displays), [](NV_GPU_DISPLAYIDS& display) {
+                        display.version = NV_GPU_DISPLAYIDS_VER;
+                    });
+
+                    if (NvAPI_GPU_GetAllDisplayIds(physical_gpus[physical_gpu_index], displays.data(), &num_displays) != NVAPI_OK) {
+                        std::cerr << "Error: Failed to get connected displays!" << std::endl;
+                        continue;
+                    }
+
+                    assert(displays.size() >= num_displays);    // In some cases the initially reported number appears to be conservative!
+                    displays.resize(num_displays);
+
+                    for (const NV_GPU_DISPLAYIDS& display : displays) {
+                        toolbox::DisplayTopology::Output output;
+                        output.m_gpu = gpu.m_key;
+                        output.m_display_id = display.displayId;
+                        output.m_is_active = (display.isActive != 0);
+
+                        const auto display_name = display_names.find(display.displayId);
+
+                        if (display_name != display_names.end()) {
+                            output.m_key = display_name->second;
+                        }
+                        else {
+                            std::ostringstream key;
+                            key << "nv:0x" << std::hex << std::setfill('0') << std::setw(8) << display.displayId;
+                            output.m_key = key.str();
+                        }
+
+                        switch (display.connectorType) {
+                        case NV_MONITOR_CONN_TYPE_VGA: output.m_connector = "VGA"; break;
+                        case NV_MONITOR_CONN_TYPE_COMPONENT: output.m_connector = "Component"; break;
+                        case NV_MONITOR_CONN_TYPE_SVIDEO: output.m_connector = "S-Video"; break;
+                        case NV_MONITOR_CONN_TYPE_HDMI: output.m_connector = "HDMI"; break;
+                        case NV_MONITOR_CONN_TYPE_DVI: output.m_connector = "DVI"; break;
+                        case NV_MONITOR_CONN_TYPE_LVDS: output.m_connector = "LVDS"; break;
+                        case NV_MONITOR_CONN_TYPE_DP: output.m_connector = "DP"; break;
+                        case NV_MONITOR_CONN_TYPE_COMPOSITE: output.m_connector = "Composite"; break;
+                        default: output.m_connector = "Unknown"; break;
+                        }
+
+                        topology.m_outputs.push_back(output);
+                    }
+                }
+            }
 
-            std::for_each(begin(display_grids), end(display_grids), [](NV_MOSAIC_GRID_TOPO& display_grid) {
-                print_to_stream(std::cout, display_grid, "  ");
-            });
+            return topology;
         }
+    };
 
-        //------------------------------------------------------------------------------
-        // Enumerate logical GPUs and the physical GPUs underneath it.
-        NvLogicalGpuHandle logical_gpus[NVAPI_MAX_LOGICAL_GPUS] = {};
-        NvU32 num_logical_gpus = 0;
-
-        if (NvAPI_EnumLogicalGPUs(logical_gpus, &num_logical_gpus) != NVAPI_OK) {
-            std::cerr << "Error: Failed to enumerate logical GPUs!" << std::endl;
-            return EXIT_FAILURE;
-        }
+    //------------------------------------------------------------------------------
+    // Adapters and the outputs attached to them (DXGI), also covers GPUs of other
+    // vendors.
+    class DxgiTopologyProvider final : public toolbox::DisplayTopologyProvider
+    {
+    public:
 
-        NvPhysicalGpuHandle physical_gpus[NVAPI_MAX_PHYSICAL_GPUS] = { 0 };
-        NvU32 num_physical_gpus = 0;
-        NvU32 total_num_physical_gpus = 0;
+        const char* name() const override { return "DXGI"; }
 
-        for (NvU32 logical_gpu_index = 0; logical_gpu_index < num_logical_gpus; ++logical_gpu_index) {
-            std::cout << "Logical GPU " << logical_gpu_index << std::endl;
+        toolbox::DisplayTopology enumerate() override
+        {
+            toolbox::DisplayTopology topology;
+            ComPtr<IDXGIFactory4> factory;
 
-            if (NvAPI_GetPhysicalGPUsFromLogicalGPU(logical_gpus[logical_gpu_index], physical_gpus, &num_physical_gpus) != NVAPI_OK) {
-                std::cerr << "Error: Failed to enumerate physical GPUs!" << std::endl;
-                continue;
+            if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory)))) {
+                throw std::runtime_error("Failed to create DXGI factory!");
             }
 
-            total_num_physical_gpus += num_physical_gpus;
-
-            for (size_t physical_gpu_index = 0; physical_gpu_index < num_physical_gpus; ++physical_gpu_index) {
-                NvAPI_ShortString name = {};
-
-                if (NvAPI_GPU_GetFullName(physical_gpus[physical_gpu_index], name) != NVAPI_OK) {
-                    std::cerr << "Error: Failed to get GPU name!" << std::endl;
-                    continue;
-                }
-
-                std::cout << "  Physical GPU " << physical_gpu_index << ": " << name << std::endl;
+            ComPtr<IDXGIAdapter> adapter;
 
-                NvU32 num_displays = 0;
+            for (UINT adapter_index = 0; factory->EnumAdapters(adapter_index, &adapter) != DXGI_ERROR_NOT_FOUND; ++adapter_index) {
+                DXGI_ADAPTER_DESC adapter_desc = {};
 
-                if (NvAPI_GPU_GetAllDisplayIds(physical_gpus[physical_gpu_index], nullptr, &num_displays) != NVAPI_OK) {
-                    std::cerr << "Error: Failed to get conencted displays!" << std::endl;
+                if (FAILED(adapter->GetDesc(&adapter_desc))) {
+                    std::cerr << "Error: Failed to get adapter description!" << std::endl;
                     continue;
                 }
 
-                std::vector<NV_GPU_DISPLAYIDS> displays(num_displays);
+                toolbox::DisplayTopology::PhysicalGpu gpu;
+                gpu.m_key = luid_to_key(adapter_desc.AdapterLuid);
+                gpu.m_name = to_utf8(adapter_desc.Description);
+                topology.m_physical_gpus.push_back(gpu);
 
-                std::for_each(begin(displays), end(displays), [](NV_GPU_DISPLAYIDS& display) {
-                    display.version = NV_GPU_DISPLAYIDS_VER;
-                });
+                ComPtr<IDXGIOutput> output;
 
-                if (NvAPI_GPU_GetAllDisplayIds(physical_gpus[physical_gpu_index], displays.data(), &num_displays) != NVAPI_OK) {
-                    std::cerr << "Error: Failed to get conencted displays!" << std::endl;
-                    continue;
-                }
+                for (UINT output_index = 0; adapter->EnumOutputs(output_index, &output) != DXGI_ERROR_NOT_FOUND; ++output_index) {
+                    DXGI_OUTPUT_DESC output_desc = {};
 
-                assert(displays.size() >= num_displays);    // In some cases the initially reported number appears to be conservative!
-                displays.resize(num_displays);
-
-                for (size_t display_index = 0; display_index < displays.size(); ++display_index) {
-                    std::cout << "    Display " << display_index << ": ";
-
-                    switch (displays[display_index].connectorType) {
-                    case NV_MONITOR_CONN_TYPE_VGA: std::cout << "VGA"; break;
-                    case NV_MONITOR_CONN_TYPE_COMPONENT: std::cout << "Component"; break;
-                    case NV_MONITOR_CONN_TYPE_SVIDEO: std::cout << "S-Video"; break;
-                    case NV_MONITOR_CONN_TYPE_HDMI: std::cout << "HDMI"; break;
-                    case NV_MONITOR_CONN_TYPE_DVI: std::cout << "DVI"; break;
-                    case NV_MONITOR_CONN_TYPE_LVDS: std::cout << "LVDS"; break;
-                    case NV_MONITOR_CONN_TYPE_DP: std::cout << "DP"; break;
-                    case NV_MONITOR_CONN_TYPE_COMPOSITE: std::cout << "Composite"; break;
-                    default: std::cout << "Unknown"; break;
+                    if (FAILED(output->GetDesc(&output_desc))) {
+                        std::cerr << "Error: Failed to get output description!" << std::endl;
+                        continue;
                     }
 
-                    std::cout << ", 0x" << std::hex << std::setfill('0') << std::setw(8) << displays[display_index].displayId << std::dec;
+                    toolbox::DisplayTopology::Output topology_output;
+                    topology_output.m_key = to_utf8(output_desc.DeviceName);
+                    topology_output.m_gpu = gpu.m_key;
+                    topology_output.m_is_active = (output_desc.AttachedToDesktop != FALSE);
+                    topology.m_outputs.push_back(topology_output);
+                }
+            }
 
-                    if (displays[display_index].isDynamic) {
-                        std::cout << ", dynamic";
-                    }
+            return topology;
+        }
+    };
 
-                    if (displays[display_index].isActive) {
-                        std::cout << ", active";
-                    }
+    //------------------------------------------------------------------------------
+    // Describes the display devices and their current modes, which is cheap to
+    // query, for telling whether a topology snapshot still matches the system.
+    uint64_t current_display_topology_fingerprint()
+    {
+        std::ostringstream description;
 
-                    if (displays[display_index].isCluster) {
-                        std::cout << ", cluster";
-                    }
+        description << GetSystemMetrics(SM_XVIRTUALSCREEN) << "," << GetSystemMetrics(SM_YVIRTUALSCREEN) << ","
+            << GetSystemMetrics(SM_CXVIRTUALSCREEN) << "," << GetSystemMetrics(SM_CYVIRTUALSCREEN) << ","
+            << GetSystemMetrics(SM_CMONITORS) << ";";
 
-                    if (displays[display_index].isOSVisible) {
-                        std::cout << ", OS visible";
-                    }
+        DISPLAY_DEVICEA display_device = {};
+        display_device.cb = sizeof(display_device);
 
-                    if (displays[display_index].isWFD) {
-                        std::cout << ", wireless";
-                    }
+        for (DWORD display_device_index = 0; EnumDisplayDevicesA(nullptr, display_device_index, &display_device, 0); ++display_device_index) {
+            description << display_device.DeviceName << "," << display_device.DeviceString << "," << display_device.DeviceID << "," << display_device.StateFlags;
 
-                    if (displays[display_index].isConnected) {
-                        if (displays[display_index].isPhysicallyConnected) {
-                            std::cout << ", physically connected";
-                        }
-                        else {
-                            std::cout << ", connected";
-                        }
-                    }
+            DEVMODEA device_mode = {};
+            device_mode.dmSize = sizeof(device_mode);
 
-                    std::cout << std::endl;
-                }
+            if (EnumDisplaySettingsExA(display_device.DeviceName, ENUM_CURRENT_SETTINGS, &device_mode, 0)) {
+                description << "," << device_mode.dmPosition.x << "," << device_mode.dmPosition.y << "," << device_mode.dmPelsWidth << ","
+                    << device_mode.dmPelsHeight << "," << device_mode.dmDisplayFrequency;
             }
-        }
 
-        if (NvAPI_EnumPhysicalGPUs(physical_gpus, &num_physical_gpus) != NVAPI_OK) {
-            std::cerr << "Error: Failed to enumerate physical GPUs!" << std::endl;
-            return EXIT_FAILURE;
+            description << ";";
         }
 
-        assert(num_physical_gpus == total_num_physical_gpus);
-
-        //------------------------------------------------------------------------------
-        // ...
-        return EXIT_SUCCESS;
+        return toolbox::display_topology_fingerprint(description.str());
     }
 
     //------------------------------------------------------------------------------
-    // DirectX based GPU query
+    // Display topology
     //------------------------------------------------------------------------------
 
-    int directx()
+    //------------------------------------------------------------------------------
+    // Take the topology from the snapshot if it still matches the system, enumerate
+    // it through all providers (and update the snapshot) otherwise. Lists the
+    // monitors making up the virtual screen for opengl().
+    //
+    // The providers and CUDA are probed concurrently, as startup tasks. A provider
+    // that fails is reported and left out like in toolbox::build_display_topology().
+    int display_topology()
     {
-        std::cout << "[DirectX]" << std::endl;
+        std::cout << "[Display Topology]" << std::endl << std::endl;
 
-        //------------------------------------------------------------------------------
-        // Grab DirectX factory.
-        ComPtr<IDXGIFactory4> factory;
+        uint64_t fingerprint = 0;
+        bool is_from_snapshot = false;
+        toolbox::DisplayTopology topology;
 
-        if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory)))) {
-            std::cerr << "Error: Failed to create DXGI factory!" << std::endl;
-            return EXIT_FAILURE;
-        }
+        WindowsTopologyProvider windows_provider;
+        NvapiTopologyProvider nvapi_provider;
+        DxgiTopologyProvider dxgi_provider;
+        std::array<toolbox::DisplayTopology, 3> fragments;
 
-        //------------------------------------------------------------------------------
-        // Enumerate DirectX adapters (GPUs).
-        std::cout << std::endl;
+        const auto enumerate = [&is_from_snapshot](toolbox::DisplayTopologyProvider& provider, toolbox::DisplayTopology& fragment) {
+            if (is_from_snapshot) {
+                return;
+            }
+
+            try {
+                fragment = provider.enumerate();
+            }
+            catch (std::exception& e) {
+                std::cerr << "Warning: Display topology provider " << provider.name() << " failed: " << e.what() << std::endl;
+            }
+        };
 
-        UINT adapter_index = 0;
-        IDXGIAdapter* adapter = nullptr;
+        startup.add_task("snapshot", {}, [&]() {
+            fingerprint = current_display_topology_fingerprint();
+            is_from_snapshot = (!display_topology_snapshot_path.empty() && toolbox::load_display_topology(display_topology_snapshot_path, topology) && (topology.m_fingerprint == fingerprint));
+        });
 
-        while (factory->EnumAdapters(adapter_index, &adapter) != DXGI_ERROR_NOT_FOUND) {
-            DXGI_ADAPTER_DESC adapter_desc = {};
+        startup.add_task("windows", { "snapshot" }, [&]() { enumerate(windows_provider, fragments[0]); });
+        startup.add_task("nvapi", { "snapshot" }, [&]() { enumerate(nvapi_provider, fragments[1]); });
+        startup.add_task("dxgi", { "snapshot" }, [&]() { enumerate(dxgi_provider, fragments[2]); });
 
-            if (FAILED(adapter->GetDesc(&adapter_desc))) {
-                std::cerr << "Error: Failed to get adapter description!" << std::endl;
-                continue;
+        startup.add_task("topology", { "windows", "nvapi", "dxgi" }, [&]() {
+            if (is_from_snapshot) {
+                return;
             }
 
-            std::cout << "Adapter " << adapter_index << ": ";
-            std::wcout << adapter_desc.Description;
-            std::cout << ", 0x" << std::hex << adapter_desc.AdapterLuid.HighPart << std::setfill('0') << std::setw(8) << adapter_desc.AdapterLuid.LowPart << std::dec;
-            std::cout << std::endl;
+            topology = toolbox::DisplayTopology();
 
-            UINT output_index = 0;
-            IDXGIOutput* output = nullptr;
+            for (const toolbox::DisplayTopology& fragment : fragments) {
+                toolbox::merge_display_topology(topology, fragment);
+            }
 
-            //------------------------------------------------------------------------------
-            // Enumerate outputs (displays).
-            while (adapter->EnumOutputs(output_index, &output) != DXGI_ERROR_NOT_FOUND) {
-                DXGI_OUTPUT_DESC output_desc = {};
+            topology.m_fingerprint = fingerprint;
 
-                if (FAILED(output->GetDesc(&output_desc))) {
-                    std::cerr << "Error: Failed to get output description!" << std::endl;
-                    continue;
-                }
+            if (!display_topology_snapshot_path.empty()) {
+                toolbox::save_display_topology(display_topology_snapshot_path, topology);
+            }
+        });
 
-                std::cout << "  Output " << output_index << ": ";
-                std::wcout << output_desc.DeviceName;
+        //------------------------------------------------------------------------------
+        // Independent of the display topology, initialized here to overlap with it.
+        startup.add_task("cuda", {}, []() {
+            is_cuda_available = (cuInit(0) == CUDA_SUCCESS);
+        });
 
-                bool first = true;
+        const auto start_time = std::chrono::steady_clock::now();
 
-                if (output_desc.AttachedToDesktop) {
-                    if (first) { std::cout << " ("; }
-                    else { std::cout << ", "; }
-                    std::cout << "display attached";
-                    first = false;
-                }
+        if (!startup.run()) {
+            std::cerr << "Error: Failed to probe the system!" << std::endl;
+            startup.print_timeline(std::cerr);
+            return EXIT_FAILURE;
+        }
 
-                MONITORINFO monitor_info = {};
-                monitor_info.cbSize = sizeof(monitor_info);
+        if (is_from_snapshot) {
+            std::cout << "From snapshot " << display_topology_snapshot_path;
+        }
+        else {
+            std::cout << "Enumerated";
+        }
 
-                if (GetMonitorInfo(output_desc.Monitor, &monitor_info)) {
-                    if (monitor_info.dwFlags & MONITORINFOF_PRIMARY) {
-                        if (first) { std::cout << " ("; }
-                        else { std::cout << ", "; }
-                        std::cout << "primary display";
-                        first = false;
-                    }
-                }
+        std::cout << " in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count() << " ms" << std::endl << std::endl;
+        toolbox::print_display_topology(std::cout, topology);
 
-                if (!first) { std::cout << ")"; }
-                std::cout << std::endl;
+        if (is_cuda_available) {
+            std::cout << std::endl << "CUDA available" << std::endl;
+        }
 
-                output->Release();
-                ++output_index;
+        //------------------------------------------------------------------------------
+        // Add to list of monitors making up the virtual screen.
+        virtual_screen.m_x = topology.m_virtual_screen.m_x;
+        virtual_screen.m_y = topology.m_virtual_screen.m_y;
+        virtual_screen.m_width = topology.m_virtual_screen.m_width;
+        virtual_screen.m_height = topology.m_virtual_screen.m_height;
+        num_virtual_screen_monitors = long(topology.m_monitors.size());
+
+        for (const toolbox::DisplayTopology::Monitor& monitor : topology.m_monitors) {
+            rect_t virtual_screen_monitor = {};
+            {
+                virtual_screen_monitor.m_x = monitor.m_rect.m_x;
+                virtual_screen_monitor.m_y = monitor.m_rect.m_y;
+                virtual_screen_monitor.m_width = monitor.m_rect.m_width;
+                virtual_screen_monitor.m_height = monitor.m_rect.m_height;
             }
 
-            adapter->Release();
-            ++adapter_index;
+            virtual_screen_monitors.push_back(virtual_screen_monitor);
         }
 
-        return EXIT_SUCCESS;
+        return (virtual_screen_monitors.empty() ? EXIT_FAILURE : EXIT_SUCCESS);
     }
 
     //------------------------------------------------------------------------------
@@ -879,11 +2013,12 @@ namespace {
             return EXIT_FAILURE;
         }
 
+        scene_state.publish(INITIAL_SCENE, 0);
+
         //------------------------------------------------------------------------------
-        // Initialize CUDA if available;
-        if (cuInit(0) == CUDA_SUCCESS) {
-            std::cout << std::endl << "CUDA available" << std::endl;
-        }
+        // Windows and their contexts have to live on the main thread, so the rest of
+        // startup is timed as phases rather than run as tasks.
+        startup.begin_phase("windows");
 
         //------------------------------------------------------------------------------
         // Register a window class.
@@ -1013,6 +2148,9 @@ namespace {
         assert(display_contexts.size() == virtual_screen_monitors.size());
         assert(gl_contexts.size() == virtual_screen_monitors.size());
 
+        startup.end_phase("windows");
+        startup.begin_phase("wgl gpus");
+
         //------------------------------------------------------------------------------
         // Make one of the contexts current so we can initialize OpenGL (via GLEW).
         std::cout << std::endl;
@@ -1099,6 +2237,37 @@ namespace {
             return EXIT_FAILURE;
         }
 
+        startup.end_phase("wgl gpus");
+
+        //------------------------------------------------------------------------------
+        // Compile the points program for all windows' contexts while the rest starts.
+        std::unique_ptr<program_registry_t> shared_programs = create_program_registry(display_contexts[0], gl_contexts[0]);
+
+        if (!shared_programs) {
+            std::cerr << "Error: Failed to create the program loader's OpenGL context: ";
+            log_last_error_message();
+            return EXIT_FAILURE;
+        }
+
+        RenderPoints::request_program(*shared_programs, point_grid);
+
+        //------------------------------------------------------------------------------
+        // Recompile the points programs, every variant requested, whenever their
+        // shaders change (if loaded from files), the render threads swap them in at
+        // their next frame.
+        std::unique_ptr<toolbox::FileWatcher> shader_watcher;
+
+        if (!shader_directory.empty()) {
+            const std::vector<std::string> shader_paths = { RenderPoints::vertex_shader_path(), RenderPoints::fragment_shader_path() };
+
+            shader_watcher.reset(new toolbox::FileWatcher(shader_paths, [&shared_programs](const std::string& path) {
+                std::cout << "Shader changed: " << path << std::endl;
+                RenderPoints::reload_programs(*shared_programs);
+            }));
+
+            std::cout << "Watching " << shader_directory << " for shader changes (" << shader_watcher->mechanism() << ")" << std::endl;
+        }
+
         //------------------------------------------------------------------------------
         // Create one (affinity) display and OpenGL context per GPU.
         std::vector<HDC> affinity_display_contexts;
@@ -1156,36 +2325,56 @@ namespace {
         std::vector<GLuint> framebuffers(affinity_display_contexts.size());
         std::vector<GLuint> color_attachments(affinity_display_contexts.size());
 
-        if ((0)) {
-            start_render_threads(affinity_display_contexts, affinity_gl_contexts,
-                [&framebuffers, &color_attachments, &affinity_programs](size_t thread_index)
+        if (run_offscreen_benchmark && !affinity_display_contexts.empty()) {
+            const std::unique_ptr<program_registry_t> affinity_shared_programs = create_program_registry(affinity_display_contexts[0], affinity_gl_contexts[0]);
+
+            if (!affinity_shared_programs) {
+                std::cerr << "Error: Failed to create the program loader's OpenGL context: ";
+                log_last_error_message();
+                return EXIT_FAILURE;
+            }
+
+            const std::unique_ptr<toolbox::RenderWorkerPool> affinity_render_workers = create_render_workers(affinity_display_contexts, affinity_gl_contexts);
+
+            start_render_threads(*affinity_render_workers,
+                [&framebuffers, &color_attachments, &affinity_programs, &affinity_shared_programs](size_t thread_index)
             {
                 if (wglSwapIntervalEXT(1) != TRUE) {
                     std::cerr << "Error: Failed to set swap interval: ";
                     log_last_error_message();
                 }
 
-                affinity_programs[thread_index] = RenderPoints::create_program();
+                RenderPoints::request_program(*affinity_shared_programs, point_grid);
+                affinity_programs[thread_index] = RenderPoints::get_program(*affinity_shared_programs, thread_index, point_grid);
                 create_texture_backed_render_targets(&framebuffers[thread_index], &color_attachments[thread_index], 1, 4096, 4096);
             },
+                nullptr,
                 [framebuffers, color_attachments, &affinity_programs](size_t thread_index)
             {
                 const auto start_time = std::chrono::steady_clock::now();
-                GLuint vao = 0;
+                const GLuint program = affinity_programs[thread_index];
+                RenderContextState context;
+                gl_state_t& gl_state = context.m_gl_state;
 
                 //------------------------------------------------------------------------------
                 // Render frames.
                 for (size_t frame_index = 0; frame_index < (1024 * 16); ++frame_index) {
-                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[thread_index]);
-                    glClearColor(0.0, 0.0, 0.0, 1.0);
+                    gl_state.bind_draw_framebuffer(framebuffers[thread_index]);
+                    gl_state.clear_color(0.0f, 0.0f, 0.0f, 1.0f);
                     glClear(GL_COLOR_BUFFER_BIT);
 
                     //toolbox::OpenGLProgram::validate(programs[thread_index]);
-                    glUseProgram(affinity_programs[thread_index]);
+                    gl_state.use_program(program);
 
-                    RenderPoints::set_rect(rect);
-                    RenderPoints::set_mvp(mvp);
-                    RenderPoints::draw(vao);
+                    scene_state.read_at(frame_index, context.m_scene, &context.m_scene_version);
+
+                    const float* const rect = context.m_scene.m_rect;
+                    const float* const mvp = context.m_scene.m_mvp;
+
+                    context.m_uniforms.begin_frame();
+                    RenderPoints::set_uniforms(gl_state, context.m_uniforms, rect, mvp);
+                    RenderPoints::draw(gl_state, context.m_vao, point_grid, rect, mvp, context.m_points_view.m_viewport, context.m_points_view.m_margin, context.m_points_view.m_ranges);
+                    context.m_uniforms.end_frame();
 
                     glFlush();
                 }
@@ -1195,196 +2384,245 @@ namespace {
                 const auto end_time = std::chrono::steady_clock::now();
                 const auto duration = (end_time - start_time);
 
-                std::cout << "Render thread completed in: " << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << " ms" << std::endl;
+                std::ostringstream report;
+                report << "Render thread completed in: " << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << " ms, "
+                    << gl_state.statistics().m_elided << " of " << gl_state.statistics().m_calls << " state changes elided" << std::endl;
+                std::cout << report.str();
 
                 delete_texture_backed_render_targets(&framebuffers[thread_index], &color_attachments[thread_index], 1);
             });
         }
 
+        const auto tidy = [&]() {
+            shader_watcher.reset();
+            shared_programs.reset();
+
+            std::for_each(begin(gl_contexts), end(gl_contexts), [](HGLRC gl_context) {
+                wglDeleteContext(gl_context);
+            });
+
+            std::for_each(begin(display_contexts), end(display_contexts), [](HDC display_context) {
+                wglDeleteDCNV(display_context);
+            });
+
+            std::for_each(begin(gl_contexts), end(gl_contexts), [](HGLRC gl_context) {
+                wglDeleteContext(gl_context);
+            });
+
+            for (size_t i = 0; i < virtual_screen_monitors.size(); ++i) {
+                if ((wc.style & CS_OWNDC) != CS_OWNDC) {
+                    ReleaseDC(windows[i], display_contexts[i]);
+                }
+
+                DestroyWindow(windows[i]);
+            }
+        };
+
+        //------------------------------------------------------------------------------
+        // Run the scenario matrix instead (if given).
+        if (!scenario_matrix_path.empty()) {
+            const int result = run_scenarios(scenario_matrix_path, display_contexts, gl_contexts, *shared_programs);
+            tidy();
+            return result;
+        }
+
+        if (run_point_grid_sweep) {
+            const int result = run_point_grid_sweeps(display_contexts, gl_contexts, *shared_programs);
+            tidy();
+            return result;
+        }
+
         std::vector<GLuint> programs(display_contexts.size());
         size_t initial_start_time_offset = (1000000 * 2);
         const auto start_time = std::chrono::steady_clock::now();
 
-        start_render_threads(display_contexts, gl_contexts,
-            [&programs](size_t thread_index)
+        toolbox::FrameTimingLog frame_timing_log;
+        frame_timing_log.start(flusher_thread_scheduling);
+
+        //------------------------------------------------------------------------------
+        // Sized to the render threads that will render, created once their setup is
+        // done, as one that failed would never arrive and break the barrier.
+        std::unique_ptr<toolbox::FrameBarrier> frame_barrier;
+
+        startup.begin_phase("render threads");
+
+        std::unique_ptr<toolbox::RenderWorkerPool> render_workers = create_render_workers(display_contexts, gl_contexts);
+        std::vector<int32_t> gpu_numa_nodes(display_contexts.size(), -1);
+
+        start_render_threads(*render_workers,
+            [&programs, &shared_programs, &gpu_numa_nodes](size_t thread_index)
         {
             if (wglSwapIntervalEXT(1) != TRUE) {
                 std::cerr << "Error: Failed to set swap interval: ";
                 log_last_error_message();
             }
 
-            programs[thread_index] = RenderPoints::create_program();
+            programs[thread_index] = RenderPoints::get_program(*shared_programs, thread_index, point_grid);
+            gpu_numa_nodes[thread_index] = current_gpu_numa_node();
         },
-            [&display_contexts, &programs, &start_time, initial_start_time_offset](size_t thread_index)
+            [&render_workers, &gpu_numa_nodes, &frame_timing_log, &frame_barrier](size_t num_ready)
         {
-            constexpr bool LOG_TIMINGS_TO_CONSOLE = false;
-            constexpr bool LOG_TIMINGS_TO_FILE = true;
-
-            size_t start_time_offset = initial_start_time_offset;
-            GLuint vao = 0;
+            startup.end_phase("render threads");
 
-            FILE *f = nullptr;
-
-            if (LOG_TIMINGS_TO_FILE) {
-                char path[] = "D:\\timings_?.tsv";
-                path[11] = ('0' + thread_index);
-                f = fopen(path, "w");
+            if ((frame_barrier_interval > 0) && (num_ready > 0)) {
+                frame_barrier.reset(new toolbox::FrameBarrier(num_ready));
             }
 
             //------------------------------------------------------------------------------
-            // Wait till half a frame before the intended start time, let the wait in the
-            // loop handle the remainder to the first frame (if enabled).
-            std::this_thread::sleep_until(start_time + std::chrono::microseconds(start_time_offset - (1000000 / 120)));
-            auto prev_frame_start_time = std::chrono::steady_clock::now();
-
-            for (size_t frame_index = 0; frame_index < (5 * 60  * 60); ++frame_index) {
-                const auto frame_start_time = std::chrono::steady_clock::now();
-
-                if (LOG_TIMINGS_TO_CONSOLE || LOG_TIMINGS_TO_FILE) {
-                    const auto duration = (frame_start_time - prev_frame_start_time);
-                    prev_frame_start_time = frame_start_time;
-
-                    if (LOG_TIMINGS_TO_CONSOLE && (thread_index == 0)) {
-                        std::cout << "Frame: " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << std::endl;
-                    }
+            // Place the render threads near their GPUs, the main and flusher threads
+            // away from them.
+            if (render_thread_affinity == toolbox::AffinityMode::none) {
+                return;
+            }
 
-                    if (LOG_TIMINGS_TO_FILE && f && (frame_index > 60)) {
-                        fprintf(f, "%ji\t", intmax_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
-                    }
-                }
+            const toolbox::AffinityPlan plan = toolbox::plan_affinity(toolbox::detect_cpu_topology(), gpu_numa_nodes, render_thread_affinity);
+            toolbox::print_affinity_plan(std::cout, plan);
 
-                if ((0)) {
-                    //------------------------------------------------------------------------------
-                    // Start encoding in 1/60 second intervals.
-                    std::this_thread::sleep_until(start_time + std::chrono::microseconds(start_time_offset));
-                    start_time_offset += (1000000 / 60);
-                }
-                else if ((0)) {
-                    //------------------------------------------------------------------------------
-                    // Wait till we are clearly within the frame interval.
-                    if (wglDelayBeforeSwapNV(display_contexts[thread_index], GLfloat(1.0 / 80.0)) != TRUE) {
-                        //std::cout << GetLastError() << std::endl;
-                    }
+            for (size_t thread_index = 0; thread_index < render_workers->size(); ++thread_index) {
+                if (!toolbox::set_thread_affinity(render_workers->native_handle(thread_index), plan.m_render_threads[thread_index])) {
+                    std::cerr << "Error: Failed to set affinity of render thread " << thread_index << ": ";
+                    log_last_error_message();
                 }
+            }
 
-                const auto encode_start_time = std::chrono::steady_clock::now();
-
-                if (LOG_TIMINGS_TO_CONSOLE || LOG_TIMINGS_TO_FILE) {
-                    const auto duration = (encode_start_time - frame_start_time);
+            if (!toolbox::set_current_thread_affinity(plan.m_other_threads) || !toolbox::set_thread_affinity(frame_timing_log.flusher_native_handle(), plan.m_other_threads)) {
+                std::cerr << "Error: Failed to set affinity of main or flusher thread: ";
+                log_last_error_message();
+            }
+        },
+            [&display_contexts, &programs, &shared_programs, &start_time, initial_start_time_offset, &frame_timing_log, &frame_barrier](size_t thread_index)
+        {
+            const toolbox::ScopedThreadScheduling scheduling(render_thread_scheduling);
+            const size_t start_time_offset = initial_start_time_offset;
 
-                    if (LOG_TIMINGS_TO_CONSOLE && (thread_index == 0)) {
-                        std::cout << "Sync: " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << std::endl;
-                    }
+            //------------------------------------------------------------------------------
+            // Create the frame pacer selected for this monitor, pacing to its refresh
+            // rate (if known).
+            toolbox::SteadyClock clock;
+            toolbox::FramePacerConfig pacer_config;
 
-                    if (LOG_TIMINGS_TO_FILE && f && (frame_index > 60)) {
-                        fprintf(f, "%ji\t", intmax_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
-                    }
-                }
+            const int refresh_rate = GetDeviceCaps(display_contexts[thread_index], VREFRESH);
 
-                //------------------------------------------------------------------------------
-                // Encode the frame.
-                if ((1)) {
-                    switch (frame_index % 8) {
-                    case 0:
-                        glEnable(GL_SCISSOR_TEST);
-                        glScissor(0, 256, 2048, 256);
-                        glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
-                        break;
-
-                    case 1:
-                        glEnable(GL_SCISSOR_TEST);
-                        glScissor(0, 512, 2048, 256);
-                        glClearColor(0.0f, 1.0f, 0.0f, 1.0f);
-                        break;
-
-                    case 2:
-                        glEnable(GL_SCISSOR_TEST);
-                        glScissor(0, 768, 2048, 256);
-                        glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
-                        break;
-
-                    case 3:
-                        glEnable(GL_SCISSOR_TEST);
-                        glScissor(0, 64, 2048, 64);
-                        glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
-                        break;
-
-                    case 4:
-                        glEnable(GL_SCISSOR_TEST);
-                        glScissor(0, 128, 2048, 64);
-                        glClearColor(0.0f, 1.0f, 1.0f, 1.0f);
-                        break;
-
-                    case 5:
-                        glEnable(GL_SCISSOR_TEST);
-                        glScissor(0, 192, 2048, 64);
-                        glClearColor(1.0f, 0.0f, 1.0f, 1.0f);
-                        break;
-
-                    default:
-                        glDisable(GL_SCISSOR_TEST);
-                        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-                        break;
-                    }
+            if (refresh_rate > 1) {   // 0 and 1 indicate the hardware default.
+                pacer_config.m_interval = std::chrono::duration_cast<toolbox::Clock::duration>(std::chrono::duration<double>(1.0 / refresh_rate));
+            }
 
-                    glClear(GL_COLOR_BUFFER_BIT);
-                }
+            pacer_config.m_delay_before_swap = [display_context = display_contexts[thread_index]](float seconds) {
+                return (wglDelayBeforeSwapNV(display_context, GLfloat(seconds)) == TRUE);
+            };
 
-                if ((0)) {
-                    toolbox::OpenGLProgram::validate(programs[thread_index]);
-                }
+            const std::string& pacing_mode = frame_pacing_modes[std::min(thread_index, (frame_pacing_modes.size() - 1))];
+            const std::unique_ptr<toolbox::FramePacer> pacer = toolbox::create_frame_pacer(pacing_mode, clock, pacer_config);
 
-                if ((0)) {
-                    glUseProgram(programs[thread_index]);
+            //------------------------------------------------------------------------------
+            // Timings are handed off to the flusher thread, never written from here.
+            toolbox::FrameTimingLog::Channel* timing_channel = nullptr;
 
-                    RenderPoints::set_rect(rect);
-                    RenderPoints::set_mvp(mvp);
-                    RenderPoints::draw(vao);
-                }
+            if (frame_timing_output == FrameTimingOutput::file) {
+                char path[] = "D:\\timings_?.trace";
+                path[11] = ('0' + thread_index);
+                timing_channel = frame_timing_log.open_channel(path, make_frame_trace_header(thread_index, display_contexts[thread_index], start_time));
+            }
 
-                //------------------------------------------------------------------------------
-                // Swap buffers.
-                const auto swap_buffers_start_time = std::chrono::steady_clock::now();
+            FrameEncoder encoder;
+            encoder.m_program = programs[thread_index];
+            encoder.m_programs = shared_programs.get();
+            encoder.m_context_index = thread_index;
+            encoder.m_context.m_points_view = monitor_points_view(thread_index);
+            encoder.m_frame_barrier = frame_barrier.get();
 
-                if (LOG_TIMINGS_TO_CONSOLE || LOG_TIMINGS_TO_FILE) {
-                    const auto duration = (swap_buffers_start_time - encode_start_time);
+            WglSwap swap;
+            swap.m_display_context = display_contexts[thread_index];
 
-                    if (LOG_TIMINGS_TO_CONSOLE && (thread_index == 0)) {
-                        std::cout << "Encode: " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << std::endl;
-                    }
+            //------------------------------------------------------------------------------
+            // Wait till half a frame before the intended start time, let the pacer
+            // handle the remainder to the first frame (if enabled).
+            toolbox::PrecisionWaiter(clock).wait_until(start_time + std::chrono::microseconds(start_time_offset - (1000000 / 120)));
 
-                    if (LOG_TIMINGS_TO_FILE && f && (frame_index > 60)) {
-                        fprintf(f, "%ji\t", intmax_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
-                    }
-                }
+            const auto first_frame_time = (start_time + std::chrono::microseconds(start_time_offset));
+            const size_t num_frames = (5 * 60 * 60);
 
-                SwapBuffers(display_contexts[thread_index]);
+            if (pacing_mode == "free-run") {
+                toolbox::FreeRunPacing pacing;
+                render_frames(thread_index, num_frames, first_frame_time, start_time, pacing, encoder, swap, timing_channel);
+            }
+            else {
+                toolbox::DynamicPacing pacing(*pacer);
+                render_frames(thread_index, num_frames, first_frame_time, start_time, pacing, encoder, swap, timing_channel);
+            }
 
-                if (LOG_TIMINGS_TO_CONSOLE || LOG_TIMINGS_TO_FILE) {
-                    const auto now = std::chrono::steady_clock::now();
-                    const auto duration = (now - swap_buffers_start_time);
+            //------------------------------------------------------------------------------
+            // Report how accurately the pacer woke up (assembled first so the output of
+            // the render threads does not interleave).
+            const toolbox::WakeStatistics& wake_statistics = pacer->wake_statistics();
+
+            if (wake_statistics.count() > 0) {
+                std::ostringstream report;
+                report << std::fixed << std::setprecision(1);
+                report << "Render thread " << thread_index << " pacing (" << pacer->name() << ") wake error [us]:"
+                    << " mean " << (wake_statistics.mean_ns() / 1000.0)
+                    << ", stddev " << (wake_statistics.standard_deviation_ns() / 1000.0)
+                    << ", min " << (wake_statistics.min_ns() / 1000.0)
+                    << ", max " << (wake_statistics.max_ns() / 1000.0)
+                    << ", early " << wake_statistics.early_count() << " of " << wake_statistics.count() << std::endl;
+                std::cout << report.str();
+            }
 
-                    if (LOG_TIMINGS_TO_CONSOLE) {
-                        std::cout << "Swap: " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << std::endl;
-                    }
+            {
+                std::ostringstream report;
+                report << "Render thread " << thread_index << ": " << scheduling.report() << std::endl;
+                report << "Render thread " << thread_index << ": " << encoder.m_context.m_gl_state.statistics().m_elided << " of "
+                    << encoder.m_context.m_gl_state.statistics().m_calls << " state changes elided" << std::endl;
+                report << "Render thread " << thread_index << ": scene version " << encoder.m_context.m_scene_version << " in the last frame" << std::endl;
+
+                if (const auto* const ring = encoder.m_context.m_uniforms.ring()) {
+                    report << "Render thread " << thread_index << ": uniform ring stalled " << ring->statistics().m_stalls << " time(s) in "
+                        << ring->statistics().m_frames << " frames" << std::endl;
+                }
 
-                    if (LOG_TIMINGS_TO_FILE && f && (frame_index > 60)) {
-                        fprintf(f, "%ji\t", intmax_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
-                        fprintf(f, "%ji\n", intmax_t(std::chrono::duration_cast<std::chrono::microseconds>(now - start_time).count()));
-                    }
+                if (encoder.m_program_swapper.m_num_swaps > 0) {
+                    const ProgramSwapper& swapper = encoder.m_program_swapper;
+                    report << "Render thread " << thread_index << ": " << swapper.m_num_swaps << " program swap(s), max "
+                        << std::chrono::duration<double, std::milli>(swapper.m_max_latency).count() << " ms after linking, max "
+                        << std::chrono::duration<double, std::micro>(swapper.m_max_swap_time).count() << " us at the frame boundary" << std::endl;
                 }
+
+                std::cout << report.str();
             }
 
-            if (f) {
-                fclose(f);
+            if (encoder.m_frame_barrier_timeout_frame_index != SIZE_MAX) {
+                std::ostringstream report;
+                report << "Error: Render thread " << thread_index << " frame barrier broken at frame " << encoder.m_frame_barrier_timeout_frame_index << std::endl;
+                std::cerr << report.str();
             }
         });
 
         //------------------------------------------------------------------------------
-        // Main loop driving application window.
+        // Main loop driving application window (and the scene, if animated, paced to
+        // the first monitor).
+        std::unique_ptr<toolbox::ScopedThreadScheduling> main_scheduling(new toolbox::ScopedThreadScheduling(main_thread_scheduling));
         MSG message = {};
 
-        while (try_join_render_threads(10) == false) {
+        const auto first_frame_time = (start_time + std::chrono::microseconds(initial_start_time_offset));
+        const int refresh_rate = GetDeviceCaps(display_contexts[0], VREFRESH);
+        const double frames_per_second = ((refresh_rate > 1) ? double(refresh_rate) : 60.0);
+
+        while (try_join_render_threads(animate_scene ? 0 : 10) == false) {
+            if (animate_scene) {
+                publish_animated_scene(first_frame_time, frames_per_second);
+
+                //------------------------------------------------------------------------------
+                // Handle application window messages, waiting at most a millisecond.
+                MsgWaitForMultipleObjects(0, nullptr, FALSE, 1, QS_ALLINPUT);
+
+                while (PeekMessage(&message, nullptr, 0, 0, PM_REMOVE)) {
+                    TranslateMessage(&message);
+                    DispatchMessage(&message);
+                }
+
+                continue;
+            }
+
             //------------------------------------------------------------------------------
             // Handle application window messages.
             GetMessage(&message, nullptr, 0, 0);
@@ -1395,28 +2633,39 @@ namespace {
         //------------------------------------------------------------------------------
         // Wait for all render threads to terminate.
         join_render_threads();
+        render_workers.reset();
+        frame_timing_log.stop();
 
-        //------------------------------------------------------------------------------
-        // Tidy.
-        std::for_each(begin(gl_contexts), end(gl_contexts), [](HGLRC gl_context) {
-            wglDeleteContext(gl_context);
-        });
+        std::cout << "Frame timing log flusher: " << frame_timing_log.flusher_report() << std::endl;
+        std::cout << "Main thread: " << main_scheduling->report() << std::endl;
+        main_scheduling.reset();
 
-        std::for_each(begin(display_contexts), end(display_contexts), [](HDC display_context) {
-            wglDeleteDCNV(display_context);
-        });
+        std::cout << std::endl;
+        startup.print_timeline(std::cout);
+        std::cout << "Time to first frame: " << startup.time_to("first frame").count() << " ms" << std::endl << std::endl;
 
-        std::for_each(begin(gl_contexts), end(gl_contexts), [](HGLRC gl_context) {
-            wglDeleteContext(gl_context);
-        });
+        const toolbox::OpenGLProgramCache::statistics_t program_cache_statistics = program_cache().statistics();
 
-        for (size_t i = 0; i < virtual_screen_monitors.size(); ++i) {
-            if ((wc.style & CS_OWNDC) != CS_OWNDC) {
-                ReleaseDC(windows[i], display_contexts[i]);
-            }
+        std::cout << "Program cache: " << program_cache_statistics.hits << " hit(s), "
+            << program_cache_statistics.misses << " miss(es), "
+            << program_cache_statistics.invalidations << " invalidation(s), "
+            << program_cache_statistics.stores << " store(s), "
+            << program_cache_statistics.reflections << " program(s) introspected" << std::endl;
 
-            DestroyWindow(windows[i]);
-        }
+        const program_registry_t::Statistics program_registry_statistics = shared_programs->statistics();
+
+        std::cout << "Program registry: " << program_registry_statistics.m_compiles << " program(s) compiled for "
+            << program_registry_statistics.m_requests << " request(s), "
+            << program_registry_statistics.m_failures << " failure(s), "
+            << program_registry_statistics.m_reflections << " reflection(s), "
+            << program_registry_statistics.m_reloads << " reload(s), "
+            << program_registry_statistics.m_reload_failures << " failed reload(s)" << std::endl << std::endl;
+
+        write_program_statistics(std::cout, shared_programs->program_statistics());
+
+        //------------------------------------------------------------------------------
+        // Tidy.
+        tidy();
 
         //------------------------------------------------------------------------------
         // ...
@@ -1431,11 +2680,166 @@ namespace {
 int
 main(int argc, char* argv[])
 {
-    windows();
-    std::cout << std::endl;
-    nvapi();
-    std::cout << std::endl;
-    directx();
+    //------------------------------------------------------------------------------
+    // Parse options.
+    static const char PACING_OPTION[] = "--pacing=";
+    static const char BARRIER_OPTION[] = "--barrier=";
+    static const char AFFINITY_OPTION[] = "--affinity=";
+    static const char SCHEDULING_OPTION[] = "--scheduling=";
+    static const char WORKLOAD_OPTION[] = "--workload=";
+    static const char POINTS_OPTION[] = "--points=";
+    static const char TIMINGS_OPTION[] = "--timings=";
+    static const char SCENARIOS_OPTION[] = "--scenarios=";
+    static const char TOPOLOGY_SNAPSHOT_OPTION[] = "--topology-snapshot=";
+    static const char SHADERS_OPTION[] = "--shaders=";
+    const std::vector<std::string> frame_pacer_names = toolbox::frame_pacer_names();
+
+    for (int i = 1; i < argc; ++i) {
+        bool is_valid = false;
+
+        if (strncmp(argv[i], PACING_OPTION, (sizeof(PACING_OPTION) - 1)) == 0) {
+            std::istringstream modes(argv[i] + (sizeof(PACING_OPTION) - 1));
+            std::string mode;
+
+            frame_pacing_modes.clear();
+            is_valid = true;
+
+            while (std::getline(modes, mode, ',')) {
+                is_valid &= (std::find(begin(frame_pacer_names), end(frame_pacer_names), mode) != end(frame_pacer_names));
+                frame_pacing_modes.push_back(mode);
+            }
+
+            is_valid &= !frame_pacing_modes.empty();
+        }
+        else if (strncmp(argv[i], BARRIER_OPTION, (sizeof(BARRIER_OPTION) - 1)) == 0) {
+            char* end = nullptr;
+            frame_barrier_interval = size_t(strtoul(argv[i] + (sizeof(BARRIER_OPTION) - 1), &end, 10));
+            is_valid = ((end != nullptr) && (*end == '\0'));
+        }
+        else if (strncmp(argv[i], AFFINITY_OPTION, (sizeof(AFFINITY_OPTION) - 1)) == 0) {
+            try {
+                render_thread_affinity = toolbox::affinity_mode_from_name(argv[i] + (sizeof(AFFINITY_OPTION) - 1));
+                is_valid = true;
+            }
+            catch (std::exception&) {
+            }
+        }
+        else if (strncmp(argv[i], WORKLOAD_OPTION, (sizeof(WORKLOAD_OPTION) - 1)) == 0) {
+            try {
+                frame_workload = toolbox::workload_from_string(argv[i] + (sizeof(WORKLOAD_OPTION) - 1));
+                is_valid = true;
+            }
+            catch (std::exception&) {
+            }
+        }
+        else if (strncmp(argv[i], POINTS_OPTION, (sizeof(POINTS_OPTION) - 1)) == 0) {
+            try {
+                point_grid = toolbox::point_grid_from_string(argv[i] + (sizeof(POINTS_OPTION) - 1));
+                is_valid = true;
+            }
+            catch (std::exception&) {
+            }
+        }
+        else if (strcmp(argv[i], "--points-sweep") == 0) {
+            run_point_grid_sweep = true;
+            is_valid = true;
+        }
+        else if (strncmp(argv[i], TIMINGS_OPTION, (sizeof(TIMINGS_OPTION) - 1)) == 0) {
+            const std::string output = (argv[i] + (sizeof(TIMINGS_OPTION) - 1));
+            is_valid = true;
+
+            if (output == "none") {
+                frame_timing_output = FrameTimingOutput::none;
+            }
+            else if (output == "file") {
+                frame_timing_output = FrameTimingOutput::file;
+            }
+            else if (output == "console") {
+                frame_timing_output = FrameTimingOutput::console;
+            }
+            else {
+                is_valid = false;
+            }
+        }
+        else if (strncmp(argv[i], SCENARIOS_OPTION, (sizeof(SCENARIOS_OPTION) - 1)) == 0) {
+            scenario_matrix_path = (argv[i] + (sizeof(SCENARIOS_OPTION) - 1));
+            is_valid = !scenario_matrix_path.empty();
+        }
+        else if (strncmp(argv[i], TOPOLOGY_SNAPSHOT_OPTION, (sizeof(TOPOLOGY_SNAPSHOT_OPTION) - 1)) == 0) {
+            display_topology_snapshot_path = (argv[i] + (sizeof(TOPOLOGY_SNAPSHOT_OPTION) - 1));
+            is_valid = true;
+        }
+        else if (strncmp(argv[i], SHADERS_OPTION, (sizeof(SHADERS_OPTION) - 1)) == 0) {
+            shader_directory = (argv[i] + (sizeof(SHADERS_OPTION) - 1));
+            is_valid = !shader_directory.empty();
+        }
+        else if (strcmp(argv[i], "--animate") == 0) {
+            animate_scene = true;
+            is_valid = true;
+        }
+        else if (strcmp(argv[i], "--offscreen-benchmark") == 0) {
+            run_offscreen_benchmark = true;
+            is_valid = true;
+        }
+        else if (strncmp(argv[i], SCHEDULING_OPTION, (sizeof(SCHEDULING_OPTION) - 1)) == 0) {
+            std::istringstream roles(argv[i] + (sizeof(SCHEDULING_OPTION) - 1));
+            std::string role;
+
+            is_valid = true;
+
+            while (std::getline(roles, role, ',')) {
+                const size_t colon = role.find(':');
+                const std::string name = role.substr(0, colon);
+                toolbox::SchedulingConfig* const config = ((name == "render") ? &render_thread_scheduling :
+                                                           (name == "flusher") ? &flusher_thread_scheduling :
+                                                           (name == "main") ? &main_thread_scheduling : nullptr);
+
+                try {
+                    is_valid &= ((config != nullptr) && (colon != std::string::npos));
+
+                    if (is_valid) {
+                        *config = toolbox::scheduling_config_from_string(role.substr(colon + 1));
+                    }
+                }
+                catch (std::exception&) {
+                    is_valid = false;
+                }
+            }
+        }
+
+        if (!is_valid) {
+            std::cerr << "Usage: TestMultiGpuMultiMonitor [--pacing=<mode>[,<mode>...]] [--barrier=<frames>] [--affinity=<mode>] [--scheduling=<role>:<policy>[,...]]" << std::endl;
+            std::cerr << "                                [--workload=<workload>[+<workload>...]] [--timings=none|file|console] [--offscreen-benchmark] [--scenarios=<matrix>]" << std::endl;
+            std::cerr << "                                [--points=<grid>] [--points-sweep] [--animate] [--shaders=<dir>] [--topology-snapshot=<path>]" << std::endl;
+            std::cerr << "  Pacing modes (one per monitor, the last applies to all remaining):";
+
+            for (const std::string& name : frame_pacer_names) {
+                std::cerr << " " << name;
+            }
+
+            std::cerr << std::endl;
+            std::cerr << "  Barrier: lock-step all render threads before swapping every <frames> frames, 0 (default) disables." << std::endl;
+            std::cerr << "  Affinity modes (placement of render threads relative to their GPUs):";
+
+            for (const std::string& name : toolbox::affinity_mode_names()) {
+                std::cerr << " " << name;
+            }
+
+            std::cerr << std::endl;
+            std::cerr << "  Scheduling: per role (render, flusher, main) normal, fifo[:<priority>] or rr[:<priority>]." << std::endl;
+            std::cerr << "  Workloads: none, clear, scissor-clear (default), points, validate." << std::endl;
+            std::cerr << "  Points: <columns>x<rows>[:<point size>][:flat|uv|vignette] drawn by the points workload (1024x1024:1:vignette by default)." << std::endl;
+            std::cerr << "  Points sweep: find the largest grid of the point size and shading each monitor sustains at its refresh rate instead." << std::endl;
+            std::cerr << "  Animate: rotate the points from the main thread, published to the render threads for the frame they are at." << std::endl;
+            std::cerr << "  Shaders: load points.vert and points.frag from the directory (see shaders/) and reload them when they change." << std::endl;
+            std::cerr << "  Timings: per frame timings to a trace per monitor (file, default), of the first monitor to the console or none." << std::endl;
+            std::cerr << "  Scenarios: run the scenario matrix in the given file on all monitors and print the results instead." << std::endl;
+            std::cerr << "  Topology snapshot: display topology cached between runs (TestMultiGpuMultiMonitor.topology by default), empty to always enumerate." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    display_topology();
     std::cout << std::endl;
     opengl();
 
@@ -0,0 +1,26 @@
+#version 410
+
+// See points.vert. The vignette's factor and exponent may be defined before
+// the defaults here.
+
+#if !defined(POINT_VIGNETTE_FACTOR)
+#define POINT_VIGNETTE_FACTOR 36.0
+#endif
+#if !defined(POINT_VIGNETTE_EXPONENT)
+#define POINT_VIGNETTE_EXPONENT 4.0
+#endif
+
+in vec2 v_uv;
+out vec4 f_color;
+
+void main() {
+#if defined(POINT_UV_COLOR)
+    vec3 color = vec3(v_uv.rg, 0.0);
+#else
+    vec3 color = vec3(0.8, 0.8, 0.8);
+#endif
+#if defined(POINT_VIGNETTE)
+    color *= pow(clamp(((v_uv.x * (1.0 - v_uv.x)) * (v_uv.y * (1.0 - v_uv.y)) * POINT_VIGNETTE_FACTOR), 0.0, 1.0), POINT_VIGNETTE_EXPONENT);
+#endif
+    f_color = vec4(color, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 410
+
+// Loaded with --shaders=<dir> and reloaded on change. POINT_GRID_COLUMNS,
+// POINT_GRID_ROWS, POINT_SIZE and those of the features (POINT_UV_COLOR,
+// POINT_VIGNETTE) are defined after the #version line to match the variant
+// (see point_shader_with_defines()).
+
+layout(std140) uniform PointGridFrame {
+    vec4 u_rect;
+    mat4 u_mvp;
+};
+
+out vec2 v_uv;
+
+void main() {
+    int x = (gl_VertexID % POINT_GRID_COLUMNS);
+    int y = (gl_VertexID / POINT_GRID_COLUMNS);
+    vec2 uv = (vec2(x, y) * vec2((1.0 / float(POINT_GRID_COLUMNS - 1)), (1.0 / float(POINT_GRID_ROWS - 1))));
+    gl_Position = (u_mvp * vec4((u_rect.xy + (uv * u_rect.zw)), 0.0, 1.0));
+    gl_PointSize = float(POINT_SIZE);
+    v_uv = vec2(uv.x, uv.y);
+}